@@ -11,6 +11,7 @@
 
 #include "pytorch_blade/common_utils/tempfs.h"
 
+#include <sys/syscall.h>
 #include <unistd.h>
 
 #include <fstream>
@@ -55,6 +56,31 @@ std::vector<char> make_filename(std::string name_prefix) {
 
   return filename;
 }
+
+bool WriteBytesToFd(
+    int fd,
+    const std::string& bytes,
+    const std::string& fname) {
+  ssize_t left_len = bytes.length();
+  const char* data = bytes.data();
+  errno = 0;
+  while (left_len > 0) {
+    auto sz = ::write(fd, data, left_len);
+    if (sz <= 0) {
+      if (errno != EINTR && errno != EAGAIN) {
+        LOG(ERROR) << "Failed to write content to file: " << fname
+                   << ", error: " << strerror(errno);
+        return false;
+      }
+      errno = 0;
+      continue;
+    }
+    left_len -= sz;
+    data += sz;
+  }
+
+  return true;
+}
 } // namespace
 
 TempFile::TempFile(std::string prefix) : fname_(""), fd_(-1) {
@@ -77,25 +103,7 @@ TempFile::~TempFile() {
 }
 
 bool TempFile::WriteBytesToFile(const std::string& bytes) {
-  ssize_t left_len = bytes.length();
-  const char* data = bytes.data();
-  errno = 0;
-  while (left_len > 0) {
-    auto sz = ::write(fd_, data, left_len);
-    if (sz <= 0) {
-      if (errno != EINTR && errno != EAGAIN) {
-        LOG(ERROR) << "Failed to write content to temp file: " << GetFilename()
-                   << ", error: " << strerror(errno);
-        return false;
-      }
-      errno = 0;
-      continue;
-    }
-    left_len -= sz;
-    data += sz;
-  }
-
-  return true;
+  return WriteBytesToFd(fd_, bytes, GetFilename());
 }
 
 const std::string& TempFile::GetFilename() const {
@@ -117,5 +125,39 @@ std::string TempFile::ReadStringFromFile() {
       std::istreambuf_iterator<char>());
   return str;
 }
+
+MemoryFile::MemoryFile(std::string name) : fname_(""), fd_(-1) {
+#ifdef SYS_memfd_create
+  // MFD_CLOEXEC, which is not defined by old system headers.
+  const unsigned int kMfdCloexec = 0x0001U;
+  fd_ = ::syscall(SYS_memfd_create, name.c_str(), kMfdCloexec);
+#else
+  errno = ENOSYS;
+#endif // SYS_memfd_create
+  if (fd_ < 0) {
+    LOG(WARNING) << "Failed to create memory file: " << name
+                 << ", error: " << std::strerror(errno);
+    return;
+  }
+  fname_ = "/proc/self/fd/" + std::to_string(fd_);
+}
+
+MemoryFile::~MemoryFile() {
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+}
+
+bool MemoryFile::IsValid() const {
+  return fd_ >= 0;
+}
+
+bool MemoryFile::WriteBytesToFile(const std::string& bytes) {
+  return IsValid() && WriteBytesToFd(fd_, bytes, GetFilename());
+}
+
+const std::string& MemoryFile::GetFilename() const {
+  return fname_;
+}
 } // namespace blade
 } // namespace torch
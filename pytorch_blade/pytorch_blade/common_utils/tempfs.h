@@ -40,5 +40,28 @@ class TempFile {
   std::string fname_;
   int fd_;
 };
+
+/// A file living in memory only (see memfd_create(2)), which is freed once
+/// closed, e.g. to dlopen a library without touching the disk.
+class MemoryFile {
+ public:
+  MemoryFile(std::string name = "");
+  ~MemoryFile();
+  DISALLOW_COPY_AND_ASSIGN(MemoryFile);
+
+  /// Return false if memory files are not supported, e.g. on Linux < 3.17.
+  bool IsValid() const;
+
+  /// Write bytes content to the file and return true on success.
+  bool WriteBytesToFile(const std::string& bytes);
+
+  /// Get the path of the file under /proc/self/fd, which is valid as long as
+  /// the MemoryFile is alive.
+  const std::string& GetFilename() const;
+
+ private:
+  std::string fname_;
+  int fd_;
+};
 } // namespace blade
 } // namespace torch
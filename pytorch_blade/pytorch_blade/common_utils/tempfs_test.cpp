@@ -15,6 +15,7 @@
 
 #include "pytorch_blade/common_utils/tempfs.h"
 
+using torch::blade::MemoryFile;
 using torch::blade::TempFile;
 
 TEST(Tempfs, TestNormal) {
@@ -42,3 +43,18 @@ TEST(Tempfs, TestNormal) {
   std::ifstream f(fname);
   ASSERT_FALSE(f.good()); // tempfile not still acessable
 }
+
+TEST(Tempfs, TestMemoryFile) {
+  MemoryFile mem_file("TheName");
+  if (!mem_file.IsValid()) {
+    return; // memfd_create is not supported
+  }
+  ASSERT_TRUE(mem_file.GetFilename().find("/proc/self/fd/") == 0);
+  std::string payload("hello, I'am the payload.");
+  ASSERT_TRUE(mem_file.WriteBytesToFile(payload));
+
+  std::ifstream f(mem_file.GetFilename(), std::ios::binary);
+  std::string loaded_bytes(
+      (std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+  ASSERT_EQ(payload, loaded_bytes);
+}
@@ -13,6 +13,7 @@
 
 #include <torch/csrc/jit/serialization/pickle.h>
 #include <algorithm>
+#include <cerrno>
 #include <cstdlib>
 #include <string>
 
@@ -120,6 +121,23 @@ double ReadDoubleFromEnvVar(const char* env_var_name, double default_val) {
   return default_val;
 }
 
+int64_t ReadInt64FromEnvVar(const char* env_var_name, int64_t default_val) {
+  const char* env_var_val = std::getenv(env_var_name);
+  if (env_var_val == nullptr) {
+    return default_val;
+  }
+  char* end = nullptr;
+  errno = 0;
+  long long value = std::strtoll(env_var_val, &end, 10);
+  if (end == env_var_val || *end != '\0' || errno == ERANGE) {
+    LOG(ERROR) << "Failed to parse the env-var ${" << env_var_name
+               << "} into int64: " << env_var_val
+               << ". Use the default value: " << default_val;
+    return default_val;
+  }
+  return value;
+}
+
 std::string ReadStringFromEnvVar(
     const char* env_var_name,
     std::string default_val) {
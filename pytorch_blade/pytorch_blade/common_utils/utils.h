@@ -36,6 +36,7 @@ std::vector<std::string> StrSplit(const std::string& str, char delim);
 namespace env {
 bool ReadBoolFromEnvVar(const char* env_var_name, bool default_val);
 double ReadDoubleFromEnvVar(const char* env_var_name, double default_val);
+int64_t ReadInt64FromEnvVar(const char* env_var_name, int64_t default_val);
 std::string ReadStringFromEnvVar(
     const char* env_var_name,
     std::string default_val);
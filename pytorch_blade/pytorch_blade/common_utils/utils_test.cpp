@@ -36,3 +36,17 @@ TEST(DumpIValues, TestDumpIValues) {
   auto ivalue = torch::jit::pickle_load(load_input);
   EXPECT_TRUE(ivalue.isTensor());
 }
+
+TEST(ReadInt64FromEnvVar, TestReadInt64FromEnvVar) {
+  using torch::blade::env::ReadInt64FromEnvVar;
+  unsetenv("TORCH_BLADE_TEST_INT64_ENV");
+  EXPECT_EQ(ReadInt64FromEnvVar("TORCH_BLADE_TEST_INT64_ENV", 3), 3);
+  setenv("TORCH_BLADE_TEST_INT64_ENV", "4", 1);
+  EXPECT_EQ(ReadInt64FromEnvVar("TORCH_BLADE_TEST_INT64_ENV", 3), 4);
+  // Not an integer, use the default value.
+  setenv("TORCH_BLADE_TEST_INT64_ENV", "4.5", 1);
+  EXPECT_EQ(ReadInt64FromEnvVar("TORCH_BLADE_TEST_INT64_ENV", 3), 3);
+  setenv("TORCH_BLADE_TEST_INT64_ENV", "", 1);
+  EXPECT_EQ(ReadInt64FromEnvVar("TORCH_BLADE_TEST_INT64_ENV", 3), 3);
+  unsetenv("TORCH_BLADE_TEST_INT64_ENV");
+}
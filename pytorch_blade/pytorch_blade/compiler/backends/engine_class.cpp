@@ -11,6 +11,9 @@
 
 #include "pytorch_blade/compiler/backends/engine_class.h"
 
+#include <ATen/Parallel.h>
+#include <c10/core/DeviceGuard.h>
+#include <c10/core/impl/DeviceGuardImplInterface.h>
 #include <torch/script.h>
 #include "pytorch_blade/common_utils/logging.h"
 #include "pytorch_blade/common_utils/utils.h"
@@ -23,6 +26,21 @@ namespace backends {
 namespace {
 using namespace at;
 
+// One of `eager`, `lazy` and `async`, see EngineClass::Prefetch.
+std::string GetEngineInitMode() {
+  static std::string mode = []() {
+    auto mode =
+        env::ReadStringFromEnvVar("TORCH_BLADE_ENGINE_INIT_MODE", "eager");
+    if (mode != "eager" && mode != "lazy" && mode != "async") {
+      LOG(WARNING) << "Unknown TORCH_BLADE_ENGINE_INIT_MODE: " << mode
+                   << ", fallback to eager";
+      mode = "eager";
+    }
+    return mode;
+  }();
+  return mode;
+}
+
 bool allClose(
     const at::Tensor& t1,
     const at::Tensor& t2,
@@ -47,13 +65,55 @@ const char* kOrigSubG = "module_graph";
 const char* kFallbackModule = "fallback_module";
 
 EngineClass::EngineClass(SerialType serialized) {
-  const auto& engine_state =
-      EngineState::Deserialize(std::move(std::get<0>(serialized)));
-  engine_ = EngineInterface::CreateEngine(engine_state);
-  TORCH_CHECK(engine_, "Create Engine failed!");
-
+  engine_state_.reset(new EngineState(
+      EngineState::Deserialize(std::move(std::get<0>(serialized)))));
   attr_dict_ = std::move(std::get<1>(serialized));
   attr_debug_name_ = std::move(GetAttrString(kDebugName));
+  if (GetEngineInitMode() == "eager") {
+    Initialize();
+  }
+}
+
+std::shared_ptr<EngineInterface> EngineClass::GetEngine() {
+  std::call_once(engine_created_, [&]() {
+    // The state is only released here, thus it's safe to read it unlocked.
+    auto engine = EngineInterface::CreateEngine(*engine_state_);
+    TORCH_CHECK(engine, "Create Engine failed!");
+    std::lock_guard<std::mutex> guard(engine_mutex_);
+    engine_ = engine;
+    engine_state_.reset();
+  });
+  return engine_;
+}
+
+void EngineClass::Prefetch(const c10::intrusive_ptr<EngineClass>& self) {
+  if (self->engine_prefetched_.exchange(true)) {
+    return;
+  }
+  // Engines bind the current device on creation, e.g. DiscEngine.
+  c10::optional<c10::Device> device;
+  if (at::hasCUDA()) {
+    device = c10::impl::getDeviceGuardImpl(c10::kCUDA)->getDevice();
+  }
+  at::launch([self, device]() {
+    c10::OptionalDeviceGuard guard(device);
+    try {
+      self->GetEngine();
+    } catch (const std::exception& error) {
+      // Raised again on first use.
+      LOG(WARNING) << "Failed to prefetch engine " << self->attr_debug_name_
+                   << ": " << error.what();
+    }
+  });
+}
+
+bool EngineClass::IsReady() const {
+  std::lock_guard<std::mutex> guard(engine_mutex_);
+  return engine_ != nullptr;
+}
+
+void EngineClass::Initialize() {
+  GetEngine();
 }
 
 at::List<at::Tensor> EngineClass::Fallback(const at::List<at::Tensor>& inputs) {
@@ -68,7 +128,9 @@ at::List<at::Tensor> EngineClass::Fallback(const at::List<at::Tensor>& inputs) {
   return ret.toTensorList();
 }
 
-at::List<at::Tensor> EngineClass::Execute(const at::List<at::Tensor>& inputs) {
+at::List<at::Tensor> EngineClass::Execute(
+    const at::List<at::Tensor>& inputs,
+    const at::List<at::Tensor>& provided_outputs) {
   if (GetRecordClusterIOFlag()) {
     // Note:
     // This is for accuracy debug & testing purpose, not recommend
@@ -114,7 +176,8 @@ at::List<at::Tensor> EngineClass::Execute(const at::List<at::Tensor>& inputs) {
   const auto& enable_error_fallback =
       env::ReadBoolFromEnvVar("TORCH_BLADE_DEBUG_ENABLE_ERROR_FALLBACK", false);
 
-  if (engine_->ShouldFallback(inputs)) {
+  auto engine = GetEngine();
+  if (engine->ShouldFallback(inputs)) {
     outputs = Fallback(inputs);
   } else {
     try {
@@ -123,7 +186,9 @@ at::List<at::Tensor> EngineClass::Execute(const at::List<at::Tensor>& inputs) {
       bool in_regular_state =
           !(enable_error_fallback && should_error_fallback_);
       if (in_regular_state) {
-        outputs = engine_->Execute(inputs);
+        outputs = provided_outputs.empty()
+            ? engine->Execute(inputs)
+            : engine->Execute(inputs, provided_outputs);
       }
       if (enable_error_fallback) {
         // DEBUG MODE!!!
@@ -198,8 +263,10 @@ void EngineClass::DumpAttrToFile(
 }
 
 void EngineClass::DumpModelProto(const std::string& dump_file) const {
+  std::lock_guard<std::mutex> guard(engine_mutex_);
+  const auto& state = engine_ ? engine_->GetState() : *engine_state_;
   std::ofstream writer(dump_file);
-  writer << engine_->GetState().model_proto;
+  writer << state.model_proto;
   writer.close();
 }
 
@@ -246,13 +313,18 @@ EngineClass::SerialType EngineClass::Serialize(
 }
 
 EngineClass::SerialType EngineClass::Serialize() {
-  return std::make_tuple(
-      std::move(engine_->GetState().Serialize()), attr_dict_);
+  std::lock_guard<std::mutex> guard(engine_mutex_);
+  const auto& state = engine_ ? engine_->GetState() : *engine_state_;
+  return std::make_tuple(std::move(state.Serialize()), attr_dict_);
 }
 
 c10::intrusive_ptr<EngineClass> EngineClass::Deserialize(
     SerialType serialized) {
-  return c10::make_intrusive<EngineClass>(std::move(serialized));
+  auto engine = c10::make_intrusive<EngineClass>(std::move(serialized));
+  if (GetEngineInitMode() == "async") {
+    Prefetch(engine);
+  }
+  return engine;
 }
 
 bool InitTorchBladeEngine() {
@@ -291,6 +363,13 @@ bool InitTorchBladeEngine() {
                    at::List<at::Tensor> inputs) {
                   return self->Execute(inputs);
                 })
+            .def(
+                "execute_with_outputs",
+                [](const c10::intrusive_ptr<EngineClass>& self,
+                   at::List<at::Tensor> inputs,
+                   at::List<at::Tensor> outputs) {
+                  return self->Execute(inputs, outputs);
+                })
             // The following four lines expose methods of the
             // MyStackClass<std::string> class as-is. `torch::class_` will
             // automatically examine the argument and return types of the
@@ -303,6 +382,13 @@ bool InitTorchBladeEngine() {
             .def("get_attr_string", &EngineClass::GetAttrString)
             .def("get_attr_keys", &EngineClass::GetAttrKeys)
             .def("last_inputs", &EngineClass::last_inputs)
+            .def(
+                "prefetch",
+                [](const c10::intrusive_ptr<EngineClass>& self) {
+                  EngineClass::Prefetch(self);
+                })
+            .def("is_ready", &EngineClass::IsReady)
+            .def("initialize", &EngineClass::Initialize)
             .def("last_outputs", &EngineClass::last_outputs)
             // class_<>::def_pickle allows you to define the serialization
             // and deserialization methods for your C++ class.
@@ -11,6 +11,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <fstream>
 #include <mutex>
 #include <tuple>
@@ -50,12 +51,29 @@ class EngineClass : public torch::CustomClassHolder {
   DISALLOW_COPY_AND_ASSIGN(EngineClass);
 
   EngineClass(SerialType serialized);
-  at::List<at::Tensor> Execute(const at::List<at::Tensor>& inputs);
+  // The results are written into `provided_outputs` where possible, see
+  // EngineInterface::Execute.
+  at::List<at::Tensor> Execute(
+      const at::List<at::Tensor>& inputs,
+      const at::List<at::Tensor>& provided_outputs = {});
   void DumpAttrToFile(const std::string&, const std::string& dump_file) const;
   void DumpModelProto(const std::string& dump_file) const;
   std::string GetAttrString(const std::string&) const;
   std::vector<std::string> GetAttrKeys() const;
 
+  // By default the engine is created on construction. It is created on first
+  // use instead if `TORCH_BLADE_ENGINE_INIT_MODE` is `lazy`, or in the
+  // background once deserialized if it is `async`, thus a module with many
+  // engines is loaded without initializing them serially.
+  //
+  // Starts creating the engine in the inter-op thread pool if not yet, which
+  // lets the engines of a module be initialized in parallel.
+  static void Prefetch(const c10::intrusive_ptr<EngineClass>& self);
+  // Returns true if the engine has been created.
+  bool IsReady() const;
+  // Creates the engine if not yet, waits for it if being created.
+  void Initialize();
+
   SerialType Serialize();
   static c10::intrusive_ptr<EngineClass> Deserialize(
       EngineClass::SerialType serialized);
@@ -72,11 +90,18 @@ class EngineClass : public torch::CustomClassHolder {
  private:
   torch::jit::Module GetFallback();
   at::List<at::Tensor> Fallback(const at::List<at::Tensor>& inputs);
+  std::shared_ptr<EngineInterface> GetEngine();
 
   std::once_flag fallback_loaded_;
   std::string attr_debug_name_;
   AttrDictType attr_dict_;
   c10::intrusive_ptr<c10::ivalue::Object> fallback_module_;
+  std::once_flag engine_created_;
+  std::atomic<bool> engine_prefetched_{false};
+  // Guards `engine_` and `engine_state_`. The state is released once the
+  // engine, which holds a copy of it, is created.
+  mutable std::mutex engine_mutex_;
+  std::unique_ptr<EngineState> engine_state_;
   std::shared_ptr<EngineInterface> engine_;
   at::List<at::Tensor> last_inputs_;
   at::List<at::Tensor> last_outputs_;
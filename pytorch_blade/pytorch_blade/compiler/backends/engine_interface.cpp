@@ -104,6 +104,31 @@ const EngineCreatorRegister& EngineCreatorRegister::RegisterBackend(
   return *this;
 }
 
+bool IsReusableOutput(
+    const at::Tensor& output,
+    at::IntArrayRef sizes,
+    const at::TensorOptions& options) {
+  return output.defined() && output.is_contiguous() &&
+      output.sizes() == sizes &&
+      output.scalar_type() == c10::typeMetaToScalarType(options.dtype()) &&
+      output.device() == options.device();
+}
+
+at::List<at::Tensor> EngineInterface::Execute(
+    const at::List<at::Tensor>& inputs,
+    const at::List<at::Tensor>& outputs) {
+  auto results = Execute(inputs);
+  for (size_t k = 0; k < results.size() && k < outputs.size(); ++k) {
+    at::Tensor result = results[k];
+    at::Tensor output = outputs[k];
+    if (IsReusableOutput(output, result.sizes(), result.options())) {
+      output.copy_(result);
+      results.set(k, output);
+    }
+  }
+  return results;
+}
+
 std::shared_ptr<EngineInterface> EngineInterface::CreateEngine(
     const EngineState& state) {
   return EngineCreatorRegistry::GetRegistry().CreateEngine(state);
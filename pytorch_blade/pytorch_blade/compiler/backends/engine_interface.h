@@ -50,6 +50,13 @@ struct EngineState {
   static EngineState Deserialize(const SerialType& serialized);
 };
 
+// Returns true if the results of an output of `sizes` and `options` can be
+// written into `output`, a tensor provided by the caller.
+bool IsReusableOutput(
+    const at::Tensor& output,
+    at::IntArrayRef sizes,
+    const at::TensorOptions& options);
+
 class EngineInterface {
  public:
   // The State is used by [de]serialization.
@@ -66,6 +73,16 @@ class EngineInterface {
 
   virtual at::List<at::Tensor> Execute(const at::List<at::Tensor>& inputs) = 0;
 
+  // Same as above, but writes the results into `outputs`, the tensors
+  // preallocated by the caller, where possible. A provided tensor is returned
+  // as the output if it is contiguous and has the shape, dtype and device of
+  // the output, otherwise a new tensor is returned instead. `outputs` may
+  // have fewer tensors than the engine outputs. The default implementation
+  // copies the results into the provided tensors.
+  virtual at::List<at::Tensor> Execute(
+      const at::List<at::Tensor>& inputs,
+      const at::List<at::Tensor>& outputs);
+
   virtual bool ShouldFallback(const at::List<at::Tensor>& inputs) {
     return false;
   }
@@ -32,6 +32,9 @@ class DiscEngine : public torch::blade::backends::EngineInterface {
   DiscEngine(const State& state);
 
   at::List<at::Tensor> Execute(const at::List<at::Tensor>& inputs) override;
+  at::List<at::Tensor> Execute(
+      const at::List<at::Tensor>& inputs,
+      const at::List<at::Tensor>& outputs) override;
 
   const State& GetState() const {
     return *engine_state_;
@@ -70,6 +73,14 @@ at::List<at::Tensor> DiscEngine::Execute(const at::List<at::Tensor>& inputs) {
   return engine_ctx->Execute(inputs);
 }
 
+at::List<at::Tensor> DiscEngine::Execute(
+    const at::List<at::Tensor>& inputs,
+    const at::List<at::Tensor>& outputs) {
+  auto engine_ctx = FetchRalContext();
+  CHECK_NOTNULL(engine_ctx);
+  return engine_ctx->Execute(inputs, outputs);
+}
+
 // FetchRalContext guarantee to return an effective engine_ctx_
 std::shared_ptr<RalContext> DiscEngine::FetchRalContext() {
   // Note: we use lock_guard(mutex) since the multi-threads collision with low
@@ -13,6 +13,11 @@
 
 #include <dlfcn.h>
 
+#include <atomic>
+#include <sstream>
+#include <unordered_map>
+
+#include <ATen/MemoryOverlap.h>
 #include <c10/core/CPUAllocator.h>
 #if PYTORCH_MAJOR_VERSION == 1 && PYTORCH_MINOR_VERSION >= 12
 #include <c10/core/impl/alloc_cpu.h>
@@ -61,6 +66,12 @@ class RalAllocator : public tao::ral::Allocator {
     dealloc_func_(buffer);
   }
 
+  // Both the torch cpu allocator and the cuda caching allocator are
+  // thread-safe.
+  bool isThreadSafe() const override {
+    return true;
+  }
+
  private:
   alloc_t alloc_func_;
   dealloc_t dealloc_func_;
@@ -97,16 +108,44 @@ bool RalContext::CheckCurrentDevice(const at::List<at::Tensor>& inputs) const {
 
 std::tuple<void*, void*> RalContext::LoadEngine(
     const std::string& ral_engine_bytes) {
-  // Also had tried with shm_fs, however, dlopen tao_lib is not always
-  // successful.
-  auto is_ok = lib_tmpf_.WriteBytesToFile(ral_engine_bytes);
-  TORCH_CHECK(is_ok, "Failed to dump RAL engine to file");
-  std::string filename = lib_tmpf_.GetFilename();
-  void* tao_lib = dlopen(filename.c_str(), RTLD_NOW | RTLD_LOCAL);
-  TORCH_CHECK(tao_lib, "Fail to open ral engine");
+  // Loads the engine from memory, thus there is no filesystem I/O and no
+  // file is left behind on crashes.
+  void* tao_lib = nullptr;
+  lib_memf_.reset(new MemoryFile("ral_lib.so"));
+  if (lib_memf_->WriteBytesToFile(ral_engine_bytes)) {
+    std::string filename = lib_memf_->GetFilename();
+    // dlopen takes a library loaded from the same path as the same one. The
+    // path of a memory file (`/proc/self/fd/N`) is reused once its fd number
+    // is, while a library loaded from it may still be alive (e.g. not
+    // unloaded by dlclose), in which case the stale one would be returned.
+    void* stale_lib = dlopen(filename.c_str(), RTLD_NOW | RTLD_NOLOAD);
+    if (stale_lib != nullptr) {
+      dlclose(stale_lib);
+      LOG(WARNING) << "A library is already loaded from " << filename
+                   << ", fallback to a temp file";
+    } else {
+      tao_lib = dlopen(filename.c_str(), RTLD_NOW | RTLD_LOCAL);
+      if (tao_lib == nullptr) {
+        LOG(WARNING) << "Fail to open ral engine from memory, "
+                     << "fallback to a temp file";
+      }
+    }
+  }
+  if (tao_lib == nullptr) {
+    // Also had tried with shm_fs, however, dlopen tao_lib is not always
+    // successful.
+    lib_memf_.reset();
+    lib_tmpf_.reset(new TempFile("ral_lib.so"));
+    auto is_ok = lib_tmpf_->WriteBytesToFile(ral_engine_bytes);
+    TORCH_CHECK(is_ok, "Failed to dump RAL engine to file");
+    std::string filename = lib_tmpf_->GetFilename();
+    tao_lib = dlopen(filename.c_str(), RTLD_NOW | RTLD_LOCAL);
+    TORCH_CHECK(tao_lib, "Fail to open ral engine");
+  }
 
   void* func_handle = dlsym(tao_lib, kMlirLoweredEntry);
   TORCH_CHECK(func_handle, "Fail to find kMlirLoweredEntry");
+  tao_ral_resolve_api_table(tao_lib);
   return std::make_tuple(tao_lib, func_handle);
 }
 
@@ -118,9 +157,13 @@ RalContext::~RalContext() {
 
 RalContext::RalContext(std::shared_ptr<backends::EngineState> state)
     : engine_state_(state) {
-  auto is_ok = meta_tmpf_.WriteBytesToFile(state->model_proto);
-  TORCH_CHECK(is_ok, "FAiled to dump model proto to file.");
-  default_opt_.metadata_file_path = meta_tmpf_.GetFilename();
+  // The metadata is parsed from memory, thus the path only names the process
+  // level const store, which is unique among the alive engines.
+  std::ostringstream metadata_name;
+  metadata_name << "ral_meta@" << this;
+  default_opt_.metadata_file_path = metadata_name.str();
+  default_opt_.metadata_data = engine_state_->model_proto.data();
+  default_opt_.metadata_size = engine_state_->model_proto.size();
   default_opt_.cache_workspace_mem_across_execution = true;
   auto torch_allocator = c10::GetAllocator(torch::kCPU);
   TORCH_CHECK(torch_allocator != nullptr);
@@ -136,7 +179,15 @@ RalContext::RalContext(std::shared_ptr<backends::EngineState> state)
   at::globalContext().lazyInitCUDA();
   gpu_device_ = c10::cuda::current_device();
 #else
-  ral_ctx_ = tao::ral::cpu::MakeBaseCpuContext(default_opt_, cpu_opt_);
+  // e.g. `TORCH_BLADE_DISC_NUM_CONTEXTS=4` for 4 threads serving requests.
+  static std::atomic<uint64_t> next_uid{1};
+  uid_ = next_uid++;
+  int num_contexts = static_cast<int>(std::max<int64_t>(
+      1, env::ReadInt64FromEnvVar("TORCH_BLADE_DISC_NUM_CONTEXTS", 1)));
+  ral_ctx_pool_.resize(num_contexts);
+  if (num_contexts > 1) {
+    default_opt_.use_process_level_const_store = true;
+  }
 #endif // TORCH_BLADE_BUILD_WITH_CUDA
 
   void* func_handle = nullptr;
@@ -146,6 +197,22 @@ RalContext::RalContext(std::shared_ptr<backends::EngineState> state)
   entry_func_ = (func_t)func_handle;
 
   CHECK(entry_func_ != nullptr);
+
+  for (const char* mask = tao_ral_strided_inputs(tao_lib_); *mask; ++mask) {
+    strided_inputs_.push_back(*mask == '1');
+  }
+
+  // e.g. `1:pow2;0.1=1`, see tao::ral::ShapeBucketingPolicy::parse
+  auto bucketing_spec =
+      env::ReadStringFromEnvVar("TORCH_BLADE_DISC_SHAPE_BUCKETING", "");
+  if (!bucketing_spec.empty()) {
+    std::string error;
+    shape_bucketing_ =
+        tao::ral::ShapeBucketingPolicy::parse(bucketing_spec, &error);
+    if (!shape_bucketing_) {
+      LOG(WARNING) << "Shape bucketing is disabled: " << error;
+    }
+  }
 }
 
 at::List<at::Tensor> RalContext::PreProcessInputs(
@@ -153,13 +220,78 @@ at::List<at::Tensor> RalContext::PreProcessInputs(
   // TODO: we currently only support inputs on the same device as tensorrt
   TORCH_CHECK(CheckCurrentDevice(inputs));
 
-  at::List<at::Tensor> contiguous_inputs;
-  for (at::Tensor inp_tensor : inputs) {
-    // make sure the input is in contiguous layout
-    auto contiguous_tensor = inp_tensor.contiguous();
-    contiguous_inputs.push_back(contiguous_tensor);
+  at::List<at::Tensor> ral_inputs;
+  for (size_t k = 0; k < inputs.size(); ++k) {
+    at::Tensor inp_tensor = inputs[k];
+    // The engine consumes a strided input in place if it is a transposed view
+    // of a contiguous (batch of) matrix, e.g. `x.t()` fed into a matmul.
+    bool keep_layout = k < strided_inputs_.size() && strided_inputs_[k] &&
+        inp_tensor.dim() >= 2 && inp_tensor.transpose(-1, -2).is_contiguous();
+    if (!keep_layout) {
+      // make sure the input is in contiguous layout
+      inp_tensor = inp_tensor.contiguous();
+    }
+    ral_inputs.push_back(inp_tensor);
+  }
+  return ral_inputs;
+}
+
+at::List<at::Tensor> RalContext::PadInputs(
+    const at::List<at::Tensor>& inputs,
+    tao::ral::BucketedDims* dims) const {
+  std::vector<std::vector<int64_t>> padded_shapes;
+  padded_shapes.reserve(inputs.size());
+  for (at::Tensor inp : inputs) {
+    std::vector<int64_t> padded_shape;
+    if (!shape_bucketing_->bucketShape(
+            inp.sizes().vec(), &padded_shape, dims)) {
+      dims->clear();
+      return inputs;
+    }
+    padded_shapes.push_back(std::move(padded_shape));
+  }
+
+  at::List<at::Tensor> padded_inputs;
+  for (size_t idx = 0; idx < inputs.size(); ++idx) {
+    at::Tensor inp = inputs[idx];
+    const auto& padded_shape = padded_shapes[idx];
+    // The padding sizes of constant_pad_nd start from the last dim.
+    std::vector<int64_t> pad;
+    for (int64_t dim = inp.dim() - 1; dim >= 0; --dim) {
+      pad.push_back(0);
+      pad.push_back(padded_shape[dim] - inp.size(dim));
+    }
+    if (std::any_of(pad.begin(), pad.end(), [](int64_t p) { return p > 0; })) {
+      inp = at::constant_pad_nd(inp, pad, 0);
+    }
+    padded_inputs.push_back(inp);
   }
-  return contiguous_inputs;
+  return padded_inputs;
+}
+
+at::List<at::Tensor> RalContext::SliceOutputs(
+    const at::List<at::Tensor>& outputs,
+    const tao::ral::BucketedDims& dims) const {
+  at::List<at::Tensor> sliced_outputs;
+  for (size_t idx = 0; idx < outputs.size(); ++idx) {
+    at::Tensor out = outputs[idx];
+    std::vector<int64_t> sliced_shape;
+    TORCH_CHECK(
+        shape_bucketing_->getSlicedShape(
+            idx, out.sizes().vec(), dims, &sliced_shape),
+        "Output #",
+        idx,
+        " with shape ",
+        out.sizes(),
+        " does not follow the shape bucketing spec");
+    for (int64_t dim = 0; dim < out.dim(); ++dim) {
+      if (sliced_shape[dim] != out.size(dim)) {
+        out = out.narrow(dim, 0, sliced_shape[dim]);
+      }
+    }
+    sliced_outputs.push_back(out.contiguous());
+  }
+  return sliced_outputs;
 }
 
 void RalContext::BindingInputs(
@@ -168,7 +300,51 @@ void RalContext::BindingInputs(
   for (size_t idx = 0; idx < inputs.size(); ++idx) {
     at::Tensor inp = inputs[idx];
     const auto& shape = inp.sizes();
-    exec_ctx.bindInput(idx, inp.data_ptr(), shape.vec());
+    if (inp.is_contiguous()) {
+      exec_ctx.bindInput(idx, inp.data_ptr(), shape.vec());
+    } else {
+      exec_ctx.bindInput(
+          idx, inp.data_ptr(), shape.vec(), inp.strides().vec());
+    }
+  }
+}
+
+void RalContext::BindingOutputBuffers(
+    const at::List<at::Tensor>& inputs,
+    const at::List<at::Tensor>& outputs,
+    tao::ral::ExecutionContext& exec_ctx) const {
+  const auto& outputs_info = engine_state_->outputs;
+  std::vector<at::Tensor> bound_outputs;
+  for (size_t idx = 0; idx < outputs.size() && idx < outputs_info.size();
+       ++idx) {
+    at::Tensor out = outputs[idx];
+    if (!out.defined() || !out.is_contiguous() || out.nbytes() == 0 ||
+        out.scalar_type() != outputs_info[idx].scalar_type) {
+      continue;
+    }
+#ifdef TORCH_BLADE_BUILD_WITH_CUDA
+    if (out.is_cuda() != (outputs_info[idx].device == "cuda") ||
+        (out.is_cuda() && out.get_device() != gpu_device_)) {
+      continue;
+    }
+#else
+    if (!out.is_cpu()) {
+      continue;
+    }
+#endif // TORCH_BLADE_BUILD_WITH_CUDA
+    // The engine may still read an input while writing an output, and the
+    // results of two outputs must not be written into the same memory. Any
+    // (possible) overlap falls back to a regular allocation.
+    auto overlaps = [&](const at::Tensor& other) {
+      return other.defined() &&
+          at::get_overlap_status(other, out) != at::MemOverlapStatus::NO;
+    };
+    if (std::any_of(inputs.begin(), inputs.end(), overlaps) ||
+        std::any_of(bound_outputs.begin(), bound_outputs.end(), overlaps)) {
+      continue;
+    }
+    exec_ctx.bindOutputBuffer(idx, out.data_ptr(), out.nbytes());
+    bound_outputs.push_back(out);
   }
 }
 
@@ -179,8 +355,18 @@ inline bool IsEmptyTensor(const tao::ral::buffer_shape_t& shape) {
 }
 
 at::List<at::Tensor> RalContext::CreateAndBindingOutputs(
+    const at::List<at::Tensor>& inputs,
+    const at::List<at::Tensor>& provided_outputs,
     tao::ral::ExecutionContext& exec_ctx) const {
   at::List<at::Tensor> outputs;
+  // The holders of the buffers referred by multiple tensors, keyed by the
+  // buffer. A holder frees the buffer, or keeps the input it is forwarded
+  // from alive, when the last output referring to it is destroyed.
+  std::unordered_map<const void*, std::shared_ptr<void>> buffer_holders;
+  for (at::Tensor inp : inputs) {
+    buffer_holders.emplace(
+        inp.data_ptr(), std::shared_ptr<void>(inp.data_ptr(), [inp](void*) {}));
+  }
 
   auto num_outputs = engine_state_->outputs.size();
   outputs.reserve(num_outputs);
@@ -204,31 +390,54 @@ at::List<at::Tensor> RalContext::CreateAndBindingOutputs(
     auto option = torch::device(dev_type)
                       .dtype(scalar_type)
                       .memory_format(torch::MemoryFormat::Contiguous);
+    // The buffers allocated by Ral are freed by the torch allocator directly,
+    // since the tensors may outlive the Ral context.
+    auto cpu_allocator = c10::GetAllocator(torch::kCPU);
+    TORCH_CHECK(cpu_allocator != nullptr);
+    std::function<void(void*)> deleter = [cpu_allocator](void* ptr) {
+      cpu_allocator->raw_deallocate(ptr);
+    };
+#ifdef TORCH_BLADE_BUILD_WITH_CUDA
+    if (output_info.device == "cuda") {
+      deleter = c10::cuda::CUDACachingAllocator::raw_delete;
+    }
+#endif
+    void* data = const_cast<void*>(out_buf->data());
     at::Tensor out_tensor;
+    at::Tensor provided = idx < provided_outputs.size()
+        ? provided_outputs.get(idx)
+        : at::Tensor();
     if (IsEmptyTensor(out_buf->shape())) {
       out_tensor = torch::zeros(out_buf->shape(), option);
-    } else if (out_buf->owned()) {
-      auto cpu_allocator = c10::GetAllocator(torch::kCPU);
-      TORCH_CHECK(cpu_allocator != nullptr);
-      std::function<void(void*)> deleter = [cpu_allocator](void* ptr) {
-        cpu_allocator->raw_deallocate(ptr);
-      };
-#ifdef TORCH_BLADE_BUILD_WITH_CUDA
-      if (output_info.device == "cuda") {
-        deleter = c10::cuda::CUDACachingAllocator::raw_delete;
+    } else if (provided.defined() && data == provided.data_ptr()) {
+      // The output is written into the buffer provided by the caller.
+      if (provided.sizes() == out_buf->shape()) {
+        out_tensor = provided;
+      } else {
+        out_tensor = torch::from_blob(data, out_buf->shape(), option).clone();
       }
-#endif
-      out_tensor = torch::from_blob(
-          const_cast<void*>(out_buf->data()),
-          out_buf->shape(),
-          deleter,
-          option);
+    } else if (out_buf->owned()) {
+      out_tensor = torch::from_blob(data, out_buf->shape(), deleter, option);
       out_buf->release();
+    } else if (out_buf->persistent()) {
+      // A persistent buffer (e.g. a constant) is read by the following
+      // executions, thus it must not be modified in place through the output.
+      out_tensor = torch::from_blob(data, out_buf->shape(), option).clone();
     } else {
-      out_tensor =
-          torch::from_blob(
-              const_cast<void*>(out_buf->data()), out_buf->shape(), option)
-              .clone();
+      // The buffer is forwarded from an input, or shared by multiple outputs,
+      // in which case the first output referring to it frees it.
+      auto& holder = buffer_holders[data];
+      if (!holder && out_buf->allocated()) {
+        holder.reset(data, deleter);
+        out_buf->release();
+      }
+      if (holder) {
+        out_tensor = torch::from_blob(
+            data, out_buf->shape(), [holder](void*) {}, option);
+      } else {
+        // The owner of the buffer is unknown.
+        out_tensor = torch::from_blob(data, out_buf->shape(), option).clone();
+      }
     }
     outputs.push_back(out_tensor);
   }
@@ -263,9 +472,46 @@ tao::ral::BaseContext* RalContext::LoadCache() {
   }
   return ral_ctx_ptr;
 }
+#else
+namespace {
+
+// The context each engine pinned the thread to, keyed by the uid of the
+// engine, thus the engine lock is only taken on the first execution of the
+// thread. The entries of the destroyed engines are never matched again, and
+// are dropped by clearing the cache once it grows too large, after which the
+// live engines pin the thread again, which is fine since the contexts of an
+// engine are interchangeable.
+constexpr size_t kMaxThreadContextCacheSize = 1024;
+thread_local std::unordered_map<uint64_t, tao::ral::BaseContext*>
+    tContextCache;
+
+} // namespace
+
+tao::ral::BaseContext* RalContext::LoadCache() {
+  auto it = tContextCache.find(uid_);
+  if (it != tContextCache.end()) {
+    return it->second;
+  }
+  if (tContextCache.size() >= kMaxThreadContextCacheSize) {
+    tContextCache.clear();
+  }
+
+  std::lock_guard<std::mutex> guard(mtx_);
+  auto& ral_ctx = ral_ctx_pool_[next_ctx_idx_];
+  next_ctx_idx_ = (next_ctx_idx_ + 1) % ral_ctx_pool_.size();
+  // The contexts are created lazily, thus only as many as the threads
+  // executing the engine are created.
+  if (ral_ctx == nullptr) {
+    ral_ctx = tao::ral::cpu::MakeBaseCpuContext(default_opt_, cpu_opt_);
+  }
+  tContextCache.emplace(uid_, ral_ctx.get());
+  return ral_ctx.get();
+}
 #endif // TORCH_BLADE_BUILD_WITH_CUDA
 
-at::List<at::Tensor> RalContext::Execute(const at::List<at::Tensor>& inputs) {
+at::List<at::Tensor> RalContext::Execute(
+    const at::List<at::Tensor>& inputs,
+    const at::List<at::Tensor>& outputs) {
 #ifdef TORCH_BLADE_BUILD_WITH_CUDA
   auto ral_ctx = LoadCache();
   // execution context is per-inference context and thread-safe
@@ -273,13 +519,19 @@ at::List<at::Tensor> RalContext::Execute(const at::List<at::Tensor>& inputs) {
       tao::ral::MakeExecutionContext<tao::ral::gpu::BaseCudaExecutionContext>(
           ral_ctx);
 #else
+  auto ral_ctx = LoadCache();
   auto exec_ctx =
       tao::ral::MakeExecutionContext<tao::ral::cpu::BaseCpuExecutionContext>(
-          ral_ctx_.get());
+          ral_ctx);
 #endif // TORCH_BLADE_BUILD_WITH_CUDA
 
-  auto contiguous_inputs = PreProcessInputs(inputs);
-  BindingInputs(contiguous_inputs, *exec_ctx.get());
+  auto ral_inputs = PreProcessInputs(inputs);
+  tao::ral::BucketedDims bucketed_dims;
+  if (shape_bucketing_) {
+    ral_inputs = PadInputs(ral_inputs, &bucketed_dims);
+  }
+  BindingInputs(ral_inputs, *exec_ctx.get());
+  BindingOutputBuffers(ral_inputs, outputs, *exec_ctx.get());
   auto tao_ral_func_ptr = reinterpret_cast<void*>(&tao_ral_call_impl);
 
   // execute
@@ -291,8 +543,12 @@ at::List<at::Tensor> RalContext::Execute(const at::List<at::Tensor>& inputs) {
     throw ex;
   }
 
-  auto outputs = CreateAndBindingOutputs(*exec_ctx.get());
-  return outputs;
+  auto ral_outputs =
+      CreateAndBindingOutputs(ral_inputs, outputs, *exec_ctx.get());
+  if (!bucketed_dims.empty()) {
+    ral_outputs = SliceOutputs(ral_outputs, bucketed_dims);
+  }
+  return ral_outputs;
 }
 } // namespace blade
 } // namespace torch
@@ -13,6 +13,7 @@
 
 #include <memory>
 #include <mutex>
+#include <thread>
 #include <unordered_map>
 
 #include <torch/script.h>
@@ -35,6 +36,7 @@ using CUDAStream = ::c10::hip::HIPStream;
 // TODO(disc): figure out why the bazel does not trigger re-compile this file
 // after we update ral.
 #include "tensorflow/compiler/mlir/xla/ral/context/base/cpu/cpu_context_impl.h"
+#include "tensorflow/compiler/mlir/xla/ral/ral_shape_bucketing.h"
 
 #include "pytorch_blade/common_utils/macros.h"
 #include "pytorch_blade/common_utils/tempfs.h"
@@ -51,22 +53,54 @@ class RalContext {
   RalContext(std::shared_ptr<backends::EngineState> state);
   ~RalContext();
 
-  at::List<at::Tensor> Execute(const at::List<at::Tensor>&);
+  // Writes the results into `outputs` in place where possible, see
+  // EngineInterface::Execute.
+  at::List<at::Tensor> Execute(
+      const at::List<at::Tensor>& inputs,
+      const at::List<at::Tensor>& outputs = {});
 
  private:
   void BindingInputs(
       const at::List<at::Tensor>& inputs,
       tao::ral::ExecutionContext& exec_ctx) const;
   bool CheckCurrentDevice(const at::List<at::Tensor>& inputs) const;
+  // Provides the buffers of `outputs` to the engine, which writes the results
+  // into them in place if their sizes match. Buffers that overlap an input or
+  // a previously provided output are skipped.
+  void BindingOutputBuffers(
+      const at::List<at::Tensor>& inputs,
+      const at::List<at::Tensor>& outputs,
+      tao::ral::ExecutionContext& exec_ctx) const;
+  // Outputs aliasing the inputs or the other outputs are returned as views
+  // sharing the underlying buffers, which are freed when the last tensor
+  // referring to them is destroyed. Outputs written into the tensors provided
+  // by the caller are returned as the provided tensors.
   at::List<at::Tensor> CreateAndBindingOutputs(
+      const at::List<at::Tensor>& inputs,
+      const at::List<at::Tensor>& provided_outputs,
       tao::ral::ExecutionContext& exec_ctx) const;
+  // Makes the inputs contiguous, except the ones the engine can consume in
+  // their current layouts (e.g. transposed gemm operands).
   at::List<at::Tensor> PreProcessInputs(
       const at::List<at::Tensor>& inputs) const;
+  // Pads the inputs with zeros to their bucketed shapes, leaves them as is if
+  // they can not be bucketed.
+  at::List<at::Tensor> PadInputs(
+      const at::List<at::Tensor>& inputs,
+      tao::ral::BucketedDims* dims) const;
+  // Slices the padding off the outputs designated by the shape bucketing spec.
+  at::List<at::Tensor> SliceOutputs(
+      const at::List<at::Tensor>& outputs,
+      const tao::ral::BucketedDims& dims) const;
   std::tuple<void*, void*> LoadEngine(const std::string& ral_engine_bytes);
 
   std::shared_ptr<backends::EngineState> engine_state_;
-  TempFile lib_tmpf_{"ral_lib.so"};
-  TempFile meta_tmpf_{"ral_meta.pb"};
+  // The engine is loaded from a memory file, or a temp file if memory files
+  // are not supported. The file must be kept open while the engine is loaded,
+  // otherwise its path may be reused by another engine, which dlopen would
+  // take as the loaded one.
+  std::unique_ptr<MemoryFile> lib_memf_;
+  std::unique_ptr<TempFile> lib_tmpf_;
 
 #ifdef TORCH_BLADE_BUILD_WITH_CUDA
   int64_t gpu_device_;
@@ -77,9 +111,26 @@ class RalContext {
       ral_ctx_map_;
   tao::ral::BaseContext* LoadCache();
 #else
-  std::unique_ptr<tao::ral::BaseContext> ral_ctx_;
+  // A pool of contexts sharing the constants and the packed weights, thus the
+  // concurrent executions do not contend for the states of a single context.
+  // Each thread is pinned to a context, assigned in a round-robin way on its
+  // first execution and remembered in a thread local cache.
+  std::mutex mtx_;
+  std::vector<std::unique_ptr<tao::ral::BaseContext>> ral_ctx_pool_;
+  size_t next_ctx_idx_ = 0;
+  // Unique among all the engines ever created, thus an entry of a destroyed
+  // engine in the thread local caches never matches.
+  uint64_t uid_;
+  tao::ral::BaseContext* LoadCache();
 #endif // TORCH_BLADE_BUILD_WITH_CUDA
 
+  // Whether each input can be bound with a non-contiguous layout, see
+  // tao_ral_strided_inputs.
+  std::vector<bool> strided_inputs_;
+
+  // Not null if shape bucketing is enabled.
+  std::unique_ptr<tao::ral::ShapeBucketingPolicy> shape_bucketing_;
+
   tao::ral::BaseContextOption default_opt_;
   tao::ral::cpu::BaseCpuContextOption cpu_opt_;
   void* tao_lib_;
@@ -32,6 +32,9 @@ class TRTEngine : public torch::blade::backends::EngineInterface {
   TRTEngine(const State& state);
 
   at::List<at::Tensor> Execute(const at::List<at::Tensor>& inputs) override;
+  at::List<at::Tensor> Execute(
+      const at::List<at::Tensor>& inputs,
+      const at::List<at::Tensor>& outputs) override;
 
   const State& GetState() const {
     return *engine_state_;
@@ -57,6 +60,12 @@ at::List<at::Tensor> TRTEngine::Execute(const at::List<at::Tensor>& inputs) {
   return engine_ctx_->Execute(inputs);
 }
 
+at::List<at::Tensor> TRTEngine::Execute(
+    const at::List<at::Tensor>& inputs,
+    const at::List<at::Tensor>& outputs) {
+  return engine_ctx_->Execute(inputs, outputs);
+}
+
 bool TRTEngine::ShouldFallback(const at::List<at::Tensor>& inputs) {
   return !engine_ctx_->IsInRange(inputs);
 }
@@ -11,6 +11,8 @@
 
 #include "pytorch_blade/compiler/tensorrt/tensorrt_engine_context.h"
 
+#include <algorithm>
+
 #include <c10/cuda/CUDAException.h>
 #include <c10/cuda/CUDAFunctions.h>
 #include <c10/cuda/CUDAStream.h>
@@ -193,7 +195,8 @@ void TRTContext::BindingInputs(
 
 at::List<at::Tensor> TRTContext::CreateAndBindingOutputs(
     std::vector<void*>& binding_buffers,
-    std::shared_ptr<nvinfer1::IExecutionContext>& context) const {
+    std::shared_ptr<nvinfer1::IExecutionContext>& context,
+    const at::List<at::Tensor>& provided_outputs) const {
   at::List<at::Tensor> outputs{};
   const auto& graph_outputs = engine_state_->outputs;
   outputs.reserve(graph_outputs.size());
@@ -218,7 +221,23 @@ at::List<at::Tensor> TRTContext::CreateAndBindingOutputs(
     auto option = torch::device(torch::kCUDA)
                       .dtype(torch_type.type)
                       .memory_format(torch::MemoryFormat::Contiguous);
-    at::Tensor out_tensor = torch::empty(torch_type.shape, option);
+    at::Tensor out_tensor;
+    if (k < provided_outputs.size()) {
+      out_tensor = provided_outputs.get(k);
+    }
+    // PostProcessOutputs returns a new tensor if the dtype differs, and the
+    // buffer of an input or another output can not be reused.
+    auto reuse_option = option.device(torch::kCUDA, tensorrt_device_);
+    bool reusable = torch_type.type == graph_outputs[k].scalar_type &&
+        backends::IsReusableOutput(out_tensor, torch_type.shape, reuse_option);
+    if (reusable) {
+      void* data = out_tensor.data_ptr();
+      reusable = std::find(binding_buffers.begin(), binding_buffers.end(),
+                           data) == binding_buffers.end();
+    }
+    if (!reusable) {
+      out_tensor = torch::empty(torch_type.shape, option);
+    }
     binding_buffers[output_bind_indices_[optimization_profile_][k]] =
         out_tensor.data_ptr();
     outputs.push_back(out_tensor);
@@ -345,7 +364,9 @@ at::List<at::Tensor> TRTContext::PreProcessInputs(
   return cuda_ctu_inputs;
 }
 
-at::List<at::Tensor> TRTContext::Execute(const at::List<at::Tensor>& inputs) {
+at::List<at::Tensor> TRTContext::Execute(
+    const at::List<at::Tensor>& inputs,
+    const at::List<at::Tensor>& outputs) {
   std::vector<void*> binding_buffers(engine_->getNbBindings());
 
   // TODO: we assume the inputs are all computed on the current cuda
@@ -363,10 +384,10 @@ at::List<at::Tensor> TRTContext::Execute(const at::List<at::Tensor>& inputs) {
 
   // Input/output CUDA memory bindings
   BindingInputs(cuda_ctu_inputs, binding_buffers);
-  at::List<at::Tensor> outputs =
-      CreateAndBindingOutputs(binding_buffers, context);
+  at::List<at::Tensor> trt_outputs =
+      CreateAndBindingOutputs(binding_buffers, context, outputs);
   context->enqueueV2(&binding_buffers[0], stream, nullptr);
-  return PostProcessOutputs(outputs);
+  return PostProcessOutputs(trt_outputs);
 }
 
 at::List<at::Tensor> TRTContext::PostProcessOutputs(
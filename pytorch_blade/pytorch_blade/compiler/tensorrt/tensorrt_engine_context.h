@@ -35,7 +35,11 @@ class TRTContext {
   // this is not thread-safe initialization
   TRTContext(std::shared_ptr<State> state);
   std::string SerializeAsString() const;
-  at::List<at::Tensor> Execute(const at::List<at::Tensor>&);
+  // Writes the results into `outputs` in place where possible, see
+  // EngineInterface::Execute.
+  at::List<at::Tensor> Execute(
+      const at::List<at::Tensor>& inputs,
+      const at::List<at::Tensor>& outputs = {});
   bool IsInRange(const at::List<at::Tensor>& inputs);
 
  private:
@@ -44,9 +48,12 @@ class TRTContext {
   // the TRTEngine is not the owner of the blobs' cuda memory.
   void BindingInputs(const at::List<at::Tensor>& inputs, std::vector<void*>&)
       const;
+  // Binds the tensors in `provided_outputs` to the outputs they fit, and
+  // allocates the others.
   at::List<at::Tensor> CreateAndBindingOutputs(
       std::vector<void*>&,
-      std::shared_ptr<nvinfer1::IExecutionContext>& context) const;
+      std::shared_ptr<nvinfer1::IExecutionContext>& context,
+      const at::List<at::Tensor>& provided_outputs) const;
   at::List<at::Tensor> PostProcessOutputs(
       const at::List<at::Tensor>& outputs) const;
   at::List<at::Tensor> PreProcessInputs(
@@ -17,6 +17,7 @@
 #include "pytorch_blade/compiler/mlir/runtime/disc_engine.h"
 #include "pytorch_blade/ltc/disc_compiler/passes/io.h"
 #include "pytorch_blade/ltc/disc_compiler/replay.h"
+#include "tensorflow/compiler/mlir/xla/ral/ral_metadata.h"
 
 #include <torch/csrc/jit/jit_log.h>
 #include <torch/csrc/lazy/core/hash.h>
@@ -156,7 +157,12 @@ std::vector<c10::IValue> RegisterDiscClass(
         cmd);
 
     state->set_engine_bytes(ReadFileBytes(output_fname));
-    state->set_model_proto(ReadFileBytes(output_fname + ".pbtxt"));
+    // The host consts inside the const blob file (if any) are carried along
+    // with the metadata, since the engine is loaded from memory.
+    auto metadata_fname = output_fname + ".pbtxt";
+    state->set_model_proto(::tao::ral::bundleMetadataWithConstBlob(
+        ReadFileBytes(metadata_fname),
+        ReadFileBytes(::tao::ral::getConstBlobFileName(metadata_fname))));
     for (auto input : sub_graph->inputs()) {
       inputs.push_back(torch::blade::backends::TensorInfo(*input));
     }
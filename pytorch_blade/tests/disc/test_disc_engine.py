@@ -9,9 +9,18 @@
 # See the License for the specific language governing permissions and
 # limitations under the License.
 
+import io
+import json
+import os
+import subprocess
+import sys
+import tempfile
 import unittest
+from concurrent.futures import ThreadPoolExecutor
+from unittest import mock
+
 import torch
-from torch_blade import mlir
+from torch_blade import mlir, utils
 
 from tests.disc.testing_base import DiscTestCase
 
@@ -38,6 +47,162 @@ class TestDiscEngine(DiscTestCase):
 
         self.assertEqual(three, 3 * one)
 
+    def _cvt_add_mul(self):
+        class AddMul(torch.nn.Module):
+            def forward(self, x, y):
+                return x + y, x * y
+
+        x = torch.randn(8, device=self.device)
+        y = torch.randn(8, device=self.device)
+        add_mul = self.cvt_to_disc(AddMul().eval(), (x, y))
+        engines = utils.collect_engines(add_mul, mlir._DISC_GROUP_NAME)
+        self.assertEqual(len(engines), 1)
+        return engines[0][1]
+
+    def test_duplicated_provided_outputs(self):
+        engine = self._cvt_add_mul()
+        x = torch.randn(8, device=self.device)
+        y = torch.randn(8, device=self.device)
+        out = torch.empty(8, device=self.device)
+        add, mul = engine.execute_with_outputs([x, y], [out, out])
+        self.assertEqual(add, x + y)
+        self.assertEqual(mul, x * y)
+        self.assertNotEqual(add.data_ptr(), mul.data_ptr())
+
+    def test_provided_output_overlapping_input(self):
+        engine = self._cvt_add_mul()
+        base = torch.randn(1025, device=self.device)
+        # x and the first output share all but one element at an offset.
+        x = base[:1024]
+        y = torch.randn(1024, device=self.device)
+        expect_add, expect_mul = x + y, x * y
+        add, mul = engine.execute_with_outputs(
+            [x, y], [base[1:], torch.empty(1024, device=self.device)])
+        self.assertEqual(add, expect_add)
+        self.assertEqual(mul, expect_mul)
+
+    def test_context_pool_with_many_engines(self):
+        if self.device.type != "cpu":
+            self.skipTest("the pool of contexts is only used on cpu")
+
+        class Triple(torch.nn.Module):
+            def forward(self, x):
+                return 3.0 * x + 0.0 + 0.0
+
+        triple = self.cvt_to_disc(Triple().eval(), torch.randn(8))
+        buf = io.BytesIO()
+        torch.jit.save(triple, buf)
+
+        # More engines than the threads can keep pinned in a small cache, and
+        # each thread executes all of them in turn.
+        num_engines, num_threads = 20, 4
+        with mock.patch.dict(os.environ, {"TORCH_BLADE_DISC_NUM_CONTEXTS": "2"}):
+            modules = []
+            for _ in range(num_engines):
+                buf.seek(0)
+                modules.append(torch.jit.load(buf))
+
+            def run(tid):
+                for step in range(3 * num_engines):
+                    module = modules[(tid + step) % num_engines]
+                    x = torch.randn(8)
+                    if not torch.allclose(module(x), 3 * x):
+                        return False
+                return True
+
+            with ThreadPoolExecutor(num_threads) as executor:
+                results = list(executor.map(run, range(num_threads)))
+        self.assertTrue(all(results))
+
+
+# Loads the module saved at argv[1] in a new process, thus the engines are
+# initialized in the mode set by TORCH_BLADE_ENGINE_INIT_MODE, which is read
+# once per process. Prints the readiness of the engines along the way.
+_INIT_MODE_SCRIPT = """
+import io, json, sys
+import torch
+import torch_blade
+from torch_blade import mlir
+
+path, device = sys.argv[1], torch.device(sys.argv[2])
+x = torch.randn(8, device=device)
+def load():
+    module = torch.jit.load(path, map_location=device)
+    return module, mlir.collect_engines(module)[0][1]
+def run(module):
+    return bool(torch.allclose(module(x), 3 * x))
+
+result = {}
+module, engine = load()
+result["ready_on_load"] = engine.is_ready()
+# Serializes the engine before it is created.
+buf = io.BytesIO()
+torch.jit.save(module, buf)
+result["ready_after_save"] = engine.is_ready()
+buf.seek(0)
+result["reloaded_ok"] = run(torch.jit.load(buf, map_location=device))
+
+# The first call races with the prefetching.
+engine.prefetch()
+result["prefetched_ok"] = run(module)
+result["ready_after_call"] = engine.is_ready()
+
+module, engine = load()
+mlir.prefetch_engines(module, wait=True)
+result["ready_after_prefetch"] = engine.is_ready()
+result["ok_after_prefetch"] = run(module)
+print(json.dumps(result))
+"""
+
+
+class TestEngineInitMode(DiscTestCase):
+    def setUp(self):
+        super().setUp()
+
+        class Triple(torch.nn.Module):
+            def forward(self, x):
+                return 3.0 * x + 0.0 + 0.0
+
+        x = torch.randn(8, device=self.device)
+        triple = self.cvt_to_disc(Triple().eval(), x)
+        self.tmp_dir = tempfile.TemporaryDirectory()
+        self.model_path = os.path.join(self.tmp_dir.name, "triple.pt")
+        torch.jit.save(triple, self.model_path)
+
+    def tearDown(self):
+        self.tmp_dir.cleanup()
+        super().tearDown()
+
+    def _run(self, mode):
+        env = dict(os.environ, TORCH_BLADE_ENGINE_INIT_MODE=mode)
+        proc = subprocess.run(
+            [sys.executable, "-c", _INIT_MODE_SCRIPT, self.model_path,
+             str(self.device)],
+            env=env, stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+            universal_newlines=True)
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        result = json.loads(proc.stdout.strip().splitlines()[-1])
+        for key in ["reloaded_ok", "prefetched_ok", "ready_after_call",
+                    "ready_after_prefetch", "ok_after_prefetch"]:
+            self.assertTrue(result[key], key)
+        return result
+
+    def test_eager(self):
+        result = self._run("eager")
+        self.assertTrue(result["ready_on_load"])
+        self.assertTrue(result["ready_after_save"])
+
+    def test_lazy(self):
+        result = self._run("lazy")
+        self.assertFalse(result["ready_on_load"])
+        # Serializing does not create the engine.
+        self.assertFalse(result["ready_after_save"])
+
+    def test_async(self):
+        # The engine may or may not be ready on load, depending on the
+        # progress of the background initialization.
+        self._run("async")
+
 
 if __name__ == "__main__":
     unittest.main()
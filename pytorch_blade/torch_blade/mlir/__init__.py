@@ -53,6 +53,13 @@ def collect_engines(script_module):
     return utils.collect_engines(script_module, _DISC_GROUP_NAME)
 
 
+def prefetch_engines(script_module, wait=False):
+    """
+    Initialize all engines in a script_module of disc in parallel
+    """
+    utils.prefetch_engines(script_module, _DISC_GROUP_NAME, wait)
+
+
 def num_engines(script_module):
     """
     Return the number of engines of MLIR
@@ -11,6 +11,7 @@
 
 import os
 import shutil
+import struct
 import subprocess
 import tempfile
 from datetime import datetime
@@ -24,6 +25,21 @@ from torch_blade.config import Config
 from torch_blade.logging import logger
 
 
+# Keep in sync with bundleMetadataWithConstBlob in ral_metadata.h: the const
+# blob is appended to the metadata, followed by its size and a magic number.
+_METADATA_BUNDLE_MAGIC = 0x454C444E55424C52
+
+
+def _bundle_const_blob(pb_bytes, blob_file):
+    if not os.path.exists(blob_file):
+        return pb_bytes
+    with open(blob_file, "rb") as f_blob:
+        blob_bytes = f_blob.read()
+    if len(blob_bytes) == 0:
+        return pb_bytes
+    return pb_bytes + blob_bytes + struct.pack("<QQ", len(blob_bytes), _METADATA_BUNDLE_MAGIC)
+
+
 def _dump_to_tempfile(tmp_dir, dump_bytes):
     inp_file = tempfile.NamedTemporaryFile(dir=tmp_dir, delete=False)
     inp_file.write(bytes(dump_bytes, "utf-8"))
@@ -92,11 +108,17 @@ def _compile_torchscript(graph):
             so_bytes = f.read()
         with open(out_file_pbtxt, "rb") as f_pbtxt:
             pb_bytes = f_pbtxt.read()
+        # the engine is loaded from memory, thus the host consts inside the
+        # const blob file (if any) are carried along with the metadata
+        out_file_blob = out_file_pbtxt + ".blob"
+        pb_bytes = _bundle_const_blob(pb_bytes, out_file_blob)
 
         if debug_log_enabled:
             # copy result to mlir_dump_dir
             shutil.move(out_file_name, os.path.join(mlir_dump_dir, f"out.{time_str}.so"))
             shutil.move(out_file_pbtxt, os.path.join(mlir_dump_dir, f"out.{time_str}.so.pbtxt"))
+            if os.path.exists(out_file_blob):
+                shutil.move(out_file_blob, os.path.join(mlir_dump_dir, f"out.{time_str}.so.pbtxt.blob"))
 
         return so_bytes, pb_bytes, input_dev_str, output_dev_str
 
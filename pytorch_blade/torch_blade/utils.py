@@ -187,6 +187,19 @@ def collect_engines(script_module, group_type):
     engines = [script_module.getattr(name) for name in engine_names]
     return list(zip(engine_names, engines))
 
+def prefetch_engines(script_module, group_type, wait=False):
+    """
+    Initialize the engines of the group type in parallel in the background,
+    which are not initialized on loading if TORCH_BLADE_ENGINE_INIT_MODE is
+    `lazy` or `async`. Block until all of them are ready if wait is True
+    """
+    engines = collect_engines(script_module, group_type)
+    for _, engine in engines:
+        engine.prefetch()
+    if wait:
+        for _, engine in engines:
+            engine.initialize()
+
 def num_engines(script_module, group_type):
     """
     Return the number of engines of the group_type
@@ -9,4 +9,4 @@
 # See the License for the specific language governing permissions and
 # limitations under the License.
 
-from .disc import enable
+from .disc import enable, warmup_compilation_cache
@@ -12,6 +12,7 @@
 
 
 
+import ctypes
 import os
 import tensorflow as tf
 
@@ -63,3 +64,48 @@ def enable(disc_cpu=False, num_intra_op_threads=1, fast_math_level=4):
         os.environ.setdefault("DISC_CPU_FAST_MATH_LEVEL", str(fast_math_level))
     tf.load_op_library(tao_op_path)
     print("Welcome BladeDISC!")
+
+
+def warmup_compilation_cache(histogram_path, cache_dir=None, top_n=0,
+                             num_threads=None):
+    '''Compile the recorded signatures into the compilation cache.
+
+    The signatures seen by a process running with the env var
+    DISC_SHAPE_HISTOGRAM_PATH set are recorded into the shape histogram
+    file along with their call counts. This method compiles the most
+    frequently called ones ahead of time, thus a serving process sharing
+    the compilation cache does not compile them when taking traffic.
+    It should be called after `enable`.
+
+    Parameters
+    ----------
+    histogram_path : str
+        The shape histogram file recorded.
+
+    cache_dir: str
+        The compilation cache directory, defaults to the env var
+        DISC_COMPILATION_CACHE_PATH.
+
+    top_n: int
+        The number of the most frequently called signatures to compile,
+        all of them are compiled if non-positive.
+
+    num_threads: int
+        The number of compilations in parallel, defaults to the number of
+        cpus.
+    '''
+    if cache_dir is None:
+        cache_dir = os.environ.get("DISC_COMPILATION_CACHE_PATH", "")
+    if not cache_dir:
+        raise ValueError("compilation cache directory is not specified")
+    if num_threads is None:
+        num_threads = os.cpu_count() or 1
+    lib = ctypes.CDLL(os.path.join(_ROOT, TAO_OP_NAME))
+    warmup = lib.tao_warmup_compilation_cache
+    warmup.argtypes = [ctypes.c_char_p, ctypes.c_char_p, ctypes.c_int64,
+                       ctypes.c_int]
+    warmup.restype = ctypes.c_int
+    if warmup(histogram_path.encode(), cache_dir.encode(), top_n,
+              num_threads) != 0:
+        raise RuntimeError(
+            "fail to warm up compilation cache from {}".format(histogram_path))
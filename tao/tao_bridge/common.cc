@@ -45,8 +45,16 @@ static void AllocateTaoBridgeFlags() {
                               &opts->verbose_compilation_err_log));
   CHECK_OK(ReadBoolFromEnvVar("TAO_ENFORCE_VERBOSE_COMPILATION_LOG", false,
                               &opts->verbose_compilation_log));
+  CHECK_OK(ReadBoolFromEnvVar("TAO_ENABLE_COMPILER_DAEMON", false,
+                              &opts->enable_compiler_daemon));
+  CHECK_OK(ReadInt64FromEnvVar("TAO_COMPILER_DAEMON_WORKERS", 4,
+                               &opts->compiler_daemon_workers));
+  CHECK_OK(ReadInt64FromEnvVar("TAO_COMPILER_DAEMON_IDLE_TIMEOUT", 600,
+                               &opts->compiler_daemon_idle_timeout));
   CHECK_OK(ReadStringFromEnvVar("DISC_COMPILATION_CACHE_PATH", "",
                                 &opts->disc_cache_path));
+  CHECK_OK(ReadStringFromEnvVar("DISC_SHAPE_HISTOGRAM_PATH", "",
+                                &opts->disc_shape_histogram_path));
   CHECK_OK(ReadBoolFromEnvVar("TAO_ENABLE_MLIR", false, &opts->enable_mlir));
 
   CHECK_OK(ReadBoolFromEnvVar("TAO_MLIR_BRANCH_ONLY", true,
@@ -86,6 +94,8 @@ static void AllocateTaoBridgeFlags() {
   CHECK_OK(ReadBoolFromEnvVar("DISC_DEBUG", false, &opts->disc_debug_mode));
   CHECK_OK(ReadBoolFromEnvVar("DISC_FORCE_FALLBACK", false,
                               &opts->disc_force_fallback));
+  CHECK_OK(ReadStringFromEnvVar("DISC_SHAPE_BUCKETING", "",
+                                &opts->disc_shape_bucketing));
 
   CHECK_OK(ReadInt64FromEnvVar(
       "TAO_PROFILING_GUIDED_COMPILATION_PROFILING_TIME_BY_MIN", 5,
@@ -40,8 +40,21 @@ struct TaoBridgeOptions {
   // If enforce print compiler log.
   bool verbose_compilation_log;
 
+  // Whether to compile clusters through a long-lived tao_compiler_main daemon
+  // instead of launching a process per cluster. Controlled by env var
+  // `TAO_ENABLE_COMPILER_DAEMON` defaults to false.
+  bool enable_compiler_daemon;
+  // Number of worker processes of the compiler daemon.
+  int64 compiler_daemon_workers;
+  // Seconds a daemon worker waits for new requests before exiting.
+  int64 compiler_daemon_idle_timeout;
+
   // Compilation cache dump path.
   std::string disc_cache_path;
+  // Path of the shape histogram recording the signatures seen and their call
+  // counts, consumed by `WarmupCompilationCache`. Controlled by env var
+  // `DISC_SHAPE_HISTOGRAM_PATH` defaults to empty, i.e. disabled.
+  std::string disc_shape_histogram_path;
   // Whether to enable mlir compilation.
   bool enable_mlir;
 
@@ -70,6 +83,10 @@ struct TaoBridgeOptions {
   bool disc_debug_mode;
   // Go fallback path if is true.
   bool disc_force_fallback;
+  // Spec of the shape bucketing policy, e.g. `1:pow2;0.1=1`, see
+  // `tao::ral::ShapeBucketingPolicy::parse`. Controlled by env var
+  // `DISC_SHAPE_BUCKETING` defaults to empty, i.e. disabled.
+  std::string disc_shape_bucketing;
 
   // Whether to enable bace reformat pass to cast come fp32 const to fp16.
   bool bace_reformat_enabled;
@@ -0,0 +1,310 @@
+// Copyright 2022 The BladeDISC Authors. All rights reserved.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tao_bridge/compilation_cache_index.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/gtl/cleanup.h"
+#include "tensorflow/core/lib/hash/crc32c.h"
+#include "tensorflow/core/platform/env.h"
+
+namespace tensorflow {
+namespace tao {
+
+namespace {
+
+constexpr size_t kRecordHeaderSize = 2 * sizeof(uint32_t);
+
+Status IOError(const std::string& context, const std::string& path) {
+  return errors::Internal(context, " ", path, ": ", strerror(errno));
+}
+
+// Holds an exclusive file lock during its lifetime.
+class FileLock {
+ public:
+  explicit FileLock(const std::string& path) : path_(path) {
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0) return;
+    int ret;
+    do {
+      ret = flock(fd_, LOCK_EX);
+    } while (ret != 0 && errno == EINTR);
+    if (ret != 0) {
+      close(fd_);
+      fd_ = -1;
+    }
+  }
+  ~FileLock() {
+    if (fd_ >= 0) close(fd_);
+  }
+
+  Status status() const {
+    return fd_ >= 0 ? Status::OK() : IOError("failed to lock", path_);
+  }
+
+ private:
+  std::string path_;
+  int fd_;
+};
+
+bool WriteFully(int fd, const char* data, size_t size, off_t offset) {
+  while (size > 0) {
+    ssize_t n = pwrite(fd, data, size, offset);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    data += n;
+    size -= n;
+    offset += n;
+  }
+  return true;
+}
+
+}  // namespace
+
+CompilationCacheIndex::CompilationCacheIndex(const std::string& cache_dir,
+                                             int64 compaction_threshold)
+    : cache_dir_(cache_dir), compaction_threshold_(compaction_threshold) {}
+
+CompilationCacheIndex::~CompilationCacheIndex() { CloseLogLocked(); }
+
+void CompilationCacheIndex::CloseLogLocked() {
+  if (log_fd_ >= 0) close(log_fd_);
+  log_fd_ = -1;
+  log_inode_ = 0;
+  log_device_ = 0;
+  log_offset_ = 0;
+  num_log_records_ = 0;
+}
+
+Status CompilationCacheIndex::Refresh() {
+  mutex_lock lock(mu_);
+  return RefreshLocked();
+}
+
+Status CompilationCacheIndex::RefreshLocked() {
+  std::string log_path = getPath(getLogFileName());
+  struct stat log_stat;
+  if (stat(log_path.c_str(), &log_stat) != 0) {
+    if (errno != ENOENT) return IOError("failed to stat", log_path);
+    // Nothing is inserted yet, or the snapshot is left without a log.
+    return log_fd_ < 0 ? LoadSnapshotLocked() : Status::OK();
+  }
+  if (log_fd_ < 0 || log_stat.st_ino != log_inode_ ||
+      log_stat.st_dev != log_device_) {
+    // The log is compacted (by any process) since the last read, the entries
+    // of the old log are in the snapshot now. The log is opened before loading
+    // the snapshot, since the snapshot is replaced before the log.
+    CloseLogLocked();
+    int fd = open(log_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      if (errno == ENOENT) return Status::OK();
+      return IOError("failed to open", log_path);
+    }
+    if (fstat(fd, &log_stat) != 0) {
+      close(fd);
+      return IOError("failed to stat", log_path);
+    }
+    log_fd_ = fd;
+    log_inode_ = log_stat.st_ino;
+    log_device_ = log_stat.st_dev;
+    TF_RETURN_IF_ERROR(LoadSnapshotLocked());
+  }
+  return ReadLogLocked();
+}
+
+Status CompilationCacheIndex::LoadSnapshotLocked() {
+  std::string path = getPath(getSnapshotFileName());
+  if (!Env::Default()->FileExists(path).ok()) return Status::OK();
+  CompilationCacheIndexSnapshot snapshot;
+  TF_RETURN_IF_ERROR(ReadBinaryProto(Env::Default(), path, &snapshot));
+  for (auto& entry : snapshot.entries()) {
+    entries_[entry.key()] = entry;
+  }
+  return Status::OK();
+}
+
+Status CompilationCacheIndex::ReadLogLocked() {
+  struct stat log_stat;
+  if (fstat(log_fd_, &log_stat) != 0) {
+    return IOError("failed to stat", getPath(getLogFileName()));
+  }
+  if (log_stat.st_size <= log_offset_) return Status::OK();
+
+  std::vector<char> buffer(log_stat.st_size - log_offset_);
+  size_t size = 0;
+  while (size < buffer.size()) {
+    ssize_t n = pread(log_fd_, buffer.data() + size, buffer.size() - size,
+                      log_offset_ + size);
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0) return IOError("failed to read", getPath(getLogFileName()));
+    if (n == 0) break;
+    size += n;
+  }
+
+  size_t pos = 0;
+  while (size - pos >= kRecordHeaderSize) {
+    uint32_t length, masked_crc;
+    memcpy(&length, buffer.data() + pos, sizeof(length));
+    memcpy(&masked_crc, buffer.data() + pos + sizeof(length),
+           sizeof(masked_crc));
+    const char* payload = buffer.data() + pos + kRecordHeaderSize;
+    // Stops at a record being written, which is read in the next time.
+    if (size - pos - kRecordHeaderSize < length ||
+        crc32c::Unmask(masked_crc) != crc32c::Value(payload, length)) {
+      break;
+    }
+    CompilationCacheIndexEntry entry;
+    if (!entry.ParseFromArray(payload, length)) break;
+    entries_[entry.key()] = std::move(entry);
+    pos += kRecordHeaderSize + length;
+    ++num_log_records_;
+  }
+  log_offset_ += pos;
+  return Status::OK();
+}
+
+Status CompilationCacheIndex::AppendLocked(
+    const CompilationCacheIndexEntry& entry) {
+  std::string log_path = getPath(getLogFileName());
+  int fd = open(log_path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) return IOError("failed to open", log_path);
+  auto closer = tensorflow::gtl::MakeCleanup([fd]() { close(fd); });
+  // The log is just created.
+  if (log_fd_ < 0) TF_RETURN_IF_ERROR(RefreshLocked());
+  struct stat log_stat;
+  if (fstat(fd, &log_stat) != 0 || log_stat.st_ino != log_inode_ ||
+      log_stat.st_dev != log_device_) {
+    return errors::Internal("log file is replaced without the lock: ",
+                            log_path);
+  }
+  // All the valid records are read while holding the lock, truncates the
+  // broken tail left by a crashed writer, if any.
+  if (log_stat.st_size > log_offset_ && ftruncate(fd, log_offset_) != 0) {
+    return IOError("failed to truncate", log_path);
+  }
+
+  std::string payload;
+  entry.SerializeToString(&payload);
+  uint32_t length = payload.size();
+  uint32_t masked_crc =
+      crc32c::Mask(crc32c::Value(payload.data(), payload.size()));
+  std::string record(kRecordHeaderSize, '\0');
+  memcpy(&record[0], &length, sizeof(length));
+  memcpy(&record[sizeof(length)], &masked_crc, sizeof(masked_crc));
+  record += payload;
+  if (!WriteFully(fd, record.data(), record.size(), log_offset_)) {
+    return IOError("failed to append to", log_path);
+  }
+  log_offset_ += record.size();
+  ++num_log_records_;
+  entries_[entry.key()] = entry;
+  return Status::OK();
+}
+
+Status CompilationCacheIndex::Insert(const CompilationCacheIndexEntry& entry,
+                                     bool override, bool* inserted) {
+  if (inserted) *inserted = false;
+  mutex_lock lock(mu_);
+  auto it = entries_.find(entry.key());
+  if (it != entries_.end() && !override) return Status::OK();
+
+  Status s = Env::Default()->RecursivelyCreateDir(cache_dir_);
+  if (!s.ok() && !errors::IsAlreadyExists(s)) {
+    errors::AppendToMessage(&s, "when creating directory ", cache_dir_);
+    return s;
+  }
+  FileLock file_lock(getPath(getLockFileName()));
+  TF_RETURN_IF_ERROR(file_lock.status());
+  // The entry may be inserted by another process meanwhile.
+  TF_RETURN_IF_ERROR(RefreshLocked());
+  if (!override && entries_.count(entry.key())) return Status::OK();
+  TF_RETURN_IF_ERROR(AppendLocked(entry));
+  if (inserted) *inserted = true;
+  if (num_log_records_ >= compaction_threshold_) {
+    TF_RETURN_IF_ERROR(CompactLocked());
+  }
+  return Status::OK();
+}
+
+bool CompilationCacheIndex::Find(const std::string& key,
+                                 CompilationCacheIndexEntry* entry) {
+  mutex_lock lock(mu_);
+  auto it = entries_.find(key);
+  if (it == entries_.end()) return false;
+  if (entry) *entry = it->second;
+  return true;
+}
+
+Status CompilationCacheIndex::Compact() {
+  mutex_lock lock(mu_);
+  if (!Env::Default()->IsDirectory(cache_dir_).ok()) return Status::OK();
+  FileLock file_lock(getPath(getLockFileName()));
+  TF_RETURN_IF_ERROR(file_lock.status());
+  TF_RETURN_IF_ERROR(RefreshLocked());
+  return CompactLocked();
+}
+
+Status CompilationCacheIndex::CompactLocked() {
+  if (log_fd_ >= 0 && num_log_records_ == 0) return Status::OK();
+  auto* env = Env::Default();
+  std::string suffix = absl::StrCat(".tmp.", getpid());
+
+  CompilationCacheIndexSnapshot snapshot;
+  for (auto& pair : entries_) {
+    *snapshot.add_entries() = pair.second;
+  }
+  std::string snapshot_path = getPath(getSnapshotFileName());
+  TF_RETURN_IF_ERROR(
+      WriteBinaryProto(env, snapshot_path + suffix, snapshot));
+  TF_RETURN_IF_ERROR(env->RenameFile(snapshot_path + suffix, snapshot_path));
+
+  // Replaces the log with an empty one, the readers of the old log see the
+  // change of the inode and reload the snapshot.
+  std::string log_path = getPath(getLogFileName());
+  int fd = open((log_path + suffix).c_str(),
+                O_RDONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) return IOError("failed to create", log_path + suffix);
+  auto closer = tensorflow::gtl::MakeCleanup([fd]() { close(fd); });
+  TF_RETURN_IF_ERROR(env->RenameFile(log_path + suffix, log_path));
+  struct stat log_stat;
+  if (fstat(fd, &log_stat) != 0) return IOError("failed to stat", log_path);
+  closer.release();
+  CloseLogLocked();
+  log_fd_ = fd;
+  log_inode_ = log_stat.st_ino;
+  log_device_ = log_stat.st_dev;
+  VLOG(1) << "Compact compilation cache index with " << entries_.size()
+          << " entries in " << cache_dir_;
+  return Status::OK();
+}
+
+size_t CompilationCacheIndex::size() {
+  mutex_lock lock(mu_);
+  return entries_.size();
+}
+
+int64 CompilationCacheIndex::numLogRecords() {
+  mutex_lock lock(mu_);
+  return num_log_records_;
+}
+
+}  // namespace tao
+}  // namespace tensorflow
@@ -0,0 +1,105 @@
+// Copyright 2022 The BladeDISC Authors. All rights reserved.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TAO_TAO_BRIDGE_COMPILATION_CACHE_INDEX_H_
+#define TAO_TAO_BRIDGE_COMPILATION_CACHE_INDEX_H_
+
+#include <sys/types.h>
+
+#include <string>
+#include <unordered_map>
+
+#include "tao_bridge/tao_compilation_result.pb.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/mutex.h"
+
+namespace tensorflow {
+namespace tao {
+
+// The on-disk index of the compilation cache, which maps the content hash of a
+// signature to the file of its compiled result. It can be shared by multiple
+// processes, and consists of the following files in the cache directory:
+//  - `disc_cache.index`: a `CompilationCacheIndexSnapshot` of the entries
+//    compacted so far, replaced atomically by renaming.
+//  - `disc_cache.log`: the entries inserted after the last compaction, each
+//    record is a length (u32), a masked crc32c (u32) and a serialized
+//    `CompilationCacheIndexEntry`.
+//  - `disc_cache.lock`: the file lock serializing the writers.
+// Inserting appends one record to the log, and the log is compacted into the
+// snapshot every `compaction_threshold` records. Readers do not take the lock:
+// a record being written fails the checksum and is read later, and a
+// compacted log is detected by the change of its inode.
+class CompilationCacheIndex {
+ public:
+  explicit CompilationCacheIndex(const std::string& cache_dir,
+                                 int64 compaction_threshold = 1024);
+  ~CompilationCacheIndex();
+
+  CompilationCacheIndex(const CompilationCacheIndex&) = delete;
+  void operator=(const CompilationCacheIndex&) = delete;
+
+  static std::string getSnapshotFileName() { return "disc_cache.index"; }
+  static std::string getLogFileName() { return "disc_cache.log"; }
+  static std::string getLockFileName() { return "disc_cache.lock"; }
+
+  // Loads the entries inserted by all the processes so far, including the
+  // ones inserted since the last call.
+  Status Refresh();
+
+  // Returns true and fills `entry` if `key` is found. Does not look for the
+  // entries inserted by other processes after the last `Refresh`.
+  bool Find(const std::string& key, CompilationCacheIndexEntry* entry);
+
+  // Inserts `entry` if its key is not found, or overrides the existing one if
+  // `override` is true. `inserted` is set to true if the index is updated.
+  Status Insert(const CompilationCacheIndexEntry& entry, bool override,
+                bool* inserted = nullptr);
+
+  // Merges the log into the snapshot.
+  Status Compact();
+
+  // Returns the number of entries.
+  size_t size();
+
+  // Returns the number of records in the log read or written by this
+  // instance since the last compaction it observed.
+  int64 numLogRecords();
+
+ private:
+  std::string getPath(const std::string& name) const {
+    return cache_dir_ + "/" + name;
+  }
+
+  Status RefreshLocked();
+  Status LoadSnapshotLocked();
+  // Reads the records appended after `log_offset_`.
+  Status ReadLogLocked();
+  Status CompactLocked();
+  Status AppendLocked(const CompilationCacheIndexEntry& entry);
+  void CloseLogLocked();
+
+  mutex mu_;
+  const std::string cache_dir_;
+  const int64 compaction_threshold_;
+  std::unordered_map<std::string, CompilationCacheIndexEntry> entries_;
+
+  // The log file being read, and the end of the last valid record in it.
+  int log_fd_ = -1;
+  ino_t log_inode_ = 0;
+  dev_t log_device_ = 0;
+  off_t log_offset_ = 0;
+  int64 num_log_records_ = 0;
+};
+
+}  // namespace tao
+}  // namespace tensorflow
+
+#endif  // TAO_TAO_BRIDGE_COMPILATION_CACHE_INDEX_H_
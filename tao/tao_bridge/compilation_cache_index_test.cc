@@ -0,0 +1,140 @@
+// Copyright 2022 The BladeDISC Authors. All rights reserved.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tao_bridge/compilation_cache_index.h"
+
+#include <fstream>
+
+#include "gtest/gtest.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+
+namespace tensorflow {
+namespace tao {
+namespace {
+
+std::string MakeCacheDir() {
+  std::string dir;
+  CHECK(Env::Default()->LocalTempFilename(&dir));
+  return dir;
+}
+
+CompilationCacheIndexEntry MakeEntry(const std::string& key,
+                                     const std::string& filename) {
+  CompilationCacheIndexEntry entry;
+  entry.set_key(key);
+  entry.set_filename(filename);
+  entry.set_target_device("CPU");
+  return entry;
+}
+
+TEST(CompilationCacheIndexTest, TestInsertAndReload) {
+  std::string dir = MakeCacheDir();
+  {
+    CompilationCacheIndex index(dir);
+    TF_ASSERT_OK(index.Refresh());
+    bool inserted = false;
+    TF_ASSERT_OK(index.Insert(MakeEntry("a", "file_a"), false, &inserted));
+    EXPECT_TRUE(inserted);
+    TF_ASSERT_OK(index.Insert(MakeEntry("a", "file_b"), false, &inserted));
+    EXPECT_FALSE(inserted);
+    TF_ASSERT_OK(index.Insert(MakeEntry("b", "file_b"), false, &inserted));
+    EXPECT_TRUE(inserted);
+    EXPECT_EQ(index.numLogRecords(), 2);
+  }
+
+  CompilationCacheIndex index(dir);
+  TF_ASSERT_OK(index.Refresh());
+  CompilationCacheIndexEntry entry;
+  ASSERT_TRUE(index.Find("a", &entry));
+  EXPECT_EQ(entry.filename(), "file_a");
+  ASSERT_TRUE(index.Find("b", &entry));
+  EXPECT_EQ(entry.filename(), "file_b");
+  EXPECT_FALSE(index.Find("c", &entry));
+
+  bool inserted = false;
+  TF_ASSERT_OK(index.Insert(MakeEntry("a", "file_c"), true, &inserted));
+  EXPECT_TRUE(inserted);
+  CompilationCacheIndex reloaded(dir);
+  TF_ASSERT_OK(reloaded.Refresh());
+  ASSERT_TRUE(reloaded.Find("a", &entry));
+  EXPECT_EQ(entry.filename(), "file_c");
+}
+
+TEST(CompilationCacheIndexTest, TestSharedByMultipleInstances) {
+  std::string dir = MakeCacheDir();
+  CompilationCacheIndex writer(dir);
+  CompilationCacheIndex reader(dir);
+  TF_ASSERT_OK(writer.Refresh());
+  TF_ASSERT_OK(reader.Refresh());
+
+  TF_ASSERT_OK(writer.Insert(MakeEntry("a", "file_a"), false));
+  EXPECT_FALSE(reader.Find("a", nullptr));
+  TF_ASSERT_OK(reader.Refresh());
+  EXPECT_TRUE(reader.Find("a", nullptr));
+
+  // The reader picks up the entries across the compaction of the writer.
+  TF_ASSERT_OK(writer.Insert(MakeEntry("b", "file_b"), false));
+  TF_ASSERT_OK(writer.Compact());
+  EXPECT_EQ(writer.numLogRecords(), 0);
+  TF_ASSERT_OK(writer.Insert(MakeEntry("c", "file_c"), false));
+  TF_ASSERT_OK(reader.Refresh());
+  EXPECT_EQ(reader.size(), 3);
+  EXPECT_EQ(reader.numLogRecords(), 1);
+
+  // The reader does not append the entry inserted by the writer again.
+  bool inserted = true;
+  TF_ASSERT_OK(reader.Insert(MakeEntry("c", "file_d"), false, &inserted));
+  EXPECT_FALSE(inserted);
+}
+
+TEST(CompilationCacheIndexTest, TestCompactionThreshold) {
+  std::string dir = MakeCacheDir();
+  CompilationCacheIndex index(dir, /*compaction_threshold=*/4);
+  TF_ASSERT_OK(index.Refresh());
+  for (int i = 0; i < 10; ++i) {
+    std::string key = std::to_string(i);
+    TF_ASSERT_OK(index.Insert(MakeEntry(key, "file_" + key), false));
+  }
+  EXPECT_EQ(index.numLogRecords(), 2);
+
+  CompilationCacheIndex reloaded(dir);
+  TF_ASSERT_OK(reloaded.Refresh());
+  EXPECT_EQ(reloaded.size(), 10);
+}
+
+TEST(CompilationCacheIndexTest, TestBrokenLogTail) {
+  std::string dir = MakeCacheDir();
+  {
+    CompilationCacheIndex index(dir);
+    TF_ASSERT_OK(index.Insert(MakeEntry("a", "file_a"), false));
+  }
+  // Simulates a writer crashed in the middle of appending a record.
+  {
+    std::ofstream log(dir + "/" + CompilationCacheIndex::getLogFileName(),
+                      std::ios::app | std::ios::binary);
+    log.write("\x10\x00\x00\x00\x01", 5);
+  }
+
+  CompilationCacheIndex index(dir);
+  TF_ASSERT_OK(index.Refresh());
+  EXPECT_EQ(index.size(), 1);
+  TF_ASSERT_OK(index.Insert(MakeEntry("b", "file_b"), false));
+
+  CompilationCacheIndex reloaded(dir);
+  TF_ASSERT_OK(reloaded.Refresh());
+  EXPECT_EQ(reloaded.size(), 2);
+  EXPECT_TRUE(reloaded.Find("b", nullptr));
+}
+
+}  // namespace
+}  // namespace tao
+}  // namespace tensorflow
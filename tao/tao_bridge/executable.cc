@@ -11,6 +11,8 @@
 
 #include "tao_bridge/executable.h"
 
+#include <unistd.h>
+
 #include "absl/strings/str_cat.h"
 #include "tensorflow/core/framework/allocation_description.pb.h"
 #include "tensorflow/core/framework/resource_var.h"
@@ -331,9 +333,38 @@ Status Executable::PostRunProcess(const ExecutableRunOptions& options,
 }
 
 void Executable::DumpToFile(const std::string& filename) const {
-  CHECK(WriteBinaryProto(tensorflow::Env::Default(), filename,
-                         *compiled_result_.get())
-            .ok());
+  TF_CHECK_OK(WriteCompilerResultAtomically(filename, *compiled_result_.get(),
+                                            /*text_format=*/false));
+}
+
+namespace {
+
+std::string TempFileName(const std::string& filename) {
+  return absl::StrCat(filename, ".tmp.", getpid());
+}
+
+}  // namespace
+
+/* static */ Status Executable::CopyFileAtomically(const std::string& src,
+                                                   const std::string& dst) {
+  auto* env = tensorflow::Env::Default();
+  std::string tmp = TempFileName(dst);
+  Status status = env->CopyFile(src, tmp);
+  if (status.ok()) status = env->RenameFile(tmp, dst);
+  if (!status.ok()) env->DeleteFile(tmp);
+  return status;
+}
+
+/* static */ Status Executable::WriteCompilerResultAtomically(
+    const std::string& filename, const TaoCompilerResult& result,
+    bool text_format) {
+  auto* env = tensorflow::Env::Default();
+  std::string tmp = TempFileName(filename);
+  Status status = text_format ? WriteTextProto(env, tmp, result)
+                              : WriteBinaryProto(env, tmp, result);
+  if (status.ok()) status = env->RenameFile(tmp, filename);
+  if (!status.ok()) env->DeleteFile(tmp);
+  return status;
 }
 
 std::unique_ptr<Executable> ExecutableFactory::NewExecutable(
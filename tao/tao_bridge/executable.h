@@ -180,6 +180,14 @@ class ExecutableRunOptions {
   }
   const std::map<int, OptionalTensor>& variables() const { return variables_; }
 
+  // Inputs padded to their bucketed shapes, which replace the inputs of the
+  // op context.
+  ExecutableRunOptions& set_padded_inputs(std::map<int, Tensor> inputs) {
+    padded_inputs_ = std::move(inputs);
+    return *this;
+  }
+  const std::map<int, Tensor>& padded_inputs() const { return padded_inputs_; }
+
   ExecutableRunOptions& set_profile_state(ProfileState* state) {
     profile_state_ = state;
     return *this;
@@ -190,6 +198,7 @@ class ExecutableRunOptions {
   OpKernelContext* ctx_ = nullptr;
   int num_constant_args_ = 0;
   std::map<int, OptionalTensor> variables_;
+  std::map<int, Tensor> padded_inputs_;
   ProfileState* profile_state_ = nullptr;
 };
 
@@ -206,6 +215,9 @@ class Executable {
 
   std::string compiled_result_file() const { return compiled_result_file_; }
 
+  // Dumps the compiled result to `filename`, along with the files it refers
+  // to. Each file is written under a temp name and then renamed to its final
+  // name, since it may be loaded by other processes meanwhile.
   virtual void DumpToFile(const std::string& filename) const;
 
   virtual std::string target_device() const = 0;
@@ -225,6 +237,16 @@ class Executable {
                                 BufferAllocations& allocations,
                                 std::vector<Tensor>& output_tensors);
 
+  // Copies `src` to `dst` via a temp file next to `dst`, thus `dst` is either
+  // missing, the old one or the complete new one at any time.
+  static Status CopyFileAtomically(const std::string& src,
+                                   const std::string& dst);
+
+  // Writes `result` to `filename` via a temp file, see `CopyFileAtomically`.
+  static Status WriteCompilerResultAtomically(const std::string& filename,
+                                              const TaoCompilerResult& result,
+                                              bool text_format);
+
   virtual Status StartProfiler(const ExecutableRunOptions& options) {
     return Status::OK();
   }
@@ -11,11 +11,65 @@
 
 #include "tao_bridge/kernels/disc_launch.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include "tensorflow/stream_executor/stream_executor.h"
 
 namespace tensorflow {
 namespace tao {
 
+namespace {
+
+std::vector<int64_t> ToDims(const TensorShape& shape) {
+  std::vector<int64_t> dims(shape.dims());
+  for (int i = 0; i < shape.dims(); ++i) dims[i] = shape.dim_size(i);
+  return dims;
+}
+
+TensorShape ToTensorShape(const std::vector<int64_t>& dims) {
+  TensorShape shape;
+  for (int64_t dim : dims) shape.AddDim(dim);
+  return shape;
+}
+
+// Copies the region shared by `src` and `dst` of the same rank, and zeros the
+// rest of `dst` if `zero_fill` is true. Both are in device memory unless
+// `on_host` is true.
+void CopySharedRegion(OpKernelContext* ctx, const Tensor& src, Tensor* dst,
+                      bool on_host, bool zero_fill) {
+  auto to_ptr = [](const Tensor& tensor) {
+    return const_cast<char*>(tensor.tensor_data().data());
+  };
+  char* src_ptr = to_ptr(src);
+  char* dst_ptr = to_ptr(*dst);
+  int64 elem_bytes = DataTypeSize(src.dtype());
+  if (on_host) {
+    if (zero_fill) std::memset(dst_ptr, 0, dst->TotalBytes());
+    ::tao::ral::forEachSharedChunk(
+        ToDims(src.shape()), ToDims(dst->shape()), elem_bytes,
+        [&](int64_t dst_offset, int64_t src_offset, int64_t bytes) {
+          std::memcpy(dst_ptr + dst_offset, src_ptr + src_offset, bytes);
+        });
+    return;
+  }
+  auto stream = ctx->op_device_context()->stream();
+  if (zero_fill) {
+    se::DeviceMemoryBase dst_mem(dst_ptr, dst->TotalBytes());
+    stream->ThenMemZero(&dst_mem, dst->TotalBytes());
+  }
+  ::tao::ral::forEachSharedChunk(
+      ToDims(src.shape()), ToDims(dst->shape()), elem_bytes,
+      [&](int64_t dst_offset, int64_t src_offset, int64_t bytes) {
+        se::DeviceMemoryBase dst_mem(dst_ptr + dst_offset, bytes);
+        stream->ThenMemcpy(&dst_mem,
+                           se::DeviceMemoryBase(src_ptr + src_offset, bytes),
+                           bytes);
+      });
+}
+
+}  // namespace
+
 DiscLaunchOp::DiscLaunchOp(OpKernelConstruction* ctx)
     : LaunchBase(ctx),
       mlir_function_(FunctionAttr("mlir_function")),
@@ -27,6 +81,14 @@ DiscLaunchOp::DiscLaunchOp(OpKernelConstruction* ctx)
   mode_ = bridge_opts->tao_launch_async_compilation ? kAsync : kDefault;
   mlir_compile_status_ = Status::OK();
   tick_.reset(new TaoLaunchTick(name()));
+  if (!bridge_opts->disc_shape_bucketing.empty()) {
+    std::string error;
+    shape_bucketing_ = ::tao::ral::ShapeBucketingPolicy::parse(
+        bridge_opts->disc_shape_bucketing, &error);
+    if (!shape_bucketing_) {
+      LOG(WARNING) << "Shape bucketing is disabled: " << error;
+    }
+  }
 }
 
 DiscLaunchOp::~DiscLaunchOp() {
@@ -89,10 +151,21 @@ Status DiscLaunchOp::CompileAndRunMlir(OpKernelContext* ctx, DoneHelper* helper,
     return Status::OK();
   }
 
+  // With shape bucketing, the inputs are compiled with the static shapes they
+  // are padded to, otherwise with dynamic shapes.
+  std::map<int, TensorShape> bucketed_shapes;
+  ::tao::ral::BucketedDims bucketed_dims;
+  if (shape_bucketing_ &&
+      !BucketInputShapes(ctx, &bucketed_shapes, &bucketed_dims)) {
+    VLOG(1) << "Inputs of " << name() << " are not bucketed.";
+    bucketed_shapes.clear();
+    bucketed_dims.clear();
+  }
+
   auto call_info = &(helper->call_info);
-  TF_RETURN_IF_ERROR(
-      CompileToLocalExecutable(ctx, mlir_function_, /* is_mlir */ true,
-                               call_info, &variables, &mlir_executable, &stat));
+  TF_RETURN_IF_ERROR(CompileToLocalExecutable(
+      ctx, mlir_function_, /* is_mlir */ true, bucketed_shapes, call_info,
+      &variables, &mlir_executable, &stat));
 
   if (mlir_executable == nullptr) {
     return Status::OK();
@@ -103,12 +176,101 @@ Status DiscLaunchOp::CompileAndRunMlir(OpKernelContext* ctx, DoneHelper* helper,
   ExecutableRunOptions options;
   TF_RETURN_IF_ERROR(PrepareExecutableRunOptions(ctx, ConstantsAttr().size(),
                                                  variables, &options));
+  if (bucketed_shapes.empty()) {
+    return RunExecutable(mlir_executable, options, call_info);
+  }
+
+  std::map<int, Tensor> padded_inputs;
+  TF_RETURN_IF_ERROR(PadInputs(ctx, bucketed_shapes, &padded_inputs));
+  options.set_padded_inputs(std::move(padded_inputs));
+  TF_RETURN_IF_ERROR(RunExecutable(mlir_executable, options, call_info));
+  return SliceOutputs(ctx, bucketed_dims);
+}
+
+bool DiscLaunchOp::BucketInputShapes(OpKernelContext* ctx,
+                                     std::map<int, TensorShape>* bucketed,
+                                     ::tao::ral::BucketedDims* dims) {
+  // The inputs whose shapes are compiled as is.
+  std::set<int> excluded;
+  excluded.insert(ConstantsAttr().begin(), ConstantsAttr().end());
+  excluded.insert(FixedShapesAttr().begin(), FixedShapesAttr().end());
+  excluded.insert(HostArgsAttr().begin(), HostArgsAttr().end());
+  excluded.insert(ResourcesAttr().begin(), ResourcesAttr().end());
+  for (int i = 0; i < ctx->num_inputs(); ++i) {
+    if (excluded.count(i)) continue;
+    const Tensor& input = ctx->input(i);
+    std::vector<int64_t> padded_dims;
+    if (!shape_bucketing_->bucketShape(ToDims(input.shape()), &padded_dims,
+                                       dims)) {
+      return false;
+    }
+    TensorShape padded_shape = ToTensorShape(padded_dims);
+    if (padded_shape != input.shape() &&
+        !DataTypeCanUseMemcpy(input.dtype())) {
+      return false;
+    }
+    bucketed->emplace(i, padded_shape);
+  }
+  return true;
+}
 
-  return RunExecutable(mlir_executable, options, call_info);
+Status DiscLaunchOp::PadInputs(OpKernelContext* ctx,
+                               const std::map<int, TensorShape>& bucketed,
+                               std::map<int, Tensor>* padded_inputs) {
+  for (auto& pair : bucketed) {
+    const Tensor& input = ctx->input(pair.first);
+    if (input.shape() == pair.second) continue;
+    bool on_host = !ctx->op_device_context() ||
+                   ctx->input_memory_type(pair.first) == HOST_MEMORY;
+    AllocatorAttributes alloc_attr;
+    alloc_attr.set_on_host(on_host);
+    Tensor padded;
+    TF_RETURN_IF_ERROR(
+        ctx->allocate_temp(input.dtype(), pair.second, &padded, alloc_attr));
+    CopySharedRegion(ctx, input, &padded, on_host, /*zero_fill=*/true);
+    padded_inputs->emplace(pair.first, padded);
+  }
+  return Status::OK();
+}
+
+Status DiscLaunchOp::SliceOutputs(OpKernelContext* ctx,
+                                  const ::tao::ral::BucketedDims& dims) {
+  for (int i = 0; i < ctx->num_outputs(); ++i) {
+    Tensor* output = ctx->mutable_output(i);
+    if (output == nullptr) continue;
+    auto padded_dims = ToDims(output->shape());
+    std::vector<int64_t> sliced_dims;
+    if (!shape_bucketing_->getSlicedShape(i, padded_dims, dims,
+                                          &sliced_dims)) {
+      return errors::InvalidArgument(
+          "Output #", i, " of ", name(), " with shape ",
+          output->shape().DebugString(),
+          " does not follow the shape bucketing spec: ",
+          GetTaoBridgeOptions()->disc_shape_bucketing);
+    }
+    if (sliced_dims == padded_dims) continue;
+    if (std::equal(padded_dims.begin() + 1, padded_dims.end(),
+                   sliced_dims.begin() + 1)) {
+      // Only the leading dim is sliced, which shares the buffer.
+      *output = output->Slice(0, sliced_dims[0]);
+      continue;
+    }
+    bool on_host =
+        !ctx->op_device_context() || ctx->output_memory_type(i) == HOST_MEMORY;
+    AllocatorAttributes alloc_attr;
+    alloc_attr.set_on_host(on_host);
+    Tensor sliced;
+    TF_RETURN_IF_ERROR(ctx->allocate_temp(
+        output->dtype(), ToTensorShape(sliced_dims), &sliced, alloc_attr));
+    CopySharedRegion(ctx, *output, &sliced, on_host, /*zero_fill=*/false);
+    *output = sliced;
+  }
+  return Status::OK();
 }
 
 Status DiscLaunchOp::CompileToLocalExecutable(
     OpKernelContext* ctx, const NameAttrList& function, bool is_mlir,
+    const std::map<int, TensorShape>& bucketed,
     TaoCompileFuncCallInfo* call_info, std::map<int, OptionalTensor>* variables,
     tao::Executable** executable, TaoProfileStat** stat) {
   TaoCompInfoCollector::Get().SetCallTimestamp(call_info,
@@ -196,8 +358,9 @@ Status DiscLaunchOp::CompileToLocalExecutable(
   fixed_shape_args.insert(FixedShapesAttr().begin(), FixedShapesAttr().end());
   host_args_set.insert(HostArgsAttr().begin(), HostArgsAttr().end());
   auto status = cache->Compile(std::move(input_ptr), function, constant_args,
-                               fixed_shape_args, host_args_set, *variables, ctx,
-                               executable, stat, is_mlir, call_info);
+                               fixed_shape_args, host_args_set, bucketed,
+                               *variables, ctx, executable, stat, is_mlir,
+                               call_info);
   TaoCompInfoCollector::Get().SetCallTimestamp(call_info,
                                                TIME_COMPILE_CALL_END);
   return status;
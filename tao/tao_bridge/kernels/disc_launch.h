@@ -15,6 +15,7 @@
 #include "tao_bridge/common.h"
 #include "tao_bridge/kernels/launch_base.h"
 #include "tao_bridge/kernels/platform_info.h"
+#include "tensorflow/compiler/mlir/xla/ral/ral_shape_bucketing.h"
 #include "tensorflow/core/framework/function.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/stream_executor/platform.h"
@@ -37,11 +38,25 @@ class DiscLaunchOp : public LaunchBase {
 
   Status CompileToLocalExecutable(OpKernelContext* ctx,
                                   const NameAttrList& function, bool is_mlir,
+                                  const std::map<int, TensorShape>& bucketed,
                                   TaoCompileFuncCallInfo* call_info,
                                   std::map<int, OptionalTensor>* variables,
                                   tao::Executable** executable,
                                   TaoProfileStat** stat);
 
+  // Computes the shapes the inputs are padded to by shape bucketing. Returns
+  // false if the inputs of this call can not be bucketed.
+  bool BucketInputShapes(OpKernelContext* ctx,
+                         std::map<int, TensorShape>* bucketed,
+                         ::tao::ral::BucketedDims* dims);
+  // Pads the inputs with zeros to their bucketed shapes.
+  Status PadInputs(OpKernelContext* ctx,
+                   const std::map<int, TensorShape>& bucketed,
+                   std::map<int, Tensor>* padded_inputs);
+  // Slices the padding off the outputs designated by the shape bucketing spec.
+  Status SliceOutputs(OpKernelContext* ctx,
+                      const ::tao::ral::BucketedDims& dims);
+
   NameAttrList mlir_function_;
   FunctionLibraryRuntime::Handle mlir_func_handle_;
 
@@ -55,6 +70,9 @@ class DiscLaunchOp : public LaunchBase {
   Status mlir_compile_status_;
   std::shared_ptr<TaoLaunchTick> tick_;
 
+  // Not null if shape bucketing is enabled.
+  std::unique_ptr<::tao::ral::ShapeBucketingPolicy> shape_bucketing_;
+
   std::atomic<int> err_msg_print_counter_{0};
   TF_DISALLOW_COPY_AND_ASSIGN(DiscLaunchOp);
 };
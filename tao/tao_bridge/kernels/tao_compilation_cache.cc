@@ -12,10 +12,14 @@
 #include "tao_bridge/kernels/tao_compilation_cache.h"
 
 #include <dlfcn.h>
+#include <fcntl.h>
 #include <sys/wait.h>
+#include <unistd.h>
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <cstring>
 #include <ctime>
 #include <fstream>
 #include <functional>
@@ -26,7 +30,9 @@
 
 #include "absl/strings/str_cat.h"
 #include "tao_bridge/common.h"
+#include "tao_bridge/compilation_cache_index.h"
 #include "tao_bridge/dumper_common.h"
+#include "tao_bridge/kernels/tao_compiler_daemon_client.h"
 #include "tao_bridge/passes/tao_build_tao_op_pass.h"
 #include "tao_bridge/tao_util.h"
 #include "tao_bridge/tf/dump_graph.h"
@@ -36,7 +42,9 @@
 #include "tensorflow/core/framework/function.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/cleanup.h"
+#include "tensorflow/core/platform/fingerprint.h"
 #include "tensorflow/core/platform/subprocess.h"
 #include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/ptr_util.h"
@@ -325,11 +333,14 @@ using ItemSignature = TaoCompilationCache::Signature;
 // feature. 2, We may have multiple intances of TaoCompilationCache if we have
 // multiple sessions in the same process. However there should be only one
 // instance of PersistentCompliationCache in order to get stable result.
+// 3, The cache directory can be shared by multiple processes, see
+// `CompilationCacheIndex` for the layout of the index. The compiled results
+// inserted by other processes are picked up when missing in the local index.
 class PersistentCompliationCache {
  public:
   // cache_dump_path: the path used to store the cache files.
   explicit PersistentCompliationCache(const string& cache_dump_path)
-      : cache_dump_path_(cache_dump_path) {
+      : cache_dump_path_(cache_dump_path), index_(cache_dump_path) {
     auto status = LoadFromFile();
     TF_CHECK_OK(status);
   }
@@ -345,7 +356,8 @@ class PersistentCompliationCache {
   PersistentCompliationCache(const PersistentCompliationCache&) = delete;
   void operator=(const PersistentCompliationCache&) = delete;
 
-  // Returns the name of file used to store `CompilationCacheResult`.
+  // Returns the name of file used to store `CompilationCacheResult` by the
+  // legacy versions, which is imported into the index when loading.
   static string getCacheTableFileName() { return "disc_cache"; }
 
   // Returns the path of file used to store `CompilationCacheResult`.
@@ -360,13 +372,11 @@ class PersistentCompliationCache {
     return cache;
   }
 
-  // Saves cache table to file located at `getCacheTableFilePath`.
-  Status DumpToFile() {
-    mutex_lock lock(mu_);
-    return DumpToFileLocked();
-  }
+  // Compacts the index on disk. The entries are written through when updated,
+  // thus there is nothing to flush.
+  Status DumpToFile() { return index_.Compact(); }
 
-  // Loads cache table from file located at `getCacheTableFilePath`.
+  // Loads the index, and imports the legacy cache table file if any.
   Status LoadFromFile();
 
   // Returns true if found, otherwise return false.
@@ -374,120 +384,143 @@ class PersistentCompliationCache {
   // compiled result proto corresponding to `sig`.
   bool find(const std::string& target_device, const ItemSignature& sig,
             std::string& out_filename) {
-    mutex_lock lock(mu_);
-    auto& device_level_cache = cache_[target_device];
-    auto it = device_level_cache.find(sig);
-    if (it != device_level_cache.end()) out_filename = it->second;
-    return it != device_level_cache.end();
+    return find(getKey(target_device, sig), out_filename);
+  }
+
+  // Same as above, but looks up the content hash of the signature.
+  bool find(const std::string& key, std::string& out_filename) {
+    CompilationCacheIndexEntry entry;
+    bool found = index_.Find(key, &entry);
+    if (!found) {
+      // It may be compiled by another process sharing the cache.
+      Status status = index_.Refresh();
+      if (!status.ok()) {
+        LOG(WARNING) << "fail to refresh compilation cache: "
+                     << status.error_message();
+      }
+      found = index_.Find(key, &entry);
+    }
+    if (found) out_filename = entry.filename();
+    return found;
   }
 
   // Update the value for key `sig` to `filename`. Override the value if
-  // `override` is ture. Returns true if updated.
+  // `override` is ture. Returns true if updated. Appends a record to the index
+  // on disk, which costs O(1) regardless of the size of the cache.
   bool update(const std::string& target_device, const ItemSignature& sig,
-              const std::string& filename, bool override = false,
-              bool write_through = true) {
-    mutex_lock lock(mu_);
-    auto& device_level_cache = cache_[target_device];
-    auto it = device_level_cache.emplace(sig, filename);
-    bool updated = it.second;
-    if (override && !updated) {
-      it.first->second = filename;
-      updated = true;
-    }
-    if (updated) {
-      is_cache_dirty_ = true;
-      if (write_through) {
-        TF_CHECK_OK(DumpToFileLocked());
-      }
-    }
+              const std::string& filename, bool override = false) {
+    return update(target_device, getKey(target_device, sig), filename,
+                  override);
+  }
+
+  // Same as above, but updates the content hash of the signature.
+  bool update(const std::string& target_device, const std::string& key,
+              const std::string& filename, bool override = false) {
+    CompilationCacheIndexEntry entry;
+    entry.set_key(key);
+    entry.set_filename(filename);
+    entry.set_target_device(target_device);
+    bool updated = false;
+    TF_CHECK_OK(index_.Insert(entry, override, &updated));
     return updated;
   }
 
-  // Returns a (per-process-level) unique name used for saving compiled result
-  // proto on disc.
+  // Returns a unique name used for saving compiled result proto on disc. The
+  // file is created exclusively, thus the name is unique across the processes
+  // sharing the cache.
   std::string getNextUniqueNameOfCompiledResultProto() {
-    mutex_lock lock(mu_);
+    Status s = tensorflow::Env::Default()->RecursivelyCreateDir(
+        cache_dump_path_);
+    if (!s.ok() && !errors::IsAlreadyExists(s)) {
+      LOG(WARNING) << "fail to create " << cache_dump_path_ << ": "
+                   << s.error_message();
+    }
     std::string path;
-    do {
+    while (true) {
       path =
           absl::StrCat(cache_dump_path_, "/", "disc_cache_item_", next_idx_++);
-    } while (tensorflow::Env::Default()->FileExists(path).ok());
+      int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+                    0644);
+      if (fd >= 0) {
+        close(fd);
+        break;
+      }
+      if (errno != EEXIST) {
+        LOG(WARNING) << "fail to create " << path << ": " << strerror(errno);
+        break;
+      }
+    }
     return path;
   }
 
- private:
-  // Saves cache table to file located at `getCacheTableFilePath`.
-  Status DumpToFileLocked();
+  // Dumps the compiled result of `executable` to `filename`. Each file is
+  // written atomically under its final name by `Executable::DumpToFile`, since
+  // the files may be loaded by other processes meanwhile.
+  static void DumpExecutableToFile(const Executable& executable,
+                                   const std::string& filename) {
+    executable.DumpToFile(filename);
+  }
+
+  // Returns the content hash of `sig` on `target_device`.
+  static std::string getKey(const std::string& target_device,
+                            const ItemSignature& sig);
+
+  // Returns the content hash of `sig_proto` on `target_device`.
+  static std::string getKey(const std::string& target_device,
+                            const EntrySignature& sig_proto);
 
  private:
-  mutex mu_;
   string cache_dump_path_;
-  using DeviceLevelCache =
-      std::unordered_map<ItemSignature, string, ItemSignature::Hash>;
-  // target device str -> device level cache.
-  std::unordered_map<std::string, DeviceLevelCache> cache_;
-  std::atomic<uint64_t> next_idx_;
-  bool is_cache_dirty_ = false;
+  CompilationCacheIndex index_;
+  std::atomic<uint64_t> next_idx_{0};
 };
 
-Status PersistentCompliationCache::DumpToFileLocked() {
-  if (!is_cache_dirty_) return Status::OK();
-
-  VLOG(2) << "Dump compilation cache to: " << cache_dump_path_;
-  CompilationCacheResult result;
-  Status s = tensorflow::Env::Default()->RecursivelyCreateDir(cache_dump_path_);
-  if (!s.ok() && !errors::IsAlreadyExists(s)) {
-    errors::AppendToMessage(&s, "when creating directory ", cache_dump_path_);
-    return s;
-  }
-
-  for (auto& outter : cache_) {
-    auto& device = outter.first;
-    auto& device_level_cache = outter.second;
-    for (auto& inner : device_level_cache) {
-      auto& sig = inner.first;
-      auto entry = result.add_entries();
-      entry->set_filename(inner.second);
-      entry->set_target_device(device);
-      auto& sig_proto = *entry->mutable_sig();
-      *sig_proto.mutable_name() = sig.name;
-      for (size_t i = 0; i < sig.arg_ranks.size(); ++i) {
-        const auto& pair = sig.arg_ranks[i];
-        TypeRankPair* pair_proto = sig_proto.add_arg_ranks();
-        pair_proto->set_type(static_cast<int>(pair.first));
-        pair_proto->set_rank(pair.second);
-      }
-      for (size_t i = 0; i < sig.arg_types.size(); ++i) {
-        const auto& pair = sig.arg_types[i];
-        tensorflow::TensorShapeProto shape_proto;
-        pair.second.AsProto(&shape_proto);
-        TypeShapePair* pair_proto = sig_proto.add_arg_types();
-        pair_proto->set_type(static_cast<int>(pair.first));
-        shape_proto.AppendToString(pair_proto->mutable_shape());
-      }
-      for (size_t i = 0; i < sig.host_args.size(); ++i) {
-        sig_proto.add_host_args(sig.host_args[i]);
-      }
-      for (size_t i = 0; i < sig.arg_values.size(); ++i) {
-        tensorflow::TensorProto tensor_proto;
-        sig.arg_values[i].AsProtoTensorContent(&tensor_proto);
-        tensor_proto.AppendToString(sig_proto.add_arg_values());
-      }
-    }
-  }
+/* static */ std::string PersistentCompliationCache::getKey(
+    const std::string& target_device, const ItemSignature& sig) {
+  EntrySignature sig_proto;
+  *sig_proto.mutable_name() = sig.name;
+  for (size_t i = 0; i < sig.arg_ranks.size(); ++i) {
+    const auto& pair = sig.arg_ranks[i];
+    TypeRankPair* pair_proto = sig_proto.add_arg_ranks();
+    pair_proto->set_type(static_cast<int>(pair.first));
+    pair_proto->set_rank(pair.second);
+  }
+  for (size_t i = 0; i < sig.arg_types.size(); ++i) {
+    const auto& pair = sig.arg_types[i];
+    tensorflow::TensorShapeProto shape_proto;
+    pair.second.AsProto(&shape_proto);
+    TypeShapePair* pair_proto = sig_proto.add_arg_types();
+    pair_proto->set_type(static_cast<int>(pair.first));
+    shape_proto.AppendToString(pair_proto->mutable_shape());
+  }
+  for (size_t i = 0; i < sig.host_args.size(); ++i) {
+    sig_proto.add_host_args(sig.host_args[i]);
+  }
+  for (size_t i = 0; i < sig.arg_values.size(); ++i) {
+    tensorflow::TensorProto tensor_proto;
+    sig.arg_values[i].AsProtoTensorContent(&tensor_proto);
+    tensor_proto.AppendToString(sig_proto.add_arg_values());
+  }
+  return getKey(target_device, sig_proto);
+}
 
-  TF_RETURN_IF_ERROR(WriteBinaryProto(tensorflow::Env::Default(),
-                                      getCacheTableFilePath(), result));
-  is_cache_dirty_ = false;
-  return Status::OK();
+/* static */ std::string PersistentCompliationCache::getKey(
+    const std::string& target_device, const EntrySignature& sig_proto) {
+  std::string content = absl::StrCat(target_device, "\n");
+  sig_proto.AppendToString(&content);
+  Fprint128 fp = Fingerprint128(content);
+  return absl::StrCat(absl::Hex(fp.high64, absl::kZeroPad16),
+                      absl::Hex(fp.low64, absl::kZeroPad16));
 }
 
 Status PersistentCompliationCache::LoadFromFile() {
+  TF_RETURN_IF_ERROR(index_.Refresh());
+
   CompilationCacheResult result;
-  // Early return if the cache file is not created before.
+  // Early return if the legacy cache file is not created before.
   if (!tensorflow::Env::Default()->FileExists(getCacheTableFilePath()).ok()) {
-    VLOG(2) << "Skip load compilation cache due to no "
-            << getCacheTableFilePath();
+    LOG(INFO) << "Load compilation cache success from " << cache_dump_path_
+              << " with " << index_.size() << " entries.";
     return Status::OK();
   }
   if (!ReadBinaryProto(tensorflow::Env::Default(), getCacheTableFilePath(),
@@ -497,43 +530,117 @@ Status PersistentCompliationCache::LoadFromFile() {
                             getCacheTableFilePath());
   }
 
+  // The signature is not deserialized, its serialized bytes are hashed as the
+  // key directly.
+  int num_imported = 0;
   for (int i = 0; i < result.entries_size(); ++i) {
-    auto& sig_proto = result.entries(i).sig();
-    ItemSignature sig;
-    sig.name = sig_proto.name();
-    for (int j = 0; j < sig_proto.arg_ranks_size(); ++j) {
-      const TypeRankPair& pair_proto = sig_proto.arg_ranks(j);
-      sig.arg_ranks.emplace_back(
-          static_cast<tensorflow::DataType>(pair_proto.type()),
-          pair_proto.rank());
-    }
-    for (int j = 0; j < sig_proto.arg_types_size(); ++j) {
-      const TypeShapePair& pair_proto = sig_proto.arg_types(j);
-      tensorflow::TensorShapeProto shape_proto;
-      shape_proto.ParseFromString(pair_proto.shape());
-      sig.arg_types.emplace_back(
-          static_cast<tensorflow::DataType>(pair_proto.type()),
-          tensorflow::TensorShape(shape_proto));
-    }
-    for (int j = 0; j < sig_proto.host_args_size(); ++j) {
-      sig.host_args.push_back(sig_proto.host_args(j));
-    }
-    for (int j = 0; j < sig_proto.arg_values_size(); ++j) {
-      tensorflow::TensorProto tensor_proto;
-      tensor_proto.ParseFromString(sig_proto.arg_values(j));
-      sig.arg_values.emplace_back();
-      TF_RET_CHECK(sig.arg_values.back().FromProto(tensor_proto));
-    }
-    VLOG(2) << "loading signature: "
-            << TaoCompilationCache::SignatureDebugString(sig);
-    cache_[result.entries(i).target_device()][sig] =
-        result.entries(i).filename();
+    auto& legacy_entry = result.entries(i);
+    CompilationCacheIndexEntry entry;
+    entry.set_key(
+        getKey(legacy_entry.target_device(), legacy_entry.sig()));
+    entry.set_filename(legacy_entry.filename());
+    entry.set_target_device(legacy_entry.target_device());
+    bool inserted = false;
+    TF_RETURN_IF_ERROR(index_.Insert(entry, /*override*/ false, &inserted));
+    num_imported += inserted;
   }
   LOG(INFO) << "Load compilation cache success from " << cache_dump_path_
-            << " with " << result.entries_size() << " entries.";
+            << " with " << index_.size() << " entries (" << num_imported
+            << " imported from " << getCacheTableFilePath() << ").";
   return Status::OK();
 }
 
+// Records the signatures seen together with their compiler inputs and call
+// counts into a `ShapeHistogram` file, which is used to warm up the
+// compilation cache before a serving process takes traffic, see
+// `WarmupCompilationCache`. The counts recorded by the previous runs sharing
+// the file are accumulated. The file is rewritten atomically when the
+// compilation cache is destroyed or the process exits, thus concurrent
+// processes sharing the file may overwrite the records of each other.
+class ShapeHistogramRecorder {
+ public:
+  explicit ShapeHistogramRecorder(const std::string& path) : path_(path) {
+    ShapeHistogram histogram;
+    if (tensorflow::Env::Default()->FileExists(path_).ok()) {
+      Status status =
+          ReadBinaryProto(tensorflow::Env::Default(), path_, &histogram);
+      if (!status.ok()) {
+        LOG(WARNING) << "fail to load shape histogram " << path_ << ": "
+                     << status.error_message();
+        histogram.Clear();
+      }
+    }
+    for (auto& entry : *histogram.mutable_entries()) {
+      std::unique_ptr<Item>& item = items_[entry.key()];
+      item.reset(new Item);
+      item->call_count = entry.call_count();
+      item->entry.Swap(&entry);
+    }
+  }
+
+  ~ShapeHistogramRecorder() {
+    Status status = DumpToFile();
+    if (!status.ok()) {
+      LOG(WARNING) << "fail to dump shape histogram: "
+                   << status.error_message();
+    }
+  }
+
+  ShapeHistogramRecorder(const ShapeHistogramRecorder&) = delete;
+  void operator=(const ShapeHistogramRecorder&) = delete;
+
+  // Returns the singleton
+  static ShapeHistogramRecorder& Global() {
+    static ShapeHistogramRecorder recorder(
+        GetTaoBridgeOptions()->disc_shape_histogram_path);
+    return recorder;
+  }
+
+  // Records `input` as the compiler input of the signature `key`, and returns
+  // the counter of its calls, which lives as long as the recorder.
+  std::atomic<int64>* Record(const std::string& key,
+                             const std::string& func_name,
+                             const TaoCompilerInput& input) {
+    mutex_lock lock(mu_);
+    std::unique_ptr<Item>& item = items_[key];
+    if (!item) item.reset(new Item);
+    item->entry.set_key(key);
+    item->entry.set_target_device(input.options().device_type());
+    item->entry.set_func_name(func_name);
+    input.SerializeToString(item->entry.mutable_compiler_input());
+    return &item->call_count;
+  }
+
+  Status DumpToFile() {
+    ShapeHistogram histogram;
+    {
+      mutex_lock lock(mu_);
+      if (items_.empty()) return Status::OK();
+      for (auto& pair : items_) {
+        ShapeHistogramEntry* entry = histogram.add_entries();
+        *entry = pair.second->entry;
+        entry->set_call_count(pair.second->call_count.load());
+      }
+    }
+    std::string tmp_path = absl::StrCat(path_, ".tmp.", getpid());
+    TF_RETURN_IF_ERROR(
+        WriteBinaryProto(tensorflow::Env::Default(), tmp_path, histogram));
+    return tensorflow::Env::Default()->RenameFile(tmp_path, path_);
+  }
+
+ private:
+  struct Item {
+    // `call_count` of the entry is not used.
+    ShapeHistogramEntry entry;
+    std::atomic<int64> call_count{0};
+  };
+
+  const std::string path_;
+  mutex mu_;
+  std::unordered_map<std::string, std::unique_ptr<Item>> items_
+      GUARDED_BY(mu_);
+};
+
 }  // namespace
 
 Tensor ToCpu(OpKernelContext* ctx, Tensor t, MemoryType mem_type) {
@@ -559,6 +666,7 @@ TaoCompilationCache::TaoCompilationCache(bool async_compilation)
   auto* opts = GetTaoBridgeOptions();
   tao_compiler_path_ = opts->tao_compiler_path;
   disc_cache_path_ = opts->disc_cache_path;
+  record_shape_histogram_ = !opts->disc_shape_histogram_path.empty();
   profile_guide_mode_ = opts->profiling_guided_compilation_mode;
   // Dumper Options
   auto* dumper_opts = GetTaoDumperOptions();
@@ -575,6 +683,7 @@ TaoCompilationCache::TaoCompilationCache(bool async_compilation)
   LOG(INFO) << "TaoCompilationCache initiate: ";
   LOG(INFO) << "    tao compiler path: " << tao_compiler_path_;
   LOG(INFO) << "      disk cache path: " << disc_cache_path_;
+  LOG(INFO) << " shape histogram path: " << opts->disc_shape_histogram_path;
   LOG(INFO) << "     remove tmp files: " << remove_after_compile_;
   LOG(INFO) << "    async compilation: " << async_compilation_;
   LOG(INFO) << "    profiling guide compilation: " << profile_guide_mode_;
@@ -604,6 +713,13 @@ TaoCompilationCache::~TaoCompilationCache() {
     }
   }
 
+  if (record_shape_histogram_) {
+    Status s = ShapeHistogramRecorder::Global().DumpToFile();
+    if (!s.ok()) {
+      LOG(ERROR) << "Error when dumping shape histogram: " << s.error_message();
+    }
+  }
+
   if (tao_profile_stat_handle_thread_) {
     stop_ = true;
     delete tao_profile_stat_handle_thread_;
@@ -633,7 +749,9 @@ Status TaoCompilationCache::DumpToFile() {
       }
       // Always re-dump in case there are some runtime-caches (e.g. tuning
       // cache)
-      pair.second->executable->DumpToFile(out_filename);
+      PersistentCompliationCache::DumpExecutableToFile(
+          *pair.second->executable, out_filename);
+      disc_cache.update(device, sig, out_filename);
     }
   }
 
@@ -709,6 +827,7 @@ uint64 TaoCompilationCache::Signature::Hash::operator()(
 Status TaoCompilationCache::BuildSignature(
     const NameAttrList& function, const std::map<int, Tensor>& constant_args,
     const std::set<int>& fixed_shape_args, const std::set<int>& host_args,
+    const std::map<int, TensorShape>& bucketed_shapes,
     const std::map<int, OptionalTensor>& variable_args, OpKernelContext* ctx,
     Signature* signature, bool is_mlir) {
   signature->name = Canonicalize(function.name(), AttrSlice(&function.attr()));
@@ -737,6 +856,9 @@ Status TaoCompilationCache::BuildSignature(
     } else if ((!is_mlir) || (fixed_shape_args.count(i))) {
       signature->arg_types.emplace_back(ctx->input_dtype(i),
                                         ctx->input(i).shape());
+    } else if (bucketed_shapes.count(i) > 0) {
+      signature->arg_types.emplace_back(ctx->input_dtype(i),
+                                        bucketed_shapes.at(i));
     } else {
       // if is_mlir
       signature->arg_ranks.emplace_back(ctx->input_dtype(i),
@@ -776,6 +898,7 @@ Status SerializeFunctionLibrary(TaoCompilerInput* compiler_input,
 Status PrepareCompilerInput(
     const NameAttrList& function, const std::map<int, Tensor>& constant_args,
     const std::set<int>& fixed_shape_args, const std::set<int>& host_args,
+    const std::map<int, TensorShape>& bucketed_shapes,
     const std::map<int, OptionalTensor>& variable_args, OpKernelContext* ctx,
     TaoCompilerInput* compiler_input, bool is_mlir = false) {
   auto& options = *(compiler_input->mutable_options());
@@ -823,6 +946,11 @@ Status PrepareCompilerInput(
       // Handles the non-constant arguments.
       const Tensor& input = ctx->input(input_num);
       CHECK(input.dtype() != tensorflow::DT_RESOURCE);
+      // Bucketed inputs are compiled with the static shapes they are padded
+      // to.
+      bool bucketed = bucketed_shapes.count(input_num) > 0;
+      const TensorShape& input_shape =
+          bucketed ? bucketed_shapes.at(input_num) : input.shape();
       if (is_mlir) {
         if (fixed_shape_args.count(input_num) > 0) {
           // only used for Mlir dynamic shape compiler
@@ -831,6 +959,7 @@ Status PrepareCompilerInput(
           arg->set_kind_v2(ArgumentKind::kHostArgs);
         } else {
           arg->set_kind_v2(ArgumentKind::kParameter);
+          arg->set_static_shape(bucketed);
         }
       } else {
         if (input.NumElements() > 0) {
@@ -845,7 +974,7 @@ Status PrepareCompilerInput(
       }
       arg->set_type(static_cast<int>(input.dtype()));
       tensorflow::TensorShapeProto shape_proto;
-      input.shape().AsProto(&shape_proto);
+      input_shape.AsProto(&shape_proto);
       shape_proto.AppendToString(arg->mutable_shape());
     } else {
       // Handles resource variables.
@@ -918,6 +1047,57 @@ Status PrepareCompilerInput(
 }
 namespace {
 
+// Compiles the input with the compiler daemon, and gets the result in the
+// encoding of `waitpid`. Returns an error if the daemon is not available, in
+// which case the input should be compiled by a standalone compiler process.
+Status CompileWithDaemon(const std::string& tao_compiler_path,
+                         const TaoCompilerInput& input,
+                         const std::string& input_file_name,
+                         const std::string& output_file_name,
+                         AsyncCompilationMgr::CancellationMgr* cancellation_mgr,
+                         bool* early_stopped, int* exit_status,
+                         std::string* output) {
+  auto* client = TaoCompilerDaemonClient::Get(tao_compiler_path, input);
+  std::function<std::unique_ptr<mutex_lock>()> fork_lock =
+      [cancellation_mgr]() {
+        return cancellation_mgr ? cancellation_mgr->Lock() : nullptr;
+      };
+  std::unique_ptr<TaoCompilerDaemonClient::Request> request;
+  TF_RETURN_IF_ERROR(client->Submit(input_file_name, output_file_name,
+                                    fork_lock, &request));
+
+  AsyncCompilationMgr::CancellationMgr::Handle handle =
+      AsyncCompilationMgr::CancellationMgr::kInvalidHandle;
+  if (cancellation_mgr) {
+    handle = cancellation_mgr->RegisterCancellationAction([&request]() {
+      request->Cancel();
+      VLOG(2) << "try to cancel compilation daemon request.";
+    });
+    if (handle == AsyncCompilationMgr::CancellationMgr::kInvalidHandle) {
+      *early_stopped = true;
+      return Status::OK();
+    }
+  }
+  int exit_code = -1;
+  Status status = request->Wait(&exit_code, output);
+  if (cancellation_mgr) {
+    cancellation_mgr->RemoveCancellationAction(handle);
+  }
+  if (errors::IsCancelled(status)) {
+    // The same as a standalone compiler process killed by the cancellation.
+    *exit_status = W_EXITCODE(0, SIGKILL);
+    return Status::OK();
+  }
+  TF_RETURN_IF_ERROR(status);
+  if (exit_code == kCompilerDaemonRejected) {
+    return errors::Unavailable(*output);
+  }
+  *exit_status = W_EXITCODE(exit_code, 0);
+  absl::StrAppend(output, "\n(see ", client->log_file(),
+                  " for the logs of tao_compiler daemon)");
+  return Status::OK();
+}
+
 Status CompileFunctionImpl(
     const std::string& func_name, const std::string& tao_compiler_path,
     const std::string& output_file_name, TaoCompilerInput& input,
@@ -948,51 +1128,71 @@ Status CompileFunctionImpl(
   }
 
   auto start = std::chrono::steady_clock::now();
-  tensorflow::tao::SubProcess tao_compiler;
-  VLOG(2) << "compiling function " << func_name << ", input file is "
-          << input_file_name << ", output file is " << output_file_name;
-  std::vector<string> tao_compiler_args = {tao_compiler_path, input_file_name,
-                                           output_file_name};
-  tao_compiler.SetProgram(tao_compiler_path, tao_compiler_args);
-  tao_compiler.SetChannelAction(tensorflow::tao::CHAN_STDOUT,
-                                tensorflow::tao::ACTION_PIPE);
-  tao_compiler.SetChannelAction(tensorflow::tao::CHAN_STDERR,
-                                tensorflow::tao::ACTION_PIPE);
-  {
-    // We need this trick because OpenBlas has a known bug
-    // which leading to deadlock when using fork in multi-thread environment.
-    // https://github.com/xianyi/OpenBLAS/issues/2270
-    std::unique_ptr<mutex_lock> l;
-    if (cancellation_mgr) {
-      l = cancellation_mgr->Lock();
-    }
-
-    VLOG(2) << "start tao_compiler";
-    if (!tao_compiler.Start()) {
-      return errors::Internal("Failed to launch tao_comipler: " +
-                              tao_compiler_path);
-    }
-  }
+  int exit_status = -1;
   string stdout_output;
   string stderr_output;
-
-  AsyncCompilationMgr::CancellationMgr::Handle handle =
-      AsyncCompilationMgr::CancellationMgr::kInvalidHandle;
-  if (cancellation_mgr) {
-    handle = cancellation_mgr->RegisterCancellationAction([&tao_compiler]() {
-      tao_compiler.Kill(9);
-      VLOG(2) << "try to kill compilation process.";
-    });
-    if (handle == AsyncCompilationMgr::CancellationMgr::kInvalidHandle) {
-      // early stop triggered.
+  bool compiled_by_daemon = false;
+  if (GetTaoBridgeOptions()->enable_compiler_daemon) {
+    bool early_stopped = false;
+    Status status = CompileWithDaemon(
+        tao_compiler_path, input, input_file_name, output_file_name,
+        cancellation_mgr, &early_stopped, &exit_status, &stderr_output);
+    if (early_stopped) {
       VLOG(2) << "hit early stop...";
       return Status::OK();
     }
+    if (status.ok()) {
+      compiled_by_daemon = true;
+    } else {
+      VLOG(1) << "compile " << func_name << " with standalone tao_compiler: "
+              << status.error_message();
+    }
   }
-  int exit_status = tao_compiler.Communicate(
-      /*stdin_input=*/nullptr, &stdout_output, &stderr_output);
-  if (cancellation_mgr) {
-    cancellation_mgr->RemoveCancellationAction(handle);
+  if (!compiled_by_daemon) {
+    tensorflow::tao::SubProcess tao_compiler;
+    VLOG(2) << "compiling function " << func_name << ", input file is "
+            << input_file_name << ", output file is " << output_file_name;
+    std::vector<string> tao_compiler_args = {tao_compiler_path, input_file_name,
+                                             output_file_name};
+    tao_compiler.SetProgram(tao_compiler_path, tao_compiler_args);
+    tao_compiler.SetChannelAction(tensorflow::tao::CHAN_STDOUT,
+                                  tensorflow::tao::ACTION_PIPE);
+    tao_compiler.SetChannelAction(tensorflow::tao::CHAN_STDERR,
+                                  tensorflow::tao::ACTION_PIPE);
+    {
+      // We need this trick because OpenBlas has a known bug
+      // which leading to deadlock when using fork in multi-thread environment.
+      // https://github.com/xianyi/OpenBLAS/issues/2270
+      std::unique_ptr<mutex_lock> l;
+      if (cancellation_mgr) {
+        l = cancellation_mgr->Lock();
+      }
+
+      VLOG(2) << "start tao_compiler";
+      if (!tao_compiler.Start()) {
+        return errors::Internal("Failed to launch tao_comipler: " +
+                                tao_compiler_path);
+      }
+    }
+
+    AsyncCompilationMgr::CancellationMgr::Handle handle =
+        AsyncCompilationMgr::CancellationMgr::kInvalidHandle;
+    if (cancellation_mgr) {
+      handle = cancellation_mgr->RegisterCancellationAction([&tao_compiler]() {
+        tao_compiler.Kill(9);
+        VLOG(2) << "try to kill compilation process.";
+      });
+      if (handle == AsyncCompilationMgr::CancellationMgr::kInvalidHandle) {
+        // early stop triggered.
+        VLOG(2) << "hit early stop...";
+        return Status::OK();
+      }
+    }
+    exit_status = tao_compiler.Communicate(
+        /*stdin_input=*/nullptr, &stdout_output, &stderr_output);
+    if (cancellation_mgr) {
+      cancellation_mgr->RemoveCancellationAction(handle);
+    }
   }
   std::chrono::duration<double> elapsed_sec =
       std::chrono::steady_clock::now() - start;
@@ -1069,6 +1269,96 @@ Status CompileFunction(const std::string& func_name,
                              input, remove_after_compile, nullptr);
 }
 
+Status WarmupCompilationCache(const std::string& histogram_path,
+                              const std::string& cache_dir, int64 top_n,
+                              int num_threads) {
+  if (cache_dir.empty()) {
+    return errors::InvalidArgument("compilation cache path is not set");
+  }
+  ShapeHistogram histogram;
+  TF_RETURN_IF_ERROR(
+      ReadBinaryProto(tensorflow::Env::Default(), histogram_path, &histogram));
+  std::vector<const ShapeHistogramEntry*> entries;
+  for (const auto& entry : histogram.entries()) entries.push_back(&entry);
+  std::stable_sort(
+      entries.begin(), entries.end(),
+      [](const ShapeHistogramEntry* lhs, const ShapeHistogramEntry* rhs) {
+        return lhs->call_count() > rhs->call_count();
+      });
+  if (top_n > 0 && entries.size() > static_cast<size_t>(top_n)) {
+    entries.resize(top_n);
+  }
+
+  // Not the global instance, since `cache_dir` may not be the one used by
+  // this process.
+  PersistentCompliationCache disc_cache(cache_dir);
+  std::string tao_compiler_path = GetTaoBridgeOptions()->tao_compiler_path;
+  bool remove_after_compile = GetTaoDumperOptions()->remove_after_compile;
+  auto warmup = [&](const ShapeHistogramEntry& hist_entry) -> Status {
+    std::string filename;
+    if (disc_cache.find(hist_entry.key(), filename)) return Status::OK();
+    TaoCompilerInput input;
+    if (!input.ParseFromString(hist_entry.compiler_input())) {
+      return errors::DataLoss("broken compiler input of ",
+                              hist_entry.func_name());
+    }
+    std::string output_file_name;
+    if (!tensorflow::Env::Default()->LocalTempFilename(&output_file_name)) {
+      return errors::Internal(
+          "couldn't get temp tao_compiler_result file name");
+    }
+    auto output_cleaner = tensorflow::gtl::MakeCleanup(
+        [&output_file_name, remove_after_compile] {
+          if (remove_after_compile) {
+            tensorflow::Env::Default()->DeleteFile(output_file_name);
+          }
+        });
+    TF_RETURN_IF_ERROR(CompileFunctionImpl(
+        hist_entry.func_name(), tao_compiler_path, output_file_name, input,
+        remove_after_compile, nullptr));
+    // The compiled result is loaded as it is at runtime to verify it, and to
+    // be dumped along with the files it refers to.
+    auto executable = ExecutableFactory::Global().NewExecutable(
+        hist_entry.target_device(), output_file_name);
+    if (!executable) {
+      return errors::Internal("Executable Not registered for DEVICE " +
+                              hist_entry.target_device());
+    }
+    TF_RETURN_IF_ERROR(executable->Init());
+    filename = disc_cache.getNextUniqueNameOfCompiledResultProto();
+    PersistentCompliationCache::DumpExecutableToFile(*executable, filename);
+    disc_cache.update(hist_entry.target_device(), hist_entry.key(), filename);
+    return Status::OK();
+  };
+
+  std::vector<Status> statuses(entries.size());
+  {
+    // The destructor waits for the scheduled compilations.
+    thread::ThreadPool pool(tensorflow::Env::Default(), "disc_cache_warmup",
+                            std::max(num_threads, 1));
+    for (size_t i = 0; i < entries.size(); ++i) {
+      pool.Schedule([&, i] { statuses[i] = warmup(*entries[i]); });
+    }
+  }
+  int num_failed = 0;
+  for (size_t i = 0; i < entries.size(); ++i) {
+    if (statuses[i].ok()) continue;
+    ++num_failed;
+    LOG(WARNING) << "fail to warm up " << entries[i]->func_name()
+                 << " with call count " << entries[i]->call_count() << ": "
+                 << statuses[i].error_message();
+  }
+  LOG(INFO) << "Warm up compilation cache " << cache_dir << " with "
+            << entries.size() - num_failed << " of " << entries.size()
+            << " signatures from " << histogram_path << ".";
+  TF_RETURN_IF_ERROR(disc_cache.DumpToFile());
+  if (num_failed > 0) {
+    return errors::Internal("fail to warm up ", num_failed, " of ",
+                            entries.size(), " signatures");
+  }
+  return Status::OK();
+}
+
 uint64 TaoCompilationCache::GetSignatureHash(
     const NameAttrList& function, const std::map<int, Tensor>& constant_args,
     const std::set<int>& fixed_shape_args, const std::set<int>& host_args,
@@ -1076,7 +1366,8 @@ uint64 TaoCompilationCache::GetSignatureHash(
     bool is_mlir) {
   Signature signature;
   BuildSignature(function, constant_args, fixed_shape_args, host_args,
-                 variable_args, ctx, &signature, is_mlir);
+                 /*bucketed_shapes=*/{}, variable_args, ctx, &signature,
+                 is_mlir);
   Signature::Hash hash;
   auto hash_sig = hash(signature);
   return hash_sig;
@@ -1086,6 +1377,7 @@ Status TaoCompilationCache::Compile(
     std::unique_ptr<TaoCompilerInput> input, const NameAttrList& function,
     const std::map<int, Tensor>& constant_args,
     const std::set<int>& fixed_shape_args, const std::set<int>& host_args,
+    const std::map<int, TensorShape>& bucketed_shapes,
     const std::map<int, OptionalTensor>& variable_args, OpKernelContext* ctx,
     Executable** executable, TaoProfileStat** stat, bool is_mlir,
     TaoCompileFuncCallInfo* call_info) {
@@ -1094,12 +1386,12 @@ Status TaoCompilationCache::Compile(
   }
   if (async_compilation_) {
     return CompileImplAsync(std::move(input), function, constant_args,
-                            fixed_shape_args, host_args, variable_args, ctx,
-                            executable, is_mlir, call_info);
+                            fixed_shape_args, host_args, bucketed_shapes,
+                            variable_args, ctx, executable, is_mlir, call_info);
   } else {
     return CompileImpl(std::move(input), function, constant_args,
-                       fixed_shape_args, host_args, variable_args, ctx,
-                       executable, is_mlir, call_info);
+                       fixed_shape_args, host_args, bucketed_shapes,
+                       variable_args, ctx, executable, is_mlir, call_info);
   }
 }
 
@@ -1183,6 +1475,7 @@ Status TaoCompilationCache::CompileImpl(
     std::unique_ptr<TaoCompilerInput> input_ptr, const NameAttrList& function,
     const std::map<int, Tensor>& constant_args,
     const std::set<int>& fixed_shape_args, const std::set<int>& host_args,
+    const std::map<int, TensorShape>& bucketed_shapes,
     const std::map<int, OptionalTensor>& variable_args, OpKernelContext* ctx,
     Executable** executable, bool is_mlir, TaoCompileFuncCallInfo* call_info) {
   CHECK(constant_args.size() + variable_args.size() <=
@@ -1191,8 +1484,8 @@ Status TaoCompilationCache::CompileImpl(
   auto& input = *input_ptr;
   Signature signature;
   TF_RETURN_IF_ERROR(BuildSignature(function, constant_args, fixed_shape_args,
-                                    host_args, variable_args, ctx, &signature,
-                                    is_mlir));
+                                    host_args, bucketed_shapes, variable_args,
+                                    ctx, &signature, is_mlir));
 
   VLOG(2) << "Signature: " << SignatureDebugString(signature);
 
@@ -1272,14 +1565,18 @@ Status TaoCompilationCache::CompileImpl(
             VLOG(0) << "tao_compiler_result file: " << output_file_name;
           }
         });
-    if (!hit_cache) {
-      // Do the actual JIT compilation without holding the lock (it can take
-      // a long time.)
+    // The compiler input is recorded into the shape histogram even if the
+    // compiled result is cached.
+    if (!hit_cache || record_shape_histogram_) {
       entry->compilation_status =
           PrepareCompilerInput(function, constant_args, fixed_shape_args,
-                               host_args, variable_args, ctx, &input, is_mlir);
+                               host_args, bucketed_shapes, variable_args, ctx,
+                               &input, is_mlir);
       TF_RETURN_IF_ERROR(entry->compilation_status);
-
+    }
+    if (!hit_cache) {
+      // Do the actual JIT compilation without holding the lock (it can take
+      // a long time.)
       if (!tensorflow::Env::Default()->LocalTempFilename(&output_file_name)) {
         return errors::Internal(
             "couldn't get temp tao_compiler_result file name");
@@ -1306,11 +1603,20 @@ Status TaoCompilationCache::CompileImpl(
       auto& disc_cache = PersistentCompliationCache::Global();
       auto filename = disc_cache.getNextUniqueNameOfCompiledResultProto();
       // Create a new copy in case the compiled result is temporary file.
-      entry->executable->DumpToFile(filename);
-      disc_cache.update(input.options().device_type(), signature, filename,
-                        /*override*/ false, /*write_through*/ true);
+      PersistentCompliationCache::DumpExecutableToFile(*entry->executable,
+                                                       filename);
+      disc_cache.update(input.options().device_type(), signature, filename);
+    }
+    if (record_shape_histogram_ && entry->compilation_status.ok()) {
+      entry->call_counter = ShapeHistogramRecorder::Global().Record(
+          PersistentCompliationCache::getKey(input.options().device_type(),
+                                             signature),
+          function.name(), input);
     }
   }
+  if (entry->call_counter) {
+    entry->call_counter->fetch_add(1, std::memory_order_relaxed);
+  }
 
   if (entry->compilation_status == Status::OK()) {
     *executable = entry->executable.get();
@@ -1322,6 +1628,7 @@ Status TaoCompilationCache::CompileImplAsync(
     std::unique_ptr<TaoCompilerInput> input_ptr, const NameAttrList& function,
     const std::map<int, Tensor>& constant_args,
     const std::set<int>& fixed_shape_args, const std::set<int>& host_args,
+    const std::map<int, TensorShape>& bucketed_shapes,
     const std::map<int, OptionalTensor>& variable_args, OpKernelContext* ctx,
     Executable** executable, bool is_mlir, TaoCompileFuncCallInfo* call_info) {
   VLOG(2) << "TaoCompilationCache::CompileImplAsync is called...";
@@ -1334,8 +1641,8 @@ Status TaoCompilationCache::CompileImplAsync(
   auto& input = *input_ptr;
   Signature signature;
   TF_RETURN_IF_ERROR(BuildSignature(function, constant_args, fixed_shape_args,
-                                    host_args, variable_args, ctx, &signature,
-                                    is_mlir));
+                                    host_args, bucketed_shapes, variable_args,
+                                    ctx, &signature, is_mlir));
   Signature::Hash hash;
   auto hash_sig = hash(signature);
   VLOG(2) << "Signature: " << SignatureDebugString(signature);
@@ -1425,9 +1732,15 @@ Status TaoCompilationCache::CompileImplAsync(
         // expensive. Try to move some work to the background thread in order to
         // reduce overhead in the critical path.
         entry->compilation_status = PrepareCompilerInput(
-            function, constant_args, fixed_shape_args, host_args, variable_args,
-            ctx, &input, is_mlir);
+            function, constant_args, fixed_shape_args, host_args,
+            bucketed_shapes, variable_args, ctx, &input, is_mlir);
         TF_RETURN_IF_ERROR(entry->compilation_status);
+        if (record_shape_histogram_) {
+          entry->call_counter = ShapeHistogramRecorder::Global().Record(
+              PersistentCompliationCache::getKey(input.options().device_type(),
+                                                 signature),
+              function.name(), input);
+        }
 
         auto raw_input_ptr = input_ptr.release();
         string func_name = function.name();
@@ -1486,6 +1799,9 @@ Status TaoCompilationCache::CompileImplAsync(
       }
     }
   }
+  if (entry->call_counter) {
+    entry->call_counter->fetch_add(1, std::memory_order_relaxed);
+  }
 
   compile_ok =
       entry && entry->compiled && entry->compilation_status == Status::OK();
@@ -1664,3 +1980,16 @@ void TaoCompilationCache::DumpInfo(OpKernelContext* ctx,
 
 }  // namespace tao
 }  // namespace tensorflow
+
+extern "C" int tao_warmup_compilation_cache(const char* histogram_path,
+                                            const char* cache_dir,
+                                            int64_t top_n, int num_threads) {
+  auto status = tensorflow::tao::WarmupCompilationCache(
+      histogram_path, cache_dir, top_n, num_threads);
+  if (!status.ok()) {
+    LOG(ERROR) << "Error when warming up compilation cache: "
+               << status.error_message();
+    return -1;
+  }
+  return 0;
+}
@@ -48,6 +48,7 @@ class TaoCompilationCache : public ResourceBase {
                  const std::map<int, Tensor>& constant_args,
                  const std::set<int>& fixed_shape_args,
                  const std::set<int>& host_args,
+                 const std::map<int, TensorShape>& bucketed_shapes,
                  const std::map<int, OptionalTensor>& variable_args,
                  OpKernelContext* ctx, Executable** executable,
                  TaoProfileStat** stat = nullptr, bool is_mlir = false,
@@ -94,6 +95,7 @@ class TaoCompilationCache : public ResourceBase {
                      const std::map<int, Tensor>& constant_args,
                      const std::set<int>& fixed_shape_args,
                      const std::set<int>& host_args,
+                     const std::map<int, TensorShape>& bucketed_shapes,
                      const std::map<int, OptionalTensor>& variable_args,
                      OpKernelContext* ctx, Executable** executable,
                      bool is_mlir = false,
@@ -103,6 +105,7 @@ class TaoCompilationCache : public ResourceBase {
                           const std::map<int, Tensor>& constant_args,
                           const std::set<int>& fixed_shape_args,
                           const std::set<int>& host_args,
+                          const std::map<int, TensorShape>& bucketed_shapes,
                           const std::map<int, OptionalTensor>& variable_args,
                           OpKernelContext* ctx, Executable** executable,
                           bool is_mlir = false,
@@ -110,10 +113,13 @@ class TaoCompilationCache : public ResourceBase {
 
   Status DumpToFile();
 
-  // Builds the signature for a compilation.
+  // Builds the signature for a compilation. `bucketed_shapes` maps the inputs
+  // padded by shape bucketing to the shapes they are padded to, which are
+  // compiled as static shapes.
   static Status BuildSignature(
       const NameAttrList& function, const std::map<int, Tensor>& constant_args,
       const std::set<int>& fixed_shape_args, const std::set<int>& host_args,
+      const std::map<int, TensorShape>& bucketed_shapes,
       const std::map<int, OptionalTensor>& variable_args, OpKernelContext* ctx,
       Signature* signature, bool is_mlir = false);
 
@@ -135,6 +141,10 @@ class TaoCompilationCache : public ResourceBase {
 
     bool compilation_slot_initialized = false;
     int compilation_slot = -1;
+
+    // The number of calls recorded into the shape histogram, null if the
+    // recording is disabled.
+    std::atomic<int64>* call_counter GUARDED_BY(mu) = nullptr;
   };
 
   mutex compile_cache_mu_;
@@ -150,6 +160,7 @@ class TaoCompilationCache : public ResourceBase {
   bool remove_after_compile_ = false;
 
   std::string disc_cache_path_;
+  bool record_shape_histogram_ = false;
 
   std::atomic<bool> stop_{false};
   TaoProfileStat tao_profile_stat_;
@@ -191,6 +202,17 @@ Status CompileFunction(const std::string& func_name,
                        const std::string& tao_compiler_path,
                        const std::string& output_file_name,
                        TaoCompilerInput& input, bool remove_after_compile);
+
+// Compiles the `top_n` most frequently called signatures recorded in the
+// shape histogram at `histogram_path` (see `DISC_SHAPE_HISTOGRAM_PATH`), with
+// up to `num_threads` compilations in parallel, and stores the compiled
+// results into the compilation cache at `cache_dir`. It is meant to be run
+// before a serving process sharing the cache takes traffic, thus the recorded
+// signatures are not compiled on the critical path. The signatures already in
+// the cache are skipped, and all of them are compiled if `top_n` <= 0.
+Status WarmupCompilationCache(const std::string& histogram_path,
+                              const std::string& cache_dir, int64 top_n,
+                              int num_threads);
 }  // namespace tao
 }  // namespace tensorflow
 
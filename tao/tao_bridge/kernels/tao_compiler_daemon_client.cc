@@ -0,0 +1,236 @@
+// Copyright 2022 The BladeDISC Authors. All rights reserved.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tao_bridge/kernels/tao_compiler_daemon_client.h"
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <map>
+#include <unordered_map>
+
+#include "absl/strings/str_cat.h"
+#include "tao_bridge/common.h"
+#include "tao_bridge/tf/subprocess.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace tao {
+
+namespace {
+
+// The wire protocol, keep in sync with
+// tao_compiler/decoupling/tao_compiler_daemon.h.
+constexpr uint32_t kCompilerDaemonMagic = 0x43534944;  // "DISC"
+constexpr uint32_t kCompilerDaemonVersion = 1;
+
+bool ReadFully(int fd, void* buf, size_t size) {
+  char* ptr = static_cast<char*>(buf);
+  while (size > 0) {
+    ssize_t n = read(fd, ptr, size);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    ptr += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool WriteFully(int fd, const void* buf, size_t size) {
+  const char* ptr = static_cast<const char*>(buf);
+  while (size > 0) {
+    ssize_t n = send(fd, ptr, size, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    ptr += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool WriteString(int fd, const std::string& str) {
+  uint32_t length = str.size();
+  return WriteFully(fd, &length, sizeof(length)) &&
+         WriteFully(fd, str.data(), length);
+}
+
+std::string GetSocketDir() {
+  const char* tmp_dir = getenv("TMPDIR");
+  return (tmp_dir && *tmp_dir) ? tmp_dir : "/tmp";
+}
+
+}  // namespace
+
+/* static */ TaoCompilerDaemonClient* TaoCompilerDaemonClient::Get(
+    const std::string& tao_compiler_path, const TaoCompilerInput& input) {
+  // Sorts the env vars to get a stable key.
+  std::map<std::string, std::string> envs(input.env().begin(),
+                                          input.env().end());
+  const std::string& device_type = input.options().device_type();
+  std::string key = absl::StrCat(tao_compiler_path, "\n", device_type, "\n");
+  // A rebuilt compiler gets a new daemon.
+  struct stat compiler_stat;
+  if (stat(tao_compiler_path.c_str(), &compiler_stat) == 0) {
+    absl::StrAppend(&key, compiler_stat.st_mtime, ":", compiler_stat.st_size,
+                    "\n");
+  }
+  for (auto& kv : envs) {
+    absl::StrAppend(&key, kv.first, "=", kv.second, "\n");
+  }
+
+  static mutex clients_mu(LINKER_INITIALIZED);
+  static auto* clients = new std::unordered_map<
+      std::string, std::unique_ptr<TaoCompilerDaemonClient>>;
+  mutex_lock l(clients_mu);
+  auto& client = (*clients)[key];
+  if (!client) {
+    std::string socket_path =
+        absl::StrCat(GetSocketDir(), "/tao_compiler_", getuid(), "_",
+                     absl::Hex(Hash64(key)), ".sock");
+    auto* opts = GetTaoBridgeOptions();
+    std::vector<std::string> args = {
+        tao_compiler_path,
+        absl::StrCat("--daemon=", socket_path),
+        absl::StrCat("--daemon-device=", device_type),
+        absl::StrCat("--daemon-workers=", opts->compiler_daemon_workers),
+        absl::StrCat("--daemon-idle-timeout=",
+                     opts->compiler_daemon_idle_timeout)};
+    for (auto& kv : envs) {
+      args.push_back(absl::StrCat("--env=", kv.first, "=", kv.second));
+    }
+    client.reset(new TaoCompilerDaemonClient(tao_compiler_path, socket_path,
+                                             std::move(args)));
+  }
+  return client.get();
+}
+
+int TaoCompilerDaemonClient::Connect() {
+  sockaddr_un addr;
+  if (socket_path_.size() >= sizeof(addr.sun_path)) return -1;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, socket_path_.c_str(), sizeof(addr.sun_path) - 1);
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) return -1;
+  if (connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) !=
+      0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+Status TaoCompilerDaemonClient::StartDaemon(
+    const std::function<std::unique_ptr<mutex_lock>()>& fork_lock) {
+  tensorflow::tao::SubProcess daemon;
+  daemon.SetProgram(tao_compiler_path_, daemon_args_);
+  daemon.SetChannelAction(tensorflow::tao::CHAN_STDOUT,
+                          tensorflow::tao::ACTION_PIPE);
+  daemon.SetChannelAction(tensorflow::tao::CHAN_STDERR,
+                          tensorflow::tao::ACTION_PIPE);
+  {
+    std::unique_ptr<mutex_lock> l = fork_lock();
+    if (!daemon.Start()) {
+      return errors::Internal("Failed to launch tao_compiler daemon: ",
+                              tao_compiler_path_);
+    }
+  }
+  // Returns once the daemon is listening on the socket.
+  string stdout_output;
+  string stderr_output;
+  int exit_status = daemon.Communicate(/*stdin_input=*/nullptr,
+                                       &stdout_output, &stderr_output);
+  if (exit_status != 0) {
+    return errors::Internal("tao_compiler daemon exits with errcode ",
+                            exit_status, ":\n", stderr_output);
+  }
+  VLOG(1) << "tao_compiler daemon started on " << socket_path_;
+  return Status::OK();
+}
+
+Status TaoCompilerDaemonClient::Submit(
+    const std::string& input_file, const std::string& output_file,
+    const std::function<std::unique_ptr<mutex_lock>()>& fork_lock,
+    std::unique_ptr<Request>* request) {
+  int fd = Connect();
+  if (fd < 0) {
+    mutex_lock l(mu_);
+    if (disabled_) {
+      return errors::Unavailable("tao_compiler daemon is disabled");
+    }
+    // The daemon may be started by another thread meanwhile.
+    fd = Connect();
+    if (fd < 0) {
+      Status status = StartDaemon(fork_lock);
+      if (status.ok()) fd = Connect();
+      if (fd < 0) {
+        LOG(WARNING) << "tao_compiler daemon is not available, clusters are "
+                     << "compiled by standalone processes: "
+                     << status.error_message();
+        disabled_ = true;
+        return errors::Unavailable("failed to start tao_compiler daemon");
+      }
+    }
+  }
+
+  int32_t worker_pid = -1;
+  if (!WriteFully(fd, &kCompilerDaemonMagic, sizeof(kCompilerDaemonMagic)) ||
+      !WriteFully(fd, &kCompilerDaemonVersion,
+                  sizeof(kCompilerDaemonVersion)) ||
+      !WriteString(fd, input_file) || !WriteString(fd, output_file) ||
+      !ReadFully(fd, &worker_pid, sizeof(worker_pid))) {
+    close(fd);
+    return errors::Unavailable("failed to send request to the daemon on ",
+                               socket_path_);
+  }
+  request->reset(new Request(fd, worker_pid));
+  return Status::OK();
+}
+
+TaoCompilerDaemonClient::Request::~Request() { close(fd_); }
+
+void TaoCompilerDaemonClient::Request::Cancel() {
+  if (cancelled_.exchange(true)) return;
+  // Never kills the worker by its pid: it may have finished this request and
+  // be serving another one meanwhile. The connection belongs to this request
+  // only, and the worker aborts the compilation once it is shut down.
+  shutdown(fd_, SHUT_RDWR);
+}
+
+Status TaoCompilerDaemonClient::Request::Wait(int* exit_code,
+                                              std::string* message) {
+  int32_t code;
+  uint32_t length;
+  bool received = ReadFully(fd_, &code, sizeof(code)) &&
+                  ReadFully(fd_, &length, sizeof(length));
+  if (received) {
+    message->resize(length);
+    received = length == 0 || ReadFully(fd_, &(*message)[0], length);
+  }
+  if (!received) {
+    if (cancelled_.load()) {
+      return errors::Cancelled("tao_compiler daemon request cancelled");
+    }
+    return errors::Unavailable("tao_compiler daemon worker ", worker_pid_,
+                               " exits during the compilation");
+  }
+  *exit_code = code;
+  return Status::OK();
+}
+
+}  // namespace tao
+}  // namespace tensorflow
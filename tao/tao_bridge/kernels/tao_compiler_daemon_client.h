@@ -0,0 +1,106 @@
+// Copyright 2022 The BladeDISC Authors. All rights reserved.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TAO_TAO_BRIDGE_KERNELS_TAO_COMPILER_DAEMON_CLIENT_H_
+#define TAO_TAO_BRIDGE_KERNELS_TAO_COMPILER_DAEMON_CLIENT_H_
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tao_bridge/tao_compiler_input.pb.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/mutex.h"
+
+namespace tensorflow {
+namespace tao {
+
+// The exit code replied by the daemon when it can not serve a request, keep
+// in sync with tao_compiler/decoupling/tao_compiler_daemon.h.
+constexpr int32_t kCompilerDaemonRejected = 100;
+
+// Client of the compiler daemon, i.e. `tao_compiler_main --daemon`, which
+// keeps a pool of warm compiler processes and saves the process launching and
+// compiler initialization of each compilation.
+class TaoCompilerDaemonClient {
+ public:
+  // Returns the client of the daemon compiling `input` with
+  // `tao_compiler_path`. The compiler reads the env vars only once, so there
+  // is a daemon per compiler binary, device type and env vars of the input.
+  static TaoCompilerDaemonClient* Get(const std::string& tao_compiler_path,
+                                      const TaoCompilerInput& input);
+
+  // A compilation request being served by the daemon.
+  class Request {
+   public:
+    Request(int fd, pid_t worker_pid) : fd_(fd), worker_pid_(worker_pid) {}
+    ~Request();
+
+    // Cancels the request by shutting down the connection, upon which the
+    // worker aborts the compilation. Can be called from any thread while the
+    // request is alive, and has no effect on a request `Wait` has returned.
+    void Cancel();
+
+    // Waits for the compilation to finish and gets the exit code of the
+    // compiler. Returns Cancelled if the request is cancelled, or Unavailable
+    // if the worker dies during the compilation.
+    Status Wait(int* exit_code, std::string* message);
+
+   private:
+    int fd_;
+    pid_t worker_pid_;
+    std::atomic<bool> cancelled_{false};
+  };
+
+  // Sends the request of compiling `input_file` to `output_file`, launching
+  // the daemon if it is not running. `fork_lock` returns the lock to hold
+  // while forking the daemon process. Returns an error if the daemon is not
+  // available, in which case the input should be compiled by a standalone
+  // compiler process.
+  Status Submit(const std::string& input_file, const std::string& output_file,
+                const std::function<std::unique_ptr<mutex_lock>()>& fork_lock,
+                std::unique_ptr<Request>* request);
+
+  // The file the daemon writes its logs to.
+  std::string log_file() const { return socket_path_ + ".log"; }
+
+ private:
+  TaoCompilerDaemonClient(std::string tao_compiler_path,
+                          std::string socket_path,
+                          std::vector<std::string> daemon_args)
+      : tao_compiler_path_(std::move(tao_compiler_path)),
+        socket_path_(std::move(socket_path)),
+        daemon_args_(std::move(daemon_args)) {}
+
+  // Connects to the daemon, returns -1 on failure.
+  int Connect();
+
+  Status StartDaemon(
+      const std::function<std::unique_ptr<mutex_lock>()>& fork_lock);
+
+  const std::string tao_compiler_path_;
+  const std::string socket_path_;
+  const std::vector<std::string> daemon_args_;
+
+  mutex mu_;
+  // Set once the daemon fails to start, the following requests go to the
+  // standalone compiler processes directly.
+  bool disabled_ = false;
+};
+
+}  // namespace tao
+}  // namespace tensorflow
+
+#endif  // TAO_TAO_BRIDGE_KERNELS_TAO_COMPILER_DAEMON_CLIENT_H_
@@ -0,0 +1,123 @@
+// Copyright 2022 The BladeDISC Authors. All rights reserved.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tao_bridge/kernels/tao_compiler_daemon_client.h"
+
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+
+namespace tensorflow {
+namespace tao {
+namespace {
+
+using Request = TaoCompilerDaemonClient::Request;
+
+// A request connected to a fake worker, which is a process sleeping until
+// being killed, so that the tests can check it is never killed by the client.
+class CompilerDaemonRequestTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds), 0);
+    worker_fd_ = fds[1];
+    worker_pid_ = fork();
+    ASSERT_GE(worker_pid_, 0);
+    if (worker_pid_ == 0) {
+      while (true) pause();
+    }
+    request_.reset(new Request(fds[0], worker_pid_));
+  }
+
+  void TearDown() override {
+    request_.reset();
+    close(worker_fd_);
+    kill(worker_pid_, SIGKILL);
+    waitpid(worker_pid_, nullptr, 0);
+  }
+
+  void Reply(int32_t exit_code, const std::string& message) {
+    uint32_t length = message.size();
+    ASSERT_EQ(write(worker_fd_, &exit_code, sizeof(exit_code)),
+              sizeof(exit_code));
+    ASSERT_EQ(write(worker_fd_, &length, sizeof(length)), sizeof(length));
+    ASSERT_EQ(write(worker_fd_, message.data(), length), length);
+  }
+
+  // Returns true if the worker sees the connection shut down by the client.
+  bool IsShutdown() {
+    char c;
+    return read(worker_fd_, &c, 1) == 0;
+  }
+
+  bool IsWorkerAlive() { return waitpid(worker_pid_, nullptr, WNOHANG) == 0; }
+
+  int worker_fd_ = -1;
+  pid_t worker_pid_ = -1;
+  std::unique_ptr<Request> request_;
+};
+
+TEST_F(CompilerDaemonRequestTest, CancelBeforeCompletion) {
+  request_->Cancel();
+  EXPECT_TRUE(IsShutdown());
+  int exit_code = -1;
+  std::string message;
+  Status status = request_->Wait(&exit_code, &message);
+  EXPECT_TRUE(errors::IsCancelled(status)) << status;
+  EXPECT_TRUE(IsWorkerAlive());
+}
+
+TEST_F(CompilerDaemonRequestTest, CancelDuringCompilation) {
+  int exit_code = -1;
+  std::string message;
+  Status status;
+  std::thread waiter(
+      [&]() { status = request_->Wait(&exit_code, &message); });
+  // Gives the waiter a chance to block on the response.
+  usleep(100 * 1000);
+  request_->Cancel();
+  waiter.join();
+  EXPECT_TRUE(errors::IsCancelled(status)) << status;
+  EXPECT_TRUE(IsShutdown());
+  EXPECT_TRUE(IsWorkerAlive());
+}
+
+TEST_F(CompilerDaemonRequestTest, CancelAfterCompletion) {
+  Reply(1, "compilation failed");
+  int exit_code = -1;
+  std::string message;
+  TF_EXPECT_OK(request_->Wait(&exit_code, &message));
+  EXPECT_EQ(exit_code, 1);
+  EXPECT_EQ(message, "compilation failed");
+  // The worker may be serving another request by now.
+  request_->Cancel();
+  EXPECT_TRUE(IsWorkerAlive());
+}
+
+TEST_F(CompilerDaemonRequestTest, WorkerExits) {
+  close(worker_fd_);
+  worker_fd_ = -1;
+  int exit_code = -1;
+  std::string message;
+  Status status = request_->Wait(&exit_code, &message);
+  EXPECT_TRUE(errors::IsUnavailable(status)) << status;
+}
+
+}  // namespace
+}  // namespace tao
+}  // namespace tensorflow
@@ -48,17 +48,27 @@ void MlirExecutable::DumpToFile(const std::string& filename) const {
   *result.mutable_mlir()->mutable_const_proto_filename() = filename + ".so.pb";
   if (tao_compiler_result().mlir().so_lib_filename() !=
       result.mlir().so_lib_filename()) {
-    TF_CHECK_OK(tensorflow::Env::Default()->CopyFile(
-        tao_compiler_result().mlir().so_lib_filename(),
-        result.mlir().so_lib_filename()));
+    TF_CHECK_OK(
+        CopyFileAtomically(tao_compiler_result().mlir().so_lib_filename(),
+                           result.mlir().so_lib_filename()));
   }
   if (tao_compiler_result().mlir().const_proto_filename() !=
       result.mlir().const_proto_filename()) {
-    TF_CHECK_OK(tensorflow::Env::Default()->CopyFile(
-        tao_compiler_result().mlir().const_proto_filename(),
-        result.mlir().const_proto_filename()));
+    TF_CHECK_OK(
+        CopyFileAtomically(tao_compiler_result().mlir().const_proto_filename(),
+                           result.mlir().const_proto_filename()));
+    // The const blob file goes along with the metadata file if the host consts
+    // are emitted to it, see `getConstBlobFileName` in ral_metadata.h.
+    std::string blob_filename =
+        tao_compiler_result().mlir().const_proto_filename() + ".blob";
+    if (tensorflow::Env::Default()->FileExists(blob_filename).ok()) {
+      TF_CHECK_OK(CopyFileAtomically(
+          blob_filename, result.mlir().const_proto_filename() + ".blob"));
+    }
   }
-  CHECK(WriteTextProto(tensorflow::Env::Default(), filename, result).ok());
+  // The compiled result refers to the files above, thus is written last.
+  TF_CHECK_OK(
+      WriteCompilerResultAtomically(filename, result, /*text_format=*/true));
 }
 
 Status MlirExecutable::PreRunProcess(const ExecutableRunOptions& options,
@@ -103,6 +113,7 @@ Status MlirExecutable::InitImpl(const TaoCompilerResult* result) {
   }
 
   entry_func_ = (MLIR_FUNC_T)func_handle;
+  tao_ral_resolve_api_table(dso_handle_);
 
   RalTfContextOptions opts;
   opts.metadata_file_path = result->mlir().const_proto_filename();
@@ -116,6 +127,9 @@ Status MlirExecutable::RunImpl(const ExecutableRunOptions& options,
   auto exec_ctx =
       ::tao::ral::MakeExecutionContext<RalTfExecutionContext>(ral_ctx);
   exec_ctx->setOpContext(options.ctx());
+  for (auto& pair : options.padded_inputs()) {
+    exec_ctx->setInput(pair.first, pair.second);
+  }
 
   void* ctx_struct[] = {exec_ctx.get(), (void*)tao_ral_call_impl};
   entry_func_(ctx_struct);
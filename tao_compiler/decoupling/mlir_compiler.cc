@@ -112,7 +112,11 @@ Status ConvertInputInfo(const TaoCompilerInput& input, Graph* graph,
       data_types[index] = (dtype == DT_INVALID ? "" : DataType_Name(dtype));
       // Force to codegen dynamic shape (not dynamic rank) code
       std::vector<int> dims(arg_shapes[index].dims(), -1);
-      if (known_arg_shapes.count(absl::AsciiStrToLower(n->name())) > 0) {
+      if (input.args(index).static_shape()) {
+        for (auto i = 0; i < dims.size(); i++) {
+          dims[i] = arg_shapes[index].dim_size(i);
+        }
+      } else if (known_arg_shapes.count(absl::AsciiStrToLower(n->name())) > 0) {
         auto known_shape = known_arg_shapes[absl::AsciiStrToLower(n->name())];
         for (auto i = 0; i < dims.size(); i++) {
           dims[i] = known_shape.dim_size(i);
@@ -303,6 +307,12 @@ CompilerMLIR::~CompilerMLIR() {}
 
 Status CompilerMLIR::Init(const TaoCompilerInput& input,
                           const string& output_file) {
+  // The compiler may be reused for many inputs (e.g. by the compiler daemon),
+  // drops the states of the last compilation. The module should be destroyed
+  // before the context owning it.
+  module_ = nullptr;
+  context_.reset();
+  result_proto_.Clear();
   return Status::OK();
 }
 
@@ -26,6 +26,8 @@ namespace tao {
 
 struct CompilerMLIR_GPU::Impl {
   mlir::disc_ral::GpuDeviceInfo device_context;
+  // The device info is queried once and reused by the following compilations.
+  bool device_initialized = false;
 };
 
 CompilerMLIR_GPU::CompilerMLIR_GPU() : impl_(new Impl) {}
@@ -36,6 +38,8 @@ std::string CompilerMLIR_GPU::DefaultDevice() { return "gpu"; }
 
 Status CompilerMLIR_GPU::Init(const TaoCompilerInput& input,
                               const string& output_file) {
+  TF_RETURN_IF_ERROR(CompilerMLIR::Init(input, output_file));
+  if (impl_->device_initialized) return Status::OK();
   CUdevice device;
   CUcontext context;
   auto& ctx = impl_->device_context;
@@ -59,6 +63,7 @@ Status CompilerMLIR_GPU::Init(const TaoCompilerInput& input,
   //                          CU_DEVICE_ATTRIBUTE_MAX_THREADS_PER_BLOCK,
   //                          device),
   //     "cuDeviceGetAttribute (MAX_THREADS_PER_BLOCK)");
+  impl_->device_initialized = true;
   return Status::OK();
 }
 
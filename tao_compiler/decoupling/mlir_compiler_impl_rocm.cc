@@ -27,6 +27,8 @@ namespace tao {
 
 struct CompilerMLIR_DCU::Impl {
   mlir::disc_ral::GpuDeviceInfo device_context;
+  // The device info is queried once and reused by the following compilations.
+  bool device_initialized = false;
 };
 
 CompilerMLIR_DCU::CompilerMLIR_DCU() : impl_(new Impl) {}
@@ -37,6 +39,8 @@ std::string CompilerMLIR_DCU::DefaultDevice() { return "gpu"; }
 
 Status CompilerMLIR_DCU::Init(const TaoCompilerInput& input,
                               const string& output_file) {
+  TF_RETURN_IF_ERROR(CompilerMLIR::Init(input, output_file));
+  if (impl_->device_initialized) return Status::OK();
   hipDevice_t device;
   hipCtx_t context;
   auto& ctx = impl_->device_context;
@@ -47,6 +51,7 @@ Status CompilerMLIR_DCU::Init(const TaoCompilerInput& input,
   RETURN_ON_CUDA_ERROR(
       hipDeviceComputeCapability(&ctx.cc_major, &ctx.cc_minor, device),
       "hipDeviceComputeCapability");
+  impl_->device_initialized = true;
   VLOG(2) << "Finish rocm init";
   return Status::OK();
 }
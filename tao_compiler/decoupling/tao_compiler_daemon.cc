@@ -0,0 +1,386 @@
+// Copyright 2022 The BladeDISC Authors. All rights reserved.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/decoupling/tao_compiler_daemon.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/file.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <set>
+#include <thread>
+
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace tao {
+
+namespace {
+
+// The longest file name accepted in a request.
+constexpr uint32_t kMaxFileNameLength = 4096;
+// A client that does not send its request in time is dropped, so that it can
+// not block a worker forever.
+constexpr int kRequestTimeoutSec = 30;
+// The exit code of a worker aborting a cancelled compilation.
+constexpr int kWorkerCancelledExitCode = 2;
+
+bool ReadFully(int fd, void* buf, size_t size) {
+  char* ptr = static_cast<char*>(buf);
+  while (size > 0) {
+    ssize_t n = read(fd, ptr, size);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    ptr += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool WriteFully(int fd, const void* buf, size_t size) {
+  const char* ptr = static_cast<const char*>(buf);
+  while (size > 0) {
+    ssize_t n = send(fd, ptr, size, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    ptr += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool ReadString(int fd, std::string* str) {
+  uint32_t length;
+  if (!ReadFully(fd, &length, sizeof(length)) || length > kMaxFileNameLength) {
+    return false;
+  }
+  str->resize(length);
+  return length == 0 || ReadFully(fd, &(*str)[0], length);
+}
+
+bool FillSocketAddress(const std::string& path, sockaddr_un* addr) {
+  if (path.size() >= sizeof(addr->sun_path)) return false;
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  strncpy(addr->sun_path, path.c_str(), sizeof(addr->sun_path) - 1);
+  return true;
+}
+
+// Returns true if a daemon is accepting connections on `path`.
+bool IsDaemonAlive(const sockaddr_un& addr) {
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) return false;
+  bool alive =
+      connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0;
+  close(fd);
+  return alive;
+}
+
+int64_t NowInSeconds() {
+  return std::chrono::duration_cast<std::chrono::seconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Aborts the worker once the client shuts down the connection, i.e. cancels
+// the request being compiled. The worker is then respawned by the supervisor.
+// The watcher is stopped before the response is written, so a cancellation
+// never affects the following requests served by the same worker.
+class CancellationWatcher {
+ public:
+  explicit CancellationWatcher(int conn) : conn_(conn) {
+    if (pipe2(stop_pipe_, O_CLOEXEC) != 0) {
+      PLOG(WARNING) << "failed to create the pipe, the compilation can not "
+                    << "be cancelled";
+      return;
+    }
+    thread_ = std::thread([this]() { Watch(); });
+  }
+
+  ~CancellationWatcher() { Stop(); }
+
+  void Stop() {
+    if (!thread_.joinable()) return;
+    char c = 0;
+    while (write(stop_pipe_[1], &c, 1) < 0 && errno == EINTR) {
+    }
+    thread_.join();
+    close(stop_pipe_[0]);
+    close(stop_pipe_[1]);
+  }
+
+ private:
+  void Watch() {
+    pollfd pfds[2] = {{conn_, POLLRDHUP, 0}, {stop_pipe_[0], POLLIN, 0}};
+    while (true) {
+      int ready = poll(pfds, 2, -1);
+      if (ready < 0) {
+        if (errno == EINTR) continue;
+        PLOG(WARNING) << "poll on the connection failed";
+        return;
+      }
+      if (pfds[1].revents) return;
+      if (pfds[0].revents & (POLLRDHUP | POLLHUP | POLLERR)) {
+        VLOG(0) << "compilation cancelled by the client, worker " << getpid()
+                << " exits";
+        _exit(kWorkerCancelledExitCode);
+      }
+    }
+  }
+
+  int conn_;
+  int stop_pipe_[2] = {-1, -1};
+  std::thread thread_;
+};
+
+void ServeConnection(int conn, const CompileRequestHandler& handler) {
+  timeval timeout{kRequestTimeoutSec, 0};
+  setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  uint32_t magic, version;
+  std::string input_file, output_file;
+  if (!ReadFully(conn, &magic, sizeof(magic)) ||
+      !ReadFully(conn, &version, sizeof(version)) ||
+      magic != kCompilerDaemonMagic || version != kCompilerDaemonVersion ||
+      !ReadString(conn, &input_file) || !ReadString(conn, &output_file)) {
+    LOG(WARNING) << "drop a malformed compilation request";
+    return;
+  }
+
+  int32_t pid = getpid();
+  if (!WriteFully(conn, &pid, sizeof(pid))) return;
+
+  VLOG(1) << "compiling " << input_file << " to " << output_file;
+  auto start = std::chrono::steady_clock::now();
+  std::string message;
+  CancellationWatcher watcher(conn);
+  int32_t exit_code = handler(input_file, output_file, &message);
+  watcher.Stop();
+  std::chrono::duration<double> elapsed_sec =
+      std::chrono::steady_clock::now() - start;
+  VLOG(0) << "compiled " << input_file << " with exit code " << exit_code
+          << " in " << elapsed_sec.count() << " seconds";
+
+  uint32_t length = message.size();
+  if (!WriteFully(conn, &exit_code, sizeof(exit_code)) ||
+      !WriteFully(conn, &length, sizeof(length)) ||
+      !WriteFully(conn, message.data(), length)) {
+    LOG(WARNING) << "failed to reply the result of " << input_file;
+  }
+}
+
+// Serves the requests one by one until being idle for `idle_timeout_sec`.
+void WorkerLoop(int listen_fd, int idle_timeout_sec,
+                const CompileRequestHandler& handler) {
+  int64_t deadline = NowInSeconds() + idle_timeout_sec;
+  while (true) {
+    int64_t remaining = deadline - NowInSeconds();
+    if (remaining <= 0) break;
+    pollfd pfd{listen_fd, POLLIN, 0};
+    int ready = poll(&pfd, 1, static_cast<int>(remaining * 1000));
+    if (ready < 0 && errno != EINTR) {
+      PLOG(ERROR) << "poll on the daemon socket failed";
+      _exit(1);
+    }
+    if (ready <= 0) continue;
+    // All the workers are waked up by a new connection while only one of them
+    // gets it, the others see EAGAIN since the socket is non-blocking.
+    int conn = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (conn < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ||
+          errno == ECONNABORTED) {
+        continue;
+      }
+      PLOG(ERROR) << "accept on the daemon socket failed";
+      _exit(1);
+    }
+    ServeConnection(conn, handler);
+    close(conn);
+    deadline = NowInSeconds() + idle_timeout_sec;
+  }
+  VLOG(0) << "worker " << getpid() << " exits after being idle for "
+          << idle_timeout_sec << " seconds";
+  _exit(0);
+}
+
+pid_t SpawnWorker(int listen_fd, const CompilerDaemonOptions& options,
+                  const CompileRequestHandler& handler) {
+  pid_t pid = fork();
+  if (pid == 0) {
+    signal(SIGPIPE, SIG_IGN);
+    WorkerLoop(listen_fd, options.idle_timeout_sec, handler);
+  } else if (pid < 0) {
+    PLOG(ERROR) << "failed to fork a compiler daemon worker";
+  }
+  return pid;
+}
+
+// Runs in the detached daemon process: keeps the workers alive until all of
+// them exit on idle, then removes the socket and exits.
+void SupervisorLoop(int listen_fd, const struct stat& socket_stat,
+                    const CompilerDaemonOptions& options,
+                    const CompileRequestHandler& handler) {
+  std::set<pid_t> workers;
+  for (int i = 0; i < options.num_workers; ++i) {
+    pid_t pid = SpawnWorker(listen_fd, options, handler);
+    if (pid > 0) workers.insert(pid);
+  }
+  while (!workers.empty()) {
+    int status;
+    pid_t pid = waitpid(-1, &status, 0);
+    if (pid < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    if (!workers.erase(pid)) continue;
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0) continue;
+    if (WIFEXITED(status) &&
+        WEXITSTATUS(status) == kWorkerCancelledExitCode) {
+      VLOG(1) << "compiler daemon worker " << pid
+              << " exits on cancellation, respawning";
+    } else {
+      LOG(WARNING) << "compiler daemon worker " << pid
+                   << " exits abnormally (" << status << "), respawning";
+    }
+    pid_t new_pid = SpawnWorker(listen_fd, options, handler);
+    if (new_pid > 0) workers.insert(new_pid);
+  }
+  // Only removes the socket if it is not replaced by a new daemon.
+  struct stat current;
+  if (stat(options.socket_path.c_str(), &current) == 0 &&
+      current.st_ino == socket_stat.st_ino &&
+      current.st_dev == socket_stat.st_dev) {
+    unlink(options.socket_path.c_str());
+  }
+  close(listen_fd);
+  VLOG(0) << "compiler daemon on " << options.socket_path << " exits";
+  _exit(0);
+}
+
+void RedirectStdio(const std::string& log_file) {
+  int null_fd = open("/dev/null", O_RDONLY);
+  if (null_fd >= 0) {
+    dup2(null_fd, STDIN_FILENO);
+    close(null_fd);
+  }
+  int log_fd = open(log_file.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0600);
+  if (log_fd >= 0) {
+    dup2(log_fd, STDOUT_FILENO);
+    dup2(log_fd, STDERR_FILENO);
+    close(log_fd);
+  }
+}
+
+}  // namespace
+
+int CompilationStatusToExitCode(const Status& status) {
+  if (status.ok()) return 0;
+  if (status.code() == tensorflow::error::RESOURCE_EXHAUSTED) {
+    return 2;
+  } else if (status.code() == tensorflow::error::DEADLINE_EXCEEDED) {
+    return 3;
+  }
+  return 1;
+}
+
+Status StartCompilerDaemon(const CompilerDaemonOptions& options,
+                           const std::function<Status()>& warmup,
+                           const CompileRequestHandler& handler) {
+  if (options.num_workers <= 0) {
+    return errors::InvalidArgument("the compiler daemon needs a worker");
+  }
+  sockaddr_un addr;
+  if (!FillSocketAddress(options.socket_path, &addr)) {
+    return errors::InvalidArgument("socket path too long: ",
+                                   options.socket_path);
+  }
+
+  // Serializes the daemons started on the same socket concurrently.
+  std::string lock_file = options.socket_path + ".lock";
+  int lock_fd = open(lock_file.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (lock_fd < 0 || flock(lock_fd, LOCK_EX) != 0) {
+    if (lock_fd >= 0) close(lock_fd);
+    return errors::Internal("failed to lock ", lock_file, ": ",
+                            strerror(errno));
+  }
+
+  if (IsDaemonAlive(addr)) {
+    VLOG(0) << "compiler daemon is already running on " << options.socket_path;
+    close(lock_fd);
+    return Status::OK();
+  }
+
+  // The socket file, if any, is left by a dead daemon.
+  unlink(options.socket_path.c_str());
+  int listen_fd =
+      socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  mode_t old_mask = umask(0077);
+  bool bound = listen_fd >= 0 &&
+               bind(listen_fd, reinterpret_cast<const sockaddr*>(&addr),
+                    sizeof(addr)) == 0 &&
+               listen(listen_fd, SOMAXCONN) == 0;
+  umask(old_mask);
+  struct stat socket_stat;
+  if (!bound || stat(options.socket_path.c_str(), &socket_stat) != 0) {
+    std::string error = strerror(errno);
+    if (listen_fd >= 0) close(listen_fd);
+    close(lock_fd);
+    return errors::Internal("failed to listen on ", options.socket_path, ": ",
+                            error);
+  }
+
+  Status status = warmup();
+  if (!status.ok()) {
+    close(listen_fd);
+    unlink(options.socket_path.c_str());
+    close(lock_fd);
+    return status;
+  }
+
+  pid_t pid = fork();
+  if (pid < 0) {
+    std::string error = strerror(errno);
+    close(listen_fd);
+    unlink(options.socket_path.c_str());
+    close(lock_fd);
+    return errors::Internal("failed to fork the compiler daemon: ", error);
+  }
+  if (pid > 0) {
+    // The socket is ready: the pending connections are served once the
+    // workers are up.
+    close(listen_fd);
+    close(lock_fd);
+    VLOG(0) << "compiler daemon " << pid << " listens on "
+            << options.socket_path;
+    return Status::OK();
+  }
+
+  // The daemon process, detaches from the client so that the client is not
+  // blocked on its stdout/stderr pipes.
+  close(lock_fd);
+  setsid();
+  RedirectStdio(options.socket_path + ".log");
+  SupervisorLoop(listen_fd, socket_stat, options, handler);
+  return Status::OK();
+}
+
+}  // namespace tao
+}  // namespace tensorflow
@@ -0,0 +1,79 @@
+// Copyright 2022 The BladeDISC Authors. All rights reserved.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TENSORFLOW_COMPILER_DECOUPLING_TAO_COMPILER_DAEMON_H_
+#define TENSORFLOW_COMPILER_DECOUPLING_TAO_COMPILER_DAEMON_H_
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "tensorflow/core/lib/core/status.h"
+
+namespace tensorflow {
+namespace tao {
+
+// The wire protocol between the compiler daemon and its clients (see
+// tao_bridge/kernels/tao_compiler_daemon_client.cc), all the integers are in
+// native byte order since both sides live on the same host:
+//  - request: magic (u32), version (u32), length (u32) and bytes of the input
+//    file name, length (u32) and bytes of the output file name.
+//  - the daemon replies the pid (i32) of the worker serving the request.
+//  - response: exit code (i32), length (u32) and bytes of the error message.
+// The client cancels a request by shutting down the connection, upon which the
+// worker aborts the compilation. The worker must never be killed by its pid,
+// since it may be serving the next request by then.
+// The exit code has the same meaning as the one of `tao_compiler_main`.
+constexpr uint32_t kCompilerDaemonMagic = 0x43534944;  // "DISC"
+constexpr uint32_t kCompilerDaemonVersion = 1;
+// The exit code replied when the daemon can not serve the request, e.g. the
+// env vars of the input differ from the ones the daemon is started with. The
+// client is expected to compile the input with a standalone process instead.
+constexpr int32_t kCompilerDaemonRejected = 100;
+
+// Maps the status of a compilation to the exit code of `tao_compiler_main`.
+int CompilationStatusToExitCode(const Status& status);
+
+struct CompilerDaemonOptions {
+  // Path of the unix domain socket the daemon listens on.
+  std::string socket_path;
+  // Number of worker processes serving the requests concurrently.
+  int num_workers = 4;
+  // A worker exits after being idle for such seconds, and the daemon exits
+  // after all its workers exit.
+  int idle_timeout_sec = 600;
+};
+
+// Compiles `input_file` to `output_file` and returns the exit code, an error
+// message is written to `message` on failure.
+using CompileRequestHandler = std::function<int(
+    const std::string& input_file, const std::string& output_file,
+    std::string* message)>;
+
+// Starts a compiler daemon listening on `options.socket_path`, or does nothing
+// if a daemon is already listening on it. `warmup` is called once before the
+// workers are forked, so the states it initializes (e.g. registered passes and
+// llvm targets) are shared by all the workers. `warmup` must not start any
+// thread. Returns once the socket is ready to accept requests, while the
+// daemon keeps running in the background.
+//
+// The compiler keeps per-compilation states and reads env vars into static
+// caches, so the requests are served by a pool of pre-forked worker processes,
+// each of which compiles one input at a time. A worker aborting a cancelled
+// compilation or crashed is respawned.
+Status StartCompilerDaemon(const CompilerDaemonOptions& options,
+                           const std::function<Status()>& warmup,
+                           const CompileRequestHandler& handler);
+
+}  // namespace tao
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_COMPILER_DECOUPLING_TAO_COMPILER_DAEMON_H_
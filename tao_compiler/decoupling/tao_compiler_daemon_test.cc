@@ -0,0 +1,189 @@
+// Copyright 2022 The BladeDISC Authors. All rights reserved.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/decoupling/tao_compiler_daemon.h"
+
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace tao {
+namespace {
+
+// The input file name asking the handler to compile until being cancelled.
+constexpr char kBlockingInput[] = "blocking";
+
+int HandleRequest(const std::string& input_file,
+                  const std::string& output_file, std::string* message) {
+  if (input_file == kBlockingInput) {
+    while (true) sleep(1);
+  }
+  *message = input_file;
+  return 0;
+}
+
+// A connection to the daemon speaking the protocol of the client.
+class Connection {
+ public:
+  explicit Connection(const std::string& socket_path) {
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+    fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (connect(fd_, reinterpret_cast<const sockaddr*>(&addr),
+                sizeof(addr)) != 0) {
+      close(fd_);
+      fd_ = -1;
+    }
+  }
+  ~Connection() {
+    if (fd_ >= 0) close(fd_);
+  }
+
+  bool connected() const { return fd_ >= 0; }
+
+  // Sends the request and returns the pid of the worker serving it.
+  pid_t Send(const std::string& input_file) {
+    uint32_t header[] = {kCompilerDaemonMagic, kCompilerDaemonVersion};
+    uint32_t input_length = input_file.size();
+    uint32_t output_length = 0;
+    int32_t pid = -1;
+    if (!Write(header, sizeof(header)) ||
+        !Write(&input_length, sizeof(input_length)) ||
+        !Write(input_file.data(), input_length) ||
+        !Write(&output_length, sizeof(output_length)) ||
+        !Read(&pid, sizeof(pid))) {
+      return -1;
+    }
+    return pid;
+  }
+
+  // Receives the response, returns false if the connection is closed.
+  bool Receive(int32_t* exit_code, std::string* message) {
+    uint32_t length;
+    if (!Read(exit_code, sizeof(*exit_code)) ||
+        !Read(&length, sizeof(length))) {
+      return false;
+    }
+    message->resize(length);
+    return length == 0 || Read(&(*message)[0], length);
+  }
+
+  void Cancel() { shutdown(fd_, SHUT_RDWR); }
+
+ private:
+  bool Write(const void* buf, size_t size) {
+    return send(fd_, buf, size, MSG_NOSIGNAL) == static_cast<ssize_t>(size);
+  }
+  bool Read(void* buf, size_t size) {
+    return recv(fd_, buf, size, MSG_WAITALL) == static_cast<ssize_t>(size);
+  }
+
+  int fd_ = -1;
+};
+
+bool WaitForExit(pid_t pid) {
+  for (int i = 0; i < 100; ++i) {
+    if (kill(pid, 0) != 0 && errno == ESRCH) return true;
+    usleep(50 * 1000);
+  }
+  return false;
+}
+
+// A daemon with a single worker, so that the tests can tell whether the
+// worker serving a request is respawned.
+class CompilerDaemonTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    std::string dir;
+    ASSERT_TRUE(Env::Default()->LocalTempFilename(&dir));
+    TF_ASSERT_OK(Env::Default()->RecursivelyCreateDir(dir));
+    options_.socket_path = dir + "/daemon.sock";
+    options_.num_workers = 1;
+    options_.idle_timeout_sec = 5;
+    TF_ASSERT_OK(StartCompilerDaemon(
+        options_, []() { return Status::OK(); }, HandleRequest));
+  }
+
+  // Compiles an input to completion and returns the pid of the worker.
+  pid_t Compile(const std::string& input_file) {
+    Connection conn(options_.socket_path);
+    EXPECT_TRUE(conn.connected());
+    pid_t pid = conn.Send(input_file);
+    EXPECT_GT(pid, 0);
+    int32_t exit_code = -1;
+    std::string message;
+    EXPECT_TRUE(conn.Receive(&exit_code, &message));
+    EXPECT_EQ(exit_code, 0);
+    EXPECT_EQ(message, input_file);
+    return pid;
+  }
+
+  CompilerDaemonOptions options_;
+};
+
+TEST_F(CompilerDaemonTest, CancelBeforeCompilation) {
+  pid_t pid = Compile("warmup");
+  {
+    // Hangs up before the worker replies its pid.
+    Connection conn(options_.socket_path);
+    ASSERT_TRUE(conn.connected());
+    conn.Cancel();
+  }
+  // The worker drops the request and keeps serving.
+  EXPECT_EQ(Compile("input"), pid);
+}
+
+TEST_F(CompilerDaemonTest, CancelDuringCompilation) {
+  Connection conn(options_.socket_path);
+  ASSERT_TRUE(conn.connected());
+  pid_t pid = conn.Send(kBlockingInput);
+  ASSERT_GT(pid, 0);
+  conn.Cancel();
+  // The worker aborts the compilation and is respawned.
+  EXPECT_TRUE(WaitForExit(pid));
+  EXPECT_NE(Compile("input"), pid);
+}
+
+TEST_F(CompilerDaemonTest, CancelAfterCompilation) {
+  Connection conn(options_.socket_path);
+  ASSERT_TRUE(conn.connected());
+  pid_t pid = conn.Send("first");
+  ASSERT_GT(pid, 0);
+  int32_t exit_code = -1;
+  std::string message;
+  ASSERT_TRUE(conn.Receive(&exit_code, &message));
+  EXPECT_EQ(exit_code, 0);
+
+  // The worker moves on to a blocking request, which must not be affected by
+  // cancelling the first one.
+  Connection next(options_.socket_path);
+  ASSERT_TRUE(next.connected());
+  EXPECT_EQ(next.Send(kBlockingInput), pid);
+  conn.Cancel();
+  usleep(200 * 1000);
+  EXPECT_EQ(kill(pid, 0), 0);
+  next.Cancel();
+  EXPECT_TRUE(WaitForExit(pid));
+}
+
+}  // namespace
+}  // namespace tao
+}  // namespace tensorflow
@@ -33,6 +33,7 @@ limitations under the License.
 #include "mlir/Pass/PassManager.h"  // from @llvm-project
 #include "mlir/Support/Timing.h"    // from @llvm-project
 #include "tensorflow/compiler/decoupling/compiler_base.h"
+#include "tensorflow/compiler/decoupling/tao_compiler_daemon.h"
 #include "tensorflow/compiler/decoupling/tao_compiler_input.pb.h"
 #include "tensorflow/compiler/decoupling/tao_compiler_trace.h"
 #include "tensorflow/compiler/xla/debug_options_flags.h"
@@ -52,7 +53,8 @@ std::unordered_map<std::string, std::string> parse_envs(
     llvm::cl::list<std::string>& envs) {
   std::unordered_map<std::string, std::string> env_pair;
   for (auto& env : envs) {
-    std::vector<std::string> kvs = absl::StrSplit(env, '=');
+    std::vector<std::string> kvs =
+        absl::StrSplit(env, absl::MaxSplits('=', 1));
     if (kvs.size() != 2) {
       LOG(FATAL) << "env option value should be ENV=VAL: " << env;
     }
@@ -71,6 +73,41 @@ std::string version_info() {
   return ss.str();
 }
 
+// Compiles a request of the compiler daemon, whose env vars are set up once
+// when the daemon starts.
+int ServeCompileRequest(const std::string& input_fn,
+                        const std::string& output_fn, std::string* message) {
+  tensorflow::tao::TaoCompilerInput input;
+  Status status = ReadBinaryProto(Env::Default(), input_fn, &input);
+  if (!status.ok()) {
+    *message = status.error_message();
+    return tao::CompilationStatusToExitCode(status);
+  }
+
+  // The env vars are read into static caches by the passes, they can not be
+  // changed per request.
+  for (auto& kv : input.env()) {
+    const char* value = getenv(kv.first.c_str());
+    if (value == nullptr || kv.second != value) {
+      *message = strings::StrCat("env var ", kv.first,
+                                 " differs from the one of the daemon");
+      return tao::kCompilerDaemonRejected;
+    }
+  }
+
+  DeviceType device_type(input.options().device_type());
+  auto status_or = CompilerBase::GetCompilerForDevice(device_type);
+  status = status_or.status();
+  if (status.ok()) {
+    status = status_or.value()->Compile(input, output_fn);
+  }
+  tao::TaoCompilerTrace::Instance()->Shutdown();
+  if (!status.ok()) {
+    *message = status.error_message();
+  }
+  return tao::CompilationStatusToExitCode(status);
+}
+
 Status RealMain(int argc, char** argv) {
   llvm::cl::OptionCategory disc_category("DISC", "Options for DISC.");
 
@@ -92,6 +129,26 @@ Status RealMain(int argc, char** argv) {
                      "this option can be specified zero or more times."),
       llvm::cl::ZeroOrMore, llvm::cl::cat(disc_category)};
 
+  llvm::cl::opt<std::string> daemon_socket{
+      "daemon",
+      llvm::cl::desc("start a compiler daemon serving the compilation "
+                     "requests on the unix domain socket."),
+      llvm::cl::cat(disc_category)};
+  llvm::cl::opt<std::string> daemon_device{
+      "daemon-device",
+      llvm::cl::desc("the device type whose compiler is warmed up by the "
+                     "compiler daemon."),
+      llvm::cl::cat(disc_category)};
+  llvm::cl::opt<int> daemon_workers{
+      "daemon-workers",
+      llvm::cl::desc("number of worker processes of the compiler daemon."),
+      llvm::cl::init(4), llvm::cl::cat(disc_category)};
+  llvm::cl::opt<int> daemon_idle_timeout{
+      "daemon-idle-timeout",
+      llvm::cl::desc("seconds the compiler daemon waits for new requests "
+                     "before exiting."),
+      llvm::cl::init(600), llvm::cl::cat(disc_category)};
+
   llvm::cl::opt<bool> version("v", llvm::cl::desc("show DIS compiler version."),
                               llvm::cl::cat(disc_category));
   llvm::cl::AddExtraVersionPrinter(
@@ -108,6 +165,27 @@ Status RealMain(int argc, char** argv) {
     return Status::OK();
   }
 
+  if (!daemon_socket.empty()) {
+    auto cmd_envs = parse_envs(envs);
+    VLOG(1) << "Setting up environment variable of the compiler daemon:";
+    for (auto& kv : cmd_envs) {
+      VLOG(1) << "    " << kv.first << "=" << kv.second;
+      setenv(kv.first.c_str(), kv.second.c_str(), 1);
+    }
+    tao::CompilerDaemonOptions options;
+    options.socket_path = daemon_socket;
+    options.num_workers = daemon_workers;
+    options.idle_timeout_sec = daemon_idle_timeout;
+    std::string device = daemon_device;
+    auto warmup = [&device]() -> Status {
+      if (device.empty()) return Status::OK();
+      // Creates the compiler, which registers the passes and initializes the
+      // llvm targets, before the workers are forked.
+      return CompilerBase::GetCompilerForDevice(DeviceType(device)).status();
+    };
+    return tao::StartCompilerDaemon(options, warmup, ServeCompileRequest);
+  }
+
   tensorflow::tao::TaoCompilerInput input;
   TF_RETURN_IF_ERROR(ReadBinaryProto(Env::Default(), input_fn, &input));
 
@@ -166,11 +244,6 @@ int main(int argc, char** argv) {
     std::string err_msg = status.error_message();
     tensorflow::error::Code code = status.code();
     VLOG(0) << "Failed! " << err_msg << " code " << code;
-    if (code == tensorflow::error::RESOURCE_EXHAUSTED) {
-      return 2;
-    } else if (code == tensorflow::error::DEADLINE_EXCEEDED) {
-      return 3;
-    }
-    return 1;
+    return tensorflow::tao::CompilationStatusToExitCode(status);
   }
 }
@@ -17,7 +17,9 @@ limitations under the License.
 
 #include <fstream>
 
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Analysis/ValueTracking.h"
 #include "llvm/CodeGen/CommandFlags.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
@@ -88,6 +90,114 @@ void DumpLLVMModule(llvm::Module* m) {
   llvm::dbgs() << str << "\n";
 }
 
+// Builds a dense api table for the ral calls having a constant api name.
+//
+// Each distinct api name is assigned a slot of the table, which is resolved by
+// the runtime (see `tao_ral_resolve_api_table`) once the module is loaded. All
+// such call sites are rewritten to:
+//   disc_ral_call_slot(ctx_struct, &disc_ral_api_table[idx], name, args)
+// which calls the resolved api entry directly and falls back to `disc_ral_call`
+// (a by-name lookup) if the slot is not resolved.
+//
+// The following symbols are exported for the runtime:
+//   i8* disc_ral_api_table[N]       : slots, filled by the runtime
+//   i8* disc_ral_api_names[N]       : api name of each slot
+//   i64 disc_ral_api_table_size     : N
+void BuildRalApiTable(llvm::Module* m, llvm::Function* ral_call) {
+  auto& ctx = m->getContext();
+  llvm::SmallVector<std::pair<llvm::CallInst*, int>> sites;
+  llvm::SmallVector<llvm::Constant*> names;
+  llvm::StringMap<int> slots;
+  for (llvm::User* user : ral_call->users()) {
+    auto call = llvm::dyn_cast<llvm::CallInst>(user);
+    if (!call || call->getCalledFunction() != ral_call) continue;
+    auto name = llvm::dyn_cast<llvm::Constant>(call->getArgOperand(1));
+    llvm::StringRef name_str;
+    if (!name || !llvm::getConstantStringInfo(name, name_str)) continue;
+    auto it = slots.try_emplace(name_str, names.size());
+    if (it.second) names.push_back(name);
+    sites.emplace_back(call, it.first->second);
+  }
+  if (names.empty()) return;
+
+  auto i8_ptr_type = llvm::Type::getInt8Ty(ctx)->getPointerTo();
+  auto i8_ptr_ptr_type = i8_ptr_type->getPointerTo();
+  auto i64_type = llvm::Type::getInt64Ty(ctx);
+  auto table_type = llvm::ArrayType::get(i8_ptr_type, names.size());
+  auto table = new llvm::GlobalVariable(
+      *m, table_type, /*isConstant=*/false, llvm::GlobalValue::ExternalLinkage,
+      llvm::Constant::getNullValue(table_type), "disc_ral_api_table");
+  llvm::SmallVector<llvm::Constant*> name_ptrs;
+  for (llvm::Constant* name : names) {
+    name_ptrs.push_back(llvm::ConstantExpr::getPointerCast(name, i8_ptr_type));
+  }
+  new llvm::GlobalVariable(*m, table_type, /*isConstant=*/true,
+                           llvm::GlobalValue::ExternalLinkage,
+                           llvm::ConstantArray::get(table_type, name_ptrs),
+                           "disc_ral_api_names");
+  new llvm::GlobalVariable(*m, i64_type, /*isConstant=*/true,
+                           llvm::GlobalValue::ExternalLinkage,
+                           llvm::ConstantInt::get(i64_type, names.size()),
+                           "disc_ral_api_table_size");
+
+  // void disc_ral_call_slot(i8* ctx_struct, i8* slot, i8* name, i8** args)
+  auto slot_func_type = llvm::FunctionType::get(
+      llvm::Type::getVoidTy(ctx),
+      {i8_ptr_type, i8_ptr_type, i8_ptr_type, i8_ptr_ptr_type}, false);
+  auto slot_func = llvm::Function::Create(
+      slot_func_type, llvm::GlobalValue::InternalLinkage, "disc_ral_call_slot",
+      m);
+  slot_func->addFnAttr(llvm::Attribute::AlwaysInline);
+  auto args = slot_func->arg_begin();
+  auto ctx_struct = args++;
+  auto slot = args++;
+  auto api_name = args++;
+  auto api_args = args;
+
+  auto entry_block = llvm::BasicBlock::Create(ctx, "entry", slot_func);
+  auto fast_block = llvm::BasicBlock::Create(ctx, "fast", slot_func);
+  auto slow_block = llvm::BasicBlock::Create(ctx, "slow", slot_func);
+  llvm::IRBuilder<> b(entry_block);
+  // A resolved slot points to an api entry, the first field of which is a
+  // function pointer of type `void (i8* entry, i8** args)`.
+  auto api_entry = b.CreateLoad(
+      i8_ptr_type, b.CreateBitOrPointerCast(slot, i8_ptr_ptr_type));
+  b.CreateCondBr(b.CreateIsNull(api_entry), slow_block, fast_block);
+
+  b.SetInsertPoint(fast_block);
+  auto invoke_type = llvm::FunctionType::get(
+      llvm::Type::getVoidTy(ctx), {i8_ptr_type, i8_ptr_ptr_type}, false);
+  auto invoke = b.CreateLoad(
+      invoke_type->getPointerTo(),
+      b.CreateBitOrPointerCast(api_entry,
+                               invoke_type->getPointerTo()->getPointerTo()));
+  // Same as `disc_ral_call`: the first argument is the real context.
+  auto real_ctx = b.CreateLoad(
+      i8_ptr_type, b.CreateBitOrPointerCast(ctx_struct, i8_ptr_ptr_type));
+  auto first_arg = b.CreateLoad(i8_ptr_type, api_args);
+  b.CreateStore(real_ctx, b.CreateBitOrPointerCast(first_arg, i8_ptr_ptr_type));
+  b.CreateCall(invoke_type, invoke, {api_entry, api_args});
+  b.CreateRetVoid();
+
+  b.SetInsertPoint(slow_block);
+  b.CreateCall(ral_call->getFunctionType(), ral_call,
+               {ctx_struct, api_name, api_args});
+  b.CreateRetVoid();
+
+  for (auto& site : sites) {
+    llvm::CallInst* call = site.first;
+    llvm::IRBuilder<> call_builder(call);
+    auto slot_ptr = call_builder.CreateConstInBoundsGEP2_32(table_type, table,
+                                                            0, site.second);
+    call_builder.CreateCall(
+        slot_func_type, slot_func,
+        {call->getArgOperand(0),
+         call_builder.CreateBitOrPointerCast(slot_ptr, i8_ptr_type),
+         call->getArgOperand(1), call->getArgOperand(2)});
+    call->eraseFromParent();
+  }
+}
+
 LogicalResult RewriteLLVMModule(llvm::Module* m) {
   auto& ctx = m->getContext();
   auto result_type = llvm::Type::getVoidTy(ctx);
@@ -124,6 +234,8 @@ LogicalResult RewriteLLVMModule(llvm::Module* m) {
   b.CreateCall(func_type, real_func, {real_ctx, api_name, api_args});
   b.CreateRetVoid();
 
+  if (isRalCallTableEnabled()) BuildRalApiTable(m, func);
+
   return success();
 }
 
@@ -181,6 +293,8 @@ void CpuLoweringOptions::initFromEnvVars() {
   tensorflow::ReadBoolFromEnvVar("DISC_CPU_ENABLE_MULTI_THREAD",
                                  target_multi_threading,
                                  &target_multi_threading);
+  tensorflow::ReadBoolFromEnvVar("DISC_CPU_MERGE_KERNEL_LAUNCH",
+                                 merge_kernel_launch, &merge_kernel_launch);
 }
 
 LogicalResult LowerHLOToLLVM(ModuleOp m, const DISCLoweringOptions& options) {
@@ -308,8 +422,14 @@ LogicalResult LowerHLOToLLVM(ModuleOp m, const DISCLoweringOptions& options) {
                                  &enable_fp16_gemm);
   tensorflow::ReadBoolFromEnvVar("TAO_MLIR_ENABLE_AMP_CONV", enable_fp16,
                                  &enable_fp16_conv);
+  // Only the cpu (oneDNN) backend supports bf16 gemm ATM.
+  bool enable_bf16_gemm = false;
+  if (!gpu_enabled) {
+    tensorflow::ReadBoolFromEnvVar("TAO_MLIR_ENABLE_AMP_BF16_GEMM", false,
+                                   &enable_bf16_gemm);
+  }
   pm.addNestedPass<FuncOp>(disc_ral::createDiscElementTypeConverterPass(
-      enable_fp16_gemm, enable_fp16_conv));
+      enable_fp16_gemm, enable_fp16_conv, enable_bf16_gemm));
   if (enable_shape_constraint_ir) {
     // shape-related optimization
     pm.addPass(disc_ral::createDiscShapeOptimizationPass());
@@ -458,7 +578,8 @@ LogicalResult LowerHLOToLLVM(ModuleOp m, const DISCLoweringOptions& options) {
     tensorflow::ReadStringFromEnvVar("DISC_TRANSFORM_SCHEDULE_FILE", "",
                                      &transform_schedule);
     pm.addNestedPass<FuncOp>(disc_ral::createDiscTransformLegalizeToLoopPass(
-        gpu_enabled, transform_schedule));
+        gpu_enabled, transform_schedule, /*expensiveCheck=*/false,
+        options.cpu_options.vector_width));
   }
 
   pm.addNestedPass<FuncOp>(createCanonicalizerPass());
@@ -620,6 +741,16 @@ LogicalResult LowerHLOToLLVM(ModuleOp m, const DISCLoweringOptions& options) {
   pm.addNestedPass<FuncOp>(createCanonicalizerPass());
 
   pm.addNestedPass<FuncOp>(disc_ral::createDiscRemoveDeadBufferPass());
+  if (!gpu_enabled && options.cpu_options.target_multi_threading &&
+      options.cpu_options.merge_kernel_launch) {
+    // Moves deallocs, thus should run before the static memory plan.
+    pm.addNestedPass<FuncOp>(disc_ral::createDiscMergeCpuLaunchPass());
+  }
+  if (isStaticMemoryPlanEnabled()) {
+    // Should be the last pass that touches the buffers, since all the planned
+    // buffers are aliases of the same arena buffer after it.
+    pm.addNestedPass<FuncOp>(disc_ral::createDiscStaticMemoryPlanPass());
+  }
 
   pm.addNestedPass<FuncOp>(::mlir::createConvertLinalgToLoopsPass());
   pm.addPass(createConvertSCFToCFPass());
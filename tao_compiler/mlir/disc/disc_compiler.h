@@ -69,6 +69,10 @@ struct CpuLoweringOptions {
 
   // If true, codegen for multi threading execution environment
   bool target_multi_threading = true;
+
+  // If true, consecutive cpu kernel launches are run in a single parallel
+  // region. Only used when `target_multi_threading` is true.
+  bool merge_kernel_launch = false;
 };
 
 struct DISCLoweringOptions {
@@ -229,6 +229,16 @@ bool useTransformSchedule() {
   return enabled;
 }
 
+bool useTransformEpilogueFusion() {
+  static bool enabled = []() {
+    bool enabled = true;
+    tensorflow::ReadBoolFromEnvVar("DISC_ENABLE_TRANSFORM_EPILOGUE_FUSION",
+                                   enabled, &enabled);
+    return enabled;
+  }();
+  return enabled;
+}
+
 bool lowerFakeQuantToQuantAndDequant() {
   static bool enabled = []() {
     bool enabled = false;
@@ -239,6 +249,36 @@ bool lowerFakeQuantToQuantAndDequant() {
   return enabled;
 }
 
+bool isRalCallTableEnabled() {
+  static bool enabled = []() {
+    bool enabled = false;
+    tensorflow::ReadBoolFromEnvVar("DISC_ENABLE_RAL_CALL_TABLE", enabled,
+                                   &enabled);
+    return enabled;
+  }();
+  return enabled;
+}
+
+bool isStaticMemoryPlanEnabled() {
+  static bool enabled = []() {
+    bool enabled = false;
+    tensorflow::ReadBoolFromEnvVar("DISC_ENABLE_STATIC_MEMORY_PLAN", enabled,
+                                   &enabled);
+    return enabled;
+  }();
+  return enabled;
+}
+
+bool isHostConstBlobEnabled() {
+  static bool enabled = []() {
+    bool enabled = false;
+    tensorflow::ReadBoolFromEnvVar("DISC_ENABLE_HOST_CONST_BLOB", enabled,
+                                   &enabled);
+    return enabled;
+  }();
+  return enabled;
+}
+
 bool isMemIntensiveOptExperimentalEnabled() {
   static bool enabled = []() {
     bool enabled = false;
@@ -117,6 +117,10 @@ bool useHorizontalFusion();
 // Returns true if `DISC_ENABLE_TRANSFORM_SCHEDULE` is true.
 bool useTransformSchedule();
 
+// Returns true if `DISC_ENABLE_TRANSFORM_EPILOGUE_FUSION` is true. When
+// enabled, elementwise consumers of a transform based gemm are fused into it.
+bool useTransformEpilogueFusion();
+
 // Returns true if `DISC_FAKE_QUANT_TO_QUANT_AND_DEQUANT` is true
 bool lowerFakeQuantToQuantAndDequant();
 
@@ -129,6 +133,17 @@ bool isStitchEnabled();
 // Returns true if `DISC_ENABLE_COMPUTE_INTENSIVE_FUSE` is true.
 bool isCompIntensFusionEnabled();
 
+// Returns true if `DISC_ENABLE_RAL_CALL_TABLE` is true.
+bool isRalCallTableEnabled();
+
+// Returns true if `DISC_ENABLE_STATIC_MEMORY_PLAN` is true.
+bool isStaticMemoryPlanEnabled();
+
+// Returns true if `DISC_ENABLE_HOST_CONST_BLOB` is true. If enabled, host
+// consts are emitted to a page-aligned const blob file along with the metadata
+// file, which is mapped and used in place at runtime.
+bool isHostConstBlobEnabled();
+
 // Returns data users of the value and its aliases (e.g. memref.cast).
 // Here non-data users means DimOp, DeallocOp and ShapeOfOp.
 SmallVector<Operation*, 4> getValueUsers(Value v);
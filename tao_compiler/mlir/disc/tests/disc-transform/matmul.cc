@@ -315,4 +315,113 @@ TEST(SimpleTest, MatMulF32_304x1024x512_5) {
       /*profiling*/ true));
 }
 
+// The following tests use the default schedule picked according to the shape
+// of the gemm and the isa of the host cpu.
+
+TEST(SimpleTest, MatMulF32_304x1024x512_DefaultSchedule) {
+  EnvSetting setting = {
+      {"DISC_ENABLE_TRANSFORM_SCHEDULE", {"1", false}},
+      {"DISC_ENABLE_SHAPE_CONSTRAINT_IR", {"1", false}},
+      {"DISC_MEM_INTENSIVE_OPT_EXPERIMENTAL", {"0", false}}};
+  EnvSettingContext ctx(setting);
+  EXPECT_TRUE(feature_test_main(
+      /*mlir_file_path*/ c_ft_path + "matmul_nn_d_f32.mlir",
+      /*backend_types*/ {BackendType::kAArch64},
+      /*num_inputs*/ 2,
+      /*num_outputs*/ 1,
+      /*input_descriptors*/ {"304x512xf32_X", "512x1024xf32_X"},
+      /*output_descriptors*/ {"f32_X"}));
+}
+
+TEST(SimpleTest, MatMulF32_8x1024x512_DefaultSchedule) {
+  EnvSetting setting = {
+      {"DISC_ENABLE_TRANSFORM_SCHEDULE", {"1", false}},
+      {"DISC_ENABLE_SHAPE_CONSTRAINT_IR", {"1", false}},
+      {"DISC_MEM_INTENSIVE_OPT_EXPERIMENTAL", {"0", false}}};
+  EnvSettingContext ctx(setting);
+  EXPECT_TRUE(feature_test_main(
+      /*mlir_file_path*/ c_ft_path + "matmul_nn_s_f32_8x512x1024.mlir",
+      /*backend_types*/ {BackendType::kAArch64},
+      /*num_inputs*/ 2,
+      /*num_outputs*/ 1,
+      /*input_descriptors*/ {"8x512xf32_X", "512x1024xf32_X"},
+      /*output_descriptors*/ {"f32_X"}));
+}
+
+TEST(SimpleTest, MatMulF32_1024x32x512_DefaultSchedule) {
+  EnvSetting setting = {
+      {"DISC_ENABLE_TRANSFORM_SCHEDULE", {"1", false}},
+      {"DISC_ENABLE_SHAPE_CONSTRAINT_IR", {"1", false}},
+      {"DISC_MEM_INTENSIVE_OPT_EXPERIMENTAL", {"0", false}}};
+  EnvSettingContext ctx(setting);
+  EXPECT_TRUE(feature_test_main(
+      /*mlir_file_path*/ c_ft_path + "matmul_nn_s_f32_1024x512x32.mlir",
+      /*backend_types*/ {BackendType::kAArch64},
+      /*num_inputs*/ 2,
+      /*num_outputs*/ 1,
+      /*input_descriptors*/ {"1024x512xf32_X", "512x32xf32_X"},
+      /*output_descriptors*/ {"f32_X"}));
+}
+
+TEST(SimpleTest, MatMulBiasReluF32_304x1024x512_DefaultSchedule) {
+  EnvSetting setting = {
+      {"DISC_ENABLE_TRANSFORM_SCHEDULE", {"1", false}},
+      {"DISC_ENABLE_SHAPE_CONSTRAINT_IR", {"1", false}},
+      {"DISC_MEM_INTENSIVE_OPT_EXPERIMENTAL", {"0", false}}};
+  EnvSettingContext ctx(setting);
+  EXPECT_TRUE(feature_test_main(
+      /*mlir_file_path*/ c_ft_path + "matmul_nn_bias_relu_d_f32.mlir",
+      /*backend_types*/ {BackendType::kAArch64},
+      /*num_inputs*/ 3,
+      /*num_outputs*/ 1,
+      /*input_descriptors*/ {"304x512xf32_X", "512x1024xf32_X", "1024xf32_X"},
+      /*output_descriptors*/ {"f32_X"}));
+}
+
+TEST(SimpleTest, MatMulNTF32_304x1024x512_DefaultSchedule) {
+  EnvSetting setting = {
+      {"DISC_ENABLE_TRANSFORM_SCHEDULE", {"1", false}},
+      {"DISC_ENABLE_SHAPE_CONSTRAINT_IR", {"1", false}},
+      {"DISC_MEM_INTENSIVE_OPT_EXPERIMENTAL", {"0", false}}};
+  EnvSettingContext ctx(setting);
+  EXPECT_TRUE(feature_test_main(
+      /*mlir_file_path*/ c_ft_path + "matmul_nt_d_f32.mlir",
+      /*backend_types*/ {BackendType::kAArch64},
+      /*num_inputs*/ 2,
+      /*num_outputs*/ 1,
+      /*input_descriptors*/ {"304x512xf32_X", "1024x512xf32_X"},
+      /*output_descriptors*/ {"f32_X"}));
+}
+
+TEST(SimpleTest, BatchMatMulNTF32_2x3x100x120x64_DefaultSchedule) {
+  EnvSetting setting = {
+      {"DISC_ENABLE_TRANSFORM_SCHEDULE", {"1", false}},
+      {"DISC_ENABLE_SHAPE_CONSTRAINT_IR", {"1", false}},
+      {"DISC_MEM_INTENSIVE_OPT_EXPERIMENTAL", {"0", false}}};
+  EnvSettingContext ctx(setting);
+  EXPECT_TRUE(feature_test_main(
+      /*mlir_file_path*/ c_ft_path + "batch_matmul_nt_p_f32.mlir",
+      /*backend_types*/ {BackendType::kAArch64},
+      /*num_inputs*/ 2,
+      /*num_outputs*/ 1,
+      /*input_descriptors*/ {"2x3x100x64xf32_X", "2x3x120x64xf32_X"},
+      /*output_descriptors*/ {"f32_X"}));
+}
+
+// All the batch dims are dynamic, thus the dot falls back to the library call.
+TEST(SimpleTest, BatchMatMulNTF32_2x3x100x120x64_DynamicBatch) {
+  EnvSetting setting = {
+      {"DISC_ENABLE_TRANSFORM_SCHEDULE", {"1", false}},
+      {"DISC_ENABLE_SHAPE_CONSTRAINT_IR", {"1", false}},
+      {"DISC_MEM_INTENSIVE_OPT_EXPERIMENTAL", {"0", false}}};
+  EnvSettingContext ctx(setting);
+  EXPECT_TRUE(feature_test_main(
+      /*mlir_file_path*/ c_ft_path + "batch_matmul_nt_d_f32.mlir",
+      /*backend_types*/ {BackendType::kAArch64},
+      /*num_inputs*/ 2,
+      /*num_outputs*/ 1,
+      /*input_descriptors*/ {"2x3x100x64xf32_X", "2x3x120x64xf32_X"},
+      /*output_descriptors*/ {"f32_X"}));
+}
+
 }  // namespace mlir_test
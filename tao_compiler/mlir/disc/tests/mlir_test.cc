@@ -626,6 +626,7 @@ Status MlirTestImpl::GenerateInputAndRun() {
   if (!entry_func_ptr) {
     return Internal("fail to find main");
   }
+  tao_ral_resolve_api_table(func_handle);
   using func_t = void (*)(void**);
   func_t entry_func = (func_t)entry_func_ptr;
 
@@ -237,4 +237,21 @@ TEST(TFMatMulOpTest, ConstWeightF32) {
   unsetenv("DISC_CPU_MATH_KERNEL_MODE");
 }
 
+// const weight test case with bf16 gemm enabled. The weight is folded into a
+// bf16 const, which exercises the bf16 variants of the ral const apis.
+TEST(TFMatMulOpTest, ConstWeightBF16Gemm) {
+  setenv("TAO_MLIR_ENABLE_AMP_BF16_GEMM", "true", 1);
+  EXPECT_TRUE(feature_test_main(
+      /*mlir_file_path*/ c_ft_path + "matmul_nn_const_weight_f32.mlir",
+      /*backend_types*/
+      kSupportedCPUBackendList,
+      /*num_inputs*/ 1,
+      /*num_outputs*/ 1,
+      /*input_descriptors*/ {"100x110xf32_X"},
+      /*output_descriptors*/ {"f32_X"},
+      // values (and their sums) exactly representable in bf16.
+      /*input_vals*/ {{1., 2., -1.}}));
+  unsetenv("TAO_MLIR_ENABLE_AMP_BF16_GEMM");
+}
+
 }  // namespace mlir_test
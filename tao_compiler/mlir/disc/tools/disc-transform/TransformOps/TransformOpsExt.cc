@@ -737,6 +737,90 @@ LogicalResult readFromPackedValue(
   return success();
 }
 
+// Returns true if `op` only permutes the dimensions of its input, i.e. a
+// transpose without tiling and padding.
+bool isPureTransposePackOp(MultiLevelPackOp op) {
+  return !op.getPaddingValue() &&
+         llvm::all_of(op.getTileLevelsVec(),
+                      [](int64_t level) { return level == 0; });
+}
+
+// Suppose `source` is the result (or a slice of the result) of a pure
+// transpose multi_level_pack op. Packing `source` using `tileLevelsVec`,
+// `tileSizesVec` and `permutationVec` is equivalent to packing the input of
+// the transpose (sliced correspondingly) using the parameters composed with
+// the transpose, which avoids materializing the transposed value.
+//
+// Returns the value to pack and updates the parameters in place if the
+// transpose is folded, otherwise returns `source` and keeps the parameters
+// unchanged.
+Value foldTransposeIntoPack(OpBuilder& b, Location loc, Value source,
+                            SmallVectorImpl<int64_t>& tileLevelsVec,
+                            SmallVectorImpl<int64_t>& tileSizesVec,
+                            SmallVectorImpl<int64_t>& permutationVec) {
+  auto sliceOp = source.getDefiningOp<tensor::ExtractSliceOp>();
+  if (sliceOp && (!strideAllOnes(sliceOp) ||
+                  sliceOp.getSourceType().getRank() !=
+                      sliceOp.getType().cast<ShapedType>().getRank()))
+    return source;
+  auto transposeOp = (sliceOp ? sliceOp.getSource() : source)
+                         .getDefiningOp<MultiLevelPackOp>();
+  if (!transposeOp || !isPureTransposePackOp(transposeOp)) return source;
+
+  // The d-th dimension of the transposed value is the `transposition[d]`-th
+  // dimension of the input.
+  auto transposition = transposeOp.getPermutationVec();
+  int64_t rank = transposition.size();
+  Value input = transposeOp.getInput();
+  if (sliceOp) {
+    SmallVector<OpFoldResult> offsets(rank), sizes(rank), strides(rank);
+    for (int64_t d = 0; d < rank; ++d) {
+      offsets[transposition[d]] = sliceOp.getMixedOffsets()[d];
+      sizes[transposition[d]] = sliceOp.getMixedSizes()[d];
+      strides[transposition[d]] = sliceOp.getMixedStrides()[d];
+    }
+    input =
+        b.create<tensor::ExtractSliceOp>(loc, input, offsets, sizes, strides);
+  }
+
+  SmallVector<int64_t> newTileLevelsVec(rank);
+  SmallVector<SmallVector<int64_t>> tileSizesPerInputDim(rank);
+  SmallVector<int64_t> oldStarts(rank);
+  int64_t packedRank = 0;
+  int64_t tileSizeIdx = 0;
+  for (int64_t d = 0; d < rank; ++d) {
+    int64_t level = tileLevelsVec[d];
+    newTileLevelsVec[transposition[d]] = level;
+    tileSizesPerInputDim[transposition[d]].assign(
+        tileSizesVec.begin() + tileSizeIdx,
+        tileSizesVec.begin() + tileSizeIdx + level);
+    oldStarts[d] = packedRank;
+    tileSizeIdx += level;
+    packedRank += 1 + level;
+  }
+
+  SmallVector<int64_t> newTileSizesVec;
+  SmallVector<int64_t> newStarts(rank);
+  int64_t start = 0;
+  for (int64_t i = 0; i < rank; ++i) {
+    newStarts[i] = start;
+    start += 1 + newTileLevelsVec[i];
+    newTileSizesVec.append(tileSizesPerInputDim[i]);
+  }
+
+  // Maps the logical dimensions of the packed value before folding to the
+  // ones after folding.
+  SmallVector<int64_t> logicalDimMapping(packedRank);
+  for (int64_t d = 0; d < rank; ++d) {
+    for (int64_t t = 0; t <= tileLevelsVec[d]; ++t)
+      logicalDimMapping[oldStarts[d] + t] = newStarts[transposition[d]] + t;
+  }
+  for (int64_t& d : permutationVec) d = logicalDimMapping[d];
+  tileLevelsVec.assign(newTileLevelsVec);
+  tileSizesVec.assign(newTileSizesVec);
+  return input;
+}
+
 }  // namespace
 
 void CacheReadOp::build(OpBuilder& builder, OperationState& result,
@@ -858,17 +942,28 @@ DiagnosedSilenceableFailure CacheReadOp::apply(
              << std::get<0>(z) << " vs " << std::get<1>(z) << "\n";
   }
 
+  // Packs the input of the transpose directly if `source` is transposed by a
+  // multi_level_pack op, e.g. the transposed operand of a dot. The packed
+  // layout is the same, thus the packed value is read in the same way.
+  SmallVector<int64_t> packTileLevelsVec = tileLevelsVec;
+  SmallVector<int64_t> packTileSizesVec = tileSizesVec;
+  SmallVector<int64_t> packPermutationVec = permutationVec;
+  Value packSource =
+      foldTransposeIntoPack(b, loc, source, packTileLevelsVec,
+                            packTileSizesVec, packPermutationVec);
+
   SmallVector<OpFoldResult> sourceDims =
-      disc_linalg_ext::getDims(b, loc, source);
+      disc_linalg_ext::getDims(b, loc, packSource);
   auto resultDims = MultiLevelPackOp::getResultShape(
-      b, loc, sourceDims, tileLevelsVec, tileSizesVec, permutationVec);
+      b, loc, sourceDims, packTileLevelsVec, packTileSizesVec,
+      packPermutationVec);
   SmallVector<Value> resultDynDims;
   for (auto r : resultDims)
     if (auto v = r.dyn_cast<Value>()) resultDynDims.push_back(v);
   auto empty = b.create<tensor::EmptyOp>(loc, packedType, resultDynDims);
-  auto packedOp =
-      b.create<MultiLevelPackOp>(loc, source, empty, tileLevelsVec,
-                                 tileSizesVec, permutationVec, paddingValue);
+  auto packedOp = b.create<MultiLevelPackOp>(
+      loc, packSource, empty, packTileLevelsVec, packTileSizesVec,
+      packPermutationVec, paddingValue);
 
   b.setInsertionPoint(targetOp);
   Operation* resultOp;
@@ -1002,8 +1097,15 @@ DiagnosedSilenceableFailure LowerMultiLevelPackToLoopOp::applyToOne(
   auto sortedPermutation = innerMostDimsInfo.permutation;
   llvm::sort(sortedPermutation);
   if (sortedPermutation != innerMostDimsInfo.permutation) {
+    // The dimensions which are not tiled (e.g. a pure transpose) may have
+    // dynamic sizes.
+    SmallVector<Value> transposeDynDims;
+    for (int64_t d : innerMostDimsInfo.permutation)
+      if (innerMostDimsInfo.dimSizes[d] == ShapedType::kDynamicSize)
+        transposeDynDims.push_back(srcDimUppers[d]);
     Value transposeDst = b.create<tensor::EmptyOp>(
-        loc, innerMostDimsInfo.transposedDimSizes, dstTy.getElementType());
+        loc, innerMostDimsInfo.transposedDimSizes, dstTy.getElementType(),
+        transposeDynDims);
     srcSlice = makeTransposeOp(b, loc, srcSlice, transposeDst,
                                innerMostDimsInfo.permutation)
                    ->getResult(0);
@@ -1013,6 +1115,12 @@ DiagnosedSilenceableFailure LowerMultiLevelPackToLoopOp::applyToOne(
       b.create<tensor::InsertSliceOp>(loc, srcSlice, loopInitValue, dstOffsets,
                                       dstSizes, dstStrides)
           ->getResult(0);
+  // A pure transpose does not need any loop.
+  if (forOps.empty()) {
+    target->getResult(0).replaceAllUsesWith(updateDst);
+    results.assign({updateDst.getDefiningOp()});
+    return DiagnosedSilenceableFailure(success());
+  }
   b.create<scf::YieldOp>(loc, updateDst);
   for (int i = static_cast<int>(forOps.size()) - 2; i >= 0; --i) {
     b.setInsertionPointAfter(forOps[i + 1]);
@@ -9,8 +9,10 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include "llvm/ADT/TypeSwitch.h"
 #include "llvm/Support/Debug.h"
 #include "mlir-hlo/Dialect/lhlo/IR/lhlo_ops.h"
+#include "mlir-hlo/Dialect/lhlo/transforms/map_lmhlo_to_scalar_op.h"
 #include "mlir/Dialect/Arith/IR/Arith.h"
 #include "mlir/Dialect/Func/IR/FuncOps.h"
 #include "mlir/Dialect/Linalg/IR/Linalg.h"
@@ -19,6 +21,8 @@
 #include "mlir/IR/MLIRContext.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Transforms/Passes.h"
+#include "tensorflow/compiler/mlir/disc/tools/disc-transform/LinalgExt/LinalgExtDialect.h"
+#include "tensorflow/compiler/mlir/disc/tools/disc-transform/LinalgExt/LinalgExtOps.h"
 #include "tensorflow/compiler/mlir/disc/tools/disc-transform/transforms/PassDetail.h"
 
 #define DEBUG_TYPE "disc-legalize-lmhlo-fusion-to-linalg"
@@ -43,6 +47,12 @@
 //    %0 = linalg.matmul(%A, %B, ...)
 //    return %0 : tensor<?x?xf32>
 //  }
+// ```
+//
+// The elementwise ops after the dot op (i.e. the epilogue, e.g. bias add and
+// activations) are converted to a single linalg.generic op consuming the
+// result of the matmul, and the broadcast ops feeding them are folded into the
+// indexing maps of the generic op.
 
 namespace mlir {
 namespace disc_ral {
@@ -53,6 +63,9 @@ using func::FuncOp;
 struct DiscLegalizeLmhloFusionToLinalgPass
     : public DiscLegalizeLmhloFusionToLinalgPassBase<
           DiscLegalizeLmhloFusionToLinalgPass> {
+  void getDependentDialects(DialectRegistry& registry) const override {
+    registry.insert<disc_linalg_ext::DISCLinalgExtDialect>();
+  }
   void runOnOperation() override;
 };
 
@@ -79,6 +92,54 @@ LogicalResult emitReturnOp(func::ReturnOp op, OpBuilder& b,
   return success();
 }
 
+// Transposes the two minor dimensions of `value` using a multi_level_pack op
+// without tiling. `transform.disc.cache_read` folds such op into the packing
+// of the operand, thus the transpose does not materialize in most cases.
+Value emitMinorTransposeOp(OpBuilder& b, Location loc, Value value) {
+  auto ty = value.getType().cast<RankedTensorType>();
+  int64_t rank = ty.getRank();
+  auto permutation = llvm::to_vector(llvm::seq<int64_t>(0, rank));
+  std::swap(permutation[rank - 2], permutation[rank - 1]);
+  SmallVector<int64_t> shape;
+  SmallVector<Value> dynDims;
+  for (int64_t d : permutation) {
+    shape.push_back(ty.getDimSize(d));
+    if (ty.isDynamicDim(d))
+      dynDims.push_back(b.create<tensor::DimOp>(loc, value, d));
+  }
+  Value empty =
+      b.create<tensor::EmptyOp>(loc, shape, ty.getElementType(), dynDims);
+  SmallVector<int64_t> tileLevels(rank, 0);
+  return b
+      .create<disc_linalg_ext::MultiLevelPackOp>(loc, value, empty, tileLevels,
+                                                 ArrayRef<int64_t>{},
+                                                 permutation)
+      ->getResult(0);
+}
+
+// Returns the reassociation collapsing the leading `numBatchDims` dimensions of
+// a rank `rank` tensor into one.
+SmallVector<ReassociationIndices> getCollapseBatchDimsReassociation(
+    int64_t rank, int64_t numBatchDims) {
+  SmallVector<ReassociationIndices> reassociation(1);
+  for (int64_t d = 0; d < rank; ++d) {
+    if (d < numBatchDims)
+      reassociation.front().push_back(d);
+    else
+      reassociation.push_back({d});
+  }
+  return reassociation;
+}
+
+// Converts a dot_general op to linalg.matmul, or linalg.batch_matmul if it has
+// batching dimensions. The batching dimensions are the leading dimensions and
+// the contracting dimensions are among the two minor dimensions (see
+// `isSupportedDot`), thus:
+//  - the batching dimensions are collapsed into one if there are more than
+//    one, in which case at most one of them may be dynamic since the result
+//    is expanded back afterwards;
+//  - the lhs (rhs) is transposed if its contracting dimension is the second
+//    minor (minor) one.
 LogicalResult emitDotGeneralOp(lmhlo::DotGeneralOp op, OpBuilder& b,
                                BlockAndValueMapping& mapping) {
   Value A = op->getOperand(0);
@@ -89,36 +150,204 @@ LogicalResult emitDotGeneralOp(lmhlo::DotGeneralOp op, OpBuilder& b,
   Value newB = mapping.lookup(B);
   Value newC = mapping.lookup(C);
 
+  auto dimNumbers = op.getDotDimensionNumbers();
+  int64_t numBatchDims = dimNumbers.getLhsBatchingDimensions().size();
+  int64_t rank = newC.getType().cast<RankedTensorType>().getRank();
+  auto resultTy = mapping.lookup(C).getType().cast<RankedTensorType>();
+  if (dimNumbers.getLhsContractingDimensions().size() != 1 ||
+      dimNumbers.getRhsContractingDimensions().size() != 1 ||
+      rank != numBatchDims + 2 ||
+      (numBatchDims > 1 &&
+       llvm::count(resultTy.getShape().take_front(numBatchDims),
+                   ShapedType::kDynamicSize) > 1))
+    return op->emitError() << "unsupported dot_general op\n";
+
+  Location loc = op->getLoc();
+  SmallVector<ReassociationIndices> reassociation;
+  if (numBatchDims > 1) {
+    reassociation = getCollapseBatchDimsReassociation(rank, numBatchDims);
+    newA = b.create<tensor::CollapseShapeOp>(loc, newA, reassociation);
+    newB = b.create<tensor::CollapseShapeOp>(loc, newB, reassociation);
+    newC = b.create<tensor::CollapseShapeOp>(loc, newC, reassociation);
+  }
+  if (dimNumbers.getLhsContractingDimensions()[0] == rank - 2)
+    newA = emitMinorTransposeOp(b, loc, newA);
+  if (dimNumbers.getRhsContractingDimensions()[0] == rank - 1)
+    newB = emitMinorTransposeOp(b, loc, newB);
+
   // firstly fill the output buffer using zero.
   auto ty = newC.getType().cast<ShapedType>();
   auto zeroAttr = b.getZeroAttr(ty.getElementType());
-  Location loc = op->getLoc();
   Value zero = b.create<arith::ConstantOp>(loc, zeroAttr);
   Value t0 = b.create<linalg::FillOp>(loc, zero, newC).result();
-  Value t1 =
-      b.create<linalg::MatmulOp>(loc, ValueRange{newA, newB}, ValueRange{t0})
-          .getResult(0);
+  Value t1;
+  if (numBatchDims == 0) {
+    t1 = b.create<linalg::MatmulOp>(loc, ValueRange{newA, newB},
+                                    ValueRange{t0})
+             .getResult(0);
+  } else {
+    t1 = b.create<linalg::BatchMatmulOp>(loc, ValueRange{newA, newB},
+                                         ValueRange{t0})
+             .getResult(0);
+  }
+  if (numBatchDims > 1)
+    t1 = b.create<tensor::ExpandShapeOp>(loc, resultTy, t1, reassociation);
   mapping.erase(C);
   mapping.map(C, t1);
 
   return success();
 }
 
+LogicalResult emitConstantOp(lmhlo::ConstantOp op, OpBuilder& b,
+                             BlockAndValueMapping& mapping) {
+  Value out = op->getOperand(0);
+  Value t = b.create<arith::ConstantOp>(op->getLoc(), op.getValue());
+  mapping.erase(out);
+  mapping.map(out, t);
+  return success();
+}
+
 LogicalResult emitLmhloOp(Operation* op, OpBuilder& b,
                           BlockAndValueMapping& mapping) {
   if (auto dotGeneralOp = dyn_cast<lmhlo::DotGeneralOp>(op)) {
     return emitDotGeneralOp(dotGeneralOp, b, mapping);
+  } else if (auto constantOp = dyn_cast<lmhlo::ConstantOp>(op)) {
+    return emitConstantOp(constantOp, b, mapping);
   }
   // TODO(wyzero): support other lmhlo ops.
   return failure();
 }
 
+bool isBroadcastOp(Operation* op) {
+  return isa<lmhlo::BroadcastInDimOp, lmhlo::DynamicBroadcastInDimOp>(op);
+}
+
+DenseIntElementsAttr getBroadcastDimensions(Operation* op) {
+  if (auto bcastOp = dyn_cast<lmhlo::BroadcastInDimOp>(op))
+    return bcastOp.getBroadcastDimensions();
+  return cast<lmhlo::DynamicBroadcastInDimOp>(op).getBroadcastDimensions();
+}
+
+// Emits the scalar version of the elementwise `op`. Returns a null value if
+// the op is not supported.
+Value emitScalarOp(Operation* op, Type resultType, ValueRange operands,
+                   OpBuilder& b) {
+  // clang-format off
+  return llvm::TypeSwitch<Operation*, Value>(op)
+      .Case<
+        lmhlo::AbsOp,
+        lmhlo::AddOp,
+        lmhlo::DivOp,
+        lmhlo::ExpOp,
+        lmhlo::LogOp,
+        lmhlo::LogisticOp,
+        lmhlo::MaxOp,
+        lmhlo::MinOp,
+        lmhlo::MulOp,
+        lmhlo::NegOp,
+        lmhlo::PowOp,
+        lmhlo::RsqrtOp,
+        lmhlo::SqrtOp,
+        lmhlo::SubtractOp,
+        lmhlo::TanhOp
+      >([&](auto concreteOp) {
+        return lmhlo::LhloOpToStdScalarOp::map<decltype(concreteOp)>(
+            concreteOp, resultType, operands, &b);
+      })
+      .Default([](Operation*) { return Value(); });
+  // clang-format on
+}
+
+// Emits the epilogue ops as a single linalg.generic op. `ops` are supposed to
+// be in topological order.
+LogicalResult emitEpilogueOps(ArrayRef<Operation*> ops, OpBuilder& b,
+                              BlockAndValueMapping& mapping) {
+  DenseMap<Value, Operation*> broadcasts;
+  DenseSet<Value> elemResults;
+  Operation* rootOp = nullptr;
+  for (Operation* op : ops) {
+    Value out = op->getOperands().back();
+    if (isBroadcastOp(op)) {
+      broadcasts[out] = op;
+    } else {
+      elemResults.insert(out);
+      rootOp = op;
+    }
+  }
+  if (!rootOp) return failure();
+
+  Location loc = rootOp->getLoc();
+  Value rootOut = rootOp->getOperands().back();
+  Value init = mapping.lookup(rootOut);
+  int64_t rank = init.getType().cast<ShapedType>().getRank();
+
+  // Collects the inputs of the generic op. The result of a broadcast op is
+  // replaced by its operand using a broadcasting indexing map.
+  SmallVector<Value> inputs;
+  SmallVector<AffineMap> indexingMaps;
+  DenseMap<Value, int> inputIndices;
+  for (Operation* op : ops) {
+    if (isBroadcastOp(op)) continue;
+    for (Value v : op->getOperands().drop_back()) {
+      if (elemResults.contains(v) || inputIndices.count(v)) continue;
+      inputIndices[v] = inputs.size();
+      auto it = broadcasts.find(v);
+      if (it == broadcasts.end()) {
+        inputs.push_back(mapping.lookup(v));
+        indexingMaps.push_back(b.getMultiDimIdentityMap(rank));
+        continue;
+      }
+      SmallVector<AffineExpr> exprs;
+      for (int64_t d : getBroadcastDimensions(it->second).getValues<int64_t>())
+        exprs.push_back(b.getAffineDimExpr(d));
+      inputs.push_back(mapping.lookup(it->second->getOperand(0)));
+      indexingMaps.push_back(AffineMap::get(rank, 0, exprs, b.getContext()));
+    }
+  }
+  indexingMaps.push_back(b.getMultiDimIdentityMap(rank));
+  SmallVector<StringRef> iteratorTypes(rank, getParallelIteratorTypeName());
+
+  Operation* unsupportedOp = nullptr;
+  auto genericOp = b.create<linalg::GenericOp>(
+      loc, init.getType(), inputs, init, indexingMaps, iteratorTypes,
+      [&](OpBuilder& nestedBuilder, Location nestedLoc, ValueRange args) {
+        DenseMap<Value, Value> scalars;
+        for (auto& it : inputIndices) scalars[it.first] = args[it.second];
+        for (Operation* op : ops) {
+          if (isBroadcastOp(op) || unsupportedOp) continue;
+          SmallVector<Value> operands;
+          for (Value v : op->getOperands().drop_back())
+            operands.push_back(scalars.lookup(v));
+          Value out = op->getOperands().back();
+          Type elemType = out.getType().cast<MemRefType>().getElementType();
+          Value result = emitScalarOp(op, elemType, operands, nestedBuilder);
+          if (!result) unsupportedOp = op;
+          scalars[out] = result;
+        }
+        Value yielded = unsupportedOp ? args.back() : scalars.lookup(rootOut);
+        nestedBuilder.create<linalg::YieldOp>(nestedLoc, yielded);
+      });
+  if (unsupportedOp) {
+    genericOp->erase();
+    return unsupportedOp->emitError() << "unsupported epilogue op\n";
+  }
+  mapping.erase(rootOut);
+  mapping.map(rootOut, genericOp->getResult(0));
+  return success();
+}
+
 LogicalResult emitLmhloFusionOp(lmhlo::FusionOp op, OpBuilder& b,
                                 BlockAndValueMapping& mapping) {
+  SmallVector<Operation*> epilogueOps;
   for (Operation& op : op.getRegion().getBlocks().front()) {
     if (isa<lmhlo::TerminatorOp>(&op)) continue;
-    if (failed(emitLmhloOp(&op, b, mapping))) return failure();
+    if (isa<lmhlo::DotGeneralOp, lmhlo::ConstantOp>(&op)) {
+      if (failed(emitLmhloOp(&op, b, mapping))) return failure();
+    } else {
+      epilogueOps.push_back(&op);
+    }
   }
+  if (!epilogueOps.empty()) return emitEpilogueOps(epilogueOps, b, mapping);
   return success();
 }
 
@@ -40,10 +40,13 @@ namespace disc_ral {
 std::unique_ptr<OperationPass<ModuleOp>>
 createDiscLegalizeLmhloFusionToLinalgPass();
 
-// Applys transform dialect ops for codegen.
+// Applys transform dialect ops for codegen. The transform ops are loaded from
+// `fileName` if provided, otherwise parsed from `transformSource` if provided,
+// otherwise taken from the payload module itself.
 std::unique_ptr<OperationPass<ModuleOp>>
-createDiscTransformDialectInterpreterPass(const std::string& fileName = "",
-                                          bool enableExpensiveChecks = false);
+createDiscTransformDialectInterpreterPass(
+    const std::string& fileName = "", bool enableExpensiveChecks = false,
+    const std::string& transformSource = "");
 
 // Converts the transformed payload IR to be suitable for RAL.
 std::unique_ptr<OperationPass<ModuleOp>> createDiscRewritePayloadIRForRALPass(
@@ -12,4 +12,83 @@ func.func @matmul_nn(%arg1: memref<?x?xf32, "cpu">, %arg2: memref<?x?xf32, "cpu"
     "lmhlo.terminator"() : () -> ()
   }) {disc.device = "cpu", disc.fusion.name = "matmul_nn_kTransform_dot_general__1_1_0", disc.fusion_type = "kTransform"} : () -> ()
   return %arg3 : memref<?x?xf32, "cpu">
-}
\ No newline at end of file
+}
+// -----
+
+// CHECK-DAG: #[[MAP0:.*]] = affine_map<(d0, d1) -> (d0, d1)>
+// CHECK-DAG: #[[MAP1:.*]] = affine_map<(d0, d1) -> (d1)>
+// CHECK-DAG: #[[MAP2:.*]] = affine_map<(d0, d1) -> ()>
+
+// CHECK-LABEL: @matmul_nn_bias_relu_residual
+// CHECK-SAME: (%[[ARG0:.*]]: tensor<?x?xf32>, %[[ARG1:.*]]: tensor<?x?xf32>, %[[BIAS:.*]]: tensor<?xf32>, %[[SHAPE:.*]]: tensor<2xindex>, %[[RES:.*]]: tensor<?x?xf32>, %[[CST:.*]]: tensor<f32>, %[[ARG6:.*]]: tensor<?x?xf32>, %[[ARG7:.*]]: tensor<?x?xf32>, %[[ARG8:.*]]: tensor<?x?xf32>, %[[ARG9:.*]]: tensor<?x?xf32>, %[[ARG10:.*]]: tensor<?x?xf32>, %[[ARG11:.*]]: tensor<?x?xf32>)
+func.func @matmul_nn_bias_relu_residual(%arg0: memref<?x?xf32, "cpu">, %arg1: memref<?x?xf32, "cpu">, %bias: memref<?xf32, "cpu">, %shape: memref<2xindex, "cpu">, %res: memref<?x?xf32, "cpu">, %cst: memref<f32, "cpu">, %arg6: memref<?x?xf32, "cpu">, %arg7: memref<?x?xf32, "cpu">, %arg8: memref<?x?xf32, "cpu">, %arg9: memref<?x?xf32, "cpu">, %arg10: memref<?x?xf32, "cpu">, %arg11: memref<?x?xf32, "cpu">) -> memref<?x?xf32, "cpu"> {
+  // CHECK: %[[ZEROS:.*]] = arith.constant dense<0.000000e+00> : tensor<f32>
+  // CHECK: %[[ZERO:.*]] = arith.constant 0.000000e+00 : f32
+  // CHECK: %[[T0:.*]] = linalg.fill ins(%[[ZERO]] : f32) outs(%[[ARG6]] : tensor<?x?xf32>) -> tensor<?x?xf32>
+  // CHECK: %[[T1:.*]] = linalg.matmul ins(%[[ARG0]], %[[ARG1]] : tensor<?x?xf32>, tensor<?x?xf32>) outs(%[[T0]] : tensor<?x?xf32>) -> tensor<?x?xf32>
+  // CHECK: %[[T2:.*]] = linalg.generic
+  // CHECK-SAME: indexing_maps = [#[[MAP0]], #[[MAP1]], #[[MAP2]], #[[MAP0]], #[[MAP0]]]
+  // CHECK-SAME: ins(%[[T1]], %[[BIAS]], %[[ZEROS]], %[[RES]] : tensor<?x?xf32>, tensor<?xf32>, tensor<f32>, tensor<?x?xf32>)
+  // CHECK-SAME: outs(%[[ARG11]] : tensor<?x?xf32>)
+  // CHECK: ^bb0(%[[V0:.*]]: f32, %[[V1:.*]]: f32, %[[V2:.*]]: f32, %[[V3:.*]]: f32, %{{.*}}: f32):
+  // CHECK: %[[V4:.*]] = arith.addf %[[V0]], %[[V1]] : f32
+  // CHECK: arith.maxf %[[V4]], %[[V2]] : f32
+  // CHECK: %[[V6:.*]] = arith.addf %{{.*}}, %[[V3]] : f32
+  // CHECK: linalg.yield %[[V6]] : f32
+  // CHECK: return %[[T2]]
+  "lmhlo.fusion"() ({
+    "lmhlo.constant"(%cst) {value = dense<0.000000e+00> : tensor<f32>} : (memref<f32, "cpu">) -> ()
+    "lmhlo.dot_general"(%arg0, %arg1, %arg6) {dot_dimension_numbers = #mhlo.dot<lhs_contracting_dimensions = [1], rhs_contracting_dimensions = [0]>} : (memref<?x?xf32, "cpu">, memref<?x?xf32, "cpu">, memref<?x?xf32, "cpu">) -> ()
+    "lmhlo.dynamic_broadcast_in_dim"(%bias, %shape, %arg7) {broadcast_dimensions = dense<1> : tensor<1xi64>} : (memref<?xf32, "cpu">, memref<2xindex, "cpu">, memref<?x?xf32, "cpu">) -> ()
+    "lmhlo.add"(%arg6, %arg7, %arg8) : (memref<?x?xf32, "cpu">, memref<?x?xf32, "cpu">, memref<?x?xf32, "cpu">) -> ()
+    "lmhlo.dynamic_broadcast_in_dim"(%cst, %shape, %arg9) {broadcast_dimensions = dense<> : tensor<0xi64>} : (memref<f32, "cpu">, memref<2xindex, "cpu">, memref<?x?xf32, "cpu">) -> ()
+    "lmhlo.max"(%arg8, %arg9, %arg10) : (memref<?x?xf32, "cpu">, memref<?x?xf32, "cpu">, memref<?x?xf32, "cpu">) -> ()
+    "lmhlo.add"(%arg10, %res, %arg11) : (memref<?x?xf32, "cpu">, memref<?x?xf32, "cpu">, memref<?x?xf32, "cpu">) -> ()
+    "lmhlo.terminator"() : () -> ()
+  }) {disc.device = "cpu", disc.fusion.name = "matmul_nn_bias_relu_residual_kTransform_dot_general__7_1_0", disc.fusion_type = "kTransform"} : () -> ()
+  return %arg11 : memref<?x?xf32, "cpu">
+}
+
+// -----
+
+// CHECK-LABEL: @matmul_nt
+// CHECK-SAME: (%[[ARG0:.*]]: tensor<?x?xf32>, %[[ARG1:.*]]: tensor<?x?xf32>, %[[ARG2:.*]]: tensor<?x?xf32>)
+func.func @matmul_nt(%arg1: memref<?x?xf32, "cpu">, %arg2: memref<?x?xf32, "cpu">, %arg3: memref<?x?xf32, "cpu">) -> memref<?x?xf32, "cpu"> {
+  // CHECK: %[[K:.*]] = tensor.dim %[[ARG1]], %{{.*}}
+  // CHECK: %[[N:.*]] = tensor.dim %[[ARG1]], %{{.*}}
+  // CHECK: %[[EMPTY:.*]] = tensor.empty(%[[K]], %[[N]]) : tensor<?x?xf32>
+  // CHECK: %[[T:.*]] = disc_linalg_ext.multi_level_pack %[[ARG1]] with
+  // CHECK-SAME: tile_levels = [0, 0] tile_sizes = [] permutation = [1, 0] into %[[EMPTY]]
+  // CHECK: %[[T0:.*]] = arith.constant 0.000000e+00 : f32
+  // CHECK: %[[T1:.*]] = linalg.fill ins(%[[T0]] : f32) outs(%[[ARG2]] : tensor<?x?xf32>) -> tensor<?x?xf32>
+  // CHECK: %[[T2:.*]] = linalg.matmul ins(%[[ARG0]], %[[T]] : tensor<?x?xf32>, tensor<?x?xf32>) outs(%[[T1]] : tensor<?x?xf32>) -> tensor<?x?xf32>
+  // CHECK: return %[[T2]]
+  "lmhlo.fusion"() ({
+    "lmhlo.dot_general"(%arg1, %arg2, %arg3) {dot_dimension_numbers = #mhlo.dot<lhs_contracting_dimensions = [1], rhs_contracting_dimensions = [1]>} : (memref<?x?xf32, "cpu">, memref<?x?xf32, "cpu">, memref<?x?xf32, "cpu">) -> ()
+    "lmhlo.terminator"() : () -> ()
+  }) {disc.device = "cpu", disc.fusion.name = "matmul_nt_kTransform_dot_general__1_1_0", disc.fusion_type = "kTransform"} : () -> ()
+  return %arg3 : memref<?x?xf32, "cpu">
+}
+
+// -----
+
+// CHECK-LABEL: @batch_matmul_nt
+// CHECK-SAME: (%[[ARG0:.*]]: tensor<2x?x?x64xf32>, %[[ARG1:.*]]: tensor<2x?x?x64xf32>, %[[ARG2:.*]]: tensor<2x?x?x?xf32>)
+func.func @batch_matmul_nt(%arg1: memref<2x?x?x64xf32, "cpu">, %arg2: memref<2x?x?x64xf32, "cpu">, %arg3: memref<2x?x?x?xf32, "cpu">) -> memref<2x?x?x?xf32, "cpu"> {
+  // CHECK: %[[A:.*]] = tensor.collapse_shape %[[ARG0]] {{\[}}[0, 1], [2], [3]] : tensor<2x?x?x64xf32> into tensor<?x?x64xf32>
+  // CHECK: %[[B:.*]] = tensor.collapse_shape %[[ARG1]] {{\[}}[0, 1], [2], [3]] : tensor<2x?x?x64xf32> into tensor<?x?x64xf32>
+  // CHECK: %[[C:.*]] = tensor.collapse_shape %[[ARG2]] {{\[}}[0, 1], [2], [3]] : tensor<2x?x?x?xf32> into tensor<?x?x?xf32>
+  // CHECK: %[[EMPTY:.*]] = tensor.empty({{.*}}) : tensor<?x64x?xf32>
+  // CHECK: %[[BT:.*]] = disc_linalg_ext.multi_level_pack %[[B]] with
+  // CHECK-SAME: tile_levels = [0, 0, 0] tile_sizes = [] permutation = [0, 2, 1] into %[[EMPTY]]
+  // CHECK: %[[T0:.*]] = arith.constant 0.000000e+00 : f32
+  // CHECK: %[[T1:.*]] = linalg.fill ins(%[[T0]] : f32) outs(%[[C]] : tensor<?x?x?xf32>) -> tensor<?x?x?xf32>
+  // CHECK: %[[T2:.*]] = linalg.batch_matmul ins(%[[A]], %[[BT]] : tensor<?x?x64xf32>, tensor<?x64x?xf32>) outs(%[[T1]] : tensor<?x?x?xf32>) -> tensor<?x?x?xf32>
+  // CHECK: %[[T3:.*]] = tensor.expand_shape %[[T2]] {{\[}}[0, 1], [2], [3]] : tensor<?x?x?xf32> into tensor<2x?x?x?xf32>
+  // CHECK: return %[[T3]]
+  "lmhlo.fusion"() ({
+    "lmhlo.dot_general"(%arg1, %arg2, %arg3) {dot_dimension_numbers = #mhlo.dot<lhs_batching_dimensions = [0, 1], rhs_batching_dimensions = [0, 1], lhs_contracting_dimensions = [3], rhs_contracting_dimensions = [3]>} : (memref<2x?x?x64xf32, "cpu">, memref<2x?x?x64xf32, "cpu">, memref<2x?x?x?xf32, "cpu">) -> ()
+    "lmhlo.terminator"() : () -> ()
+  }) {disc.device = "cpu", disc.fusion.name = "batch_matmul_nt_kTransform_dot_general__1_1_0", disc.fusion_type = "kTransform"} : () -> ()
+  return %arg3 : memref<2x?x?x?xf32, "cpu">
+}
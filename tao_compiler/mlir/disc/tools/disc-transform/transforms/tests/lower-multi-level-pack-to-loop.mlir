@@ -56,3 +56,26 @@ transform.structured.canonicalized_sequence failures(propagate) {
   %pack_op = transform.structured.match ops{["disc_linalg_ext.multi_level_pack"]} in %arg1
   transform.disc.lower_multi_level_pack_to_loop %pack_op
 }
+
+// -----
+
+// CHECK-LABEL: @multi_level_pack_transpose
+// CHECK-SAME: (%[[ARG0:.*]]: tensor<?x?xf32>, %[[ARG1:.*]]: index, %[[ARG2:.*]]: index)
+func.func @multi_level_pack_transpose(%arg0: tensor<?x?xf32>, %arg1: index, %arg2: index) -> tensor<?x?xf32> {
+  // CHECK: %[[INIT:.*]] = tensor.empty(%[[ARG1]], %[[ARG2]]) : tensor<?x?xf32>
+  // CHECK-NOT: scf.for
+  // CHECK: %[[SLICE:.*]] = tensor.extract_slice %[[ARG0]]
+  // CHECK: %[[TRANSPOSE:.*]] = linalg.generic
+  // CHECK-SAME: ins(%[[SLICE]] : tensor<?x?xf32>)
+  // CHECK: %[[UPDATE:.*]] = tensor.insert_slice %[[TRANSPOSE]] into %[[INIT]]
+  // CHECK: return %[[UPDATE]]
+  %0 = tensor.empty(%arg1, %arg2) : tensor<?x?xf32>
+  %1 = disc_linalg_ext.multi_level_pack %arg0 with tile_levels = [0, 0] tile_sizes = [] permutation = [1, 0] into %0 : (tensor<?x?xf32> tensor<?x?xf32>) -> tensor<?x?xf32>
+  return %1 : tensor<?x?xf32>
+}
+
+transform.structured.canonicalized_sequence failures(propagate) {
+^bb1(%arg1: !pdl.operation):
+  %pack_op = transform.structured.match ops{["disc_linalg_ext.multi_level_pack"]} in %arg1
+  transform.disc.lower_multi_level_pack_to_loop %pack_op
+}
@@ -68,17 +68,19 @@ LogicalResult parseTransformModuleFromFile(
   sourceMgr.AddNewSourceBuffer(std::move(memoryBuffer), llvm::SMLoc());
   transformModule =
       OwningOpRef<ModuleOp>(parseSourceFile<ModuleOp>(sourceMgr, context));
-  return success();
+  return success(static_cast<bool>(transformModule));
 }
 
 struct DiscTransformDialectInterpreterPass
     : public DiscTransformDialectInterpreterPassBase<
           DiscTransformDialectInterpreterPass> {
-  explicit DiscTransformDialectInterpreterPass(const std::string& fileName,
-                                               bool enableExpensiveChecks)
+  explicit DiscTransformDialectInterpreterPass(
+      const std::string& fileName, bool enableExpensiveChecks,
+      const std::string& transformSource)
       : DiscTransformDialectInterpreterPassBase<
             DiscTransformDialectInterpreterPass>::
-            DiscTransformDialectInterpreterPassBase() {
+            DiscTransformDialectInterpreterPassBase(),
+        transformSource_(transformSource) {
     this->transformFileName_ = fileName;
     this->enableExpensiveChecks_ = enableExpensiveChecks;
   }
@@ -124,23 +126,32 @@ struct DiscTransformDialectInterpreterPass
   }
 
   void runOnOperation() override;
+
+  // Applies the transform ops in `transformModule` to `module`.
+  LogicalResult applyTransformModule(ModuleOp module,
+                                     ModuleOp transformModule);
+
+ private:
+  // The schedule in textual form, used when no transform file is specified.
+  std::string transformSource_;
 };
 
+LogicalResult DiscTransformDialectInterpreterPass::applyTransformModule(
+    ModuleOp module, ModuleOp transformModule) {
+  for (auto op :
+       transformModule.getBody()->getOps<transform::TransformOpInterface>()) {
+    if (failed(transform::applyTransforms(
+            module, op,
+            transform::TransformOptions().enableExpensiveChecks(
+                enableExpensiveChecks_))))
+      return failure();
+  }
+  return success();
+}
+
 void DiscTransformDialectInterpreterPass::runOnOperation() {
   ModuleOp module = getOperation();
-  if (transformFileName_.empty()) {
-    llvm::errs() << "no transform file name specified, assuming the transform "
-                    "module is embedded in the IR next to the top-level\n";
-    // parse transform ops from the module itself.
-    for (auto op :
-         module.getBody()->getOps<transform::TransformOpInterface>()) {
-      if (failed(transform::applyTransforms(
-              module, op,
-              transform::TransformOptions().enableExpensiveChecks(
-                  enableExpensiveChecks_))))
-        return signalPassFailure();
-    }
-  } else {
+  if (!transformFileName_.empty()) {
     // parse transform ops from a standalone file.
     OwningOpRef<ModuleOp> transformModule;
     if (failed(parseTransformModuleFromFile(
@@ -149,15 +160,25 @@ void DiscTransformDialectInterpreterPass::runOnOperation() {
                    << transformFileName_ << "\n";
       return signalPassFailure();
     }
-    for (auto op : transformModule.get()
-                       .getBody()
-                       ->getOps<transform::TransformOpInterface>()) {
-      if (failed(transform::applyTransforms(
-              module, op,
-              transform::TransformOptions().enableExpensiveChecks(
-                  enableExpensiveChecks_))))
-        return signalPassFailure();
+    if (failed(applyTransformModule(module, transformModule.get())))
+      return signalPassFailure();
+  } else if (!transformSource_.empty()) {
+    // parse transform ops from the schedule provided by the caller.
+    OwningOpRef<ModuleOp> transformModule =
+        parseSourceString<ModuleOp>(transformSource_, module.getContext());
+    if (!transformModule) {
+      llvm::errs() << "failed to parse transform ops:\n"
+                   << transformSource_ << "\n";
+      return signalPassFailure();
     }
+    if (failed(applyTransformModule(module, transformModule.get())))
+      return signalPassFailure();
+  } else {
+    llvm::errs() << "no transform file name specified, assuming the transform "
+                    "module is embedded in the IR next to the top-level\n";
+    // parse transform ops from the module itself.
+    if (failed(applyTransformModule(module, module)))
+      return signalPassFailure();
   }
 }
 
@@ -165,9 +186,10 @@ void DiscTransformDialectInterpreterPass::runOnOperation() {
 
 std::unique_ptr<OperationPass<ModuleOp>>
 createDiscTransformDialectInterpreterPass(const std::string& fileName,
-                                          bool enableExpensiveChecks) {
+                                          bool enableExpensiveChecks,
+                                          const std::string& transformSource) {
   return std::make_unique<DiscTransformDialectInterpreterPass>(
-      fileName, enableExpensiveChecks);
+      fileName, enableExpensiveChecks, transformSource);
 }
 
 }  // namespace disc_ral
@@ -106,6 +106,10 @@ constexpr const char* kCpuKernelFunc = "disc_cpu_kernel_func";
 // A tag used to distinguish small cpu kernel (no need for multi-threading).
 constexpr const char* kSmallCpuKernel = "disc.cpu.small_kernel";
 
+// A tag used to mark a cpu launch that can be run in the same parallel region
+// as the next cpu launch.
+constexpr const char* kMergeWithNextCpuLaunch = "disc.cpu.merge_with_next";
+
 // A dimension size is small if it's smaller than this value on CPU.
 constexpr const int kReductionTileSizeOnCPU = 128;
 
@@ -94,7 +94,7 @@ class DiscConstToRALPass : public DiscConstToRALPassBase<DiscConstToRALPass> {
   void runOnOperation() override {
     ModuleOp m = getOperation();
 
-    MetadataFileEmitter emitter(metadata_file_path_);
+    MetadataFileEmitter emitter(metadata_file_path_, isHostConstBlobEnabled());
     if (!emitter.emitHeader()) {
       m.emitError("failed to emit header of metadata file: " +
                   metadata_file_path_);
@@ -181,7 +181,14 @@ LogicalResult DiscConstToRALPass::convertConstantOp(
   auto it = name_idx_map->find(name_str);
   if (it == name_idx_map->end()) {
     int next_const_idx;
-    if (on_host) {
+    if (on_host && emitter.isConstBlobEnabled() && !valueAttr.isSplat()) {
+      // Saves the raw bytes instead, which are used in place at runtime.
+      ArrayRef<char> rawData = valueAttr.getRawData();
+      next_const_idx = emitter.getNumHostConstantEmitted();
+      if (!emitter.emitHostConstantToBlob(name_str, rawData.data(),
+                                          rawData.size()))
+        return failure();
+    } else if (on_host) {
       next_const_idx = emitter.getNumHostConstantEmitted();
       if (!emitter.emitHostConstant(name_str, data_str)) return failure();
     } else {
@@ -480,8 +480,19 @@ struct TransposeConverter : public OpRewritePattern<lmhlo::TransposeOp> {
     if (rank == 3 && permutation[1] != 2 && permutation[2] != 1)
       return failure();
     bool on_gpu = placement_utils::isGpuMemRef(op->getOperand(0));
-    // TODO: support other device
-    if (!on_gpu) return failure();
+    if (on_gpu && !enableTransposeLibraryCall()) return failure();
+    if (!on_gpu) {
+      // The cpu library only handles standalone transposes, fused ones are
+      // left to the codegen.
+      if (!enableCpuTransposeLibraryCall() ||
+          op->getParentOfType<lmhlo::FusionOp>())
+        return failure();
+      Type elemTy =
+          op->getOperand(0).getType().cast<MemRefType>().getElementType();
+      if (!elemTy.isF32() && !elemTy.isF64() && !elemTy.isInteger(32) &&
+          !elemTy.isInteger(64))
+        return failure();
+    }
     Location loc = op.getLoc();
 
     Value ctx = GetContextValueFromFunctionArguments(op);
@@ -516,7 +527,8 @@ struct TransposeConverter : public OpRewritePattern<lmhlo::TransposeOp> {
     newOperands.push_back(op->getOperand(1));
 
     rewriter.replaceOpWithNewOp<DispatchOp>(op, llvm::None, ctx, newOperands,
-                                            "ral_transpose", false, "gpu");
+                                            "ral_transpose", false,
+                                            on_gpu ? "gpu" : "cpu");
     return success();
   }
 };
@@ -868,6 +880,45 @@ struct CustomCallV2OpConvertor : public OpRewritePattern<CustomCallV2Op> {
   bool gpuEnabled_;
 };
 
+// Returns true if the input received by `op`, a "ral_recv_input" dispatch op,
+// is only used as the operands of library gemm calls or to query its dims.
+// Such an input can be bound with the layout of a transposed matrix without
+// being copied, since gemm kernels only read it through the memref descriptor
+// and consume transposed operands directly.
+bool acceptsStridedInput(DispatchOp op) {
+  auto memrefTy = op->getResult(0).getType().dyn_cast<MemRefType>();
+  if (!memrefTy || memrefTy.getRank() < 2) return false;
+  bool hasGemmUser = false;
+  for (OpOperand& use : op->getResult(0).getUses()) {
+    Operation* user = use.getOwner();
+    if (isa<memref::DimOp>(user)) continue;
+    auto dispatch = dyn_cast<DispatchOp>(user);
+    // Operands of "ral_gemm" are (ctx, stream, lhs, rhs, result, ...).
+    if (!dispatch || dispatch.getCallTargetName() != "ral_gemm" ||
+        (use.getOperandNumber() != 2 && use.getOperandNumber() != 3)) {
+      return false;
+    }
+    hasGemmUser = true;
+  }
+  return hasGemmUser;
+}
+
+// Converting:
+//   %output = disc_ral.dispatch(ctx, input_idx) {call_target_name =
+//   "ral_recv_input", device = "cpu"}
+//     to
+//   %output = disc_ral.dispatch(ctx, input_idx) {call_target_name =
+//   "ral_recv_strided_input", device = "cpu"}
+// for the inputs that can be bound with a non-row-major layout, which is
+// recorded into the strided input mask of the compiled module by DiscToLLVM.
+void lowerStridedInputs(func::FuncOp func) {
+  func.walk([&](DispatchOp op) {
+    if (op.getCallTargetName() != "ral_recv_input" || !acceptsStridedInput(op))
+      return;
+    op.setCallTargetName("ral_recv_strided_input");
+  });
+}
+
 struct DiscLowerToLibraryCallPass
     : public DiscLowerToLibraryCallPassBase<DiscLowerToLibraryCallPass> {
   DiscLowerToLibraryCallPass(bool gpu_enabled)
@@ -899,7 +950,7 @@ struct DiscLowerToLibraryCallPass
       SendOutputOpConvertor
     >(context);
     // clang-format on
-    if (enableTransposeLibraryCall())
+    if (enableTransposeLibraryCall() || enableCpuTransposeLibraryCall())
       patterns.insert<TransposeConverter>(context);
 
     // GPU copy related ops
@@ -919,7 +970,10 @@ struct DiscLowerToLibraryCallPass
     if (failed(applyPatternsAndFoldGreedily(func, std::move(patterns)))) {
       func.emitError("applyPatternsAndFoldGreedily does not converge");
       signalPassFailure();
+      return;
     }
+
+    lowerStridedInputs(func);
   }
 };
 
@@ -0,0 +1,140 @@
+/* Copyright 2022 The BladeDISC Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// This file implements the logic to merge consecutive cpu kernel launches
+// into a single parallel region.
+//
+// Each `disc_ral.cpu_launch` forks and joins the threads once, which costs
+// more than the kernel itself for small fusions. A launch is marked as
+// mergeable with the next launch in the same block if the ops between them
+// do not observe the results of the launch, i.e. they are either side effect
+// free, buffer allocations or stores to the launch settings of the following
+// launches. The runtime defers a marked launch and runs it together with the
+// next launch in one parallel region, with a barrier between the two.
+//
+// The deallocations between the launches of a group are moved after the last
+// launch of the group, since a deferred launch may still use the buffers.
+
+#include "llvm/Support/Debug.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Pass/Pass.h"
+#include "tensorflow/compiler/mlir/disc/IR/disc_ral_ops.h"
+#include "tensorflow/compiler/mlir/disc/transforms/PassDetail.h"
+#include "tensorflow/compiler/mlir/disc/transforms/codegen_utils.h"
+
+#define DEBUG_TYPE "disc-merge-cpu-launch"
+
+namespace mlir {
+namespace disc_ral {
+
+namespace {
+
+// Returns true if `value` is only used as the launch settings of cpu launches
+// (and initialized by stores). The runtime reads the launch settings when a
+// launch is issued, thus they can be written between merged launches.
+bool isLaunchSetting(Value value) {
+  if (!value.getDefiningOp<memref::AllocaOp>()) return false;
+  for (OpOperand& use : value.getUses()) {
+    Operation* user = use.getOwner();
+    if (auto store = dyn_cast<memref::StoreOp>(user)) {
+      if (store.getMemRef() == value) continue;
+      return false;
+    }
+    auto launch = dyn_cast<CpuLaunchOp>(user);
+    // The first four operands are the ctx and the launch settings.
+    if (!launch || use.getOperandNumber() < 1 || use.getOperandNumber() > 3) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns true if `op` can be executed before the launches in front of it
+// finish.
+bool isTransparentToLaunch(Operation* op) {
+  if (op->getNumRegions() != 0) return false;
+  if (isa<memref::AllocOp, memref::AllocaOp>(op)) return true;
+  if (auto store = dyn_cast<memref::StoreOp>(op)) {
+    return isLaunchSetting(store.getMemRef());
+  }
+  auto memEffects = dyn_cast<MemoryEffectOpInterface>(op);
+  return memEffects && memEffects.hasNoEffect();
+}
+
+struct DiscMergeCpuLaunchPass
+    : public DiscMergeCpuLaunchPassBase<DiscMergeCpuLaunchPass> {
+  void runOnOperation() override {
+    SmallVector<Block*> blocks;
+    getOperation().walk([&](Block* block) { blocks.push_back(block); });
+    for (Block* block : blocks) {
+      processBlock(block);
+    }
+  }
+
+  void processBlock(Block* block);
+  void mergeGroup(ArrayRef<CpuLaunchOp> group,
+                  ArrayRef<memref::DeallocOp> deallocs);
+};
+
+void DiscMergeCpuLaunchPass::processBlock(Block* block) {
+  SmallVector<CpuLaunchOp> group;
+  SmallVector<memref::DeallocOp> deallocs;
+  auto flush = [&]() {
+    if (group.size() > 1) mergeGroup(group, deallocs);
+    group.clear();
+    deallocs.clear();
+  };
+  for (Operation& op : llvm::make_early_inc_range(*block)) {
+    if (auto launch = dyn_cast<CpuLaunchOp>(&op)) {
+      group.push_back(launch);
+      continue;
+    }
+    if (group.empty()) continue;
+    if (auto dealloc = dyn_cast<memref::DeallocOp>(&op)) {
+      deallocs.push_back(dealloc);
+      continue;
+    }
+    if (!isTransparentToLaunch(&op)) {
+      LLVM_DEBUG(llvm::dbgs() << "launch group ends at: " << op << "\n");
+      flush();
+    }
+  }
+  flush();
+}
+
+void DiscMergeCpuLaunchPass::mergeGroup(ArrayRef<CpuLaunchOp> group,
+                                        ArrayRef<memref::DeallocOp> deallocs) {
+  OpBuilder b(group.front());
+  for (CpuLaunchOp launch : group.drop_back()) {
+    launch->setAttr(kMergeWithNextCpuLaunch, b.getUnitAttr());
+  }
+  Operation* last = group.back();
+  for (memref::DeallocOp dealloc : llvm::reverse(deallocs)) {
+    if (dealloc->isBeforeInBlock(last)) dealloc->moveAfter(last);
+  }
+}
+
+}  // namespace
+
+std::unique_ptr<OperationPass<func::FuncOp>> createDiscMergeCpuLaunchPass() {
+  return std::make_unique<DiscMergeCpuLaunchPass>();
+}
+
+}  // namespace disc_ral
+}  // namespace mlir
@@ -0,0 +1,251 @@
+/* Copyright 2022 The BladeDISC Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// This file implements a static memory planner for the intermediate buffers
+// having static shapes.
+//
+// For each memory space, the buffers that are allocated and deallocated in
+// the entry block of a function are assigned an offset within a single arena
+// buffer according to their liveness. Buffers whose live ranges do not overlap
+// may share the same memory. After the planning:
+//   %0 = memref.alloc() : memref<4x4xf32, "cpu">
+//   ...
+//   memref.dealloc %0 : memref<4x4xf32, "cpu">
+// is converted to:
+//   %arena = memref.alloc() : memref<1024xi8, "cpu">
+//   %0 = memref.view %arena[%c512][] : memref<1024xi8, "cpu"> to
+//                                      memref<4x4xf32, "cpu">
+//   ...
+//   memref.dealloc %arena : memref<1024xi8, "cpu">
+// Thus, the runtime only needs to serve one alloc/dealloc pair for each memory
+// space per execution.
+//
+// The pass is supposed to run after all the passes that need to trace a
+// buffer back to its defining alloc op (e.g. via `getRootMemRef`), since all
+// the planned buffers share the same root after this pass.
+
+#include <algorithm>
+#include <limits>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/Support/Debug.h"
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/Interfaces/ViewLikeInterface.h"
+#include "mlir/Pass/Pass.h"
+#include "tensorflow/compiler/mlir/disc/IR/disc_ral_ops.h"
+#include "tensorflow/compiler/mlir/disc/disc_util.h"
+#include "tensorflow/compiler/mlir/disc/transforms/PassDetail.h"
+
+#define DEBUG_TYPE "disc-static-memory-plan"
+
+namespace mlir {
+namespace disc_ral {
+
+namespace {
+
+// Each planned buffer starts at an offset aligned to this value. Keep it the
+// same as the alignment of the ral allocator.
+constexpr int64_t kArenaAlignment = 128;
+
+int64_t alignTo(int64_t value, int64_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+struct PlannedBuffer {
+  memref::AllocOp alloc;
+  memref::DeallocOp dealloc;
+  int64_t bytes;
+  // live range in terms of op positions in the entry block.
+  int64_t start;
+  int64_t end;
+  int64_t offset = -1;
+
+  bool overlapsWith(const PlannedBuffer& other) const {
+    return start <= other.end && other.start <= end;
+  }
+};
+
+// Returns the size of the buffer in bytes or -1 if it's not able to be
+// planned statically.
+int64_t getStaticBufferBytes(memref::AllocOp op) {
+  auto ty = op.getResult().getType().cast<MemRefType>();
+  if (!ty.hasStaticShape() || !ty.getLayout().isIdentity()) return -1;
+  Type elemTy = ty.getElementType();
+  if (!elemTy.isIntOrIndexOrFloat() || elemTy.isIndex()) return -1;
+  if (op.getAlignment() && *op.getAlignment() > kArenaAlignment) return -1;
+  int64_t bitWidth = elemTy.getIntOrFloatBitWidth();
+  // Sub-byte types (e.g. i1) are stored using one byte per element.
+  int64_t bytes = ty.getNumElements() * std::max<int64_t>(1, bitWidth / 8);
+  return bytes > 0 ? bytes : -1;
+}
+
+// Returns the dealloc op of the buffer if the buffer is only used locally
+// (e.g. not returned, not borrowed by an `inc_ref` ral call), otherwise
+// returns nullptr.
+memref::DeallocOp getLocalDeallocOp(memref::AllocOp op, Block* block) {
+  memref::DeallocOp deallocOp;
+  SmallVector<Value> worklist{op.getResult()};
+  while (!worklist.empty()) {
+    Value value = worklist.pop_back_val();
+    for (Operation* user : value.getUsers()) {
+      if (auto dealloc = dyn_cast<memref::DeallocOp>(user)) {
+        if (deallocOp || value != op.getResult() ||
+            dealloc->getBlock() != block)
+          return nullptr;
+        deallocOp = dealloc;
+        continue;
+      }
+      if (isa<func::ReturnOp>(user)) return nullptr;
+      // The runtime tracks the ref count of the borrowed buffer, which is not
+      // possible for a sub-buffer of the arena.
+      if (auto dispatch = dyn_cast<DispatchOp>(user)) {
+        if (dispatch.getCallTargetName() == "inc_ref") return nullptr;
+      }
+      if (auto view = dyn_cast<ViewLikeOpInterface>(user)) {
+        worklist.push_back(view->getResult(0));
+      }
+    }
+  }
+  return deallocOp;
+}
+
+// Assigns an offset for each buffer, using a greedy best-fit strategy, larger
+// buffers first. Returns the total size of the arena.
+int64_t assignOffsets(SmallVectorImpl<PlannedBuffer*>& buffers) {
+  std::stable_sort(buffers.begin(), buffers.end(),
+                   [](PlannedBuffer* lhs, PlannedBuffer* rhs) {
+                     if (lhs->bytes != rhs->bytes)
+                       return lhs->bytes > rhs->bytes;
+                     return lhs->start < rhs->start;
+                   });
+  int64_t totalBytes = 0;
+  SmallVector<PlannedBuffer*> placed;
+  for (PlannedBuffer* buffer : buffers) {
+    SmallVector<PlannedBuffer*> conflicts;
+    for (PlannedBuffer* other : placed) {
+      if (buffer->overlapsWith(*other)) conflicts.push_back(other);
+    }
+    llvm::sort(conflicts, [](PlannedBuffer* lhs, PlannedBuffer* rhs) {
+      return lhs->offset < rhs->offset;
+    });
+    int64_t alignedBytes = alignTo(buffer->bytes, kArenaAlignment);
+    int64_t bestOffset = -1;
+    int64_t bestGap = std::numeric_limits<int64_t>::max();
+    int64_t cursor = 0;
+    for (PlannedBuffer* other : conflicts) {
+      int64_t gap = other->offset - cursor;
+      if (gap >= alignedBytes && gap < bestGap) {
+        bestGap = gap;
+        bestOffset = cursor;
+      }
+      cursor = std::max(
+          cursor, other->offset + alignTo(other->bytes, kArenaAlignment));
+    }
+    buffer->offset = bestOffset >= 0 ? bestOffset : cursor;
+    totalBytes = std::max(totalBytes, buffer->offset + alignedBytes);
+    placed.push_back(buffer);
+  }
+  return totalBytes;
+}
+
+struct DiscStaticMemoryPlanPass
+    : public DiscStaticMemoryPlanPassBase<DiscStaticMemoryPlanPass> {
+  void runOnOperation() override {
+    func::FuncOp func = getOperation();
+    if (func.isExternal()) return;
+    Block* block = &func.getBody().front();
+
+    DenseMap<Operation*, int64_t> positions;
+    int64_t position = 0;
+    for (Operation& op : *block) positions[&op] = position++;
+
+    // memory space -> buffers
+    llvm::MapVector<Attribute, SmallVector<PlannedBuffer>> groups;
+    for (auto alloc : block->getOps<memref::AllocOp>()) {
+      int64_t bytes = getStaticBufferBytes(alloc);
+      if (bytes < 0) continue;
+      memref::DeallocOp dealloc = getLocalDeallocOp(alloc, block);
+      if (!dealloc) continue;
+      auto ty = alloc.getResult().getType().cast<MemRefType>();
+      groups[ty.getMemorySpace()].push_back(
+          {alloc, dealloc, bytes, positions[alloc], positions[dealloc]});
+    }
+
+    for (auto& group : groups) {
+      // Not beneficial in such case.
+      if (group.second.size() < 2) continue;
+      planMemorySpace(group.first, group.second);
+    }
+  }
+
+  void planMemorySpace(Attribute memorySpace,
+                       SmallVectorImpl<PlannedBuffer>& buffers) {
+    SmallVector<PlannedBuffer*> bufferPtrs;
+    int64_t naiveBytes = 0;
+    for (auto& buffer : buffers) {
+      bufferPtrs.push_back(&buffer);
+      naiveBytes += alignTo(buffer.bytes, kArenaAlignment);
+    }
+    int64_t totalBytes = assignOffsets(bufferPtrs);
+    LLVM_DEBUG(llvm::dbgs() << "static memory plan for memory space "
+                            << memorySpace << ": " << buffers.size()
+                            << " buffers, arena size " << totalBytes
+                            << " bytes (vs. " << naiveBytes << " bytes)\n");
+
+    auto firstAlloc = llvm::min_element(
+        buffers, [](const PlannedBuffer& lhs, const PlannedBuffer& rhs) {
+          return lhs.start < rhs.start;
+        });
+    auto lastDealloc = llvm::max_element(
+        buffers, [](const PlannedBuffer& lhs, const PlannedBuffer& rhs) {
+          return lhs.end < rhs.end;
+        });
+
+    OpBuilder b(firstAlloc->alloc);
+    Location loc = firstAlloc->alloc.getLoc();
+    auto arenaTy = MemRefType::get({totalBytes}, b.getIntegerType(8),
+                                   MemRefLayoutAttrInterface{}, memorySpace);
+    Value arena = b.create<memref::AllocOp>(
+        loc, arenaTy, b.getI64IntegerAttr(kArenaAlignment));
+    b.setInsertionPointAfter(lastDealloc->dealloc);
+    b.create<memref::DeallocOp>(loc, arena);
+
+    for (auto& buffer : buffers) {
+      b.setInsertionPoint(buffer.alloc);
+      Value offset =
+          b.create<arith::ConstantIndexOp>(buffer.alloc.getLoc(), buffer.offset);
+      Value view = b.create<memref::ViewOp>(
+          buffer.alloc.getLoc(), buffer.alloc.getResult().getType(), arena,
+          offset, ValueRange{});
+      buffer.alloc.getResult().replaceAllUsesWith(view);
+      buffer.dealloc->erase();
+      buffer.alloc->erase();
+    }
+  }
+};
+
+}  // namespace
+
+std::unique_ptr<OperationPass<func::FuncOp>> createDiscStaticMemoryPlanPass() {
+  return std::make_unique<DiscStaticMemoryPlanPass>();
+}
+
+}  // namespace disc_ral
+}  // namespace mlir
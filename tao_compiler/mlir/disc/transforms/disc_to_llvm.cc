@@ -37,6 +37,7 @@
 #include "mlir/IR/Attributes.h"
 #include "mlir/IR/BuiltinOps.h"
 #include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Matchers.h"
 #include "mlir/IR/Operation.h"
 #include "mlir/Transforms/DialectConversion.h"
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
@@ -63,7 +64,11 @@ using lmhlo_disc::PrintfOp;
 constexpr const char* kRalDispatchFunctionName = "disc_ral_call";
 constexpr const char* kRalGpuLaunch = "ral_kernel_launch";
 constexpr const char* kRalCpuLaunch = "ral_kernel_launch";
+constexpr const char* kRalCpuLaunchDeferred = "ral_kernel_launch_deferred";
 constexpr const char* kMalloc = "alloc";
+constexpr const char* kMallocOutput = "ral_alloc_output";
+// The index of the output whose buffer is allocated by a memref.alloc op.
+constexpr const char* kOutputIndexAttr = "disc.output_index";
 constexpr const char* kFree = "dealloc";
 constexpr const char* kRalCompIntensFusion = "ral_comp_intens_fusion";
 
@@ -84,7 +89,12 @@ LogicalResult getTypeEncoding(MLIRContext* ctx, Type t, StrT& out) {
       out.append(Twine("i").concat(Twine(int_type.getWidth())).str());
     }
   } else if (auto fp_type = t.dyn_cast<FloatType>()) {
-    out.append(Twine("f").concat(Twine(fp_type.getWidth())).str());
+    // bf16 has the same width as f16, thus needs a dedicated encoding.
+    if (fp_type.isBF16()) {
+      out.append("bf16");
+    } else {
+      out.append(Twine("f").concat(Twine(fp_type.getWidth())).str());
+    }
   } else if (auto ctx_type = t.dyn_cast<RalExecutionContextType>() ||
                              t == llvm_pointer_type) {
     out.append("pvoid");
@@ -646,7 +656,8 @@ LogicalResult ConvertLaunchFuncOpToRalCallPattern::matchAndRewrite(
 //     to
 //   "disc_ral.dispatch"(%ctx, %3) {device = "gpu", call_target_name =
 //   "alloc", has_side_effect = false} : (!llvm.ptr<i8>, !llvm.ptr<i8>) -> ()
-// then convert to llvm
+// then convert to llvm. The buffer of an output (see `markOutputAllocs`) is
+// allocated by "ral_alloc_output" instead, which takes the output index too.
 class ConvertMemRefAllocOpToDispatchOpPattern
     : public ConvertOpToLLVMPattern<memref::AllocOp> {
  public:
@@ -722,8 +733,19 @@ LogicalResult ConvertMemRefAllocOpToDispatchOpPattern::matchAndRewrite(
                            sizes, strides, sizeBytes);
 
   // create dispatch op
-  auto dispatch_op = rewriter.create<disc_ral::DispatchOp>(
-      loc, getVoidPtrType(), context_arg, sizeBytes, kMalloc, false, device);
+  disc_ral::DispatchOp dispatch_op;
+  if (auto output_idx = op->getAttrOfType<IntegerAttr>(kOutputIndexAttr)) {
+    // The buffer of an output, which may be provided by the caller.
+    Value idx = rewriter.create<LLVM::ConstantOp>(
+        loc, rewriter.getI64Type(),
+        rewriter.getI64IntegerAttr(output_idx.getInt()));
+    dispatch_op = rewriter.create<disc_ral::DispatchOp>(
+        loc, getVoidPtrType(), context_arg, ValueRange{idx, sizeBytes},
+        kMallocOutput, false, device);
+  } else {
+    dispatch_op = rewriter.create<disc_ral::DispatchOp>(
+        loc, getVoidPtrType(), context_arg, sizeBytes, kMalloc, false, device);
+  }
   Value allocated_byte_ptr = dispatch_op.getResult(0);
 
   // Create the MemRef descriptor.
@@ -1029,9 +1051,13 @@ LogicalResult ConvertCpuLaunchOpToDispatchOpPattern::matchAndRewrite(
   ralDispatchOpArgs.push_back(untypedFuncPtr);
   ralDispatchOpArgs.push_back(packedArgs);
 
+  // A launch merged with the next one is deferred by the runtime.
+  StringRef apiName = launchOp->hasAttr(kMergeWithNextCpuLaunch)
+                          ? kRalCpuLaunchDeferred
+                          : kRalCpuLaunch;
   rewriter.replaceOpWithNewOp<disc_ral::DispatchOp>(
-      launchOp, llvm::None, adaptor.ctx(), ralDispatchOpArgs, kRalCpuLaunch,
-      false, "cpu");
+      launchOp, llvm::None, adaptor.ctx(), ralDispatchOpArgs, apiName, false,
+      "cpu");
 
   return success();
 }
@@ -1167,6 +1193,66 @@ LogicalResult ConvertSourceCodeOpToDispatchOpPattern::matchAndRewrite(
   return success();
 }
 
+// Exports the strided input mask of the module, which is read by the runtime
+// via `tao_ral_strided_inputs`. It is a null-terminated string having one char
+// per input up to the last strided one, which is '1' if the input is received
+// by "ral_recv_strided_input" (see DiscLowerToLibraryCall).
+LogicalResult exportStridedInputMask(ModuleOp m) {
+  std::string mask;
+  WalkResult result = m.walk([&](DispatchOp op) {
+    if (op.getCallTargetName() != "ral_recv_strided_input")
+      return WalkResult::advance();
+    APInt index;
+    if (op.getArgs().empty() ||
+        !matchPattern(op.getArgs().front(), m_ConstantInt(&index))) {
+      op.emitOpError() << "expects a constant input index";
+      return WalkResult::interrupt();
+    }
+    int64_t idx = index.getSExtValue();
+    if (idx >= static_cast<int64_t>(mask.size())) mask.resize(idx + 1, '0');
+    mask[idx] = '1';
+    return WalkResult::advance();
+  });
+  if (result.wasInterrupted()) return failure();
+  if (mask.empty()) return success();
+
+  mask.push_back('\0');
+  OpBuilder builder(m.getBodyRegion());
+  auto type = LLVM::LLVMArrayType::get(IntegerType::get(m.getContext(), 8),
+                                       mask.size());
+  builder.create<LLVM::GlobalOp>(m.getLoc(), type, /*isConstant=*/true,
+                                 LLVM::Linkage::External,
+                                 "disc_ral_strided_inputs",
+                                 builder.getStringAttr(mask),
+                                 /*alignment=*/0);
+  return success();
+}
+
+// Marks the memref.alloc ops allocating the buffer of exactly one output with
+// the index of the output, which are lowered to "ral_alloc_output" calls, thus
+// the runtime can hand out the output buffers provided by the caller (see
+// `ExecutionContext::bindOutputBuffer`).
+void markOutputAllocs(ModuleOp m) {
+  DenseMap<Operation*, SmallVector<int64_t>> outputIndices;
+  m.walk([&](DispatchOp op) {
+    if (op.getCallTargetName() != "ral_send_output") return;
+    // Operands of "ral_send_output" are (ctx, output_idx, output).
+    APInt index;
+    if (op.getArgs().size() != 2 ||
+        !matchPattern(op.getArgs()[0], m_ConstantInt(&index)))
+      return;
+    if (auto alloc = op.getArgs()[1].getDefiningOp<memref::AllocOp>())
+      outputIndices[alloc].push_back(index.getSExtValue());
+  });
+  for (auto& it : outputIndices) {
+    if (it.second.size() != 1) continue;
+    Operation* alloc = it.first;
+    alloc->setAttr(kOutputIndexAttr,
+                   IntegerAttr::get(IntegerType::get(m.getContext(), 64),
+                                    it.second.front()));
+  }
+}
+
 class DiscToLLVMPass : public DiscToLLVMPassBase<DiscToLLVMPass> {
   void getDependentDialects(DialectRegistry& registry) const override {
     registry.insert<LLVM::LLVMDialect>();
@@ -1175,6 +1261,8 @@ class DiscToLLVMPass : public DiscToLLVMPassBase<DiscToLLVMPass> {
  public:
   void runOnOperation() override {
     ModuleOp m = getOperation();
+    if (failed(exportStridedInputMask(m))) return signalPassFailure();
+    markOutputAllocs(m);
     SymbolTable symbol_table(m);
 
     // Populate type conversions.
@@ -37,6 +37,7 @@ limitations under the License.
 #include "tensorflow/compiler/mlir/disc/tools/disc-transform/transforms/passes.h"
 #include "tensorflow/compiler/mlir/disc/transforms/PassDetail.h"
 #include "tensorflow/compiler/mlir/disc/transforms/codegen_utils.h"
+#include "tensorflow/compiler/mlir/disc/transforms/disc_transform_schedule.h"
 #include "tensorflow/compiler/mlir/disc/transforms/fusion_utils.h"
 #include "tensorflow/compiler/mlir/disc/transforms/lhlo_elemental_utils.h"
 #include "tensorflow/compiler/mlir/disc/transforms/placement_utils.h"
@@ -71,12 +72,14 @@ struct DiscTransformLegalizeToLoopPass
           DiscTransformLegalizeToLoopPass> {
   explicit DiscTransformLegalizeToLoopPass(bool gpuEnabled,
                                            const std::string& transformFileName,
-                                           bool enableExpensiveChecks)
+                                           bool enableExpensiveChecks,
+                                           int64_t cpuVectorWidth)
       : DiscTransformLegalizeToLoopPassBase<DiscTransformLegalizeToLoopPass>::
             DiscTransformLegalizeToLoopPassBase() {
     this->gpuEnabled_ = gpuEnabled;
     this->transformFileName_ = transformFileName;
     this->enableExpensiveChecks_ = enableExpensiveChecks;
+    this->cpuVectorWidth_ = cpuVectorWidth;
   }
 
   void runOnOperation() override;
@@ -88,7 +91,8 @@ struct DiscTransformLegalizeToLoopPass
                                 FusionPattern& fusionPattern,
                                 OwningOpRef<ModuleOp>& m);
   // Builds a nested pass pipeline to legalize the outlined fusion op.
-  LogicalResult runTransformPipeline(ModuleOp m);
+  // `schedule` is used if no transform file is specified.
+  LogicalResult runTransformPipeline(ModuleOp m, const std::string& schedule);
   // Inlines the lowered IR into the orignal module.
   LogicalResult inlineTransformedModule(OpBuilder& b, Operation* fusion,
                                         FusionPattern& fusionPattern,
@@ -129,11 +133,11 @@ LogicalResult DiscTransformLegalizeToLoopPass::outlineFusionOp(
 }
 
 LogicalResult DiscTransformLegalizeToLoopPass::runTransformPipeline(
-    ModuleOp m) {
+    ModuleOp m, const std::string& schedule) {
   PassManager pm(m.getContext());
   pm.addPass(createDiscLegalizeLmhloFusionToLinalgPass());
-  pm.addPass(createDiscTransformDialectInterpreterPass(transformFileName_,
-                                                       enableExpensiveChecks_));
+  pm.addPass(createDiscTransformDialectInterpreterPass(
+      transformFileName_, enableExpensiveChecks_, schedule));
   pm.addNestedPass<func::FuncOp>(createDiscMemrefCopyToLinalgPass());
   pm.addPass(createDiscRewritePayloadIRForRALPass(gpuEnabled_));
   return pm.run(m);
@@ -175,10 +179,18 @@ LogicalResult DiscTransformLegalizeToLoopPass::handleCpuFusionOp(
   if (failed(outlineFusionOp(fusionOp, fusionPattern, m))) return failure();
   LLVM_DEBUG(llvm::dbgs() << "After outline fusion op:\n" << m.get() << "\n");
 
-  // 2, TODO(wyzero): assign a default schedule for each pattern here.
+  // 2, Assign a default schedule for the pattern if no schedule file is
+  // specified.
+  std::string schedule;
+  if (transformFileName_.empty()) {
+    CpuIsa isa = getTargetCpuIsa(cpuVectorWidth_);
+    if (failed(buildDefaultCpuSchedule(fusionPattern, isa, schedule)))
+      return fusion->emitError() << "no default schedule for the fusion\n";
+    LLVM_DEBUG(llvm::dbgs() << "Use default schedule:\n" << schedule << "\n");
+  }
 
   // 3, Build a nested pass pipeline to legalize the outlined fusion op.
-  if (failed(runTransformPipeline(m.get()))) return failure();
+  if (failed(runTransformPipeline(m.get(), schedule))) return failure();
   LLVM_DEBUG(llvm::dbgs() << "After run transform pipeline:\n"
                           << m.get() << "\n");
 
@@ -234,9 +246,10 @@ void DiscTransformLegalizeToLoopPass::runOnOperation() {
 std::unique_ptr<OperationPass<func::FuncOp>>
 createDiscTransformLegalizeToLoopPass(bool gpuEnabled,
                                       const std::string& filename,
-                                      bool expensiveCheck) {
-  return std::make_unique<DiscTransformLegalizeToLoopPass>(gpuEnabled, filename,
-                                                           expensiveCheck);
+                                      bool expensiveCheck,
+                                      int64_t cpuVectorWidth) {
+  return std::make_unique<DiscTransformLegalizeToLoopPass>(
+      gpuEnabled, filename, expensiveCheck, cpuVectorWidth);
 }
 
 }  // namespace disc_ral
@@ -0,0 +1,342 @@
+/* Copyright 2022 The BladeDISC Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// This file implements the default transform dialect schedules used by the
+// transform based cpu fusions when no schedule file is provided.
+//
+// The gemm schedule follows the classical two level blocking: the output is
+// first tiled into cache blocks and then into register blocks, the operands
+// of each register block are padded and packed into contiguous panels via
+// `disc_linalg_ext.multi_level_pack` (i.e. `transform.disc.cache_read`), and
+// the innermost gemm is vectorized. The register block is chosen according to
+// the vector ISA and the cache block according to the shape of the gemm.
+
+#include "tensorflow/compiler/mlir/disc/transforms/disc_transform_schedule.h"
+
+#include <algorithm>
+
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/raw_ostream.h"
+#include "mlir-hlo/Dialect/lhlo/IR/lhlo_ops.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "tensorflow/compiler/mlir/disc/transforms/fusion_utils.h"
+#include "tensorflow/core/util/env_var.h"
+
+#undef DEBUG_TYPE
+#define DEBUG_TYPE "disc-transform-schedule"
+
+namespace mlir {
+namespace disc_ral {
+
+namespace {
+
+// Gemms with at most this many rows are treated as small-m gemms.
+constexpr int64_t kSmallMThreshold = 16;
+// Gemms with at most this many columns and at least `kTallSkinnyRatio` times
+// more rows than columns are treated as tall-skinny gemms.
+constexpr int64_t kTallSkinnyMaxN = 64;
+constexpr int64_t kTallSkinnyRatio = 4;
+
+int64_t roundDown(int64_t value, int64_t multiple) {
+  return std::max(value / multiple, int64_t(1)) * multiple;
+}
+
+int64_t roundUp(int64_t value, int64_t multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+const char* toString(CpuIsa isa) {
+  switch (isa) {
+    case CpuIsa::kAVX2:
+      return "avx2";
+    case CpuIsa::kAVX512:
+      return "avx512";
+    case CpuIsa::kNEON:
+      return "neon";
+  }
+  return "unknown";
+}
+
+const char* toString(GemmShapeClass shapeClass) {
+  switch (shapeClass) {
+    case GemmShapeClass::kSmallM:
+      return "small-m";
+    case GemmShapeClass::kTallSkinny:
+      return "tall-skinny";
+    case GemmShapeClass::kSquare:
+      return "square";
+  }
+  return "unknown";
+}
+
+// Returns the ISA set by `DISC_TRANSFORM_SCHEDULE_ISA`, or None if not set.
+Optional<CpuIsa> getCpuIsaFromEnv() {
+  static Optional<CpuIsa> isa = []() -> Optional<CpuIsa> {
+    std::string str;
+    tensorflow::ReadStringFromEnvVar("DISC_TRANSFORM_SCHEDULE_ISA", "", &str);
+    for (CpuIsa candidate : {CpuIsa::kAVX2, CpuIsa::kAVX512, CpuIsa::kNEON}) {
+      if (str == toString(candidate)) return candidate;
+    }
+    if (!str.empty()) {
+      llvm::errs() << "unknown DISC_TRANSFORM_SCHEDULE_ISA: " << str
+                   << ", ignored\n";
+    }
+    return llvm::None;
+  }();
+  return isa;
+}
+
+}  // namespace
+
+CpuIsa getHostCpuIsa() {
+  static CpuIsa isa = []() {
+    if (auto envIsa = getCpuIsaFromEnv()) return *envIsa;
+
+    llvm::StringMap<bool> features;
+    if (llvm::sys::getHostCPUFeatures(features)) {
+      if (features.lookup("avx512f")) return CpuIsa::kAVX512;
+      if (features.lookup("neon")) return CpuIsa::kNEON;
+    }
+#if defined(__aarch64__)
+    return CpuIsa::kNEON;
+#else
+    return CpuIsa::kAVX2;
+#endif
+  }();
+  return isa;
+}
+
+CpuIsa getTargetCpuIsa(int64_t vectorWidth) {
+  if (auto envIsa = getCpuIsaFromEnv()) return *envIsa;
+  switch (vectorWidth) {
+    case 512:
+      return CpuIsa::kAVX512;
+    case 256:
+      return CpuIsa::kAVX2;
+    case 128:
+#if defined(__aarch64__)
+      return CpuIsa::kNEON;
+#else
+      return CpuIsa::kAVX2;
+#endif
+  }
+  return getHostCpuIsa();
+}
+
+GemmShapeClass classifyGemmShape(int64_t m, int64_t n) {
+  if (m >= 0 && m <= kSmallMThreshold) return GemmShapeClass::kSmallM;
+  if (n >= 0 && n <= kTallSkinnyMaxN && (m < 0 || m >= kTallSkinnyRatio * n))
+    return GemmShapeClass::kTallSkinny;
+  return GemmShapeClass::kSquare;
+}
+
+CpuGemmTileConfig getDefaultCpuGemmTileConfig(GemmShapeClass shapeClass,
+                                              CpuIsa isa) {
+  CpuGemmTileConfig config;
+  // The register block uses (almost) all the vector registers to hold the
+  // accumulators: 12 ymm, 16 zmm and 24 q registers respectively.
+  switch (isa) {
+    case CpuIsa::kAVX2:
+      config.microM = 6;
+      config.microN = 16;
+      break;
+    case CpuIsa::kAVX512:
+      config.microM = 8;
+      config.microN = 32;
+      break;
+    case CpuIsa::kNEON:
+      config.microM = 8;
+      config.microN = 12;
+      break;
+  }
+
+  switch (shapeClass) {
+    case GemmShapeClass::kSmallM:
+      // A single block covers all the rows, and a wide block along n amortizes
+      // the packing of the lhs.
+      config.blockM = roundUp(kSmallMThreshold, config.microM);
+      config.blockN = roundDown(1024, config.microN);
+      break;
+    case GemmShapeClass::kTallSkinny:
+      // A single block covers all the columns, thus the packed rhs is reused
+      // by all the row blocks.
+      config.blockM = roundDown(576, config.microM);
+      config.blockN = roundUp(kTallSkinnyMaxN, config.microN);
+      break;
+    case GemmShapeClass::kSquare:
+      config.blockM = roundDown(288, config.microM);
+      config.blockN = roundDown(256, config.microN);
+      break;
+  }
+  return config;
+}
+
+std::string buildCpuGemmSchedule(const CpuGemmTileConfig& config,
+                                 Type elemType, bool hasEpilogue,
+                                 bool isBatched) {
+  std::string schedule;
+  llvm::raw_string_ostream os(schedule);
+  std::string zero;
+  llvm::raw_string_ostream zeroOs(zero);
+  zeroOs << (elemType.isa<FloatType>() ? "0.0 : " : "0 : ") << elemType;
+  zeroOs.flush();
+
+  const char* matmulName = isBatched ? "linalg.batch_matmul" : "linalg.matmul";
+
+  auto printLowerVectors = [&](const char* stages) {
+    os << "  transform.lower_vectors {\n"
+       << "    contraction_lowering = \"outerproduct\",\n"
+       << "    multireduction_lowering = \"innerparallel\",\n"
+       << "    split_transfers = \"linalg-copy\",\n"
+       << "    stages = [" << stages << "],\n"
+       << "    transpose_avx2_lowering = false,\n"
+       << "    transpose_lowering = \"eltwise\",\n"
+       << "    unroll_vector_transfers = true\n"
+       << "  }\n";
+  };
+
+  // clang-format off
+  os << "transform.structured.canonicalized_sequence failures(propagate) {\n"
+     << "^bb1(%arg1: !pdl.operation):\n"
+     << "  %fill = transform.structured.match ops{[\"linalg.fill\"]} in %arg1\n"
+     << "  %matmul = transform.structured.match ops{[\"" << matmulName << "\"]} in %arg1\n";
+  if (hasEpilogue) {
+    // Tiles the epilogue and fuses the gemm into it, thus the epilogue is
+    // applied to each register block of the output before it is written back.
+    os << "  %epilogue = transform.structured.match ops{[\"linalg.generic\"]} in %arg1\n"
+       << "  %0:2 = transform.structured.tile_to_foreach_thread_op %epilogue num_threads [1, 1]\n"
+       << "  transform.structured.fuse_into_containing_op %matmul into %0#0\n"
+       << "  transform.structured.fuse_into_containing_op %fill into %0#0\n"
+       << "  %1:3 = transform.structured.fuse %0#1 {tile_sizes = ["
+       << config.blockM << ", " << config.blockN << "], tile_interchange = [0, 1]}\n"
+       << "  %2:3 = transform.structured.fuse %1#0 {tile_sizes = ["
+       << config.microM << ", " << config.microN << "], tile_interchange = [0, 1]}\n"
+       << "  %tiled_matmul = transform.structured.match ops{[\"linalg.matmul\"]} in %arg1\n"
+       << "  %3:2 = transform.structured.tile %tiled_matmul [0, 0, 1] {interchange = [0, 1, 2]}\n";
+  } else if (isBatched) {
+    // The batch dimension is the leading loop of a batch matmul and is tiled
+    // by one along with the cache blocks, thus each register block is a gemm
+    // of a single batch.
+    os << "  %0:2 = transform.structured.tile_to_foreach_thread_op %matmul num_threads [1, 1, 1]\n"
+       << "  transform.structured.fuse_into_containing_op %fill into %0#0\n"
+       << "  %1:4 = transform.structured.fuse %0#1 {tile_sizes = [1, "
+       << config.blockM << ", " << config.blockN << ", 0], tile_interchange = [0, 1, 2, 3]}\n"
+       << "  %2:3 = transform.structured.fuse %1#0 {tile_sizes = [0, "
+       << config.microM << ", " << config.microN << ", 0], tile_interchange = [0, 1, 2, 3]}\n"
+       << "  %3:2 = transform.structured.tile %2#0 [0, 0, 0, 1] {interchange = [0, 1, 2, 3]}\n";
+  } else {
+    os << "  %0:2 = transform.structured.tile_to_foreach_thread_op %matmul num_threads [1, 1]\n"
+       << "  transform.structured.fuse_into_containing_op %fill into %0#0\n"
+       << "  %1:3 = transform.structured.fuse %0#1 {tile_sizes = ["
+       << config.blockM << ", " << config.blockN << ", 0], tile_interchange = [0, 1, 2]}\n"
+       << "  %2:3 = transform.structured.fuse %1#0 {tile_sizes = ["
+       << config.microM << ", " << config.microN << ", 0], tile_interchange = [0, 1, 2]}\n"
+       << "  %3:2 = transform.structured.tile %2#0 [0, 0, 1] {interchange = [0, 1, 2]}\n";
+  }
+  os << "  %func0 = transform.structured.match ops{[\"func.func\"]} in %arg1\n"
+     << "  transform.disc.apply_patterns %func0 {canonicalization}\n"
+     << "  %weight_inner_slice = get_producer_of_operand %3#0[1] : (!pdl.operation) -> !pdl.operation\n"
+     << "  transform.disc.fold_producer_extract_slice %weight_inner_slice {max_repeat_num = 2}\n"
+     << "  %4 = transform.structured.pad %3#0 {padding_values = ["
+     << zero << ", " << zero << ", " << zero << "], padding_dimensions = "
+     << (isBatched ? "[0, 1, 2, 3]" : "[0, 1, 2]") << ", "
+     << "pack_paddings = [1, 1, 0], hoist_paddings = [0, 0, 0], "
+     << "transpose_paddings = "
+     << (isBatched ? "[[0, 2, 1], [0, 1, 2], [0, 1, 2]]" : "[[1, 0], [0, 1], [0, 1]]")
+     << "}\n"
+     << "  %pad_for_input = get_producer_of_operand %4[0] : (!pdl.operation) -> !pdl.operation\n"
+     << "  %pad_for_weight = get_producer_of_operand %4[1] : (!pdl.operation) -> !pdl.operation\n"
+     << "  %foreach_op = transform.structured.match ops{[\"scf.foreach_thread\"]} in %arg1\n"
+     << "  %loop_for_outter_most_n = transform.loop.get_parent_for %4 {num_loops = 4} : (!pdl.operation) -> !pdl.operation\n";
+  // The batch dimension is packed as `[batch, 1]`, whose inner most level
+  // matches the single batch of each register block.
+  if (isBatched) {
+    os << "  transform.disc.cache_read {padded} %pad_for_input at %loop_for_outter_most_n "
+       << "with tile_levels = [1, 1, 1] tile_sizes = [1, " << config.microM << ", 1] "
+       << "permutation = [0, 2, 4, 1, 5, 3]\n"
+       << "  transform.disc.cache_read {padded} %pad_for_weight at %foreach_op "
+       << "with tile_levels = [1, 1, 1] tile_sizes = [1, 1, " << config.microN << "] "
+       << "permutation = [0, 4, 2, 1, 3, 5]\n";
+  } else {
+    os << "  transform.disc.cache_read {padded} %pad_for_input at %loop_for_outter_most_n "
+       << "with tile_levels = [1, 1] tile_sizes = [" << config.microM << ", 1] "
+       << "permutation = [0, 2, 3, 1]\n"
+       << "  transform.disc.cache_read {padded} %pad_for_weight at %foreach_op "
+       << "with tile_levels = [1, 1] tile_sizes = [1, " << config.microN << "] "
+       << "permutation = [2, 0, 1, 3]\n";
+  }
+  os << "  %pack_op = transform.structured.match ops{[\"disc_linalg_ext.multi_level_pack\"]} in %arg1\n"
+     << "  transform.disc.lower_multi_level_pack_to_loop %pack_op\n"
+     << "  %func1 = transform.structured.match ops{[\"func.func\"]} in %arg1\n"
+     << "  transform.disc.apply_patterns %func1 {canonicalization}\n"
+     << "  %func2 = transform.structured.match ops{[\"func.func\"]} in %arg1\n"
+     << "  transform.structured.vectorize %func2 {vectorize_padding}\n"
+     << "  %func3 = transform.structured.match ops{[\"func.func\"]} in %arg1\n"
+     << "  transform.disc.apply_patterns %func3 {canonicalization}\n"
+     << "  transform.disc.bufferize %arg1\n";
+  // clang-format on
+  printLowerVectors("0, 1, 2, 3");
+  printLowerVectors("5, 6, 7");
+  os << "}\n";
+  os.flush();
+  return schedule;
+}
+
+LogicalResult buildDefaultCpuSchedule(FusionPattern& fusionPattern, CpuIsa isa,
+                                      std::string& schedule) {
+  auto dotOp =
+      dyn_cast_or_null<lmhlo::DotGeneralOp>(fusionPattern.getDominantOp());
+  if (!dotOp) return failure();
+
+  // The batching dimensions are the leading ones and the contracting
+  // dimensions are among the two minor ones (see `isSupportedDot`).
+  auto lhsTy = dotOp->getOperand(0).getType().cast<MemRefType>();
+  auto rhsTy = dotOp->getOperand(1).getType().cast<MemRefType>();
+  auto outTy = dotOp->getOperand(2).getType().cast<MemRefType>();
+  auto dimNumbers = dotOp.getDotDimensionNumbers();
+  int64_t rank = outTy.getRank();
+  bool isBatched = !dimNumbers.getLhsBatchingDimensions().empty();
+  bool lhsTransposed = dimNumbers.getLhsContractingDimensions()[0] == rank - 2;
+  bool rhsTransposed = dimNumbers.getRhsContractingDimensions()[0] == rank - 1;
+  int64_t m = lhsTy.getDimSize(lhsTransposed ? rank - 1 : rank - 2);
+  int64_t n = rhsTy.getDimSize(rhsTransposed ? rank - 2 : rank - 1);
+
+  // The ops other than the dot and the constants form the epilogue.
+  bool hasEpilogue = llvm::any_of(fusionPattern.getOpList(), [](Operation* op) {
+    return !isa<lmhlo::DotGeneralOp, lmhlo::ConstantOp>(op);
+  });
+  if (isBatched && hasEpilogue) return failure();
+
+  GemmShapeClass shapeClass = classifyGemmShape(m, n);
+  CpuGemmTileConfig config = getDefaultCpuGemmTileConfig(shapeClass, isa);
+  LLVM_DEBUG(llvm::dbgs() << "default gemm schedule for m = " << m
+                          << ", n = " << n << ": isa = " << toString(isa)
+                          << ", shape = " << toString(shapeClass)
+                          << ", epilogue = " << hasEpilogue
+                          << ", block = [" << config.blockM << ", "
+                          << config.blockN << "], micro = [" << config.microM
+                          << ", " << config.microN << "], batched = "
+                          << isBatched << ", transposed = [" << lhsTransposed
+                          << ", " << rhsTransposed << "]\n");
+  schedule = buildCpuGemmSchedule(config, outTy.getElementType(), hasEpilogue,
+                                  isBatched);
+  return success();
+}
+
+}  // namespace disc_ral
+}  // namespace mlir
@@ -0,0 +1,94 @@
+/* Copyright 2022 The BladeDISC Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef DISC_TRANSFORMS_DISC_TRANSFORM_SCHEDULE_H_
+#define DISC_TRANSFORMS_DISC_TRANSFORM_SCHEDULE_H_
+
+#include <string>
+
+#include "mlir/IR/Types.h"
+#include "mlir/Support/LogicalResult.h"
+
+namespace mlir {
+namespace disc_ral {
+
+class FusionPattern;
+
+// Vector ISA the default schedules are tuned for.
+enum class CpuIsa { kAVX2, kAVX512, kNEON };
+
+// Shape classes of a gemm `[m, k] x [k, n]` which prefer different blockings.
+// The batch dimension of a batched gemm and the layout of the operands do not
+// affect the class.
+enum class GemmShapeClass {
+  // m is tiny (e.g. the batch size of an inference request), thus the packed
+  // lhs is cheap and the n dimension is blocked as large as possible.
+  kSmallM,
+  // n is small compared with m, thus the whole packed rhs stays in cache and
+  // the m dimension gets the large block.
+  kTallSkinny,
+  // All the other cases.
+  kSquare
+};
+
+// Tile sizes of the two level blocking used by the default gemm schedule.
+struct CpuGemmTileConfig {
+  // Sizes of the cache blocks.
+  int64_t blockM;
+  int64_t blockN;
+  // Sizes of the register blocks (i.e. the micro kernel).
+  int64_t microM;
+  int64_t microN;
+};
+
+// Returns the ISA of the host cpu. The env var `DISC_TRANSFORM_SCHEDULE_ISA`
+// (avx2|avx512|neon) overrides the detected one.
+CpuIsa getHostCpuIsa();
+
+// Returns the ISA of the target cpu with the preferred vector width of
+// `vectorWidth` bits (see `CpuLoweringOptions::vector_width`): 512 for avx512,
+// 256 for avx2 and 128 for neon on aarch64 (avx2 otherwise). Falls back to the
+// host ISA if `vectorWidth` is not positive. The env var
+// `DISC_TRANSFORM_SCHEDULE_ISA` overrides both.
+CpuIsa getTargetCpuIsa(int64_t vectorWidth);
+
+// Returns the shape class of the gemm. Dynamic dimensions are passed as
+// negative values and treated as large ones.
+GemmShapeClass classifyGemmShape(int64_t m, int64_t n);
+
+// Returns the tile sizes for the given shape class and ISA.
+CpuGemmTileConfig getDefaultCpuGemmTileConfig(GemmShapeClass shapeClass,
+                                              CpuIsa isa);
+
+// Returns the transform dialect schedule of a gemm with element type
+// `elemType` using the tile sizes in `config`. If `hasEpilogue` is true, the
+// gemm is followed by a linalg.generic op (e.g. bias add and activation),
+// which is tiled as the root and the gemm is fused into each of its tiles.
+// If `isBatched` is true, the gemm is a linalg.batch_matmul op, which does not
+// support epilogue a.t.m.
+std::string buildCpuGemmSchedule(const CpuGemmTileConfig& config,
+                                 Type elemType, bool hasEpilogue = false,
+                                 bool isBatched = false);
+
+// Builds the default schedule tuned for `isa` for the transform based fusion
+// pattern and stores it in `schedule`. Returns failure if there is no default
+// schedule for the pattern.
+LogicalResult buildDefaultCpuSchedule(FusionPattern& fusionPattern, CpuIsa isa,
+                                      std::string& schedule);
+
+}  // namespace disc_ral
+}  // namespace mlir
+
+#endif  // DISC_TRANSFORMS_DISC_TRANSFORM_SCHEDULE_H_
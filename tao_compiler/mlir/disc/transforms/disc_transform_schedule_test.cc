@@ -0,0 +1,108 @@
+/* Copyright 2022 The BladeDISC Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/mlir/disc/transforms/disc_transform_schedule.h"
+
+#include <stdlib.h>
+
+#include "tensorflow/core/platform/test.h"
+
+namespace mlir {
+namespace disc_ral {
+namespace {
+
+TEST(DiscTransformScheduleTest, ClassifyGemmShape) {
+  EXPECT_EQ(classifyGemmShape(1, 1024), GemmShapeClass::kSmallM);
+  EXPECT_EQ(classifyGemmShape(16, 8), GemmShapeClass::kSmallM);
+  EXPECT_EQ(classifyGemmShape(16, -1), GemmShapeClass::kSmallM);
+  EXPECT_EQ(classifyGemmShape(256, 64), GemmShapeClass::kTallSkinny);
+  EXPECT_EQ(classifyGemmShape(1024, 1), GemmShapeClass::kTallSkinny);
+  EXPECT_EQ(classifyGemmShape(255, 64), GemmShapeClass::kSquare);
+  EXPECT_EQ(classifyGemmShape(1024, 65), GemmShapeClass::kSquare);
+  EXPECT_EQ(classifyGemmShape(17, 17), GemmShapeClass::kSquare);
+  // Dynamic dimensions are treated as large ones.
+  EXPECT_EQ(classifyGemmShape(-1, 32), GemmShapeClass::kTallSkinny);
+  EXPECT_EQ(classifyGemmShape(-1, 1024), GemmShapeClass::kSquare);
+  EXPECT_EQ(classifyGemmShape(512, -1), GemmShapeClass::kSquare);
+  EXPECT_EQ(classifyGemmShape(-1, -1), GemmShapeClass::kSquare);
+}
+
+TEST(DiscTransformScheduleTest, MicroKernelFitsRegisters) {
+  struct {
+    CpuIsa isa;
+    int64_t microM;
+    int64_t microN;
+  } cases[] = {{CpuIsa::kAVX2, 6, 16},
+               {CpuIsa::kAVX512, 8, 32},
+               {CpuIsa::kNEON, 8, 12}};
+  for (const auto& c : cases) {
+    for (GemmShapeClass shapeClass :
+         {GemmShapeClass::kSmallM, GemmShapeClass::kTallSkinny,
+          GemmShapeClass::kSquare}) {
+      CpuGemmTileConfig config = getDefaultCpuGemmTileConfig(shapeClass, c.isa);
+      EXPECT_EQ(config.microM, c.microM);
+      EXPECT_EQ(config.microN, c.microN);
+      // The cache blocks are made of whole register blocks.
+      EXPECT_GT(config.blockM, 0);
+      EXPECT_GT(config.blockN, 0);
+      EXPECT_EQ(config.blockM % config.microM, 0);
+      EXPECT_EQ(config.blockN % config.microN, 0);
+    }
+  }
+}
+
+TEST(DiscTransformScheduleTest, CacheBlockFollowsShapeClass) {
+  CpuGemmTileConfig smallM =
+      getDefaultCpuGemmTileConfig(GemmShapeClass::kSmallM, CpuIsa::kAVX2);
+  EXPECT_EQ(smallM.blockM, 18);
+  EXPECT_EQ(smallM.blockN, 1024);
+
+  CpuGemmTileConfig tallSkinny =
+      getDefaultCpuGemmTileConfig(GemmShapeClass::kTallSkinny, CpuIsa::kNEON);
+  EXPECT_EQ(tallSkinny.blockM, 576);
+  EXPECT_EQ(tallSkinny.blockN, 72);
+
+  CpuGemmTileConfig square =
+      getDefaultCpuGemmTileConfig(GemmShapeClass::kSquare, CpuIsa::kAVX512);
+  EXPECT_EQ(square.blockM, 288);
+  EXPECT_EQ(square.blockN, 256);
+
+  // A small-m block covers all the rows of a small-m gemm, and a tall-skinny
+  // block covers all the columns of a tall-skinny gemm.
+  for (CpuIsa isa : {CpuIsa::kAVX2, CpuIsa::kAVX512, CpuIsa::kNEON}) {
+    EXPECT_GE(getDefaultCpuGemmTileConfig(GemmShapeClass::kSmallM, isa).blockM,
+              16);
+    EXPECT_GE(
+        getDefaultCpuGemmTileConfig(GemmShapeClass::kTallSkinny, isa).blockN,
+        64);
+  }
+}
+
+TEST(DiscTransformScheduleTest, TargetCpuIsa) {
+  // The env var overrides the target, and is read once.
+  unsetenv("DISC_TRANSFORM_SCHEDULE_ISA");
+  EXPECT_EQ(getTargetCpuIsa(512), CpuIsa::kAVX512);
+  EXPECT_EQ(getTargetCpuIsa(256), CpuIsa::kAVX2);
+#if defined(__aarch64__)
+  EXPECT_EQ(getTargetCpuIsa(128), CpuIsa::kNEON);
+#else
+  EXPECT_EQ(getTargetCpuIsa(128), CpuIsa::kAVX2);
+#endif
+  EXPECT_EQ(getTargetCpuIsa(-1), getHostCpuIsa());
+}
+
+}  // namespace
+}  // namespace disc_ral
+}  // namespace mlir
@@ -196,15 +196,18 @@ struct ConvertConvOp : public OpRewritePattern<OpTy> {
   }
 };
 
+// Converts a fp32 dot_general op to a low precision (e.g. fp16 or bf16) one.
 struct ConvertDotGeneralOp : public OpRewritePattern<mhlo::DotGeneralOp> {
-  using OpRewritePattern::OpRewritePattern;
+  ConvertDotGeneralOp(MLIRContext* context, FloatType lowp_ty)
+      : OpRewritePattern<mhlo::DotGeneralOp>::OpRewritePattern(context),
+        lowp_ty_(lowp_ty) {}
 
   LogicalResult matchAndRewrite(mhlo::DotGeneralOp op,
                                 PatternRewriter& rewriter) const override {
     Location loc = op.getLoc();
     Value lhs = op.getLhs();
     Value rhs = op.getRhs();
-    FloatType f16_ty = rewriter.getF16Type();
+    FloatType f16_ty = lowp_ty_;
     FloatType f32_ty = rewriter.getF32Type();
     RankedTensorType lhs_ty = lhs.getType().dyn_cast<RankedTensorType>();
     RankedTensorType rhs_ty = rhs.getType().dyn_cast<RankedTensorType>();
@@ -228,16 +231,21 @@ struct ConvertDotGeneralOp : public OpRewritePattern<mhlo::DotGeneralOp> {
     rewriter.replaceOp(op, fp32_dot);
     return success();
   }
+
+ private:
+  FloatType lowp_ty_;
 };
 
 struct ElementTypeConverterPass
     : public ElementTypeConverterPassBase<ElementTypeConverterPass> {
   explicit ElementTypeConverterPass(bool enable_fp16_gemm,
-                                    bool enable_fp16_conv)
+                                    bool enable_fp16_conv,
+                                    bool enable_bf16_gemm)
       : ElementTypeConverterPassBase<
             ElementTypeConverterPass>::ElementTypeConverterPassBase() {
     this->enable_fp16_gemm_ = enable_fp16_gemm;
     this->enable_fp16_conv_ = enable_fp16_conv;
+    this->enable_bf16_gemm_ = enable_bf16_gemm;
   }
 
   void runOnOperation() override {
@@ -246,7 +254,9 @@ struct ElementTypeConverterPass
     RewritePatternSet patterns(&ctx);
     patterns.insert<ConvertReduceOpWithSmallWidthIntType>(&ctx);
     if (enable_fp16_gemm_) {
-      patterns.insert<ConvertDotGeneralOp>(&ctx);
+      patterns.insert<ConvertDotGeneralOp>(&ctx, FloatType::getF16(&ctx));
+    } else if (enable_bf16_gemm_) {
+      patterns.insert<ConvertDotGeneralOp>(&ctx, FloatType::getBF16(&ctx));
     }
     if (enable_fp16_conv_) {
       patterns.insert<ConvertConvOp<mhlo::DynamicConvOp>,
@@ -263,9 +273,9 @@ struct ElementTypeConverterPass
 }  // namespace
 
 std::unique_ptr<OperationPass<func::FuncOp>> createDiscElementTypeConverterPass(
-    bool enable_fp16_gemm, bool enable_fp16_conv) {
-  return std::make_unique<ElementTypeConverterPass>(enable_fp16_gemm,
-                                                    enable_fp16_conv);
+    bool enable_fp16_gemm, bool enable_fp16_conv, bool enable_bf16_gemm) {
+  return std::make_unique<ElementTypeConverterPass>(
+      enable_fp16_gemm, enable_fp16_conv, enable_bf16_gemm);
 }
 
 }  // namespace disc_ral
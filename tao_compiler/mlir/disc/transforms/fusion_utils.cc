@@ -53,7 +53,7 @@ void dumpFusionPattern(FusionPattern& pattern) {
 }
 
 bool envValueIsTrue(const std::string& envName) {
-  static const char* env = getenv(envName.c_str());
+  const char* env = getenv(envName.c_str());
   if (!env) return false;
   std::string envStr = env;
   std::transform(envStr.begin(), envStr.end(), envStr.begin(),
@@ -62,11 +62,21 @@ bool envValueIsTrue(const std::string& envName) {
 }
 
 bool enableEagerTransposeFusion() {
-  return envValueIsTrue("DISC_CPU_ENABLE_EAGER_TRANSPOSE_FUSION");
+  static bool enabled =
+      envValueIsTrue("DISC_CPU_ENABLE_EAGER_TRANSPOSE_FUSION");
+  return enabled;
 }
 
 bool enableTransposeLibraryCall() {
-  return envValueIsTrue("DISC_GPU_ENABLE_TRANSPOSE_LIBRARY_CALL");
+  static bool enabled =
+      envValueIsTrue("DISC_GPU_ENABLE_TRANSPOSE_LIBRARY_CALL");
+  return enabled;
+}
+
+bool enableCpuTransposeLibraryCall() {
+  static bool enabled =
+      envValueIsTrue("DISC_CPU_ENABLE_TRANSPOSE_LIBRARY_CALL");
+  return enabled;
 }
 
 DenseSet<Operation*> NoLoaderUser(SmallVectorImpl<Operation*>& ops) {
@@ -158,6 +158,10 @@ bool isFusible(Operation* op);
 // Return true if enable transpose library call
 bool enableTransposeLibraryCall();
 
+// Returns true if the transpose ops placed on cpu and not fused are lowered
+// to library calls (`DISC_CPU_ENABLE_TRANSPOSE_LIBRARY_CALL`).
+bool enableCpuTransposeLibraryCall();
+
 // Returns data users of the value and its aliases (e.g. memref.cast).
 // Here non-data users means DimOp, DeallocOp and ShapeOfOp.
 SmallVector<Operation*, 4> getValueUsers(Value v);
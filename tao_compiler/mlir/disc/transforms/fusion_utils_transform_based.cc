@@ -18,6 +18,23 @@ namespace disc_ral {
 /////////// Transform based CPU FusionStrategy Implemenation ///////////
 ////////////////////////////////////////////////////////////////////////
 
+// Returns true if `dims` are the leading dimensions, i.e. `[0, 1, ...]`.
+bool isLeadingDims(ArrayRef<int64_t> dims) {
+  for (const auto& en : llvm::enumerate(dims))
+    if (en.value() != static_cast<int64_t>(en.index())) return false;
+  return true;
+}
+
+// Returns true if `op` is a dot_general op which can be converted to a
+// (batch) matmul, that is:
+//  - the batching dimensions (if any) are the leading dimensions of both
+//    operands;
+//  - at most one batching dimension is dynamic if there are more than one;
+//  - there is a single contracting dimension, which is one of the two minor
+//    dimensions of each operand (i.e. the operand may be transposed).
+// The batching dimensions are collapsed into one and the transposes are
+// folded into the packing of the operands when lowering the dot op. The
+// collapsed dimension can not be expanded back into multiple dynamic ones.
 bool isSupportedDot(Operation* op) {
   auto dotOp = dyn_cast<lmhlo::DotGeneralOp>(op);
   if (!dotOp) return false;
@@ -26,24 +43,143 @@ bool isSupportedDot(Operation* op) {
   auto rhsTy = op->getOperand(1).getType().cast<MemRefType>();
   auto outTy = op->getOperand(2).getType().cast<MemRefType>();
 
-  // TODO(wyzero): support batch gemm
-  if (lhsTy.getRank() != 2 || rhsTy.getRank() != 2 || outTy.getRank() != 2)
-    return false;
-
   auto dimNumbers = dotOp.getDotDimensionNumbers();
-  if (dimNumbers.getLhsBatchingDimensions().size() != 0 ||
-      dimNumbers.getRhsBatchingDimensions().size() != 0)
+  auto lhsBatchingDims = dimNumbers.getLhsBatchingDimensions();
+  auto rhsBatchingDims = dimNumbers.getRhsBatchingDimensions();
+  int64_t rank = lhsBatchingDims.size() + 2;
+  if (lhsTy.getRank() != rank || rhsTy.getRank() != rank ||
+      outTy.getRank() != rank)
+    return false;
+  if (!isLeadingDims(lhsBatchingDims) || !isLeadingDims(rhsBatchingDims))
+    return false;
+  if (lhsBatchingDims.size() > 1 &&
+      llvm::count(outTy.getShape().take_front(lhsBatchingDims.size()),
+                  ShapedType::kDynamicSize) > 1)
     return false;
 
-  // TODO(wyzero): support dot_general with fused transpose
   auto lhsCntractingDims = dimNumbers.getLhsContractingDimensions();
   auto rhsCntractingDims = dimNumbers.getRhsContractingDimensions();
-  return (lhsCntractingDims.size() == 1 && lhsCntractingDims[0] == 1 &&
-          rhsCntractingDims.size() == 1 && rhsCntractingDims[0] == 0);
+  return (lhsCntractingDims.size() == 1 && lhsCntractingDims[0] >= rank - 2 &&
+          rhsCntractingDims.size() == 1 && rhsCntractingDims[0] >= rank - 2);
+}
+
+// Returns true if `op` is an elementwise op that can be fused into the
+// epilogue of a gemm, e.g. bias add, activations and residual add.
+bool isSupportedEpilogueElemOp(Operation* op) {
+  // clang-format off
+  if (!isa<
+    lmhlo::AbsOp,
+    lmhlo::AddOp,
+    lmhlo::DivOp,
+    lmhlo::ExpOp,
+    lmhlo::LogOp,
+    lmhlo::LogisticOp,
+    lmhlo::MaxOp,
+    lmhlo::MinOp,
+    lmhlo::MulOp,
+    lmhlo::NegOp,
+    lmhlo::PowOp,
+    lmhlo::RsqrtOp,
+    lmhlo::SqrtOp,
+    lmhlo::SubtractOp,
+    lmhlo::TanhOp
+  >(op))
+    return false;
+  // clang-format on
+
+  auto outTy = cast<lmhlo::LmhloOp>(op).getResultBuffer().getType();
+  auto memrefTy = outTy.cast<MemRefType>();
+  return memrefTy.getRank() == 2 &&
+         memrefTy.getElementType().isa<FloatType>();
+}
+
+// Returns true if `op` broadcasts a scalar or a row vector (e.g. the bias) to
+// a rank-2 buffer without expanding any dimension of size one.
+bool isSupportedEpilogueBroadcastOp(ShapeAnalysis& shapeAnalysis,
+                                    Operation* op) {
+  DenseIntElementsAttr dims;
+  if (auto bcastOp = dyn_cast<lmhlo::BroadcastInDimOp>(op)) {
+    dims = bcastOp.getBroadcastDimensions();
+  } else if (auto bcastOp = dyn_cast<lmhlo::DynamicBroadcastInDimOp>(op)) {
+    dims = bcastOp.getBroadcastDimensions();
+  } else {
+    return false;
+  }
+
+  Value in = op->getOperand(0);
+  Value out = cast<lmhlo::LmhloOp>(op).getResultBuffer();
+  auto inTy = in.getType().cast<MemRefType>();
+  auto outTy = out.getType().cast<MemRefType>();
+  if (outTy.getRank() != 2 || !outTy.getElementType().isa<FloatType>())
+    return false;
+  if (inTy.getRank() == 0) return true;
+  return inTy.getRank() == 1 && *dims.getValues<int64_t>().begin() == 1 &&
+         shapeAnalysis.isProductEqual(in, {0}, out, {1});
+}
+
+// Returns true if `epilogueOps` are the epilogue of `dotOp`, that is:
+//  - each elementwise op has the shape of the dot output and consumes the
+//    output of the dot or of another elementwise op;
+//  - the other operands of the elementwise ops are either buffers having the
+//    shape of the dot output (e.g. the residual) or broadcasted scalars and
+//    row vectors (e.g. the bias);
+//  - the pattern has a single result written by an elementwise op.
+bool isSupportedEpilogue(ShapeAnalysis& shapeAnalysis,
+                         FusionPattern& fusionPattern, Operation* dotOp,
+                         ArrayRef<Operation*> epilogueOps) {
+  if (fusionPattern.getResults().size() != 1) return false;
+
+  Value dotOut = dotOp->getOperand(2);
+  DenseSet<Value> broadcastResults;
+  SmallVector<Operation*> elemOps;
+  for (Operation* op : epilogueOps) {
+    Value out = cast<lmhlo::LmhloOp>(op).getResultBuffer();
+    if (isSupportedEpilogueBroadcastOp(shapeAnalysis, op)) {
+      broadcastResults.insert(out);
+    } else if (isSupportedEpilogueElemOp(op) &&
+               shapeAnalysis.isShapeEqual(out, dotOut)) {
+      elemOps.push_back(op);
+    } else {
+      return false;
+    }
+  }
+
+  // The ops in the pattern are not necessarily in topological order, thus
+  // grows the chain of the dot until reaching a fixed point.
+  DenseSet<Value> chainResults{dotOut};
+  DenseSet<Operation*> chainOps;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (Operation* op : elemOps) {
+      if (chainOps.contains(op)) continue;
+      if (llvm::none_of(op->getOperands().drop_back(),
+                        [&](Value v) { return chainResults.contains(v); }))
+        continue;
+      chainOps.insert(op);
+      chainResults.insert(op->getOperands().back());
+      changed = true;
+    }
+  }
+  if (chainOps.size() != elemOps.size()) return false;
+
+  for (Operation* op : elemOps) {
+    for (Value v : op->getOperands().drop_back()) {
+      if (chainResults.contains(v) || broadcastResults.contains(v)) continue;
+      if (!shapeAnalysis.isShapeEqual(v, dotOut)) return false;
+    }
+  }
+
+  Value result = fusionPattern.getResults().front();
+  return result != dotOut && chainResults.contains(result);
 }
 
 bool TransformBasedCpuFusionStrategy::isFusible(Operation* op) {
-  return isSupportedDot(op) || isa<lmhlo::ConstantOp>(op);
+  if (isSupportedDot(op) || isa<lmhlo::ConstantOp>(op)) return true;
+  // The shape of the broadcast ops is checked when initializing the pattern.
+  return useTransformEpilogueFusion() &&
+         (isSupportedEpilogueElemOp(op) ||
+          isa<lmhlo::BroadcastInDimOp, lmhlo::DynamicBroadcastInDimOp>(op));
 }
 
 bool TransformBasedCpuFusionStrategy::initFusionPattern(
@@ -55,35 +191,54 @@ bool TransformBasedCpuFusionStrategy::initFusionPattern(
   // special case for single operation.
   if (fusionPattern.getOpList().size() == 1) {
     Operation* op = *fusionPattern.getOpList().begin();
-    if (this->isFusible(op)) {
+    if (isSupportedDot(op) || isa<lmhlo::ConstantOp>(op)) {
       fusionPattern.setDominantOp(op);
       fusionPattern.setFusionType(FusionType::kTransform);
+    } else if (this->isFusible(op)) {
+      // A candidate of the epilogue of a gemm. Marks it as a kLoop pattern to
+      // allow it to be merged with the gemm. The pattern is dropped if it
+      // remains a single op fusion.
+      fusionPattern.setDominantOp(op);
+      fusionPattern.setFusionType(FusionType::kLoop);
     }
     return true;
   }
 
   DenseSet<Value> dotWeights;
   DenseSet<Operation*> supportedDotOps;
+  SmallVector<Operation*> epilogueOps;
   for (Operation* op : fusionPattern.getOpList()) {
     // early return for the case where there are non supported ops.
     if (!this->isFusible(op)) return true;
     if (isSupportedDot(op)) {
       supportedDotOps.insert(op);
       dotWeights.insert(op->getOperand(1));
+    } else if (!isa<lmhlo::ConstantOp>(op)) {
+      epilogueOps.push_back(op);
     }
   }
 
   // Only support one gemm a.t.m.
   if (supportedDotOps.size() != 1) return true;
+  Operation* dotOp = *supportedDotOps.begin();
+  if (!epilogueOps.empty() &&
+      !isSupportedEpilogue(shapeAnalysis, fusionPattern, dotOp, epilogueOps))
+    return true;
 
-  // Only support fuse const ops that are used as weights for some dot ops.
+  // Only support fuse const ops that are used as weights for some dot ops or
+  // as operands of the epilogue ops.
   for (Operation* op : fusionPattern.getOpList()) {
     if (!isa<lmhlo::ConstantOp>(op)) continue;
-    if (llvm::find(dotWeights, op->getOperand(0)) == dotWeights.end())
+    Value out = op->getOperand(0);
+    if (dotWeights.contains(out)) continue;
+    if (llvm::none_of(epilogueOps, [&](Operation* epilogueOp) {
+          return llvm::is_contained(epilogueOp->getOperands().drop_back(),
+                                    out);
+        }))
       return true;
   }
 
-  fusionPattern.setDominantOp(*supportedDotOps.begin());
+  fusionPattern.setDominantOp(dotOp);
   fusionPattern.setFusionType(FusionType::kTransform);
   return true;
 }
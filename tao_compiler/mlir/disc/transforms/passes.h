@@ -80,8 +80,10 @@ createDiscSpecializeFusionWithSpeculationPass(int sm_count = -1,
 
 // Eliminates certain element types as the input or output of ops by inserting
 // Convert ops.
+// `enable_bf16_gemm` is ignored if `enable_fp16_gemm` is true.
 std::unique_ptr<OperationPass<FuncOp>> createDiscElementTypeConverterPass(
-    bool enable_fp16_gemm = false, bool enable_fp16_conv = false);
+    bool enable_fp16_gemm = false, bool enable_fp16_conv = false,
+    bool enable_bf16_gemm = false);
 
 // Greedily maps loops to GPU hardware dimensions.
 // TODO: this pass is only a wrapper to mlir func, copied from
@@ -164,6 +166,10 @@ std::unique_ptr<OperationPass<FuncOp>> createDiscLowerTfPass(
 // A pass to remove buffers that are not accessed by others
 std::unique_ptr<OperationPass<FuncOp>> createDiscRemoveDeadBufferPass();
 
+// Assigns static offsets within an arena buffer to the intermediate buffers
+// having static shapes according to their liveness.
+std::unique_ptr<OperationPass<FuncOp>> createDiscStaticMemoryPlanPass();
+
 // Assign a meaningful name to each gpu kernel.
 std::unique_ptr<OperationPass<ModuleOp>> createDiscAssignKernelNamePass();
 
@@ -200,6 +206,9 @@ std::unique_ptr<OperationPass<FuncOp>> createDiscMemrefCanonicalizerPass();
 // outline each cpu kernel to a dedicated function
 std::unique_ptr<OperationPass<ModuleOp>> createDiscOutlineCpuKernelPass();
 
+// merge consecutive cpu kernel launches into a single parallel region
+std::unique_ptr<OperationPass<FuncOp>> createDiscMergeCpuLaunchPass();
+
 // assign a parallel schedule for each parallel op on cpu
 std::unique_ptr<OperationPass<FuncOp>> createDiscCpuMapParallelLoopPass();
 
@@ -289,11 +298,14 @@ createDiscCompIntensFusionToCUDASourcePass(int cc_major = 8, int cc_minor = 0);
 std::unique_ptr<OperationPass<ModuleOp>> createDiscGPUSourceToLibPass(
     int cc_major = 8, int cc_minor = 0);
 
-// Legalizes transform-based fusion pattern to loop.
+// Legalizes transform-based fusion pattern to loop. The default schedules are
+// tuned for the cpu with the preferred vector width of `cpuVectorWidth` bits,
+// or the host cpu if it is not positive.
 std::unique_ptr<OperationPass<func::FuncOp>>
 createDiscTransformLegalizeToLoopPass(bool gpuEnabled = false,
                                       const std::string& filename = "",
-                                      bool expensiveCheck = false);
+                                      bool expensiveCheck = false,
+                                      int64_t cpuVectorWidth = -1);
 
 }  // namespace disc_ral
 }  // namespace mlir
@@ -43,4 +43,180 @@ func.func @matmul_nn_const_weight(%arg0: memref<1024x1024xf32, "cpu">, %arg1: me
   "lmhlo.constant"(%arg1) {disc.device = "cpu", value = dense<-1.0> : tensor<1024x1024xf32>} : (memref<1024x1024xf32, "cpu">) -> ()
   "lmhlo.dot_general"(%arg2, %arg1, %arg3) {dot_dimension_numbers = #mhlo.dot<lhs_contracting_dimensions = [1], rhs_contracting_dimensions = [0]>} : (memref<?x1024xf32, "cpu">, memref<1024x1024xf32, "cpu">, memref<?x1024xf32, "cpu">) -> ()
   return %arg3 : memref<?x1024xf32, "cpu">
-}
\ No newline at end of file
+}
+
+// -----
+
+// TRANSFORM-LABEL: @matmul_nn_bias_relu_residual
+func.func @matmul_nn_bias_relu_residual(%arg0: memref<?x?xf32, "cpu">, %arg1: memref<?x256xf32, "cpu">, %bias: memref<256xf32, "cpu">,
+                                        %res: memref<?x256xf32, "cpu">, %cst: memref<f32, "cpu">, %arg5: memref<?x256xf32, "cpu">,
+                                        %arg6: memref<?x256xf32, "cpu">, %arg7: memref<?x256xf32, "cpu">, %arg8: memref<?x256xf32, "cpu">,
+                                        %arg9: memref<?x256xf32, "cpu">, %arg10: memref<?x256xf32, "cpu">) -> memref<?x256xf32, "cpu"> {
+  // TRANSFORM: "lmhlo.fusion"() ({
+  // TRANSFORM-NEXT: lmhlo.dot_general
+  // TRANSFORM-NEXT: lmhlo.broadcast_in_dim
+  // TRANSFORM-NEXT: lmhlo.add
+  // TRANSFORM-NEXT: lmhlo.constant
+  // TRANSFORM-NEXT: lmhlo.broadcast_in_dim
+  // TRANSFORM-NEXT: lmhlo.max
+  // TRANSFORM-NEXT: lmhlo.add
+  // TRANSFORM-NEXT: lmhlo.terminator
+  // TRANSFORM-NEXT: })
+  // TRANSFORM-SAME: disc.fusion_type = "kTransform"
+  // TRANSFORM-NOT: "lmhlo.fusion"
+  "lmhlo.dot_general"(%arg0, %arg1, %arg5) {dot_dimension_numbers = #mhlo.dot<lhs_contracting_dimensions = [1], rhs_contracting_dimensions = [0]>} : (memref<?x?xf32, "cpu">, memref<?x256xf32, "cpu">, memref<?x256xf32, "cpu">) -> ()
+  "lmhlo.broadcast_in_dim"(%bias, %arg6) {broadcast_dimensions = dense<1> : tensor<1xi64>} : (memref<256xf32, "cpu">, memref<?x256xf32, "cpu">) -> ()
+  "lmhlo.add"(%arg5, %arg6, %arg7) : (memref<?x256xf32, "cpu">, memref<?x256xf32, "cpu">, memref<?x256xf32, "cpu">) -> ()
+  "lmhlo.constant"(%cst) {disc.device = "cpu", value = dense<0.000000e+00> : tensor<f32>} : (memref<f32, "cpu">) -> ()
+  "lmhlo.broadcast_in_dim"(%cst, %arg8) {broadcast_dimensions = dense<> : tensor<0xi64>} : (memref<f32, "cpu">, memref<?x256xf32, "cpu">) -> ()
+  "lmhlo.max"(%arg7, %arg8, %arg9) : (memref<?x256xf32, "cpu">, memref<?x256xf32, "cpu">, memref<?x256xf32, "cpu">) -> ()
+  "lmhlo.add"(%arg9, %res, %arg10) : (memref<?x256xf32, "cpu">, memref<?x256xf32, "cpu">, memref<?x256xf32, "cpu">) -> ()
+  return %arg10 : memref<?x256xf32, "cpu">
+}
+
+// -----
+
+// A column vector broadcast is not a bias of the gemm, thus only the dot is
+// fused.
+// TRANSFORM-LABEL: @matmul_nn_column_bias
+func.func @matmul_nn_column_bias(%arg0: memref<256x?xf32, "cpu">, %arg1: memref<?x?xf32, "cpu">, %bias: memref<256xf32, "cpu">,
+                                 %arg3: memref<256x?xf32, "cpu">, %arg4: memref<256x?xf32, "cpu">,
+                                 %arg5: memref<256x?xf32, "cpu">) -> memref<256x?xf32, "cpu"> {
+  // TRANSFORM: "lmhlo.fusion"() ({
+  // TRANSFORM-NEXT: lmhlo.dot_general
+  // TRANSFORM-NEXT: lmhlo.terminator
+  // TRANSFORM-NEXT: })
+  // TRANSFORM-SAME: disc.fusion_type = "kTransform"
+  // TRANSFORM-NOT: "lmhlo.fusion"
+  // TRANSFORM: "lmhlo.broadcast_in_dim"
+  // TRANSFORM-NOT: "lmhlo.fusion"
+  // TRANSFORM: "lmhlo.add"
+  "lmhlo.dot_general"(%arg0, %arg1, %arg3) {dot_dimension_numbers = #mhlo.dot<lhs_contracting_dimensions = [1], rhs_contracting_dimensions = [0]>} : (memref<256x?xf32, "cpu">, memref<?x?xf32, "cpu">, memref<256x?xf32, "cpu">) -> ()
+  "lmhlo.broadcast_in_dim"(%bias, %arg4) {broadcast_dimensions = dense<0> : tensor<1xi64>} : (memref<256xf32, "cpu">, memref<256x?xf32, "cpu">) -> ()
+  "lmhlo.add"(%arg3, %arg4, %arg5) : (memref<256x?xf32, "cpu">, memref<256x?xf32, "cpu">, memref<256x?xf32, "cpu">) -> ()
+  return %arg5 : memref<256x?xf32, "cpu">
+}
+
+// -----
+
+// Fusing either epilogue makes the pattern have two results, thus only the dot
+// is fused.
+// TRANSFORM-LABEL: @matmul_nn_two_epilogues
+func.func @matmul_nn_two_epilogues(%arg0: memref<?x?xf32, "cpu">, %arg1: memref<?x?xf32, "cpu">, %arg2: memref<?x?xf32, "cpu">,
+                                   %arg3: memref<?x?xf32, "cpu">, %arg4: memref<?x?xf32, "cpu">, %arg5: memref<?x?xf32, "cpu">,
+                                   %arg6: memref<?x?xf32, "cpu">) -> (memref<?x?xf32, "cpu">, memref<?x?xf32, "cpu">) {
+  // TRANSFORM: "lmhlo.fusion"() ({
+  // TRANSFORM-NEXT: lmhlo.dot_general
+  // TRANSFORM-NEXT: lmhlo.terminator
+  // TRANSFORM-NEXT: })
+  // TRANSFORM-SAME: disc.fusion_type = "kTransform"
+  // TRANSFORM-NOT: "lmhlo.fusion"
+  // TRANSFORM: "lmhlo.add"
+  // TRANSFORM-NOT: "lmhlo.fusion"
+  // TRANSFORM: "lmhlo.add"
+  "lmhlo.dot_general"(%arg0, %arg1, %arg2) {dot_dimension_numbers = #mhlo.dot<lhs_contracting_dimensions = [1], rhs_contracting_dimensions = [0]>} : (memref<?x?xf32, "cpu">, memref<?x?xf32, "cpu">, memref<?x?xf32, "cpu">) -> ()
+  "lmhlo.add"(%arg2, %arg3, %arg5) : (memref<?x?xf32, "cpu">, memref<?x?xf32, "cpu">, memref<?x?xf32, "cpu">) -> ()
+  "lmhlo.add"(%arg2, %arg4, %arg6) : (memref<?x?xf32, "cpu">, memref<?x?xf32, "cpu">, memref<?x?xf32, "cpu">) -> ()
+  return %arg5, %arg6 : memref<?x?xf32, "cpu">, memref<?x?xf32, "cpu">
+}
+
+// -----
+
+// The output of the dot escapes the pattern, thus only the dot is fused.
+// TRANSFORM-LABEL: @matmul_nn_escaping_dot_output
+func.func @matmul_nn_escaping_dot_output(%arg0: memref<?x?xf32, "cpu">, %arg1: memref<?x?xf32, "cpu">, %arg2: memref<?x?xf32, "cpu">,
+                                         %arg3: memref<?x?xf32, "cpu">, %arg4: memref<?x?xf32, "cpu">) -> (memref<?x?xf32, "cpu">, memref<?x?xf32, "cpu">) {
+  // TRANSFORM: "lmhlo.fusion"() ({
+  // TRANSFORM-NEXT: lmhlo.dot_general
+  // TRANSFORM-NEXT: lmhlo.terminator
+  // TRANSFORM-NEXT: })
+  // TRANSFORM-SAME: disc.fusion_type = "kTransform"
+  // TRANSFORM-NOT: "lmhlo.fusion"
+  // TRANSFORM: "lmhlo.add"
+  "lmhlo.dot_general"(%arg0, %arg1, %arg2) {dot_dimension_numbers = #mhlo.dot<lhs_contracting_dimensions = [1], rhs_contracting_dimensions = [0]>} : (memref<?x?xf32, "cpu">, memref<?x?xf32, "cpu">, memref<?x?xf32, "cpu">) -> ()
+  "lmhlo.add"(%arg2, %arg3, %arg4) : (memref<?x?xf32, "cpu">, memref<?x?xf32, "cpu">, memref<?x?xf32, "cpu">) -> ()
+  return %arg2, %arg4 : memref<?x?xf32, "cpu">, memref<?x?xf32, "cpu">
+}
+
+// -----
+
+// Epilogue candidates are not fused without a gemm.
+// TRANSFORM-LABEL: @lone_epilogue
+func.func @lone_epilogue(%arg0: memref<?x?xf32, "cpu">, %arg1: memref<?x?xf32, "cpu">, %arg2: memref<?x?xf32, "cpu">,
+                         %arg3: memref<?x?xf32, "cpu">) -> memref<?x?xf32, "cpu"> {
+  // TRANSFORM-NOT: "lmhlo.fusion"
+  // TRANSFORM: "lmhlo.add"
+  // TRANSFORM-NOT: "lmhlo.fusion"
+  // TRANSFORM: "lmhlo.tanh"
+  // TRANSFORM-NOT: "lmhlo.fusion"
+  "lmhlo.add"(%arg0, %arg1, %arg2) : (memref<?x?xf32, "cpu">, memref<?x?xf32, "cpu">, memref<?x?xf32, "cpu">) -> ()
+  "lmhlo.tanh"(%arg2, %arg3) : (memref<?x?xf32, "cpu">, memref<?x?xf32, "cpu">) -> ()
+  return %arg3 : memref<?x?xf32, "cpu">
+}
+
+// -----
+
+// TRANSFORM-LABEL: @batch_matmul_nt
+func.func @batch_matmul_nt(%arg0: memref<2x?x?x64xf32, "cpu">, %arg1: memref<2x?x?x64xf32, "cpu">,
+                           %arg2: memref<2x?x?x?xf32, "cpu">) -> memref<2x?x?x?xf32, "cpu"> {
+  // TRANSFORM: "lmhlo.fusion"() ({
+  // TRANSFORM-NEXT: lmhlo.dot_general
+  // TRANSFORM-NEXT: lmhlo.terminator
+  // TRANSFORM-NEXT: })
+  // TRANSFORM-SAME: disc.fusion_type = "kTransform"
+  "lmhlo.dot_general"(%arg0, %arg1, %arg2) {dot_dimension_numbers = #mhlo.dot<lhs_batching_dimensions = [0, 1], rhs_batching_dimensions = [0, 1], lhs_contracting_dimensions = [3], rhs_contracting_dimensions = [3]>} : (memref<2x?x?x64xf32, "cpu">, memref<2x?x?x64xf32, "cpu">, memref<2x?x?x?xf32, "cpu">) -> ()
+  return %arg2 : memref<2x?x?x?xf32, "cpu">
+}
+
+// -----
+
+// TRANSFORM-LABEL: @matmul_tn
+func.func @matmul_tn(%arg0: memref<?x?xf32, "cpu">, %arg1: memref<?x?xf32, "cpu">,
+                     %arg2: memref<?x?xf32, "cpu">) -> memref<?x?xf32, "cpu"> {
+  // TRANSFORM: "lmhlo.fusion"() ({
+  // TRANSFORM-NEXT: lmhlo.dot_general
+  // TRANSFORM-NEXT: lmhlo.terminator
+  // TRANSFORM-NEXT: })
+  // TRANSFORM-SAME: disc.fusion_type = "kTransform"
+  "lmhlo.dot_general"(%arg0, %arg1, %arg2) {dot_dimension_numbers = #mhlo.dot<lhs_contracting_dimensions = [0], rhs_contracting_dimensions = [0]>} : (memref<?x?xf32, "cpu">, memref<?x?xf32, "cpu">, memref<?x?xf32, "cpu">) -> ()
+  return %arg2 : memref<?x?xf32, "cpu">
+}
+
+// -----
+
+// The batching dim of the lhs is not a leading dim.
+// TRANSFORM-LABEL: @batch_matmul_non_leading_batch_dim
+func.func @batch_matmul_non_leading_batch_dim(%arg0: memref<?x2x?xf32, "cpu">, %arg1: memref<2x?x?xf32, "cpu">,
+                                              %arg2: memref<2x?x?xf32, "cpu">) -> memref<2x?x?xf32, "cpu"> {
+  // TRANSFORM-NOT: "lmhlo.fusion"
+  // TRANSFORM: "lmhlo.dot_general"
+  // TRANSFORM-NOT: "lmhlo.fusion"
+  "lmhlo.dot_general"(%arg0, %arg1, %arg2) {dot_dimension_numbers = #mhlo.dot<lhs_batching_dimensions = [1], rhs_batching_dimensions = [0], lhs_contracting_dimensions = [2], rhs_contracting_dimensions = [1]>} : (memref<?x2x?xf32, "cpu">, memref<2x?x?xf32, "cpu">, memref<2x?x?xf32, "cpu">) -> ()
+  return %arg2 : memref<2x?x?xf32, "cpu">
+}
+
+// -----
+
+// TRANSFORM-LABEL: @matmul_multiple_contracting_dims
+func.func @matmul_multiple_contracting_dims(%arg0: memref<?x?x?xf32, "cpu">, %arg1: memref<?x?x?xf32, "cpu">,
+                                            %arg2: memref<?x?xf32, "cpu">) -> memref<?x?xf32, "cpu"> {
+  // TRANSFORM-NOT: "lmhlo.fusion"
+  // TRANSFORM: "lmhlo.dot_general"
+  // TRANSFORM-NOT: "lmhlo.fusion"
+  "lmhlo.dot_general"(%arg0, %arg1, %arg2) {dot_dimension_numbers = #mhlo.dot<lhs_contracting_dimensions = [1, 2], rhs_contracting_dimensions = [0, 1]>} : (memref<?x?x?xf32, "cpu">, memref<?x?x?xf32, "cpu">, memref<?x?xf32, "cpu">) -> ()
+  return %arg2 : memref<?x?xf32, "cpu">
+}
+
+// -----
+
+// The batching dims can not be collapsed into one since more than one of them
+// are dynamic.
+// TRANSFORM-LABEL: @batch_matmul_dynamic_batch_dims
+func.func @batch_matmul_dynamic_batch_dims(%arg0: memref<?x?x?x?xf32, "cpu">, %arg1: memref<?x?x?x?xf32, "cpu">,
+                                           %arg2: memref<?x?x?x?xf32, "cpu">) -> memref<?x?x?x?xf32, "cpu"> {
+  // TRANSFORM-NOT: "lmhlo.fusion"
+  // TRANSFORM: "lmhlo.dot_general"
+  // TRANSFORM-NOT: "lmhlo.fusion"
+  "lmhlo.dot_general"(%arg0, %arg1, %arg2) {dot_dimension_numbers = #mhlo.dot<lhs_batching_dimensions = [0, 1], rhs_batching_dimensions = [0, 1], lhs_contracting_dimensions = [3], rhs_contracting_dimensions = [3]>} : (memref<?x?x?x?xf32, "cpu">, memref<?x?x?x?xf32, "cpu">, memref<?x?x?x?xf32, "cpu">) -> ()
+  return %arg2 : memref<?x?x?x?xf32, "cpu">
+}
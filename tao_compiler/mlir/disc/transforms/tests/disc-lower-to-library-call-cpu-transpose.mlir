@@ -0,0 +1,44 @@
+// RUN: DISC_CPU_ENABLE_TRANSPOSE_LIBRARY_CALL=true disc-opt -disc-lower-to-library-call --split-input-file %s -o - | FileCheck %s
+
+// CHECK-LABEL: func.func @cpu_transpose_2d
+// CHECK-SAME: (%[[CTX:.*]]: !disc_ral.context, %[[IN:.*]]: memref<?x?xf32, "cpu">, %[[OUT:.*]]: memref<?x?xf32, "cpu">)
+func.func @cpu_transpose_2d(%ctx: !disc_ral.context, %in: memref<?x?xf32, "cpu">, %out: memref<?x?xf32, "cpu">) {
+  // CHECK: %[[PERM:.*]] = memref.alloc() : memref<2xi32, "cpu">
+  // CHECK: "disc_ral.dispatch"(%[[CTX]], %{{.*}}, %[[IN]], %[[PERM]], %[[OUT]])
+  // CHECK-SAME: call_target_name = "ral_transpose", device = "cpu"
+  "lmhlo.transpose"(%in, %out) {permutation = dense<[1, 0]> : tensor<2xi64>} : (memref<?x?xf32, "cpu">, memref<?x?xf32, "cpu">) -> ()
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func.func @cpu_transpose_3d
+func.func @cpu_transpose_3d(%ctx: !disc_ral.context, %in: memref<?x?x?xf32, "cpu">, %out: memref<?x?x?xf32, "cpu">) {
+  // CHECK: "disc_ral.dispatch"
+  // CHECK-SAME: call_target_name = "ral_transpose", device = "cpu"
+  "lmhlo.transpose"(%in, %out) {permutation = dense<[0, 2, 1]> : tensor<3xi64>} : (memref<?x?x?xf32, "cpu">, memref<?x?x?xf32, "cpu">) -> ()
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func.func @cpu_fused_transpose
+func.func @cpu_fused_transpose(%ctx: !disc_ral.context, %in: memref<?x?xf32, "cpu">, %out: memref<?x?xf32, "cpu">) {
+  // CHECK-NOT: ral_transpose
+  // CHECK: lmhlo.transpose
+  "lmhlo.fusion"() ({
+    "lmhlo.transpose"(%in, %out) {permutation = dense<[1, 0]> : tensor<2xi64>} : (memref<?x?xf32, "cpu">, memref<?x?xf32, "cpu">) -> ()
+    "lmhlo.terminator"() : () -> ()
+  }) {disc.fusion.name = "main_kLoop_transpose"} : () -> ()
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func.func @cpu_transpose_unsupported_type
+func.func @cpu_transpose_unsupported_type(%ctx: !disc_ral.context, %in: memref<?x?xi1, "cpu">, %out: memref<?x?xi1, "cpu">) {
+  // CHECK-NOT: ral_transpose
+  // CHECK: lmhlo.transpose
+  "lmhlo.transpose"(%in, %out) {permutation = dense<[1, 0]> : tensor<2xi64>} : (memref<?x?xi1, "cpu">, memref<?x?xi1, "cpu">) -> ()
+  return
+}
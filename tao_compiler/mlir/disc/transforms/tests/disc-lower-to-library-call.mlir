@@ -528,3 +528,35 @@ func.func @quantized_dot_general(%arg0: !disc_ral.context) {
   } : (memref<?x?x?x?xi8, "gpu">, memref<?x?x?x?xi8, "gpu">, memref<f32, "gpu">, memref<i32, "gpu">, memref<f32, "gpu">, memref<i32, "gpu">, memref<f32, "gpu">, memref<i32, "gpu">, memref<?x?x?x?xi8, "gpu">) -> ()
   return
 }
+
+// -----
+
+// CHECK-LABEL: strided_gemm_operand
+func.func @strided_gemm_operand(%arg0: !disc_ral.context) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  // CHECK: %[[LHS:.*]] = "disc_ral.dispatch"
+  // CHECK-SAME: call_target_name = "ral_recv_strided_input"
+  // CHECK: %[[RHS:.*]] = "disc_ral.dispatch"
+  // CHECK-SAME: call_target_name = "ral_recv_input"
+  %0 = "disc_ral.recv_input"(%arg0, %c0) : (!disc_ral.context, index) -> memref<?x?xf32>
+  %1 = "disc_ral.recv_input"(%arg0, %c1) : (!disc_ral.context, index) -> memref<?x?xf32>
+  %m = memref.dim %0, %c0 : memref<?x?xf32>
+  %n = memref.dim %1, %c1 : memref<?x?xf32>
+  %k = memref.dim %1, %c0 : memref<?x?xf32>
+  %2 = memref.alloc(%m, %n) : memref<?x?xf32>
+  %3 = memref.alloc(%k, %n) : memref<?x?xf32>
+  // CHECK: "disc_ral.dispatch"(%{{.*}}, %{{.*}}, %[[LHS]], %[[RHS]]
+  // CHECK-SAME: call_target_name = "ral_gemm"
+  "lmhlo.dot_general"(%0, %1, %2) {
+    dot_dimension_numbers = #mhlo.dot<
+      lhs_contracting_dimensions = [1],
+      rhs_contracting_dimensions = [0]
+    >
+  } : (memref<?x?xf32>, memref<?x?xf32>, memref<?x?xf32>) -> ()
+  // The rhs is also read by a non-library op, thus needs the row-major layout.
+  "lmhlo.abs"(%1, %3) : (memref<?x?xf32>, memref<?x?xf32>) -> ()
+  "disc_ral.send_output"(%arg0, %c0, %2) : (!disc_ral.context, index, memref<?x?xf32>) -> ()
+  "disc_ral.send_output"(%arg0, %c1, %3) : (!disc_ral.context, index, memref<?x?xf32>) -> ()
+  return
+}
@@ -0,0 +1,65 @@
+// RUN: disc-opt --disc-merge-cpu-launch -split-input-file %s | FileCheck %s
+
+func.func private @kernel_0(%arg0: !disc_ral.context, %arg1: index, %arg2: memref<?xf32>, %arg3: memref<?xf32>) attributes {disc_cpu_kernel_func}
+func.func private @kernel_1(%arg0: !disc_ral.context, %arg1: index, %arg2: memref<?xf32>, %arg3: memref<?xf32>) attributes {disc_cpu_kernel_func}
+func.func private @kernel_2(%arg0: !disc_ral.context, %arg1: index, %arg2: memref<?xf32>, %arg3: memref<?xf32>) attributes {disc_cpu_kernel_func}
+
+// CHECK-LABEL: @merge_chain
+func.func @merge_chain(%ctx: !disc_ral.context, %arg0: memref<?xf32>, %arg1: memref<?xf32>, %d: index) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %lb0 = memref.alloca() : memref<1xindex>
+  %ub0 = memref.alloca() : memref<1xindex>
+  %st0 = memref.alloca() : memref<1xindex>
+  memref.store %c0, %lb0[%c0] : memref<1xindex>
+  memref.store %d, %ub0[%c0] : memref<1xindex>
+  memref.store %c1, %st0[%c0] : memref<1xindex>
+  %0 = memref.alloc(%d) : memref<?xf32>
+  // CHECK: disc_ral.cpu_launch
+  // CHECK-SAME: callee = @kernel_0
+  // CHECK-SAME: disc.cpu.merge_with_next
+  "disc_ral.cpu_launch"(%ctx, %lb0, %ub0, %st0, %c1, %arg0, %0) {callee = @kernel_0} : (!disc_ral.context, memref<1xindex>, memref<1xindex>, memref<1xindex>, index, memref<?xf32>, memref<?xf32>) -> ()
+  %lb1 = memref.alloca() : memref<1xindex>
+  %ub1 = memref.alloca() : memref<1xindex>
+  %st1 = memref.alloca() : memref<1xindex>
+  memref.store %c0, %lb1[%c0] : memref<1xindex>
+  memref.store %d, %ub1[%c0] : memref<1xindex>
+  memref.store %c1, %st1[%c0] : memref<1xindex>
+  %1 = memref.alloc(%d) : memref<?xf32>
+  // CHECK: disc_ral.cpu_launch
+  // CHECK-SAME: callee = @kernel_1
+  // CHECK-SAME: disc.cpu.merge_with_next
+  "disc_ral.cpu_launch"(%ctx, %lb1, %ub1, %st1, %c1, %0, %1) {callee = @kernel_1} : (!disc_ral.context, memref<1xindex>, memref<1xindex>, memref<1xindex>, index, memref<?xf32>, memref<?xf32>) -> ()
+  // CHECK-NOT: memref.dealloc
+  memref.dealloc %0 : memref<?xf32>
+  // CHECK: disc_ral.cpu_launch
+  // CHECK-SAME: callee = @kernel_2
+  // CHECK-NOT: disc.cpu.merge_with_next
+  // CHECK-NEXT: memref.dealloc
+  // CHECK-NEXT: memref.dealloc
+  "disc_ral.cpu_launch"(%ctx, %lb1, %ub1, %st1, %c1, %1, %arg1) {callee = @kernel_2} : (!disc_ral.context, memref<1xindex>, memref<1xindex>, memref<1xindex>, index, memref<?xf32>, memref<?xf32>) -> ()
+  memref.dealloc %1 : memref<?xf32>
+  return
+}
+
+// -----
+
+func.func private @kernel_0(%arg0: !disc_ral.context, %arg1: index, %arg2: memref<?xf32>, %arg3: memref<?xf32>) attributes {disc_cpu_kernel_func}
+func.func private @kernel_1(%arg0: !disc_ral.context, %arg1: index, %arg2: memref<?xf32>, %arg3: memref<?xf32>) attributes {disc_cpu_kernel_func}
+
+// CHECK-LABEL: @host_read_in_between
+func.func @host_read_in_between(%ctx: !disc_ral.context, %arg0: memref<?xf32>, %arg1: memref<?xf32>, %lb: memref<1xindex>, %ub: memref<1xindex>, %st: memref<1xindex>) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  // CHECK: disc_ral.cpu_launch
+  // CHECK-NOT: disc.cpu.merge_with_next
+  // CHECK: memref.load
+  // CHECK: disc_ral.cpu_launch
+  // CHECK-NOT: disc.cpu.merge_with_next
+  "disc_ral.cpu_launch"(%ctx, %lb, %ub, %st, %c1, %arg0, %arg1) {callee = @kernel_0} : (!disc_ral.context, memref<1xindex>, memref<1xindex>, memref<1xindex>, index, memref<?xf32>, memref<?xf32>) -> ()
+  // The host reads the result of the first launch.
+  %0 = memref.load %arg1[%c0] : memref<?xf32>
+  memref.store %0, %arg0[%c0] : memref<?xf32>
+  "disc_ral.cpu_launch"(%ctx, %lb, %ub, %st, %c1, %arg0, %arg1) {callee = @kernel_1} : (!disc_ral.context, memref<1xindex>, memref<1xindex>, memref<1xindex>, index, memref<?xf32>, memref<?xf32>) -> ()
+  return
+}
@@ -35,4 +35,19 @@ module @main attributes {gpu.container_module}  {
     memref.dealloc %arg1 : memref<?x?xf32, "cpu">
     return
   }
-}
\ No newline at end of file
+}
+// -----
+
+// The buffer of an output is allocated by `ral_alloc_output`, which may hand
+// out the buffer provided by the caller.
+// CHECK-DAG: llvm.mlir.global internal constant @ral_alloc_output___cpu___pvoid_i64_i64___pvoid
+// CHECK-LABEL: test_ral_alloc_output
+module @main attributes {gpu.container_module}  {
+  func.func @test_ral_alloc_output(%arg0: !disc_ral.context) {
+    %c0 = arith.constant 0 : index
+    %c1024 = arith.constant 1024 : index
+    %0 = memref.alloc(%c1024) : memref<?xf32, "cpu">
+    "disc_ral.dispatch"(%arg0, %c0, %0) {backend_config = "", call_target_name = "ral_send_output", device = "cpu", has_side_effect = false} : (!disc_ral.context, index, memref<?xf32, "cpu">) -> ()
+    return
+  }
+}
@@ -0,0 +1,56 @@
+// RUN: disc-opt --disc-static-memory-plan -split-input-file %s | FileCheck %s
+
+// CHECK-LABEL: @basic_reuse
+// CHECK-SAME: (%[[ARG0:.*]]: memref<4x4xf32>, %[[ARG1:.*]]: memref<4x4xf32>)
+func.func @basic_reuse(%arg0 : memref<4x4xf32>, %arg1 : memref<4x4xf32>) {
+  // CHECK: %[[ARENA:.*]] = memref.alloc() {alignment = 128 : i64} : memref<256xi8>
+  // CHECK: %[[C0:.*]] = arith.constant 0 : index
+  // CHECK: %[[V0:.*]] = memref.view %[[ARENA]][%[[C0]]][] : memref<256xi8> to memref<4x4xf32>
+  // CHECK: "lmhlo.abs"(%[[ARG0]], %[[V0]])
+  // CHECK: %[[C128:.*]] = arith.constant 128 : index
+  // CHECK: %[[V1:.*]] = memref.view %[[ARENA]][%[[C128]]][] : memref<256xi8> to memref<4x4xf32>
+  // CHECK: "lmhlo.abs"(%[[V0]], %[[V1]])
+  // CHECK: %[[C0_1:.*]] = arith.constant 0 : index
+  // CHECK: %[[V2:.*]] = memref.view %[[ARENA]][%[[C0_1]]][] : memref<256xi8> to memref<4x4xf32>
+  // CHECK: "lmhlo.abs"(%[[V1]], %[[V2]])
+  // CHECK: "lmhlo.abs"(%[[V2]], %[[ARG1]])
+  // CHECK-NEXT: memref.dealloc %[[ARENA]] : memref<256xi8>
+  // CHECK-NOT: memref.dealloc
+  %0 = memref.alloc() : memref<4x4xf32>
+  "lmhlo.abs"(%arg0, %0) : (memref<4x4xf32>, memref<4x4xf32>) -> ()
+  %1 = memref.alloc() : memref<4x4xf32>
+  "lmhlo.abs"(%0, %1) : (memref<4x4xf32>, memref<4x4xf32>) -> ()
+  memref.dealloc %0 : memref<4x4xf32>
+  %2 = memref.alloc() : memref<4x4xf32>
+  "lmhlo.abs"(%1, %2) : (memref<4x4xf32>, memref<4x4xf32>) -> ()
+  memref.dealloc %1 : memref<4x4xf32>
+  "lmhlo.abs"(%2, %arg1) : (memref<4x4xf32>, memref<4x4xf32>) -> ()
+  memref.dealloc %2 : memref<4x4xf32>
+  return
+}
+
+// -----
+
+// CHECK-LABEL: @not_plannable
+func.func @not_plannable(%arg0 : memref<?xf32>, %arg1 : memref<4xf32>) -> memref<4xf32> {
+  // dynamic shape buffer is not planned.
+  // CHECK: %[[V0:.*]] = memref.alloc(%{{.*}}) : memref<?xf32>
+  %c0 = arith.constant 0 : index
+  %d0 = memref.dim %arg0, %c0 : memref<?xf32>
+  %0 = memref.alloc(%d0) : memref<?xf32>
+  "lmhlo.abs"(%arg0, %0) : (memref<?xf32>, memref<?xf32>) -> ()
+  // returned buffer is not planned.
+  // CHECK: %[[V1:.*]] = memref.alloc() : memref<4xf32>
+  %1 = memref.alloc() : memref<4xf32>
+  "lmhlo.abs"(%arg1, %1) : (memref<4xf32>, memref<4xf32>) -> ()
+  // a single plannable buffer is left as it is.
+  // CHECK: %[[V2:.*]] = memref.alloc() : memref<4xf32>
+  // CHECK-NOT: memref.view
+  %2 = memref.alloc() : memref<4xf32>
+  "lmhlo.abs"(%1, %2) : (memref<4xf32>, memref<4xf32>) -> ()
+  // CHECK: memref.dealloc %[[V0]]
+  // CHECK: memref.dealloc %[[V2]]
+  memref.dealloc %0 : memref<?xf32>
+  memref.dealloc %2 : memref<4xf32>
+  return %1 : memref<4xf32>
+}
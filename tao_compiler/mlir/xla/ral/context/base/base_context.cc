@@ -27,22 +27,27 @@ namespace tao {
 namespace ral {
 
 DEFINE_TAO_TYPE_NAME_HELPER(Eigen::half, "f16");
+DEFINE_TAO_TYPE_NAME_HELPER(Eigen::bfloat16, "bf16");
 
 BaseContext::BaseContext(BaseContextOption& opt) {
   getOrCreateResource(tao::ral::kRalGlobalConstantState, [opt, this]() {
     auto state = new tao::ral::RalGlobalConstantState;
 
-    if (discEnableGlobalConstantStore()) {
+    if (opt.use_process_level_const_store || discEnableGlobalConstantStore()) {
       state->process_level_store =
-          ConstStoreRegistrar::Instance().getConstStore(opt.metadata_file_path);
+          ConstStoreRegistrar::Instance().getConstStore(
+              opt.metadata_file_path, opt.metadata_data, opt.metadata_size);
       assert(state->process_level_store);
       return state;
     }
 
     // The metadata file is loaded once. The data will
     // be erased from metadata file once memcpy is done;
-    if ((state->metadata =
-             MetadataFile::loadFromFile(opt.metadata_file_path))) {
+    bool loaded = opt.metadata_data
+                      ? state->loadMetadataFromMemory(opt.metadata_data,
+                                                      opt.metadata_size)
+                      : state->loadMetadataFile(opt.metadata_file_path);
+    if (loaded) {
       return state;
     } else {
       delete state;
@@ -70,6 +75,18 @@ void BaseExecutionContext::bindInput(int input_idx, buffer_t buffer,
   input_ptr_set.insert(buffer);
 }
 
+void BaseExecutionContext::bindInput(int input_idx, buffer_t buffer,
+                                     const buffer_shape_t& shape,
+                                     const buffer_shape_t& strides) {
+  Tensor tensor;
+  tensor.buffer = buffer;
+  tensor.shape = shape;
+  if (!isRowMajorLayout(shape, strides)) tensor.strides = strides;
+
+  inputs.insert(std::make_pair(input_idx, tensor));
+  input_ptr_set.insert(buffer);
+}
+
 void BaseExecutionContext::bindOutput(
     int output_idx, std::unique_ptr<OutputBufferWrapper>* output) {
   auto it = outputs.find(output_idx);
@@ -91,9 +108,30 @@ void BaseExecutionContext::bindOutput(
     return;
   }
 
+  if (provided_output_ptr_set.count(it->second.buffer)) {
+    // This buffer is owned by the caller, thus no need to set a deleter.
+    return;
+  }
+
   setOutputDeleter(*(output->get()));
 }
 
+void BaseExecutionContext::bindOutputBuffer(int output_idx, buffer_t buffer,
+                                            size_t bytes) {
+  output_buffers[output_idx] = std::make_pair(buffer, bytes);
+}
+
+buffer_t BaseExecutionContext::takeOutputBuffer(int output_idx, size_t bytes) {
+  auto it = output_buffers.find(output_idx);
+  if (it == output_buffers.end() || it->second.second != bytes) {
+    return nullptr;
+  }
+  buffer_t buffer = it->second.first;
+  output_buffers.erase(it);
+  provided_output_ptr_set.insert(buffer);
+  return buffer;
+}
+
 InternalAllocator::InternalAllocator(alloc_t alloc_func, dealloc_t dealloc_func)
     : alloc_func_(alloc_func), dealloc_func_(dealloc_func) {}
 
@@ -145,6 +183,13 @@ tao::ral::MemRefType<T, N> ral_base_cuda_recv_input(ExecutionContext* ctx,
     return memref;
   }
   auto& tensor = it->second;
+  if (!tensor.strides.empty()) {
+    ctx->signalError(Context::FAILURE,
+                     "input #" + std::to_string(input_idx) +
+                         " is bound with a non-row-major layout, which is "
+                         "not accepted by the compiled module");
+    return memref;
+  }
 
   memref = assignMemRef<T, N>(tensor.buffer, tensor.shape);
 
@@ -155,6 +200,31 @@ tao::ral::MemRefType<T, N> ral_base_cuda_recv_input(ExecutionContext* ctx,
   return memref;
 }
 
+// Same as `ral_base_cuda_recv_input`, except that the input may be bound with
+// any layout, and the returned memref carries the bound strides.
+template <typename T, int N>
+tao::ral::MemRefType<T, N> ral_base_cuda_recv_strided_input(
+    ExecutionContext* ctx, int64_t input_idx) {
+  TAO_VLOG(1) << "ral_base_cuda_recv_strided_input for " << N << "d";
+  tao::ral::MemRefType<T, N> memref;
+
+  auto exec_ctx = dynamic_cast<BaseExecutionContext*>(ctx);
+  auto it = exec_ctx->inputs.find(input_idx);
+  if (it == exec_ctx->inputs.end()) {
+    ctx->signalError(Context::FAILURE, "invalid input index");
+    return memref;
+  }
+  auto& tensor = it->second;
+
+  memref = assignMemRef<T, N>(tensor.buffer, tensor.shape, tensor.strides);
+
+  if (TAO_VLOG_IS_ON(1)) {
+    tao::ral::print_memref(memref, "input");
+  }
+
+  return memref;
+}
+
 template <typename T>
 tao::ral::MemRefType<T, 0> ral_base_cuda_recv_input_0d(ExecutionContext* ctx,
                                                        int64_t input_idx) {
@@ -221,9 +291,13 @@ void ral_base_cuda_send_output_0d(ExecutionContext* ctx, int64_t output_idx,
 #define RAL_REGISTER_IO_FUNC(T, N)                                             \
   template tao::ral::MemRefType<T, N> ral_base_cuda_recv_input<T, N>(          \
       ExecutionContext * ctx, int64_t input_idx);                              \
+  template tao::ral::MemRefType<T, N> ral_base_cuda_recv_strided_input<T, N>(  \
+      ExecutionContext * ctx, int64_t input_idx);                              \
   template void ral_base_cuda_send_output<T, N>(                               \
       ExecutionContext * ctx, int64_t output_idx, tao::ral::MemRefType<T, N>); \
   TAO_RAL_API(tao::ral::kRalRecvInput, "cpu", ral_base_cuda_recv_input<T, N>); \
+  TAO_RAL_API(tao::ral::kRalRecvStridedInput, "cpu",                           \
+              ral_base_cuda_recv_strided_input<T, N>);                         \
   TAO_RAL_API(tao::ral::kRalSendOutput, "cpu", ral_base_cuda_send_output<T, N>);
 
 #define RAL_REGISTER_IO_FUNC_0D(T)                                             \
@@ -306,5 +380,14 @@ RAL_REGISTER_IO_FUNC(Eigen::half, 5);
 RAL_REGISTER_IO_FUNC(Eigen::half, 6);
 RAL_REGISTER_IO_FUNC(Eigen::half, 7);
 RAL_REGISTER_IO_FUNC(Eigen::half, 8);
+RAL_REGISTER_IO_FUNC_0D(Eigen::bfloat16);
+RAL_REGISTER_IO_FUNC(Eigen::bfloat16, 1);
+RAL_REGISTER_IO_FUNC(Eigen::bfloat16, 2);
+RAL_REGISTER_IO_FUNC(Eigen::bfloat16, 3);
+RAL_REGISTER_IO_FUNC(Eigen::bfloat16, 4);
+RAL_REGISTER_IO_FUNC(Eigen::bfloat16, 5);
+RAL_REGISTER_IO_FUNC(Eigen::bfloat16, 6);
+RAL_REGISTER_IO_FUNC(Eigen::bfloat16, 7);
+RAL_REGISTER_IO_FUNC(Eigen::bfloat16, 8);
 }  // namespace ral
 }  // namespace tao
@@ -21,6 +21,7 @@
 #include <map>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 
 #include "tensorflow/compiler/mlir/xla/ral/ral_base.h"
 #include "tensorflow/compiler/mlir/xla/ral/ral_context.h"
@@ -30,7 +31,17 @@ namespace ral {
 
 struct BaseContextOption {
   std::string metadata_file_path;
+  // If not null, the metadata is parsed from the `metadata_size` bytes at
+  // `metadata_data` instead of being loaded from `metadata_file_path`, which
+  // then only names the process level const store. The data should be alive
+  // while creating contexts.
+  const char* metadata_data = nullptr;
+  size_t metadata_size = 0;
   bool cache_workspace_mem_across_execution = false;
+  // Shares the constants with the other contexts loading the same metadata
+  // file (e.g. a pool of contexts of the same engine), see
+  // ConstStoreRegistrar. Always true if `DISC_USE_GLOBAL_CONST_STORE` is set.
+  bool use_process_level_const_store = false;
 };
 
 class BaseContext : public tao::ral::Context {
@@ -60,17 +71,31 @@ class BaseOutputBufferWrapper : public OutputBufferWrapper {
   void markOwned() override { owned_ = true; }
 
   // Release the ownership of the wrapper buffer.
-  // This requires that the buffer is owned by this wrapper.
+  // This requires that the buffer is owned or allocated by this wrapper.
   void release() override {
     deleter_ = nullptr;
     owned_ = false;
+    allocated_ = false;
   }
 
+  bool persistent() const override { return persistent_; }
+
+  // mark that the underlying buffer is a persistent buffer of the context.
+  void markPersistent() { persistent_ = true; }
+
+  bool allocated() const override { return allocated_; }
+
+  // mark that the underlying buffer is allocated by the allocator of the
+  // context and is freed by this wrapper.
+  void markAllocated() { allocated_ = true; }
+
  private:
   buffer_t data_;
   buffer_shape_t shape_;
   Deleter deleter_;
   bool owned_ = false;
+  bool persistent_ = false;
+  bool allocated_ = false;
 };
 
 class InternalAllocator : public Allocator {
@@ -92,6 +117,8 @@ class InternalAllocator : public Allocator {
 struct Tensor {
   void* buffer;
   std::vector<int64_t> shape;
+  // In elements. Empty for the row-major layout.
+  std::vector<int64_t> strides;
 };
 
 struct BaseExecutionContext : public tao::ral::ExecutionContext {
@@ -103,14 +130,26 @@ struct BaseExecutionContext : public tao::ral::ExecutionContext {
   // requirement.
   void bindInput(int input_idx, buffer_t buffer,
                  const buffer_shape_t& shape) override;
+  void bindInput(int input_idx, buffer_t buffer, const buffer_shape_t& shape,
+                 const buffer_shape_t& strides) override;
   void bindOutput(int output_idx,
                   std::unique_ptr<OutputBufferWrapper>* output) override;
+  void bindOutputBuffer(int output_idx, buffer_t buffer,
+                        size_t bytes) override;
+
+  // Returns the caller-provided buffer of the `output_idx`-th output if it has
+  // exactly `bytes` bytes, or nullptr otherwise. A buffer is taken only once.
+  buffer_t takeOutputBuffer(int output_idx, size_t bytes);
 
   // Record each input ptr. These ptrs will be used to tell if one output is
   // just i/o forwarding.
   std::unordered_set<const_buffer_t> input_ptr_set;
   // In case a same buffer is referred by multiple outputs.
   std::unordered_set<const_buffer_t> output_ptr_set;
+  // Caller-provided output buffers, which are not freed by the context.
+  std::unordered_map<int32_t, std::pair<buffer_t, size_t>> output_buffers;
+  // The caller-provided output buffers taken by the compiled module.
+  std::unordered_set<const_buffer_t> provided_output_ptr_set;
   // Input bindings
   std::unordered_map<int32_t, Tensor> inputs;
   // Output bindings
@@ -0,0 +1,363 @@
+// Copyright 2022 The BladeDISC Authors. All rights reserved.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/mlir/xla/ral/context/base/cpu/cpu_caching_allocator.h"
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/compiler/mlir/xla/ral/ral_logging.h"
+
+#ifndef ALIGN_BYTES
+#define ALIGN_BYTES 128
+#endif
+
+namespace tao {
+namespace ral {
+namespace cpu {
+
+namespace {
+
+// Each buffer is prefixed by a header. The header occupies `kHeaderBytes` to
+// keep the alignment of the underlying allocator.
+constexpr size_t kHeaderBytes = ALIGN_BYTES;
+constexpr uint64_t kHeaderMagic = 0x64697363636163ull;  // "disccac"
+constexpr int kLargeBufferClass = -1;
+
+struct BufferHeader {
+  uint64_t magic;
+  int64_t size_class;
+  size_t bytes;
+};
+static_assert(sizeof(BufferHeader) <= kHeaderBytes, "header too large");
+
+// The smallest size class. Four classes per power of two above it, thus the
+// internal fragmentation of a size class is bounded by 25%.
+constexpr int kMinClassBytesLog2 = 7;
+constexpr size_t kMinClassBytes = size_t(1) << kMinClassBytesLog2;
+constexpr int kNumClassesPerPow2Log2 = 2;
+constexpr int kNumClassesPerPow2 = 1 << kNumClassesPerPow2Log2;
+
+int sizeToClass(size_t bytes) {
+  if (bytes <= kMinClassBytes) return 0;
+  // 2^p < bytes <= 2^(p+1)
+  int p = 63 - __builtin_clzll(bytes - 1);
+  size_t base = size_t(1) << p;
+  size_t step = base >> kNumClassesPerPow2Log2;
+  int idx = (bytes - 1 - base) / step;
+  return (p - kMinClassBytesLog2) * kNumClassesPerPow2 + idx + 1;
+}
+
+size_t classToSize(int size_class) {
+  if (size_class == 0) return kMinClassBytes;
+  int p = (size_class - 1) / kNumClassesPerPow2 + kMinClassBytesLog2;
+  int idx = (size_class - 1) % kNumClassesPerPow2;
+  size_t base = size_t(1) << p;
+  return base + (idx + 1) * (base >> kNumClassesPerPow2Log2);
+}
+
+BufferHeader* getHeader(buffer_t buffer) {
+  return reinterpret_cast<BufferHeader*>(static_cast<char*>(buffer) -
+                                         kHeaderBytes);
+}
+
+std::atomic<uint64_t> nextAllocatorId{0};
+
+}  // namespace
+
+struct ThreadCachingAllocator::Depot {
+  using Magazine = std::vector<buffer_t>;
+
+  // Stats of a thread cache. Each field is only written by its owner thread
+  // and may be read by any thread.
+  struct Counters {
+    std::atomic<int64_t> num_allocs{0};
+    std::atomic<int64_t> num_thread_cache_hits{0};
+    std::atomic<int64_t> num_depot_hits{0};
+    std::atomic<int64_t> num_system_allocs{0};
+    std::atomic<int64_t> bytes_in_use{0};
+  };
+
+  struct Bin {
+    std::mutex mu;
+    std::vector<Magazine> magazines;
+  };
+
+  Depot(alloc_t alloc_func, dealloc_t dealloc_func,
+        ThreadCachingAllocatorOption opt)
+      : alloc_func(std::move(alloc_func)),
+        dealloc_func(std::move(dealloc_func)),
+        opt(opt),
+        num_classes(sizeToClass(opt.max_cached_buffer_bytes) + 1),
+        bins(new Bin[num_classes]) {}
+
+  buffer_t systemAlloc(int size_class, size_t bytes) {
+    char* base = static_cast<char*>(alloc_func(bytes + kHeaderBytes));
+    if (!base) return nullptr;
+    auto header = reinterpret_cast<BufferHeader*>(base);
+    header->magic = kHeaderMagic;
+    header->size_class = size_class;
+    header->bytes = bytes;
+    return base + kHeaderBytes;
+  }
+
+  void systemDealloc(buffer_t buffer) {
+    dealloc_func(reinterpret_cast<buffer_t>(getHeader(buffer)));
+  }
+
+  // Takes ownership of `magazine`. Buffers are returned to the system if the
+  // depot is closed or full.
+  void pushMagazine(int size_class, Magazine& magazine) {
+    int64_t bytes = classToSize(size_class) * magazine.size();
+    auto& bin = bins[size_class];
+    {
+      std::lock_guard<std::mutex> l(bin.mu);
+      if (!closed && cached_bytes + bytes <= opt.max_depot_cached_bytes) {
+        cached_bytes += bytes;
+        bin.magazines.emplace_back(std::move(magazine));
+        magazine.clear();
+        return;
+      }
+    }
+    for (buffer_t buffer : magazine) systemDealloc(buffer);
+    magazine.clear();
+  }
+
+  // Returns false if no magazine is available.
+  bool popMagazine(int size_class, Magazine& magazine) {
+    auto& bin = bins[size_class];
+    std::lock_guard<std::mutex> l(bin.mu);
+    if (bin.magazines.empty()) return false;
+    magazine = std::move(bin.magazines.back());
+    bin.magazines.pop_back();
+    cached_bytes -= classToSize(size_class) * magazine.size();
+    return true;
+  }
+
+  void releaseAll(bool close) {
+    for (int c = 0; c < num_classes; ++c) {
+      std::vector<Magazine> magazines;
+      {
+        std::lock_guard<std::mutex> l(bins[c].mu);
+        if (close) closed = true;
+        magazines.swap(bins[c].magazines);
+        for (auto& magazine : magazines) {
+          cached_bytes -= classToSize(c) * magazine.size();
+        }
+      }
+      for (auto& magazine : magazines) {
+        for (buffer_t buffer : magazine) systemDealloc(buffer);
+      }
+    }
+  }
+
+  alloc_t alloc_func;
+  dealloc_t dealloc_func;
+  ThreadCachingAllocatorOption opt;
+  int num_classes;
+  std::unique_ptr<Bin[]> bins;
+  std::atomic<int64_t> cached_bytes{0};
+  // Set when the allocator is destroyed. Thread caches that outlive the
+  // allocator return their buffers to the system directly afterwards.
+  std::atomic<bool> closed{false};
+  // Used to serve `bytes > max_cached_buffer_bytes` requests.
+  Counters large_buffer_counters;
+
+  // Live thread caches and the accumulated stats of the exited ones.
+  std::mutex threads_mu;
+  std::unordered_set<ThreadCache*> threads;
+  ThreadCachingAllocatorStats retired;
+};
+
+struct ThreadCachingAllocator::ThreadCache {
+  explicit ThreadCache(std::shared_ptr<Depot> depot)
+      : depot(std::move(depot)), bins(this->depot->num_classes) {
+    std::lock_guard<std::mutex> l(this->depot->threads_mu);
+    this->depot->threads.insert(this);
+  }
+
+  ~ThreadCache() {
+    for (int c = 0; c < depot->num_classes; ++c) {
+      if (bins[c].empty()) continue;
+      cached_bytes -= classToSize(c) * bins[c].size();
+      depot->pushMagazine(c, bins[c]);
+    }
+    std::lock_guard<std::mutex> l(depot->threads_mu);
+    depot->threads.erase(this);
+    accumulate(depot->retired);
+  }
+
+  // Moves the most recently cached `magazine_size` buffers to the depot.
+  void flushMagazine(int size_class) {
+    auto& bin = bins[size_class];
+    int n = std::min<int>(depot->opt.magazine_size, bin.size());
+    Depot::Magazine magazine(bin.end() - n, bin.end());
+    bin.resize(bin.size() - n);
+    cached_bytes -= classToSize(size_class) * n;
+    depot->pushMagazine(size_class, magazine);
+  }
+
+  void accumulate(ThreadCachingAllocatorStats& stats) const {
+    stats.num_allocs += counters.num_allocs;
+    stats.num_thread_cache_hits += counters.num_thread_cache_hits;
+    stats.num_depot_hits += counters.num_depot_hits;
+    stats.num_system_allocs += counters.num_system_allocs;
+    stats.bytes_in_use += counters.bytes_in_use;
+    stats.bytes_cached += cached_bytes;
+  }
+
+  std::shared_ptr<Depot> depot;
+  std::vector<Depot::Magazine> bins;
+  std::atomic<int64_t> cached_bytes{0};
+  Depot::Counters counters;
+};
+
+namespace {
+
+// Thread caches of all the allocators used by the current thread. A thread
+// typically uses one or two allocators, thus a linear scan is enough.
+struct ThreadCacheRegistry {
+  std::vector<std::pair<uint64_t,
+                        std::unique_ptr<ThreadCachingAllocator::ThreadCache>>>
+      entries;
+};
+
+thread_local ThreadCacheRegistry threadCacheRegistry;
+
+inline void incr(std::atomic<int64_t>& counter, int64_t delta = 1) {
+  // Only the owner thread writes the counter, no need for a atomic rmw.
+  counter.store(counter.load(std::memory_order_relaxed) + delta,
+                std::memory_order_relaxed);
+}
+
+}  // namespace
+
+ThreadCachingAllocator::ThreadCachingAllocator(alloc_t alloc_func,
+                                               dealloc_t dealloc_func,
+                                               ThreadCachingAllocatorOption opt)
+    : id_(nextAllocatorId++),
+      depot_(std::make_shared<Depot>(std::move(alloc_func),
+                                     std::move(dealloc_func), opt)) {}
+
+ThreadCachingAllocator::~ThreadCachingAllocator() {
+  depot_->releaseAll(/* close */ true);
+  // The cache of the current thread can be released eagerly. Caches of other
+  // threads are released when those threads exit or touch another allocator.
+  auto& entries = threadCacheRegistry.entries;
+  entries.erase(std::remove_if(entries.begin(), entries.end(),
+                               [&](const auto& entry) {
+                                 return entry.first == id_;
+                               }),
+                entries.end());
+}
+
+ThreadCachingAllocator::ThreadCache* ThreadCachingAllocator::getThreadCache() {
+  auto& entries = threadCacheRegistry.entries;
+  for (auto& entry : entries) {
+    if (entry.first == id_) return entry.second.get();
+  }
+  // Drops the caches of the allocators that have been destroyed.
+  entries.erase(std::remove_if(entries.begin(), entries.end(),
+                               [](const auto& entry) {
+                                 return entry.second->depot->closed.load();
+                               }),
+                entries.end());
+  entries.emplace_back(id_, std::unique_ptr<ThreadCache>(new ThreadCache(depot_)));
+  return entries.back().second.get();
+}
+
+buffer_t ThreadCachingAllocator::alloc(size_t bytes) {
+  if (bytes > depot_->opt.max_cached_buffer_bytes) {
+    auto& counters = depot_->large_buffer_counters;
+    counters.num_allocs.fetch_add(1, std::memory_order_relaxed);
+    counters.num_system_allocs.fetch_add(1, std::memory_order_relaxed);
+    counters.bytes_in_use.fetch_add(bytes, std::memory_order_relaxed);
+    return depot_->systemAlloc(kLargeBufferClass, bytes);
+  }
+
+  int size_class = sizeToClass(bytes);
+  size_t class_bytes = classToSize(size_class);
+  ThreadCache* cache = getThreadCache();
+  auto& bin = cache->bins[size_class];
+  incr(cache->counters.num_allocs);
+  incr(cache->counters.bytes_in_use, class_bytes);
+  if (!bin.empty()) {
+    incr(cache->counters.num_thread_cache_hits);
+  } else if (depot_->popMagazine(size_class, bin)) {
+    incr(cache->counters.num_depot_hits);
+    incr(cache->cached_bytes, class_bytes * bin.size());
+  } else {
+    incr(cache->counters.num_system_allocs);
+    return depot_->systemAlloc(size_class, class_bytes);
+  }
+  buffer_t buffer = bin.back();
+  bin.pop_back();
+  incr(cache->cached_bytes, -static_cast<int64_t>(class_bytes));
+  return buffer;
+}
+
+void ThreadCachingAllocator::dealloc(buffer_t buffer) {
+  if (!buffer) return;
+  BufferHeader* header = getHeader(buffer);
+  TAO_CHECK(header->magic == kHeaderMagic)
+      << "buffer " << buffer << " is not allocated by ThreadCachingAllocator";
+
+  if (header->size_class == kLargeBufferClass) {
+    depot_->large_buffer_counters.bytes_in_use.fetch_sub(
+        header->bytes, std::memory_order_relaxed);
+    depot_->systemDealloc(buffer);
+    return;
+  }
+
+  int size_class = header->size_class;
+  size_t class_bytes = header->bytes;
+  ThreadCache* cache = getThreadCache();
+  auto& bin = cache->bins[size_class];
+  incr(cache->counters.bytes_in_use, -static_cast<int64_t>(class_bytes));
+  if (bin.size() >= 2 * depot_->opt.magazine_size) {
+    cache->flushMagazine(size_class);
+  }
+  if (cache->cached_bytes + class_bytes >
+      depot_->opt.max_thread_cached_bytes) {
+    depot_->systemDealloc(buffer);
+    return;
+  }
+  bin.push_back(buffer);
+  incr(cache->cached_bytes, class_bytes);
+}
+
+void ThreadCachingAllocator::releaseAllFreeBuffers() {
+  depot_->releaseAll(/* close */ false);
+}
+
+ThreadCachingAllocatorStats ThreadCachingAllocator::getStats() const {
+  ThreadCachingAllocatorStats stats;
+  {
+    std::lock_guard<std::mutex> l(depot_->threads_mu);
+    stats = depot_->retired;
+    for (ThreadCache* cache : depot_->threads) {
+      cache->accumulate(stats);
+    }
+  }
+  auto& large = depot_->large_buffer_counters;
+  stats.num_allocs += large.num_allocs;
+  stats.num_system_allocs += large.num_system_allocs;
+  stats.bytes_in_use += large.bytes_in_use;
+  stats.bytes_cached += depot_->cached_bytes;
+  return stats;
+}
+
+}  // namespace cpu
+}  // namespace ral
+}  // namespace tao
@@ -0,0 +1,103 @@
+// Copyright 2022 The BladeDISC Authors. All rights reserved.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RAL_CONTEXT_BASE_CPU_CPU_CACHING_ALLOCATOR_H_
+#define RAL_CONTEXT_BASE_CPU_CPU_CACHING_ALLOCATOR_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "tensorflow/compiler/mlir/xla/ral/ral_base.h"
+
+namespace tao {
+namespace ral {
+namespace cpu {
+
+struct ThreadCachingAllocatorOption {
+  // Requests larger than this are forwarded to the underlying alloc/dealloc
+  // functions directly and never cached.
+  size_t max_cached_buffer_bytes = 64ll * 1024 * 1024;
+  // Number of buffers moved between a thread cache and the shared depot at a
+  // time. A thread keeps at most two magazines per size class.
+  int magazine_size = 16;
+  // Upper bound of the bytes cached by a single thread.
+  size_t max_thread_cached_bytes = 128ll * 1024 * 1024;
+  // Upper bound of the bytes cached by the shared depot.
+  size_t max_depot_cached_bytes = 1024ll * 1024 * 1024;
+};
+
+struct ThreadCachingAllocatorStats {
+  // total number of `alloc` calls.
+  int64_t num_allocs = 0;
+  // number of `alloc` calls served by the calling thread's own cache.
+  int64_t num_thread_cache_hits = 0;
+  // number of `alloc` calls served by a magazine taken from the depot.
+  int64_t num_depot_hits = 0;
+  // number of `alloc` calls that reached the underlying alloc function.
+  int64_t num_system_allocs = 0;
+  // bytes currently cached by all thread caches and the depot.
+  int64_t bytes_cached = 0;
+  // bytes currently handed out to the users of this allocator.
+  int64_t bytes_in_use = 0;
+
+  double hitRate() const {
+    return num_allocs
+               ? double(num_thread_cache_hits + num_depot_hits) / num_allocs
+               : 0.0;
+  }
+};
+
+// A cpu allocator designed to be shared by many concurrent executions.
+//
+// Requests are rounded up to a size class (four classes per power of two).
+// Each thread owns a small cache (two magazines) per size class, thus most
+// alloc/dealloc pairs do not take any lock. Full or empty magazines are
+// exchanged with a shared depot protected by a per-size-class mutex.
+//
+// Each buffer is prefixed with a header (ALIGN_BYTES bytes, thus alignment is
+// kept) which records its size class. As a result, a buffer returned by this
+// allocator must be released by this allocator, never by the underlying
+// dealloc function directly. Thread caches may outlive the allocator, thus
+// `alloc_func` and `dealloc_func` should not capture any short-lived state.
+class ThreadCachingAllocator : public Allocator {
+ public:
+  ThreadCachingAllocator(alloc_t alloc_func, dealloc_t dealloc_func,
+                         ThreadCachingAllocatorOption opt = {});
+  ~ThreadCachingAllocator();
+
+  buffer_t alloc(size_t bytes) override;
+  void dealloc(buffer_t buffer) override;
+  // Returns the buffers cached in the depot to the underlying allocator.
+  // Buffers cached by thread caches are kept since they are owned by other
+  // threads. They are bounded by `max_thread_cached_bytes` per thread and are
+  // returned when their owner threads exit.
+  void releaseAllFreeBuffers() override;
+  bool isThreadSafe() const override { return true; }
+
+  ThreadCachingAllocatorStats getStats() const;
+
+  struct Depot;
+  struct ThreadCache;
+
+ private:
+  ThreadCache* getThreadCache();
+
+  uint64_t id_;
+  std::shared_ptr<Depot> depot_;
+};
+
+}  // namespace cpu
+}  // namespace ral
+}  // namespace tao
+
+#endif  // RAL_CONTEXT_BASE_CPU_CPU_CACHING_ALLOCATOR_H_
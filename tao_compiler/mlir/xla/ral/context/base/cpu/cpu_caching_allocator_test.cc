@@ -0,0 +1,137 @@
+// Copyright 2022 The BladeDISC Authors. All rights reserved.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/mlir/xla/ral/context/base/cpu/cpu_caching_allocator.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "tensorflow/core/platform/test.h"
+
+namespace tao {
+namespace ral {
+namespace cpu {
+
+namespace {
+
+std::atomic<int64_t> numLiveSystemBuffers{0};
+
+buffer_t countingAlloc(size_t bytes) {
+  ++numLiveSystemBuffers;
+  void* ptr = nullptr;
+  posix_memalign(&ptr, 128, bytes);
+  return ptr;
+}
+
+void countingDealloc(buffer_t buffer) {
+  --numLiveSystemBuffers;
+  std::free(buffer);
+}
+
+}  // namespace
+
+TEST(ThreadCachingAllocatorTest, ReuseInSameThread) {
+  {
+    ThreadCachingAllocator allocator(countingAlloc, countingDealloc);
+    buffer_t a = allocator.alloc(1000);
+    ASSERT_TRUE(a != nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(a) % 128, 0);
+    std::memset(a, 0, 1000);
+    allocator.dealloc(a);
+    // 1000 and 1010 fall into the same size class.
+    buffer_t b = allocator.alloc(1010);
+    EXPECT_EQ(a, b);
+    allocator.dealloc(b);
+
+    auto stats = allocator.getStats();
+    EXPECT_EQ(stats.num_allocs, 2);
+    EXPECT_EQ(stats.num_thread_cache_hits, 1);
+    EXPECT_EQ(stats.num_system_allocs, 1);
+    EXPECT_EQ(stats.bytes_in_use, 0);
+    EXPECT_GE(stats.bytes_cached, 1010);
+    EXPECT_DOUBLE_EQ(stats.hitRate(), 0.5);
+  }
+  // The cache of the destroying thread is released eagerly.
+  EXPECT_EQ(numLiveSystemBuffers, 0);
+}
+
+TEST(ThreadCachingAllocatorTest, LargeBufferIsNotCached) {
+  ThreadCachingAllocatorOption opt;
+  opt.max_cached_buffer_bytes = 4096;
+  ThreadCachingAllocator allocator(countingAlloc, countingDealloc, opt);
+  int64_t num_live = numLiveSystemBuffers;
+  buffer_t a = allocator.alloc(8192);
+  EXPECT_EQ(numLiveSystemBuffers, num_live + 1);
+  allocator.dealloc(a);
+  EXPECT_EQ(numLiveSystemBuffers, num_live);
+  EXPECT_EQ(allocator.getStats().bytes_cached, 0);
+}
+
+TEST(ThreadCachingAllocatorTest, CrossThreadDeallocGoesThroughDepot) {
+  ThreadCachingAllocatorOption opt;
+  opt.magazine_size = 4;
+  ThreadCachingAllocator allocator(countingAlloc, countingDealloc, opt);
+  constexpr int kNumBuffers = 64;
+  std::vector<buffer_t> buffers;
+  for (int i = 0; i < kNumBuffers; ++i) {
+    buffers.push_back(allocator.alloc(256));
+  }
+  // Frees on another thread, the thread cache is returned to the depot when
+  // the thread exits.
+  std::thread([&] {
+    for (buffer_t buffer : buffers) allocator.dealloc(buffer);
+  }).join();
+
+  for (int i = 0; i < kNumBuffers; ++i) {
+    buffers[i] = allocator.alloc(256);
+  }
+  auto stats = allocator.getStats();
+  EXPECT_EQ(stats.num_system_allocs, kNumBuffers);
+  EXPECT_GT(stats.num_depot_hits, 0);
+  for (buffer_t buffer : buffers) allocator.dealloc(buffer);
+}
+
+TEST(ThreadCachingAllocatorTest, ConcurrentAllocDealloc) {
+  {
+    ThreadCachingAllocator allocator(countingAlloc, countingDealloc);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+      threads.emplace_back([&allocator, t] {
+        std::vector<buffer_t> live;
+        for (int i = 0; i < 1000; ++i) {
+          size_t bytes = 64 + ((i * 37 + t) % 4096);
+          buffer_t buffer = allocator.alloc(bytes);
+          std::memset(buffer, t, bytes);
+          live.push_back(buffer);
+          if (live.size() > 16) {
+            allocator.dealloc(live.front());
+            live.erase(live.begin());
+          }
+        }
+        for (buffer_t buffer : live) allocator.dealloc(buffer);
+      });
+    }
+    for (auto& thread : threads) thread.join();
+    auto stats = allocator.getStats();
+    EXPECT_EQ(stats.num_allocs, 8000);
+    EXPECT_EQ(stats.bytes_in_use, 0);
+    allocator.releaseAllFreeBuffers();
+  }
+  // Caches of the worker threads are flushed when the threads exit.
+  EXPECT_EQ(numLiveSystemBuffers, 0);
+}
+
+}  // namespace cpu
+}  // namespace ral
+}  // namespace tao
@@ -16,6 +16,7 @@
 // ============================================================================
 #include "tensorflow/compiler/mlir/xla/ral/context/base/cpu/cpu_context_impl.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <fstream>
@@ -26,6 +27,7 @@
 #include <unordered_set>
 #include <vector>
 
+#include "tensorflow/compiler/mlir/xla/ral/context/base/cpu/cpu_caching_allocator.h"
 #include "tensorflow/compiler/mlir/xla/ral/context/common_context_impl.h"
 #include "tensorflow/compiler/mlir/xla/ral/context/context_util.h"
 #include "tensorflow/compiler/mlir/xla/ral/ral_driver.h"
@@ -40,23 +42,46 @@ buffer_t cpu_alloc(size_t bytes) { return tao::ral::aligned_malloc(bytes); }
 
 void cpu_dealloc(buffer_t buffer) { std::free(buffer); }
 
+namespace {
+
+bool initUseThreadCachingAllocator() {
+  const char* env = getenv("DISC_CPU_USE_THREAD_CACHING_ALLOCATOR");
+  if (!env) return false;
+  std::string envStr = env;
+  std::transform(envStr.begin(), envStr.end(), envStr.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return envStr == "true" || envStr == "1";
+}
+
+bool useThreadCachingAllocator() {
+  static bool enabled = initUseThreadCachingAllocator();
+  return enabled;
+}
+
+}  // namespace
+
 struct BaseCpuContextState : public tao::ral::Context::Resource {
   std::mutex mu;
   std::shared_ptr<Allocator> cpu_allocator;
+  // If true, `cpu_allocator` is called without holding `mu`.
+  bool allocator_thread_safe = false;
   bool cache_workspace_mem_across_execution;
 
   // buffers which are supposed to used across executions.
   std::unordered_set<const_buffer_t> host_persistent_buffers;
+  // subset of `host_persistent_buffers` which are not allocated by us (e.g.
+  // consts mapped from the const blob file), thus never freed by us.
+  std::unordered_set<const_buffer_t> host_external_persistent_buffers;
 
   void onExecutionFinish(ExecutionContext* ctx) override {
+    if (cache_workspace_mem_across_execution) return;
     std::lock_guard<std::mutex> lock(this->mu);
-    if (!cache_workspace_mem_across_execution) {
-      cpu_allocator->releaseAllFreeBuffers();
-    }
+    cpu_allocator->releaseAllFreeBuffers();
   }
 
   void onContextFinish(Context* ctx) override {
     for (const_buffer_t buffer : host_persistent_buffers) {
+      if (host_external_persistent_buffers.count(buffer)) continue;
       cpu_allocator->dealloc(const_cast<buffer_t>(buffer));
     }
   }
@@ -75,15 +100,26 @@ std::unique_ptr<BaseContext> MakeBaseCpuContext(BaseContextOption& opt,
     auto state = new BaseCpuContextState;
     if (cpu_opt.cpu_allocator != nullptr) {
       state->cpu_allocator = cpu_opt.cpu_allocator;
+    } else if (useThreadCachingAllocator()) {
+      state->cpu_allocator.reset(
+          new ThreadCachingAllocator(cpu_alloc, cpu_dealloc));
     } else {
       state->cpu_allocator.reset(new InternalAllocator(cpu_alloc, cpu_dealloc));
     }
+    state->allocator_thread_safe = state->cpu_allocator->isThreadSafe();
     state->cache_workspace_mem_across_execution =
         opt.cache_workspace_mem_across_execution;
 
     return state;
   });
 
+  ctx->getOrCreateResource(kRalCpuLaunchState, [cpu_opt]() {
+    auto state = new CpuLaunchState;
+    state->backend = cpu_opt.launch_backend;
+    state->max_concurrency = cpu_opt.launch_max_concurrency;
+    return state;
+  });
+
   return ctx;
 }
 
@@ -98,17 +134,23 @@ void BaseCpuExecutionContext::setOutputDeleter(OutputBufferWrapper& output) {
   const_buffer_t buffer = output.data();
   if (state->host_persistent_buffers.count(buffer)) {
     // This buffer is a pesistent buffer, thus no need to set a deleter.
+    static_cast<BaseOutputBufferWrapper*>(&output)->markPersistent();
     return;
   }
 
   auto hid = host_ptr_map.find(buffer);
   if (hid != host_ptr_map.end()) {
     if (--hid->second == 0) {
-      static_cast<BaseOutputBufferWrapper*>(&output)->set_deleter(
-          [state](buffer_t data) {
-            std::lock_guard<std::mutex> lock(state->mu);
-            state->cpu_allocator->dealloc(data);
-          });
+      auto* wrapper = static_cast<BaseOutputBufferWrapper*>(&output);
+      wrapper->set_deleter([state](buffer_t data) {
+        if (state->allocator_thread_safe) {
+          state->cpu_allocator->dealloc(data);
+          return;
+        }
+        std::lock_guard<std::mutex> lock(state->mu);
+        state->cpu_allocator->dealloc(data);
+      });
+      wrapper->markAllocated();
     }
     if (outputSharedOrder[output.data()] == 1) {
       output.markOwned();
@@ -130,7 +172,10 @@ buffer_t ral_base_cpu_alloc(ExecutionContext* ctx, size_t bytes) {
   auto* state = ctx->getResource<BaseCpuContextState>(kRalBaseCpuContextState);
   auto exec_ctx = dynamic_cast<BaseCpuExecutionContext*>(ctx);
 
-  std::lock_guard<std::mutex> lock(state->mu);
+  // `host_ptr_map` is owned by the execution context, thus the lock is only
+  // needed to protect an allocator that is not thread-safe.
+  std::unique_lock<std::mutex> lock(state->mu, std::defer_lock);
+  if (!state->allocator_thread_safe) lock.lock();
   TAO_VLOG(1) << "before ral_base_cpu_alloc alloc " << bytes;
   bytes = (bytes ? bytes : 1);
   void* ptr = state->cpu_allocator->alloc(bytes);
@@ -139,6 +184,21 @@ buffer_t ral_base_cpu_alloc(ExecutionContext* ctx, size_t bytes) {
   return ptr;
 }
 
+// Allocates the buffer of the `output_idx`-th output, which is the buffer
+// provided by the caller if it has exactly `bytes` bytes.
+buffer_t ral_base_cpu_alloc_output(ExecutionContext* ctx, int64_t output_idx,
+                                   size_t bytes) {
+  auto exec_ctx = dynamic_cast<BaseCpuExecutionContext*>(ctx);
+  buffer_t ptr = exec_ctx->takeOutputBuffer(output_idx, bytes);
+  if (!ptr) return ral_base_cpu_alloc(ctx, bytes);
+  TAO_VLOG(1) << "ral_base_cpu_alloc_output: use the provided buffer " << ptr
+              << " for output #" << output_idx;
+  // Starts from two, thus the buffer is never freed by the context, the
+  // same as borrowed inputs.
+  exec_ctx->host_ptr_map.insert(std::make_pair(ptr, 2));
+  return ptr;
+}
+
 buffer_t ral_base_cpu_alloc_persistent(ExecutionContext* ctx, size_t bytes) {
   auto* state = ctx->getResource<BaseCpuContextState>(kRalBaseCpuContextState);
 
@@ -151,6 +211,15 @@ buffer_t ral_base_cpu_alloc_persistent(ExecutionContext* ctx, size_t bytes) {
   return ptr;
 }
 
+void ral_base_cpu_register_persistent(ExecutionContext* ctx, buffer_t ptr) {
+  auto* state = ctx->getResource<BaseCpuContextState>(kRalBaseCpuContextState);
+
+  std::lock_guard<std::mutex> lock(state->mu);
+  state->host_persistent_buffers.insert(ptr);
+  state->host_external_persistent_buffers.insert(ptr);
+  TAO_VLOG(1) << "ral_base_cpu_register_persistent with ptr = " << ptr;
+}
+
 void ral_base_cpu_dealloc(ExecutionContext* ctx, buffer_t buffer) {
   if (!buffer) {
     TAO_VLOG(1) << "ral_base_cpu_dealloc early return for nullptr";
@@ -160,7 +229,20 @@ void ral_base_cpu_dealloc(ExecutionContext* ctx, buffer_t buffer) {
   auto* state = ctx->getResource<BaseCpuContextState>(kRalBaseCpuContextState);
   auto exec_ctx = dynamic_cast<BaseCpuExecutionContext*>(ctx);
 
-  std::lock_guard<std::mutex> lock(state->mu);
+  std::unique_lock<std::mutex> lock(state->mu, std::defer_lock);
+  if (state->allocator_thread_safe) {
+    // Persistent buffers only show up in `host_ptr_map` when borrowed by
+    // `ral_base_cpu_bitcast`, in which case their ref count starts from two
+    // (the same as borrowed inputs) and never drops to zero. Thus there is no
+    // need to look up `host_persistent_buffers` under the lock here.
+    auto it = exec_ctx->host_ptr_map.find(buffer);
+    if (it != exec_ctx->host_ptr_map.end() && --it->second == 0) {
+      exec_ctx->host_ptr_map.erase(it);
+      state->cpu_allocator->dealloc(buffer);
+    }
+    return;
+  }
+  lock.lock();
 
   // ignore persistent buffer.
   if (state->host_persistent_buffers.count(buffer)) {
@@ -210,6 +292,9 @@ void ral_base_cpu_raw_dealloc(Context* ctx, buffer_t buffer) {
 TAO_RAL_API(tao::ral::cpu::kRalCpuAlloc, "cpu", ral_base_cpu_alloc);
 TAO_RAL_API(tao::ral::cpu::kRalCpuAllocPersistent, "cpu",
             ral_base_cpu_alloc_persistent);
+TAO_RAL_API(tao::ral::cpu::kRalCpuRegisterPersistent, "cpu",
+            ral_base_cpu_register_persistent);
+TAO_RAL_API(tao::ral::kRalAllocOutput, "cpu", ral_base_cpu_alloc_output);
 TAO_RAL_API(tao::ral::cpu::kRalCpuDealloc, "cpu", ral_base_cpu_dealloc);
 TAO_RAL_API(tao::ral::cpu::kRalCpuRawAlloc, "cpu", ral_base_cpu_raw_alloc);
 TAO_RAL_API(tao::ral::cpu::kRalCpuRawDealloc, "cpu", ral_base_cpu_raw_dealloc);
@@ -430,4 +515,28 @@ RAL_REGISTER_BITCAST_FUNC(Eigen::half, 8);
 }  // namespace cpu
 }  // namespace ral
 }  // namespace tao
+#else
+#include "third_party/eigen3/Eigen/Core"
+namespace tao {
+namespace ral {
+// Defined in stream_executor_based_impl.h when using stream executor.
+DEFINE_TAO_TYPE_NAME_HELPER(Eigen::bfloat16, "bf16");
+}  // namespace ral
+}  // namespace tao
 #endif  // TAO_RAL_USE_STREAM_EXECUTOR
+
+namespace tao {
+namespace ral {
+namespace cpu {
+RAL_REGISTER_BITCAST_FUNC_0D(Eigen::bfloat16);
+RAL_REGISTER_BITCAST_FUNC(Eigen::bfloat16, 1);
+RAL_REGISTER_BITCAST_FUNC(Eigen::bfloat16, 2);
+RAL_REGISTER_BITCAST_FUNC(Eigen::bfloat16, 3);
+RAL_REGISTER_BITCAST_FUNC(Eigen::bfloat16, 4);
+RAL_REGISTER_BITCAST_FUNC(Eigen::bfloat16, 5);
+RAL_REGISTER_BITCAST_FUNC(Eigen::bfloat16, 6);
+RAL_REGISTER_BITCAST_FUNC(Eigen::bfloat16, 7);
+RAL_REGISTER_BITCAST_FUNC(Eigen::bfloat16, 8);
+}  // namespace cpu
+}  // namespace ral
+}  // namespace tao
@@ -19,6 +19,7 @@
 #define RAL_CONTEXT_BASE_CPU_CPU_CONTEXT_IMPL_H_
 
 #include "tensorflow/compiler/mlir/xla/ral/context/base/base_context.h"
+#include "tensorflow/compiler/mlir/xla/ral/context/common_context_impl.h"
 #include "tensorflow/compiler/mlir/xla/ral/device/cpu/cpu_driver.h"
 #include "tensorflow/compiler/mlir/xla/ral/ral_context.h"
 
@@ -30,6 +31,11 @@ void cpu_dealloc(buffer_t buffer);
 
 struct BaseCpuContextOption {
   std::shared_ptr<Allocator> cpu_allocator;
+  // The backend to run the parallel loops of cpu kernels.
+  CpuLaunchBackend launch_backend = getDefaultCpuLaunchBackend();
+  // The maximum number of threads a kernel launch uses, zero for all the
+  // available cores. Only used by the thread pool backend.
+  int launch_max_concurrency = 0;
 };
 
 std::unique_ptr<BaseContext> MakeBaseCpuContext(BaseContextOption& opt,
@@ -211,17 +211,19 @@ void BaseCudaExecutionContext::setOutputDeleter(OutputBufferWrapper& output) {
     const_buffer_t buffer = output.data();
     if (state->device_persistent_buffers.count(buffer)) {
       // This buffer is a pesistent buffer, thus no need to set a deleter.
+      static_cast<BaseOutputBufferWrapper*>(&output)->markPersistent();
       return;
     }
 
     auto dit = device_ptr_map.find(buffer);
     if (dit != device_ptr_map.end()) {
       if (--dit->second == 0) {
-        static_cast<BaseOutputBufferWrapper*>(&output)->set_deleter(
-            [state](buffer_t data) {
-              std::lock_guard<std::mutex> lock(state->mu);
-              state->gpu_allocator->dealloc(data);
-            });
+        auto* wrapper = static_cast<BaseOutputBufferWrapper*>(&output);
+        wrapper->set_deleter([state](buffer_t data) {
+          std::lock_guard<std::mutex> lock(state->mu);
+          state->gpu_allocator->dealloc(data);
+        });
+        wrapper->markAllocated();
       }
       if (outputSharedOrder[output.data()] == 1) {
         output.markOwned();
@@ -250,6 +252,23 @@ buffer_t ral_base_cuda_alloc(ExecutionContext* ctx, size_t bytes) {
   return ptr;
 }
 
+// Allocates the buffer of the `output_idx`-th output, which is the buffer
+// provided by the caller if it has exactly `bytes` bytes.
+buffer_t ral_base_cuda_alloc_output(ExecutionContext* ctx, int64_t output_idx,
+                                    size_t bytes) {
+  auto exec_ctx = dynamic_cast<BaseCudaExecutionContext*>(ctx);
+  buffer_t ptr = exec_ctx->takeOutputBuffer(output_idx, bytes);
+  if (!ptr) return ral_base_cuda_alloc(ctx, bytes);
+  TAO_VLOG(1) << "ral_base_cuda_alloc_output: use the provided buffer " << ptr
+              << " for output #" << output_idx;
+  auto* state =
+      ctx->getResource<BaseCudaContextState>(kRalBaseCudaContextState);
+  std::lock_guard<std::mutex> lock(state->mu);
+  // Starts from two, thus the buffer is never freed by the context.
+  exec_ctx->device_ptr_map.insert(std::make_pair(ptr, 2));
+  return ptr;
+}
+
 buffer_t ral_base_cuda_alloc_persistent(ExecutionContext* ctx, size_t bytes) {
   auto* state =
       ctx->getResource<BaseCudaContextState>(kRalBaseCudaContextState);
@@ -661,6 +680,14 @@ RAL_REGISTER_BITCAST_FUNC(Eigen::half, 5);
 RAL_REGISTER_BITCAST_FUNC(Eigen::half, 6);
 RAL_REGISTER_BITCAST_FUNC(Eigen::half, 7);
 RAL_REGISTER_BITCAST_FUNC(Eigen::half, 8);
+RAL_REGISTER_BITCAST_FUNC(Eigen::bfloat16, 1);
+RAL_REGISTER_BITCAST_FUNC(Eigen::bfloat16, 2);
+RAL_REGISTER_BITCAST_FUNC(Eigen::bfloat16, 3);
+RAL_REGISTER_BITCAST_FUNC(Eigen::bfloat16, 4);
+RAL_REGISTER_BITCAST_FUNC(Eigen::bfloat16, 5);
+RAL_REGISTER_BITCAST_FUNC(Eigen::bfloat16, 6);
+RAL_REGISTER_BITCAST_FUNC(Eigen::bfloat16, 7);
+RAL_REGISTER_BITCAST_FUNC(Eigen::bfloat16, 8);
 RAL_REGISTER_BITCAST_FUNC(float, 1);
 RAL_REGISTER_BITCAST_FUNC(float, 2);
 RAL_REGISTER_BITCAST_FUNC(float, 3);
@@ -705,6 +732,7 @@ RAL_REGISTER_BITCAST_FUNC(bool, 8);
 TAO_RAL_API(tao::ral::gpu::kRalGpuAlloc, "gpu", ral_base_cuda_alloc);
 TAO_RAL_API(tao::ral::gpu::kRalGpuAllocPersistent, "gpu",
             ral_base_cuda_alloc_persistent);
+TAO_RAL_API(tao::ral::kRalAllocOutput, "gpu", ral_base_cuda_alloc_output);
 TAO_RAL_API(tao::ral::gpu::kRalGpuDealloc, "gpu", ral_base_cuda_dealloc);
 TAO_RAL_API(tao::ral::gpu::kRalGpuRawAlloc, "gpu", ral_base_cuda_raw_alloc);
 TAO_RAL_API(tao::ral::gpu::kRalGpuRawDealloc, "gpu", ral_base_cuda_raw_dealloc);
@@ -18,12 +18,15 @@
 #include <chrono>
 #include <cstring>
 #include <numeric>
+#include <sstream>
 
 #include "absl/strings/str_split.h"
 #include "tensorflow/compiler/mlir/xla/ral/context/context_util.h"
 #include "tensorflow/compiler/mlir/xla/ral/device/cpu/cpu_driver.h"
 #include "tensorflow/compiler/mlir/xla/ral/ral_base.h"
 #include "tensorflow/compiler/mlir/xla/ral/ral_helper.h"
+#include "tensorflow/compiler/mlir/xla/ral/ral_thread_pool.h"
+#include "third_party/eigen3/Eigen/Core"
 
 // If we're on gcc 4.8 or older, there's a known bug that prevents the use of
 // intrinsics when the architecture is not defined in the flags. See
@@ -47,6 +50,12 @@ namespace ral {
 
 using cpu::CpuLaunchDims;
 
+// Defined in stream_executor_based_impl.h when using stream executor.
+#ifndef TAO_RAL_USE_STREAM_EXECUTOR
+DEFINE_TAO_TYPE_NAME_HELPER(Eigen::half, "f16");
+DEFINE_TAO_TYPE_NAME_HELPER(Eigen::bfloat16, "bf16");
+#endif
+
 namespace {
 
 bool initDebugMode() {
@@ -106,6 +115,20 @@ bool ensureDenormalState(bool on) {
   return status;
 }
 
+CpuLaunchBackend initCpuLaunchBackend() {
+  const char* env = getenv("DISC_CPU_LAUNCH_BACKEND");
+  if (!env) return CpuLaunchBackend::kOpenMP;
+  std::string envStr = env;
+  std::transform(envStr.begin(), envStr.end(), envStr.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  if (envStr == "thread_pool") return CpuLaunchBackend::kThreadPool;
+  if (envStr != "omp") {
+    TAO_VLOG(0) << "unknown DISC_CPU_LAUNCH_BACKEND: " << env
+                << ", fallback to omp";
+  }
+  return CpuLaunchBackend::kOpenMP;
+}
+
 }  // namespace
 
 bool isDebugMode() {
@@ -149,6 +172,13 @@ bool discEnableGlobalConstantStore() {
   return enabled;
 }
 
+CpuLaunchBackend getDefaultCpuLaunchBackend() {
+  static CpuLaunchBackend backend = initCpuLaunchBackend();
+  return backend;
+}
+
+const char* kRalCpuLaunchState = "ral_cpu_launch_state";
+
 ConstStoreRegistrar& ConstStoreRegistrar::Instance() {
   static ConstStoreRegistrar instance;
   return instance;
@@ -167,15 +197,18 @@ bool ConstStoreRegistrar::unregisterConstStore(ProcessLevelConstStore* store) {
 }
 
 ProcessLevelConstStore* ConstStoreRegistrar::getConstStore(
-    std::string pb_file_path) {
+    std::string pb_file_path, const char* data, size_t size) {
   std::lock_guard<std::mutex> l(mu);
   auto it = pbFile2Instance.find(pb_file_path);
   if (it == pbFile2Instance.end()) {
     ProcessLevelConstStore* const_store = new ProcessLevelConstStore;
     const_store->pb_file_path = pb_file_path;
-    const_store->state.metadata = MetadataFile::loadFromFile(pb_file_path);
-    if (!const_store->state.metadata) {
+    bool loaded =
+        data ? const_store->state.loadMetadataFromMemory(data, size)
+             : const_store->state.loadMetadataFile(pb_file_path);
+    if (!loaded) {
       TAO_LOG(ERROR) << "failed to load metadata file from: " << pb_file_path;
+      delete const_store;
       return nullptr;
     }
     it =
@@ -185,6 +218,25 @@ ProcessLevelConstStore* ConstStoreRegistrar::getConstStore(
   return it->second;
 }
 
+bool getHostConstUniqueId(ExecutionContext* ctx, const void* ptr,
+                          std::string* id) {
+  auto* state =
+      ctx->getResource<RalGlobalConstantState>(kRalGlobalConstantState);
+  if (!state) return false;
+  std::ostringstream prefix;
+  if (state->process_level_store) {
+    prefix << state->process_level_store->pb_file_path;
+    state = &(state->process_level_store->state);
+  } else {
+    prefix << "ctx@" << ctx->getContext();
+  }
+  std::lock_guard<std::mutex> lock(state->mu);
+  auto it = state->host_constant_names.find(ptr);
+  if (it == state->host_constant_names.end()) return false;
+  *id = prefix.str() + "/" + it->second;
+  return true;
+}
+
 #ifdef TAO_CPU_ONLY
 void RalGlobalConstantState::onContextFinish(Context* ctx) /* override */ {
   if (process_level_store) {
@@ -193,7 +245,11 @@ void RalGlobalConstantState::onContextFinish(Context* ctx) /* override */ {
     if (!owned) return;
     auto cpu_driver =
         static_cast<cpu::CPUDriver*>(ctx->getDriver(cpu::CPUDriver::name()));
+    auto& metadata = process_level_store->state.metadata;
     for (auto& e : process_level_store->state.host_constants) {
+      // The consts inside the const blob file are unmapped along with the
+      // metadata file.
+      if (metadata->isHostConstantInBlob(e.second.first)) continue;
       cpu_driver->raw_dealloc(ctx, e.second.first);
     }
     delete process_level_store;
@@ -305,38 +361,66 @@ inline buffer_t ral_base_cuda_const_host_internal(
       int64_t width_in_bytes = 0;
       buffer_shape_t dim_sizes =
           GetShapeFromConstUniqueName(ctx, unique_name, &width_in_bytes);
-      // alloc, get value from metadata file
-      const std::string* hex_str_ptr;
-      if (!state->metadata->getHostConstant(key, hex_str_ptr)) {
-        std::string msg =
-            "const unique_name " + key + "not found in metadata file";
-        ctx->signalError(Context::FAILURE, msg);
-      }
-      auto data = fromHex(*hex_str_ptr);
-      auto bytes = data.size();
       int64_t num_elements = std::accumulate(dim_sizes.begin(), dim_sizes.end(),
                                              1, std::multiplies<int64_t>());
-      if (bytes < num_elements * width_in_bytes) {
-        // isSplat
-        bytes = num_elements * width_in_bytes;
-        auto splat_data = data;
-        for (int64_t i = 0; i < num_elements - 1; ++i) {
-          std::copy(splat_data.begin(), splat_data.end(),
-                    std::back_inserter(data));
+      buffer_t data_ptr = nullptr;
+      size_t bytes = 0;
+      // The consts inside the const blob file are used in place.
+      if (state->metadata->getHostConstantFromBlob(key, data_ptr, bytes)) {
+        if (bytes != static_cast<size_t>(num_elements * width_in_bytes)) {
+          std::string msg =
+              "const unique_name " + key + " has unexpected size in blob file";
+          ctx->signalError(Context::FAILURE, msg);
+          return nullptr;
         }
-      }
-      auto cpu_driver = ctx->getDriver<cpu::CPUDriver>(cpu::CPUDriver::name());
-      buffer_t data_ptr = use_process_store
+        // The const may be returned as an output or borrowed by a bitcast,
+        // thus the context has to know it's persistent. Falls back to a copy
+        // if the context can not adopt an external buffer.
+        auto cpu_driver =
+            ctx->getDriver<cpu::CPUDriver>(cpu::CPUDriver::name());
+        if (!cpu_driver->register_persistent(ctx, data_ptr)) {
+          buffer_t copy = use_process_store
                               ? cpu_driver->raw_alloc(ctx->getContext(), bytes)
                               : cpu_driver->alloc_persistent(ctx, bytes);
-      std::memcpy(data_ptr, data.data(), bytes);
-
-      TAO_VLOG(2) << "data.size: " << bytes;
-      state->metadata->releaseHostConstant(key);
+          std::memcpy(copy, data_ptr, bytes);
+          data_ptr = copy;
+        }
+        TAO_VLOG(2) << "data.size: " << bytes << " (mapped)";
+      } else {
+        // alloc, get value from metadata file
+        const std::string* hex_str_ptr;
+        if (!state->metadata->getHostConstant(key, hex_str_ptr)) {
+          std::string msg =
+              "const unique_name " + key + "not found in metadata file";
+          ctx->signalError(Context::FAILURE, msg);
+          return nullptr;
+        }
+        auto data = fromHex(*hex_str_ptr);
+        bytes = data.size();
+        if (bytes < num_elements * width_in_bytes) {
+          // isSplat
+          bytes = num_elements * width_in_bytes;
+          auto splat_data = data;
+          for (int64_t i = 0; i < num_elements - 1; ++i) {
+            std::copy(splat_data.begin(), splat_data.end(),
+                      std::back_inserter(data));
+          }
+        }
+        auto cpu_driver =
+            ctx->getDriver<cpu::CPUDriver>(cpu::CPUDriver::name());
+        data_ptr = use_process_store
+                       ? cpu_driver->raw_alloc(ctx->getContext(), bytes)
+                       : cpu_driver->alloc_persistent(ctx, bytes);
+        std::memcpy(data_ptr, data.data(), bytes);
+
+        TAO_VLOG(2) << "data.size: " << bytes;
+        state->metadata->releaseHostConstant(key);
+      }
 
       it = state->host_constants
                .insert(std::make_pair(key, std::make_pair(data_ptr, dim_sizes)))
                .first;
+      state->host_constant_names[data_ptr] = key;
       state->setHostConstByIndex(unique_index_in_module,
                                  std::make_pair(data_ptr, dim_sizes));
     }
@@ -479,6 +563,27 @@ RAL_REGISTER_CONST_HOST_FUNC(bool, 5);
 RAL_REGISTER_CONST_HOST_FUNC(bool, 6);
 RAL_REGISTER_CONST_HOST_FUNC(bool, 7);
 RAL_REGISTER_CONST_HOST_FUNC(bool, 8);
+// Registered at the end of this file when using stream executor.
+#ifndef TAO_RAL_USE_STREAM_EXECUTOR
+RAL_REGISTER_CONST_HOST_FUNC_0D(Eigen::half);
+RAL_REGISTER_CONST_HOST_FUNC(Eigen::half, 1);
+RAL_REGISTER_CONST_HOST_FUNC(Eigen::half, 2);
+RAL_REGISTER_CONST_HOST_FUNC(Eigen::half, 3);
+RAL_REGISTER_CONST_HOST_FUNC(Eigen::half, 4);
+RAL_REGISTER_CONST_HOST_FUNC(Eigen::half, 5);
+RAL_REGISTER_CONST_HOST_FUNC(Eigen::half, 6);
+RAL_REGISTER_CONST_HOST_FUNC(Eigen::half, 7);
+RAL_REGISTER_CONST_HOST_FUNC(Eigen::half, 8);
+RAL_REGISTER_CONST_HOST_FUNC_0D(Eigen::bfloat16);
+RAL_REGISTER_CONST_HOST_FUNC(Eigen::bfloat16, 1);
+RAL_REGISTER_CONST_HOST_FUNC(Eigen::bfloat16, 2);
+RAL_REGISTER_CONST_HOST_FUNC(Eigen::bfloat16, 3);
+RAL_REGISTER_CONST_HOST_FUNC(Eigen::bfloat16, 4);
+RAL_REGISTER_CONST_HOST_FUNC(Eigen::bfloat16, 5);
+RAL_REGISTER_CONST_HOST_FUNC(Eigen::bfloat16, 6);
+RAL_REGISTER_CONST_HOST_FUNC(Eigen::bfloat16, 7);
+RAL_REGISTER_CONST_HOST_FUNC(Eigen::bfloat16, 8);
+#endif
 
 static inline void* ral_aligned_malloc(ExecutionContext* ctx, int64_t size) {
   return aligned_malloc(size);
@@ -919,37 +1024,84 @@ void partitionRunner(ExecutionContext* ctx, const char* kernel_name,
   }
 }
 
-// cpu kernel launch
-void ompLaunchKernel(ExecutionContext* ctx, const char* kernel_name,
-                     CpuLaunchDims lowerBound, CpuLaunchDims upperBound,
-                     CpuLaunchDims step, int64_t unitWorkloadSizeHint,
-                     void* kernel, void** params /* kernel params */) {
+// The number of partitions per core of a loop run by the thread pool.
+constexpr int kNumPartitionsPerCore = 4;
+
+// The maximum number of partition plans cached by a context. The cache is
+// cleared once it is full, which bounds its size for highly dynamic shapes.
+constexpr size_t kMaxNumCachedPlans = 1024;
+
+std::size_t LoopPartitionPlanKey::Hasher::operator()(
+    const LoopPartitionPlanKey& key) const {
+  std::size_t seed = std::hash<int64_t>()(key.num_partitions);
+  auto combine = [&](int64_t v) {
+    seed ^= std::hash<int64_t>()(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+  };
+  combine(key.unit_workload_size_hint);
+  combine(key.num_ivs);
+  for (int64_t i = 0; i < 3 * key.num_ivs; ++i) combine(key.bounds[i]);
+  return seed;
+}
+
+// A direct-mapped cache of the partition plans in front of the one of the
+// context. A plan only depends on its key, thus the entries are shared by all
+// the contexts executed by the thread and looked up without locking.
+struct LoopPartitionPlanCacheEntry {
+  LoopPartitionPlanKey key;
+  std::shared_ptr<const LoopPartitionPlan> plan;
+};
+constexpr size_t kLoopPartitionPlanThreadCacheSize = 64;
+thread_local std::array<LoopPartitionPlanCacheEntry,
+                        kLoopPartitionPlanThreadCacheSize>
+    tLoopPartitionPlanCache;
+
+// Returns the partition plan of a loop, which is cached per loop shape.
+std::shared_ptr<const LoopPartitionPlan> getLoopPartitionPlan(
+    CpuLaunchState* state, CpuLaunchDims lowerBound, CpuLaunchDims upperBound,
+    CpuLaunchDims step, int64_t unitWorkloadSizeHint) {
   int numIVs = lowerBound.sizes[0];
-  TAO_VLOG(1) << "ompLaunchKernel: " << kernel_name << "@" << numIVs;
-  ensureDenormalState(true);
-  CpuTimer timer(kernel_name);
-  if (!numIVs) {
-    return;
+  // The thread pool claims the partitions dynamically, thus the loop is cut
+  // into more partitions than cores to balance the load between the threads.
+  int numPartitions = getNumAvailableCores();
+  if (state->backend == CpuLaunchBackend::kThreadPool) {
+    numPartitions *= kNumPartitionsPerCore;
   }
+  bool cacheable = numIVs <= kMaxNumCachedLoopIVs;
+  LoopPartitionPlanKey key;
+  LoopPartitionPlanCacheEntry* entry = nullptr;
+  if (cacheable) {
+    key.num_partitions = numPartitions;
+    key.unit_workload_size_hint = unitWorkloadSizeHint;
+    key.num_ivs = numIVs;
+    std::copy(lowerBound.data, lowerBound.data + numIVs, key.bounds.begin());
+    std::copy(upperBound.data, upperBound.data + numIVs,
+              key.bounds.begin() + numIVs);
+    std::copy(step.data, step.data + numIVs, key.bounds.begin() + 2 * numIVs);
+    entry = &tLoopPartitionPlanCache[LoopPartitionPlanKey::Hasher()(key) %
+                                     kLoopPartitionPlanThreadCacheSize];
+    if (entry->plan && entry->key == key) return entry->plan;
 
-  // Basic idea:
-  // 1, estimate #num core needed
-  //    numCore = estimate(...)
-  // 2, partition the ivs
-  //    partitions = partition(lowerBound, upperBound, step);
-  // 3, parallel launch.
+    std::lock_guard<std::mutex> lock(state->mu);
+    auto it = state->plan_cache.find(key);
+    if (it != state->plan_cache.end()) {
+      entry->key = key;
+      entry->plan = it->second;
+      return it->second;
+    }
+  }
 
-  auto plan =
-      LoopParallelAssigner(lowerBound, upperBound, step, unitWorkloadSizeHint,
-                           getNumAvailableCores());
+  std::shared_ptr<const LoopPartitionPlan> plan =
+      std::make_shared<LoopPartitionPlan>(
+          LoopParallelAssigner(lowerBound, upperBound, step,
+                               unitWorkloadSizeHint, numPartitions));
   if (TAO_VLOG_IS_ON(1)) {
-    TAO_VLOG(0) << "loop partition plan w/ " << plan.partitions.size()
+    TAO_VLOG(0) << "loop partition plan w/ " << plan->partitions.size()
                 << " partitions";
-    for (size_t i = 0; i < plan.partitions.size(); ++i) {
+    for (size_t i = 0; i < plan->partitions.size(); ++i) {
       TAO_VLOG(0) << " partition #" << i << ":";
-      for (size_t taskId = 0; taskId < plan.partitions[i].tasks.size();
+      for (size_t taskId = 0; taskId < plan->partitions[i].tasks.size();
            ++taskId) {
-        auto& task = plan.partitions[i].tasks[taskId];
+        auto task = plan->partitions[i].tasks[taskId];
         TAO_VLOG(0) << "  task@" << taskId << " w/ " << task.lowerBound.size()
                     << " ivs: ";
         for (size_t ivId = 0; ivId < task.lowerBound.size(); ++ivId) {
@@ -962,24 +1114,168 @@ void ompLaunchKernel(ExecutionContext* ctx, const char* kernel_name,
       }
     }
   }
-  if (plan.partitions.size() < 2) {
+
+  if (!cacheable) return plan;
+  entry->key = key;
+  entry->plan = plan;
+  std::lock_guard<std::mutex> lock(state->mu);
+  if (state->plan_cache.size() >= kMaxNumCachedPlans) {
+    state->plan_cache.clear();
+  }
+  state->plan_cache.emplace(key, plan);
+  return plan;
+}
+
+struct CpuKernelLaunch {
+  const char* kernel_name;
+  std::shared_ptr<const LoopPartitionPlan> plan;
+  void* kernel;
+  void** params;
+};
+
+// The launches deferred by `ral_kernel_launch_deferred` on this thread, which
+// are run together with the next `ral_kernel_launch` of the same context.
+struct DeferredCpuKernelLaunches {
+  ExecutionContext* ctx = nullptr;
+  std::vector<CpuKernelLaunch> launches;
+};
+
+thread_local DeferredCpuKernelLaunches tDeferredLaunches;
+
+// Runs `launches` in order. The launches share a single parallel region with
+// a barrier between two consecutive ones, thus a launch may consume the
+// results of the launches before it while the threads are only forked and
+// joined once.
+void runKernelLaunches(ExecutionContext* ctx, CpuLaunchState* state,
+                       const std::vector<CpuKernelLaunch>& launches) {
+  size_t numThreads = 0;
+  for (auto& launch : launches) {
+    numThreads = std::max(numThreads, launch.plan->partitions.size());
+  }
+  if (numThreads < 2) {
     TAO_VLOG(2) << "# loop partitions is less than two, use single thread.";
-    partitionRunner(ctx, kernel_name, plan.partitions[0], kernel, params);
+    for (auto& launch : launches) {
+      partitionRunner(ctx, launch.kernel_name, launch.plan->partitions[0],
+                      launch.kernel, launch.params);
+    }
+    return;
+  }
+
+  if (state->backend == CpuLaunchBackend::kThreadPool) {
+    // The calling thread is one of the workers.
+    static WorkStealingThreadPool* pool =
+        new WorkStealingThreadPool(getNumAvailableCores() - 1);
+    int numCores = getNumAvailableCores();
+    int maxConcurrency = state->max_concurrency > 0
+                             ? std::min(state->max_concurrency, numCores)
+                             : numCores;
+    for (auto& launch : launches) {
+      auto& partitions = launch.plan->partitions;
+      pool->parallelFor(partitions.size(), maxConcurrency, [&](int64_t idx) {
+        ensureDenormalState(true);
+        partitionRunner(ctx, launch.kernel_name, partitions[idx],
+                        launch.kernel, launch.params);
+      });
+    }
+    TAO_VLOG(1) << "parallel runner finish";
     return;
   }
 
-#pragma omp parallel num_threads(plan.partitions.size())
+#pragma omp parallel num_threads(numThreads)
   {
     ensureDenormalState(true);
-    int idx = omp_get_thread_num();
+    size_t idx = omp_get_thread_num();
     TAO_VLOG(1) << "parallel runner #" << idx << " start";
-    partitionRunner(ctx, kernel_name, plan.partitions[idx], kernel, params);
+    for (size_t i = 0; i < launches.size(); ++i) {
+      if (i > 0) {
+#pragma omp barrier
+      }
+      auto& launch = launches[i];
+      if (idx < launch.plan->partitions.size()) {
+        partitionRunner(ctx, launch.kernel_name, launch.plan->partitions[idx],
+                        launch.kernel, launch.params);
+      }
+    }
     TAO_VLOG(1) << "parallel runner #" << idx << " finish";
   }
   TAO_VLOG(1) << "parallel runner finish";
 }
 
+void flushDeferredKernelLaunches() {
+  auto& deferred = tDeferredLaunches;
+  if (deferred.launches.empty()) return;
+  ExecutionContext* ctx = deferred.ctx;
+  auto* state = ctx->getOrCreateResource<CpuLaunchState>(
+      kRalCpuLaunchState, []() { return new CpuLaunchState; });
+  std::vector<CpuKernelLaunch> launches;
+  launches.swap(deferred.launches);
+  deferred.ctx = nullptr;
+  runKernelLaunches(ctx, state, launches);
+}
+
+// cpu kernel launch
+void ompLaunchKernel(ExecutionContext* ctx, const char* kernel_name,
+                     CpuLaunchDims lowerBound, CpuLaunchDims upperBound,
+                     CpuLaunchDims step, int64_t unitWorkloadSizeHint,
+                     void* kernel, void** params /* kernel params */) {
+  int numIVs = lowerBound.sizes[0];
+  TAO_VLOG(1) << "ompLaunchKernel: " << kernel_name << "@" << numIVs;
+  ensureDenormalState(true);
+  CpuTimer timer(kernel_name);
+
+  // Basic idea:
+  // 1, estimate #num core needed
+  //    numCore = estimate(...)
+  // 2, partition the ivs
+  //    partitions = partition(lowerBound, upperBound, step);
+  // 3, parallel launch, together with the launches deferred before.
+
+  auto* state = ctx->getOrCreateResource<CpuLaunchState>(
+      kRalCpuLaunchState, []() { return new CpuLaunchState; });
+  auto& deferred = tDeferredLaunches;
+  if (deferred.ctx != ctx) {
+    flushDeferredKernelLaunches();
+  }
+  std::vector<CpuKernelLaunch> launches;
+  launches.swap(deferred.launches);
+  deferred.ctx = nullptr;
+  if (numIVs) {
+    launches.push_back({kernel_name,
+                        getLoopPartitionPlan(state, lowerBound, upperBound,
+                                             step, unitWorkloadSizeHint),
+                        kernel, params});
+  }
+  if (launches.empty()) return;
+  runKernelLaunches(ctx, state, launches);
+}
+
+// Records a cpu kernel launch, which is run by the next `ral_kernel_launch`
+// in the same parallel region. The compiler only defers a launch if nothing
+// between it and the next launch depends on its results.
+void ompLaunchKernelDeferred(ExecutionContext* ctx, const char* kernel_name,
+                             CpuLaunchDims lowerBound,
+                             CpuLaunchDims upperBound, CpuLaunchDims step,
+                             int64_t unitWorkloadSizeHint, void* kernel,
+                             void** params /* kernel params */) {
+  int numIVs = lowerBound.sizes[0];
+  TAO_VLOG(1) << "ompLaunchKernelDeferred: " << kernel_name << "@" << numIVs;
+  auto& deferred = tDeferredLaunches;
+  if (deferred.ctx != ctx) {
+    flushDeferredKernelLaunches();
+    deferred.ctx = ctx;
+  }
+  if (!numIVs) return;
+  auto* state = ctx->getOrCreateResource<CpuLaunchState>(
+      kRalCpuLaunchState, []() { return new CpuLaunchState; });
+  deferred.launches.push_back({kernel_name,
+                               getLoopPartitionPlan(state, lowerBound,
+                                                    upperBound, step,
+                                                    unitWorkloadSizeHint),
+                               kernel, params});
+}
+
 TAO_RAL_API(cpu::kRalCpuLaunch, "cpu", ompLaunchKernel);
+TAO_RAL_API(cpu::kRalCpuLaunchDeferred, "cpu", ompLaunchKernelDeferred);
 
 #endif  // TAO_CPU_ONLY
 }  // namespace ral
@@ -998,6 +1294,15 @@ RAL_REGISTER_CONST_HOST_FUNC(Eigen::half, 5);
 RAL_REGISTER_CONST_HOST_FUNC(Eigen::half, 6);
 RAL_REGISTER_CONST_HOST_FUNC(Eigen::half, 7);
 RAL_REGISTER_CONST_HOST_FUNC(Eigen::half, 8);
+RAL_REGISTER_CONST_HOST_FUNC_0D(Eigen::bfloat16);
+RAL_REGISTER_CONST_HOST_FUNC(Eigen::bfloat16, 1);
+RAL_REGISTER_CONST_HOST_FUNC(Eigen::bfloat16, 2);
+RAL_REGISTER_CONST_HOST_FUNC(Eigen::bfloat16, 3);
+RAL_REGISTER_CONST_HOST_FUNC(Eigen::bfloat16, 4);
+RAL_REGISTER_CONST_HOST_FUNC(Eigen::bfloat16, 5);
+RAL_REGISTER_CONST_HOST_FUNC(Eigen::bfloat16, 6);
+RAL_REGISTER_CONST_HOST_FUNC(Eigen::bfloat16, 7);
+RAL_REGISTER_CONST_HOST_FUNC(Eigen::bfloat16, 8);
 }  // namespace ral
 }  // namespace tao
 #endif  // TAO_RAL_USE_STREAM_EXECUTOR
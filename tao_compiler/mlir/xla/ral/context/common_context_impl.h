@@ -16,9 +16,15 @@
 #define ALIGN_BYTES 128
 #endif
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <chrono>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 #include "tensorflow/compiler/mlir/xla/ral/context/context_util.h"
 #include "tensorflow/compiler/mlir/xla/ral/ral_context.h"
@@ -36,21 +42,113 @@ struct ConstStoreRegistrar {
   static ConstStoreRegistrar& Instance();
 
   bool unregisterConstStore(ProcessLevelConstStore* store);
-  ProcessLevelConstStore* getConstStore(std::string pb_file_path);
+  // Returns the store of `pb_file_path`, loading the metadata file if not
+  // found. If `data` is not null, the metadata is parsed from the `size`
+  // bytes at it instead, and `pb_file_path` only names the store.
+  ProcessLevelConstStore* getConstStore(std::string pb_file_path,
+                                        const char* data = nullptr,
+                                        size_t size = 0);
 
   std::mutex mu;
   std::unordered_map<std::string, ProcessLevelConstStore*> pbFile2Instance;
   std::unordered_map<ProcessLevelConstStore*, int> referenceCounter;
 };
 
-struct RalGlobalConstantState : public tao::ral::Context::Resource {
-  RalGlobalConstantState() {
-    for (int i = 0; i < host_constants_by_idx.size(); ++i) {
-      host_constants_by_idx[i] = nullptr;
-      device_constants_by_idx[i] = nullptr;
+// A table from the unique index of a const to its item. Lookups are lock
+// free, while updates should be serialized by the caller. The table consists
+// of segments whose sizes double, thus it can grow without moving the items
+// that have been published.
+template <typename Item>
+class ConstItemTable {
+ public:
+  // The capacity of the first segment if not reserved explicitly.
+  static constexpr const size_t kDefaultInitialCapacity = 8192;
+  // Supports up to `initial_capacity * 2^(kMaxNumSegments - 1)` items.
+  static constexpr const int kMaxNumSegments = 32;
+
+  ConstItemTable() {
+    for (auto& segment : segments_) segment = nullptr;
+  }
+
+  ~ConstItemTable() {
+    for (auto& segment : segments_) delete[] segment.load();
+  }
+
+  // Disables copy and assignment methods.
+  ConstItemTable(const ConstItemTable& other) = delete;
+  ConstItemTable& operator=(const ConstItemTable& other) = delete;
+
+  // Sets the capacity of the first segment, e.g. according to the number of
+  // consts of the compiled module, thus all the items are in one segment.
+  // Takes effect only before the first update.
+  void reserve(size_t capacity) {
+    if (segments_[0].load(std::memory_order_relaxed)) return;
+    initialCapacity_ = std::max<size_t>(capacity, 1);
+  }
+
+  // Returns nullptr if not found.
+  Item* get(int64_t idx) const {
+    if (idx < 0) return nullptr;
+    size_t offset;
+    int segmentIdx = locate(idx, &offset);
+    if (segmentIdx >= kMaxNumSegments) return nullptr;
+    Slot* segment = segments_[segmentIdx].load(std::memory_order_acquire);
+    if (!segment) return nullptr;
+    Slot& slot = segment[offset];
+    return slot.ready.load(std::memory_order_acquire) ? &slot.item : nullptr;
+  }
+
+  // Sets the item of `idx` if not set yet. The table grows if necessary.
+  void set(int64_t idx, Item item) {
+    if (idx < 0) return;
+    size_t offset;
+    int segmentIdx = locate(idx, &offset);
+    if (segmentIdx >= kMaxNumSegments) return;
+    Slot* segment = segments_[segmentIdx].load(std::memory_order_relaxed);
+    if (!segment) {
+      segment = new Slot[segmentCapacity(segmentIdx)];
+      segments_[segmentIdx].store(segment, std::memory_order_release);
     }
+    Slot& slot = segment[offset];
+    if (slot.ready.load(std::memory_order_relaxed)) return;
+    slot.item = std::move(item);
+    slot.ready.store(true, std::memory_order_release);
   }
 
+ private:
+  struct Slot {
+    Item item;
+    std::atomic<bool> ready{false};
+  };
+
+  // Segment 0 holds [0, c), and segment k (k > 0) holds [c * 2^(k-1),
+  // c * 2^k), where c is the initial capacity.
+  size_t segmentCapacity(int segmentIdx) const {
+    return segmentIdx == 0 ? initialCapacity_
+                           : initialCapacity_ << (segmentIdx - 1);
+  }
+
+  int locate(int64_t idx, size_t* offset) const {
+    size_t i = static_cast<size_t>(idx);
+    if (i < initialCapacity_) {
+      *offset = i;
+      return 0;
+    }
+    int segmentIdx = 1;
+    size_t begin = initialCapacity_;
+    while (segmentIdx < kMaxNumSegments && i >= 2 * begin) {
+      begin *= 2;
+      ++segmentIdx;
+    }
+    *offset = i - begin;
+    return segmentIdx;
+  }
+
+  size_t initialCapacity_ = kDefaultInitialCapacity;
+  std::array<std::atomic<Slot*>, kMaxNumSegments> segments_;
+};
+
+struct RalGlobalConstantState : public tao::ral::Context::Resource {
   std::mutex mu;
   std::unique_ptr<MetadataFile> metadata;
   // If not null, use the process level const store instead of this context
@@ -64,50 +162,58 @@ struct RalGlobalConstantState : public tao::ral::Context::Resource {
   using ItemMap = std::unordered_map<std::string, Item>;
   ItemMap device_constants;
   ItemMap host_constants;
+  // map <host_ptr, unique_name>, used to find the constant a buffer belongs
+  // to, e.g. to share the packed weights among contexts.
+  std::unordered_map<const void*, std::string> host_constant_names;
 
   // fast path: using a unique const index to do look up.
   // Note that the const index is assigned to each const at compile time.
   // The index is unique within the compiled module level.
-  //
-  // The large index suppored to use the fast path.
-  static constexpr const int kMaxNumItemsForFastPath = 8196;
-  template <typename T>
-  using ItemArray = std::array<T, kMaxNumItemsForFastPath>;
-  using ItemLookupFastPathStorage = ItemArray<Item>;
-  using ItemLookupFastPathTable = ItemArray<std::atomic<Item*>>;
+  using ItemLookupFastPathTable = ConstItemTable<Item>;
 
   // for host const
-  ItemLookupFastPathStorage host_constants_storage;
   ItemLookupFastPathTable host_constants_by_idx;
   // for device const
-  ItemLookupFastPathStorage device_constants_storage;
   ItemLookupFastPathTable device_constants_by_idx;
 
-  // Returns nullptr if not found or supported.
+  // Loads the metadata file named `filename` and sizes the fast path tables
+  // according to the number of consts inside it.
+  // Returns false if failed.
+  bool loadMetadataFile(const std::string& filename) {
+    return initMetadata(MetadataFile::loadFromFile(filename));
+  }
+
+  // Same as above, but parses the metadata from the `size` bytes at `data`.
+  bool loadMetadataFromMemory(const char* data, size_t size) {
+    return initMetadata(MetadataFile::loadFromMemory(data, size));
+  }
+
+  bool initMetadata(std::unique_ptr<MetadataFile> file) {
+    metadata = std::move(file);
+    if (!metadata) return false;
+    host_constants_by_idx.reserve(metadata->getNumHostConstants());
+    device_constants_by_idx.reserve(metadata->getNumDeviceConstants());
+    return true;
+  }
+
+  // Returns nullptr if not found.
   Item* getHostConstByIndex(int unique_index_in_module) {
-    if (unique_index_in_module >= host_constants_by_idx.size()) return nullptr;
-    return host_constants_by_idx[unique_index_in_module];
+    return host_constants_by_idx.get(unique_index_in_module);
   }
   // update the item according to `unique_index_in_module`
+  // Should be called with `mu` held.
   void setHostConstByIndex(int unique_index_in_module, Item item) {
-    if (unique_index_in_module >= host_constants_by_idx.size()) return;
-    host_constants_storage[unique_index_in_module] = std::move(item);
-    host_constants_by_idx[unique_index_in_module] =
-        &host_constants_storage[unique_index_in_module];
+    host_constants_by_idx.set(unique_index_in_module, std::move(item));
   }
 
-  // Returns nullptr if not found or supported.
+  // Returns nullptr if not found.
   Item* getDeviceConstByIndex(int unique_index_in_module) {
-    if (unique_index_in_module >= device_constants_by_idx.size())
-      return nullptr;
-    return device_constants_by_idx[unique_index_in_module];
+    return device_constants_by_idx.get(unique_index_in_module);
   }
   // update the item according to `unique_index_in_module`
+  // Should be called with `mu` held.
   void setDeviceConstByIndex(int unique_index_in_module, Item item) {
-    if (unique_index_in_module >= device_constants_by_idx.size()) return;
-    device_constants_storage[unique_index_in_module] = std::move(item);
-    device_constants_by_idx[unique_index_in_module] =
-        &device_constants_storage[unique_index_in_module];
+    device_constants_by_idx.set(unique_index_in_module, std::move(item));
   }
 
   void onContextFinish(Context* ctx) override;
@@ -121,6 +227,12 @@ struct ProcessLevelConstStore {
 // Enables process level const store if true.
 bool discEnableGlobalConstantStore();
 
+// Returns true and sets `id` if `ptr` is the data of a host constant of the
+// context. Contexts sharing a process level const store get the same id for
+// the same constant, otherwise the id is unique to the context.
+bool getHostConstUniqueId(ExecutionContext* ctx, const void* ptr,
+                          std::string* id);
+
 template <typename T, int N>
 MemRefType<T, N> ral_base_cuda_const_cuda(ExecutionContext* ctx,
                                           void* stream_handle,
@@ -167,6 +279,63 @@ bool isProfilingEnabled();
 // Returns the maximum number of cpu cores DISC can uses.
 int getNumAvailableCores();
 
+// The ways to run the parallel loops of `ral_kernel_launch` on cpu.
+enum class CpuLaunchBackend {
+  // Runs each launch by an OpenMP team.
+  kOpenMP,
+  // Runs the launches on a work-stealing thread pool shared by the process,
+  // thus concurrent executions do not oversubscribe the cores.
+  kThreadPool,
+};
+
+// Returns the backend set by env `DISC_CPU_LAUNCH_BACKEND` (`omp` or
+// `thread_pool`), which is OpenMP by default.
+CpuLaunchBackend getDefaultCpuLaunchBackend();
+
+extern const char* kRalCpuLaunchState;
+
+struct LoopPartitionPlan;
+
+// The maximum number of ivs of a loop whose partition plan is cached.
+constexpr int kMaxNumCachedLoopIVs = 8;
+
+// Identifies the partition plan of a loop: the number of partitions, the
+// workload hint and the bounds of the loop. Fixed-size, thus building and
+// hashing it does not allocate.
+struct LoopPartitionPlanKey {
+  int64_t num_partitions = 0;
+  int64_t unit_workload_size_hint = 0;
+  int64_t num_ivs = 0;
+  // lower bounds, upper bounds and steps of the ivs.
+  std::array<int64_t, 3 * kMaxNumCachedLoopIVs> bounds{};
+
+  bool operator==(const LoopPartitionPlanKey& rhs) const {
+    return num_partitions == rhs.num_partitions &&
+           unit_workload_size_hint == rhs.unit_workload_size_hint &&
+           num_ivs == rhs.num_ivs && bounds == rhs.bounds;
+  }
+
+  struct Hasher {
+    std::size_t operator()(const LoopPartitionPlanKey& key) const;
+  };
+};
+
+// The launch settings of a context.
+struct CpuLaunchState : public tao::ral::Context::Resource {
+  CpuLaunchBackend backend = getDefaultCpuLaunchBackend();
+  // The maximum number of threads a launch uses, including the calling
+  // thread. Zero means all the available cores. Only used by kThreadPool.
+  int max_concurrency = 0;
+
+  std::mutex mu;
+  // The partition plans of the launched loops, shared by the threads executing
+  // the context. Looked up when missing from the thread local cache.
+  std::unordered_map<LoopPartitionPlanKey,
+                     std::shared_ptr<const LoopPartitionPlan>,
+                     LoopPartitionPlanKey::Hasher>
+      plan_cache;
+};
+
 // RAII object for timing measure
 struct CpuTimer {
   // Starts the time at construction time.
@@ -43,7 +43,11 @@ void RalGlobalConstantState::onContextFinish(Context* ctx) /* override */ {
         static_cast<cpu::CPUDriver*>(ctx->getDriver(cpu::CPUDriver::name()));
     auto gpu_driver =
         static_cast<gpu::GPUDriver*>(ctx->getDriver(gpu::GPUDriver::name()));
+    auto& metadata = process_level_store->state.metadata;
     for (auto& e : process_level_store->state.host_constants) {
+      // The consts inside the const blob file are unmapped along with the
+      // metadata file.
+      if (metadata->isHostConstantInBlob(e.second.first)) continue;
       cpu_driver->raw_dealloc(ctx, e.second.first);
     }
     for (auto& e : process_level_store->state.device_constants) {
@@ -274,6 +278,15 @@ RAL_REGISTER_CONST_CUDA_FUNC(Eigen::half, 5);
 RAL_REGISTER_CONST_CUDA_FUNC(Eigen::half, 6);
 RAL_REGISTER_CONST_CUDA_FUNC(Eigen::half, 7);
 RAL_REGISTER_CONST_CUDA_FUNC(Eigen::half, 8);
+RAL_REGISTER_CONST_CUDA_FUNC_0D(Eigen::bfloat16);
+RAL_REGISTER_CONST_CUDA_FUNC(Eigen::bfloat16, 1);
+RAL_REGISTER_CONST_CUDA_FUNC(Eigen::bfloat16, 2);
+RAL_REGISTER_CONST_CUDA_FUNC(Eigen::bfloat16, 3);
+RAL_REGISTER_CONST_CUDA_FUNC(Eigen::bfloat16, 4);
+RAL_REGISTER_CONST_CUDA_FUNC(Eigen::bfloat16, 5);
+RAL_REGISTER_CONST_CUDA_FUNC(Eigen::bfloat16, 6);
+RAL_REGISTER_CONST_CUDA_FUNC(Eigen::bfloat16, 7);
+RAL_REGISTER_CONST_CUDA_FUNC(Eigen::bfloat16, 8);
 #endif  // TAO_RAL_USE_STREAM_EXECUTOR
 
 static inline void ral_base_cuda_d2d_copy_memref_impl(ExecutionContext* ctx,
@@ -500,6 +513,15 @@ RAL_REGISTER_GPU_COPY_MEMREF_FUNC(Eigen::half, 5);
 RAL_REGISTER_GPU_COPY_MEMREF_FUNC(Eigen::half, 6);
 RAL_REGISTER_GPU_COPY_MEMREF_FUNC(Eigen::half, 7);
 RAL_REGISTER_GPU_COPY_MEMREF_FUNC(Eigen::half, 8);
+RAL_REGISTER_GPU_COPY_MEMREF_FUNC_0D(Eigen::bfloat16);
+RAL_REGISTER_GPU_COPY_MEMREF_FUNC(Eigen::bfloat16, 1);
+RAL_REGISTER_GPU_COPY_MEMREF_FUNC(Eigen::bfloat16, 2);
+RAL_REGISTER_GPU_COPY_MEMREF_FUNC(Eigen::bfloat16, 3);
+RAL_REGISTER_GPU_COPY_MEMREF_FUNC(Eigen::bfloat16, 4);
+RAL_REGISTER_GPU_COPY_MEMREF_FUNC(Eigen::bfloat16, 5);
+RAL_REGISTER_GPU_COPY_MEMREF_FUNC(Eigen::bfloat16, 6);
+RAL_REGISTER_GPU_COPY_MEMREF_FUNC(Eigen::bfloat16, 7);
+RAL_REGISTER_GPU_COPY_MEMREF_FUNC(Eigen::bfloat16, 8);
 RAL_REGISTER_GPU_COPY_MEMREF_FUNC_0D(int8_t);
 RAL_REGISTER_GPU_COPY_MEMREF_FUNC(int8_t, 1);
 RAL_REGISTER_GPU_COPY_MEMREF_FUNC(int8_t, 2);
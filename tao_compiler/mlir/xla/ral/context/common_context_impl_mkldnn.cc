@@ -11,7 +11,15 @@
 
 #if defined(TAO_CPU_ONLY) && defined(TAO_ENABLE_MKLDNN)
 
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
 #include <sstream>
+#include <type_traits>
 
 #if defined(TAO_X86)
 #include "mkl.h"
@@ -27,6 +35,9 @@
 namespace tao {
 namespace ral {
 
+DEFINE_TAO_TYPE_NAME_HELPER(Eigen::half, "f16");
+DEFINE_TAO_TYPE_NAME_HELPER(Eigen::bfloat16, "bf16");
+
 namespace {
 
 DiscCpuMathKernelMode initDiscCpuMathKernelMode() {
@@ -92,6 +103,18 @@ int initWeightPrePackingCacheCapacity() {
   return std::atoi(env);
 }
 
+int initCpuGemmTuningIterations() {
+  const char* env = getenv("DISC_CPU_GEMM_TUNING_ITERATIONS");
+  if (!env) return 3;
+  return std::max(1, std::atoi(env));
+}
+
+int64_t initPackedWeightStoreLimit() {
+  const char* env = getenv("DISC_CPU_PACKED_WEIGHT_STORE_LIMIT_IN_MB");
+  if (!env) return 0;
+  return std::atoll(env) * 1024 * 1024;
+}
+
 }  // namespace
 
 #if defined(TAO_AARCH64)
@@ -159,6 +182,284 @@ bool enableInOutLayoutTuning() {
   return enabled;
 }
 
+CpuGemmTuningCache& CpuGemmTuningCache::Global() {
+  static CpuGemmTuningCache* cache = new CpuGemmTuningCache;
+  return *cache;
+}
+
+CpuGemmTuningCache::CpuGemmTuningCache() {
+  const char* env = getenv("DISC_CPU_GEMM_TUNING_CACHE_FILE");
+  if (!env) return;
+  cache_file_ = env;
+  if (importFromFile(cache_file_)) {
+    TAO_VLOG(1) << "Load " << results_.size()
+                << " cpu gemm tuning results from " << cache_file_;
+  }
+}
+
+bool CpuGemmTuningCache::find(const CpuGemmTuningKey& key,
+                              DiscCpuMathKernelMode* mode) {
+  std::lock_guard<std::mutex> l(mu_);
+  auto it = results_.find(key);
+  if (it == results_.end()) return false;
+  *mode = it->second;
+  return true;
+}
+
+void CpuGemmTuningCache::insert(const CpuGemmTuningKey& key,
+                                DiscCpuMathKernelMode mode) {
+  std::lock_guard<std::mutex> l(mu_);
+  results_[key] = mode;
+  if (!cache_file_.empty() && !exportToFileLocked(cache_file_)) {
+    TAO_VLOG(0) << "Failed to update cpu gemm tuning cache file: "
+                << cache_file_;
+  }
+}
+
+bool CpuGemmTuningCache::exportToFile(const std::string& path) {
+  std::lock_guard<std::mutex> l(mu_);
+  return exportToFileLocked(path);
+}
+
+bool CpuGemmTuningCache::exportToFileLocked(const std::string& path) {
+  // Writes to a temporary file first, and then renames it, thus a reader never
+  // sees a partially written file.
+  std::string tmp_path = path + ".tmp." + std::to_string(getpid());
+  {
+    std::ofstream out(tmp_path);
+    if (!out) return false;
+    for (auto& item : results_) {
+      const CpuGemmTuningKey& key = item.first;
+      out << key.m << " " << key.n << " " << key.k << " " << key.batch << " "
+          << key.transpose_a << " " << key.transpose_b << " "
+          << key.weight_is_const << " " << static_cast<int>(item.second)
+          << "\n";
+    }
+    if (!out) return false;
+  }
+  return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+bool CpuGemmTuningCache::importFromFile(const std::string& path) {
+  std::ifstream in(path);
+  if (!in) return false;
+  std::lock_guard<std::mutex> l(mu_);
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream iss(line);
+    CpuGemmTuningKey key;
+    int mode;
+    if (!(iss >> key.m >> key.n >> key.k >> key.batch >> key.transpose_a >>
+          key.transpose_b >> key.weight_is_const >> mode)) {
+      TAO_VLOG(0) << "Skip malformed cpu gemm tuning result: " << line;
+      continue;
+    }
+    if (mode != kDiscPreferMKL && mode != kDiscPreferOneDNN) continue;
+    results_.emplace(key, static_cast<DiscCpuMathKernelMode>(mode));
+  }
+  return true;
+}
+
+PackedWeightStore& PackedWeightStore::Global() {
+  static PackedWeightStore* store = new PackedWeightStore(
+      initPackedWeightStoreLimit(), getWeightPrePackingCacheCapacity());
+  return *store;
+}
+
+PackedWeightStore::PackedWeightStore(int64_t bytes_limit,
+                                     int64_t entries_limit) {
+  stats_.bytes_limit = bytes_limit;
+  stats_.entries_limit = entries_limit;
+}
+
+PackedWeightStore::Value PackedWeightStore::getOrCreate(
+    Context* ctx, const PackedWeightKey& key, const Creator& creator) {
+  {
+    std::lock_guard<std::mutex> l(mu_);
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+      ++stats_.num_hits;
+      Entry& entry = it->second;
+      lru_.splice(lru_.begin(), lru_, entry.lru_it);
+      if (entry.owners.insert(ctx).second) context_keys_[ctx].insert(key);
+      return entry.value;
+    }
+    ++stats_.num_misses;
+  }
+
+  // Packs the weight without holding the lock, thus the lookups of other
+  // weights are not blocked.
+  size_t bytes = 0;
+  Value value = creator(&bytes);
+  if (!value) return value;
+
+  std::lock_guard<std::mutex> l(mu_);
+  auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    // Packed by another thread concurrently, keep the existing one.
+    Entry& entry = it->second;
+    if (entry.owners.insert(ctx).second) context_keys_[ctx].insert(key);
+    return entry.value;
+  }
+  if (stats_.bytes_limit > 0 &&
+      static_cast<int64_t>(bytes) > stats_.bytes_limit) {
+    TAO_VLOG(1) << "Packed weight of " << key.const_id << " (" << bytes
+                << " bytes) exceeds the limit of the store, not cached";
+    return value;
+  }
+  lru_.push_front(key);
+  Entry& entry = entries_[key];
+  entry.value = value;
+  entry.bytes = bytes;
+  entry.owners.insert(ctx);
+  entry.lru_it = lru_.begin();
+  context_keys_[ctx].insert(key);
+  ++stats_.num_entries;
+  stats_.bytes_in_use += bytes;
+  evictLocked();
+  return value;
+}
+
+void PackedWeightStore::recordLocalHit(const PackedWeightKey& key) {
+  std::lock_guard<std::mutex> l(mu_);
+  ++stats_.num_local_hits;
+  auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    lru_.splice(lru_.begin(), lru_, it->second.lru_it);
+  }
+}
+
+void PackedWeightStore::releaseContext(Context* ctx) {
+  std::lock_guard<std::mutex> l(mu_);
+  auto context_it = context_keys_.find(ctx);
+  if (context_it == context_keys_.end()) return;
+  KeySet keys = std::move(context_it->second);
+  context_keys_.erase(context_it);
+  for (const PackedWeightKey& key : keys) {
+    auto it = entries_.find(key);
+    if (it == entries_.end()) continue;
+    it->second.owners.erase(ctx);
+    if (it->second.owners.empty()) eraseLocked(it);
+  }
+  TAO_VLOG(1) << "Packed weight store: hits = " << stats_.num_hits
+              << ", local hits = " << stats_.num_local_hits << ", misses = " << stats_.num_misses
+              << ", evictions = " << stats_.num_evictions
+              << ", entries = " << stats_.num_entries
+              << ", bytes in use = " << stats_.bytes_in_use;
+}
+
+PackedWeightStoreStats PackedWeightStore::getStats() {
+  std::lock_guard<std::mutex> l(mu_);
+  return stats_;
+}
+
+void PackedWeightStore::eraseLocked(EntryMap::iterator it) {
+  Entry& entry = it->second;
+  for (Context* owner : entry.owners) {
+    auto context_it = context_keys_.find(owner);
+    if (context_it != context_keys_.end()) context_it->second.erase(it->first);
+  }
+  lru_.erase(entry.lru_it);
+  --stats_.num_entries;
+  stats_.bytes_in_use -= entry.bytes;
+  entries_.erase(it);
+}
+
+void PackedWeightStore::evictLocked() {
+  auto exceeds_limit = [&]() {
+    return (stats_.bytes_limit > 0 &&
+            stats_.bytes_in_use > stats_.bytes_limit) ||
+           (stats_.entries_limit > 0 &&
+            stats_.num_entries > stats_.entries_limit);
+  };
+  while (exceeds_limit() && !lru_.empty()) {
+    auto it = entries_.find(lru_.back());
+    TAO_VLOG(2) << "Evict packed weight of " << it->first.const_id << " ("
+                << it->second.bytes << " bytes)";
+    ++stats_.num_evictions;
+    eraseLocked(it);
+  }
+}
+
+constexpr size_t LocalPackedWeightCache::kMinPruneThreshold;
+
+PackedWeightStore::Value LocalPackedWeightCache::lookup(
+    const LocalPackedWeightKey& local_key) {
+  std::lock_guard<std::mutex> l(mu_);
+  auto it = entries_.find(local_key);
+  if (it == entries_.end()) return nullptr;
+  PackedWeightStore::Value value = it->second.value.lock();
+  if (!value) {
+    entries_.erase(it);
+    return nullptr;
+  }
+  store_->recordLocalHit(it->second.key);
+  return value;
+}
+
+void LocalPackedWeightCache::insert(const LocalPackedWeightKey& local_key,
+                                    const PackedWeightKey& key,
+                                    const PackedWeightStore::Value& value) {
+  std::lock_guard<std::mutex> l(mu_);
+  entries_[local_key] = Entry{key, value};
+  if (entries_.size() < prune_threshold_) return;
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (it->second.value.expired()) {
+      it = entries_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  prune_threshold_ = std::max(kMinPruneThreshold, 2 * entries_.size());
+}
+
+size_t LocalPackedWeightCache::size() {
+  std::lock_guard<std::mutex> l(mu_);
+  return entries_.size();
+}
+
+struct PackedWeightStoreClient : public Context::Resource {
+  LocalPackedWeightCache local_weights{&PackedWeightStore::Global()};
+
+  void onContextFinish(Context* ctx) override {
+    PackedWeightStore::Global().releaseContext(ctx);
+  }
+};
+
+// Returns the packed weight of `local_key`. Looks up the context-local cache
+// first and falls back to the process-level store with the key built by
+// `make_key`, calling `creator` to pack it if not found either.
+template <typename T, typename KeyFnT, typename CreatorT>
+std::shared_ptr<T> getOrCreatePackedWeight(
+    ExecutionContext* ctx, const LocalPackedWeightKey& local_key,
+    KeyFnT make_key, CreatorT creator) {
+  // Makes sure the references of the context are dropped once it's destroyed.
+  auto* client = ctx->getOrCreateResource<PackedWeightStoreClient>(
+      "tao_ral.cpu.packed_weight_store_client",
+      []() { return new PackedWeightStoreClient; });
+  if (auto value = client->local_weights.lookup(local_key)) {
+    return std::static_pointer_cast<T>(value);
+  }
+  PackedWeightKey key = make_key();
+  auto value = PackedWeightStore::Global().getOrCreate(
+      ctx->getContext(), key, [&](size_t* bytes) {
+        return std::static_pointer_cast<void>(creator(bytes));
+      });
+  if (value) client->local_weights.insert(local_key, key, value);
+  return std::static_pointer_cast<T>(value);
+}
+
+// Returns the id of the constant weight used in the packed weight store.
+// Falls back to a context-local id built from its address if the weight is
+// not a known host constant.
+std::string getConstWeightId(ExecutionContext* ctx, const void* ptr) {
+  std::string id;
+  if (getHostConstUniqueId(ctx, ptr, &id)) return id;
+  std::ostringstream ss;
+  ss << "ctx@" << ctx->getContext() << "/ptr@" << ptr;
+  return ss.str();
+}
+
 format_tag str2format(const std::string& fmt) {
   if (fmt == "abcd") {
     return format_tag::abcd;
@@ -581,48 +882,44 @@ template <typename TKey, typename TValue>
 using CpuGemmKeyMap = std::unordered_map<TKey, TValue, typename TKey::Hasher>;
 
 #if defined(TAO_X86)
+// The packed weight is shared among contexts, thus it's not allocated by the
+// driver of any context.
 class MklPackedWeight {
  public:
-  MklPackedWeight(ExecutionContext* ctx, const GEMMParamsKey& key);
+  explicit MklPackedWeight(const GEMMParamsKey& key);
   ~MklPackedWeight();
 
   opaque_t packed_weight() const { return packed_weight_; }
+  size_t size() const { return size_; }
 
  private:
-  Context* ctx_;
-  cpu::CPUDriver* driver_;
+  size_t size_ = 0;
   opaque_t packed_weight_ = nullptr;
 };
 
-MklPackedWeight::MklPackedWeight(ExecutionContext* ctx,
-                                 const GEMMParamsKey& key)
-    : ctx_(ctx->getContext()),
-      driver_(ctx->getDriver<cpu::CPUDriver>(cpu::CPUDriver::name())) {
-  size_t packed_weight_size =
-      cblas_sgemm_pack_get_size(CblasBMatrix, key.m, key.n, key.k);
-  packed_weight_ = driver_->raw_alloc(ctx_, packed_weight_size);
+MklPackedWeight::MklPackedWeight(const GEMMParamsKey& key) {
+  size_ = cblas_sgemm_pack_get_size(CblasBMatrix, key.m, key.n, key.k);
+  packed_weight_ = aligned_malloc(size_);
   cblas_sgemm_pack(
       CblasRowMajor, CblasBMatrix, key.transpose_b ? CblasTrans : CblasNoTrans,
       key.m, key.n, key.k, 1.0, static_cast<float*>(key.const_weight_ptr),
       key.transpose_b ? key.k : key.n, static_cast<float*>(packed_weight_));
 }
 
-MklPackedWeight::~MklPackedWeight() {
-  if (!packed_weight_) return;
-  driver_->raw_dealloc(ctx_, packed_weight_);
-}
-
-using MklGemmCache =
-    ideep::utils::lru_cache<GEMMParamsKey, std::shared_ptr<MklPackedWeight>,
-                            CpuGemmKeyMap>;
-
-struct MklGemmState : public Context::Resource {
-  std::mutex mu;
-  MklGemmCache cache{getWeightPrePackingCacheCapacity()};
-};
+MklPackedWeight::~MklPackedWeight() { std::free(packed_weight_); }
 
 #endif
 
+// Returns true if all the operands of a gemm are fp32. MKL (cblas_sgemm) and
+// the dnnl::sgemm fast path only support fp32, other data types (e.g. bf16)
+// always go through the oneDNN matmul primitive.
+template <typename Tinput, typename Tweight, typename Toutput>
+constexpr bool isFp32Gemm() {
+  return std::is_same<Tinput, float>::value &&
+         std::is_same<Tweight, float>::value &&
+         std::is_same<Toutput, float>::value;
+}
+
 template <typename Tinput, int N = 2, typename Tweight = Tinput,
           typename Toutput = Tinput>
 void mkl_ral_gemm(ExecutionContext* ctx, void* stream_handle,
@@ -632,6 +929,10 @@ void mkl_ral_gemm(ExecutionContext* ctx, void* stream_handle,
 #if not defined(TAO_X86)
   ctx->signalError(Context::FAILURE, "mkl_ral_gemm not impl");
 #else
+  if (!isFp32Gemm<Tinput, Tweight, Toutput>()) {
+    ctx->signalError(Context::FAILURE, "mkl_ral_gemm only supports fp32");
+    return;
+  }
   int m = tp_a ? A.sizes[1] : A.sizes[0];
   int k = tp_a ? A.sizes[0] : A.sizes[1];
   int n = tp_b ? B.sizes[0] : B.sizes[1];
@@ -639,42 +940,35 @@ void mkl_ral_gemm(ExecutionContext* ctx, void* stream_handle,
   if (!isWeightPrePackingForMatMulEnabled() || !weight_is_const) {
     cblas_sgemm(CblasRowMajor, tp_a ? CblasTrans : CblasNoTrans,
                 tp_b ? CblasTrans : CblasNoTrans, m, n, k, 1.0,
-                reinterpret_cast<Tinput*>(A.data), A.strides[0],
-                reinterpret_cast<Tweight*>(B.data), B.strides[0], 0.0,
-                reinterpret_cast<Toutput*>(C.data), C.strides[0]);
+                reinterpret_cast<float*>(A.data), A.strides[0],
+                reinterpret_cast<float*>(B.data), B.strides[0], 0.0,
+                reinterpret_cast<float*>(C.data), C.strides[0]);
     return;
   }
 
-  std::string unique_name =
-      "tao_ral.cpu.mkl_gemm_" + tao::ral::TaoTypeNameHelper<Tinput>::Invoke();
-  auto state = ctx->getOrCreateResource<MklGemmState>(
-      unique_name, []() { return new MklGemmState; });
-  opaque_t packed_weight;
-  {
-    GEMMParamsKey key{m, n, k, 1, tp_a, tp_b, B.data, kDiscCpuDefaultThreadId};
-    std::lock_guard<std::mutex> l(state->mu);
-    auto& cache = state->cache;
-    auto it = cache.find(key);
-    if (it == cache.end()) {
-      std::shared_ptr<MklPackedWeight> packed_weight_ptr(
-          new MklPackedWeight(ctx, key));
-      it = cache.insert(std::make_pair(key, packed_weight_ptr)).first;
-    }
-    packed_weight = it->second->packed_weight();
-  }
+  GEMMParamsKey key{m, n, k, 1, tp_a, tp_b, B.data, kDiscCpuDefaultThreadId};
+  auto make_packed_key = [&]() {
+    return PackedWeightKey{
+        getConstWeightId(ctx, B.data),
+        "mkl_sgemm_pack_" + std::to_string(m) + "x" + std::to_string(n) + "x" +
+            std::to_string(k) + (tp_b ? "_t" : "_n")};
+  };
+  auto packed_weight_ptr = getOrCreatePackedWeight<MklPackedWeight>(
+      ctx, LocalPackedWeightKey{"mkl_sgemm_pack", key}, make_packed_key,
+      [&](size_t* bytes) {
+        auto packed = std::make_shared<MklPackedWeight>(key);
+        *bytes = packed->size();
+        return packed;
+      });
+  opaque_t packed_weight = packed_weight_ptr->packed_weight();
   cblas_sgemm_compute(CblasRowMajor, tp_a ? CblasTrans : CblasNoTrans,
-                      CblasPacked, m, n, k, reinterpret_cast<Tinput*>(A.data),
-                      A.strides[0], reinterpret_cast<Tweight*>(packed_weight),
-                      B.strides[0], 0.0, reinterpret_cast<Toutput*>(C.data),
+                      CblasPacked, m, n, k, reinterpret_cast<float*>(A.data),
+                      A.strides[0], reinterpret_cast<float*>(packed_weight),
+                      B.strides[0], 0.0, reinterpret_cast<float*>(C.data),
                       C.strides[0]);
 #endif
 }
 
-struct OnednnGemmState : public Context::Resource {
-  std::mutex mu;
-  std::unordered_map<opaque_t, std::vector<ideep::tensor>> packed_weight_cache;
-};
-
 using MatmulPrimitive = ideep::matmul_forward::super;
 using OnednnAclGemmCache =
     ideep::utils::lru_cache<GEMMParamsKey, std::shared_ptr<MatmulPrimitive>,
@@ -710,7 +1004,8 @@ void onednn_ral_gemm(ExecutionContext* ctx, void* stream_handle,
   int n = tp_b ? B.sizes[0] : B.sizes[1];
 
 #if defined(TAO_X86)
-  if (!isWeightPrePackingForMatMulEnabled() || !weight_is_const) {
+  bool use_prepacking = isWeightPrePackingForMatMulEnabled() && weight_is_const;
+  if (!use_prepacking && isFp32Gemm<Tinput, Tweight, Toutput>()) {
     dnnl::sgemm(tp_a ? 'T' : 'N', tp_b ? 'T' : 'N', m, n, k, 1.0,
                 reinterpret_cast<const float*>(A.data), A.strides[0],
                 reinterpret_cast<const float*>(B.data), B.strides[0], 0.0,
@@ -749,28 +1044,37 @@ void onednn_ral_gemm(ExecutionContext* ctx, void* stream_handle,
   }
   ideep::matmul_forward::compute(*primitive, src, weight, output);
 #elif defined(TAO_X86)
+  if (!use_prepacking) {
+    ideep::matmul_forward::compute<true>(src, weight, output);
+    return;
+  }
+
+  // For low precision types (e.g. bf16), the expected layout is the blocked
+  // one used by the AVX512-BF16/AMX kernels.
   auto weights_desc =
       ideep::matmul_forward::expected_weights_desc(src, weight, output);
 
-  ideep::tensor packed_weight;
-  std::string unique_name = "tao_ral.cpu.onednn_gemm_" +
-                            tao::ral::TaoTypeNameHelper<Tinput>::Invoke();
-  auto state = ctx->getOrCreateResource<OnednnGemmState>(
-      unique_name, []() { return new OnednnGemmState; });
-  {
-    std::lock_guard<std::mutex> l(state->mu);
-    auto& packed_weights = state->packed_weight_cache[B.data];
-    for (auto& tensor : packed_weights) {
-      if (weights_desc == tensor.get_desc()) {
-        packed_weight = tensor;
-        break;
-      }
-    }
-    if (packed_weight.is_empty()) {
-      packed_weight = weight.reorder_if_differ_in(weights_desc);
-      packed_weights.push_back(packed_weight);
-    }
-  }
+  // The expected layout is determined by the data type and the gemm
+  // configuration. Within a context, the data type is implied by the address
+  // of the weight.
+  auto make_packed_key = [&]() {
+    return PackedWeightKey{
+        getConstWeightId(ctx, B.data),
+        "onednn_matmul_" + tao::ral::TaoTypeNameHelper<Tweight>::Invoke() +
+            "_" + std::to_string(m) + "x" + std::to_string(n) + "x" +
+            std::to_string(k) + (tp_a ? "_t" : "_n") + (tp_b ? "_t" : "_n")};
+  };
+  GEMMParamsKey local_key{m,    n,    k,      1,
+                          tp_a, tp_b, B.data, kDiscCpuDefaultThreadId};
+  auto packed_weight_ptr = getOrCreatePackedWeight<ideep::tensor>(
+      ctx, LocalPackedWeightKey{"onednn_matmul", local_key}, make_packed_key,
+      [&](size_t* bytes) {
+        auto packed = std::make_shared<ideep::tensor>(
+            weight.reorder_if_differ_in(weights_desc));
+        *bytes = packed->get_size();
+        return packed;
+      });
+  ideep::tensor packed_weight = *packed_weight_ptr;
   ideep::matmul_forward::compute</* keep_format */ true,
                                  /* weight_format_any */ true>(
       src, packed_weight, output);
@@ -779,6 +1083,63 @@ void onednn_ral_gemm(ExecutionContext* ctx, void* stream_handle,
 #endif
 }
 
+// Returns the backend to use for the gemm identified by `key`. The first time
+// a key is seen, each candidate backend is timed by calling `run` and the
+// fastest one is recorded in the process-level tuning cache.
+template <typename RunFunc>
+DiscCpuMathKernelMode getOrTuneCpuGemmBackend(const CpuGemmTuningKey& key,
+                                              RunFunc run) {
+  auto& cache = CpuGemmTuningCache::Global();
+  DiscCpuMathKernelMode best_mode;
+  if (cache.find(key, &best_mode)) return best_mode;
+
+#if defined(TAO_X86)
+  std::vector<DiscCpuMathKernelMode> candidates{kDiscPreferMKL,
+                                                kDiscPreferOneDNN};
+#else
+  // MKL is not supported on AArch64, and the ACL kernels are reached through
+  // oneDNN.
+  std::vector<DiscCpuMathKernelMode> candidates{kDiscPreferOneDNN};
+#endif
+
+  best_mode = candidates.front();
+  if (candidates.size() == 1) {
+    cache.insert(key, best_mode);
+    return best_mode;
+  }
+
+  static int iterations = initCpuGemmTuningIterations();
+  int64_t best_ns = std::numeric_limits<int64_t>::max();
+  for (DiscCpuMathKernelMode candidate : candidates) {
+    // Warm-up run, which also excludes one-time costs (e.g. weight packing).
+    run(candidate);
+    int64_t min_ns = std::numeric_limits<int64_t>::max();
+    for (int i = 0; i < iterations; ++i) {
+      auto start = std::chrono::steady_clock::now();
+      run(candidate);
+      auto end = std::chrono::steady_clock::now();
+      min_ns = std::min<int64_t>(
+          min_ns, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      end - start)
+                      .count());
+    }
+    TAO_VLOG(1) << "cpu gemm tuning: m = " << key.m << ", n = " << key.n
+                << ", k = " << key.k << ", batch = " << key.batch
+                << ", tp_a = " << key.transpose_a
+                << ", tp_b = " << key.transpose_b
+                << ", weight_is_const = " << key.weight_is_const
+                << ", backend = "
+                << (candidate == kDiscPreferMKL ? "mkl" : "onednn")
+                << ", time = " << min_ns << " ns";
+    if (min_ns < best_ns) {
+      best_ns = min_ns;
+      best_mode = candidate;
+    }
+  }
+  cache.insert(key, best_mode);
+  return best_mode;
+}
+
 template <typename Tinput, int N = 2, typename Tweight = Tinput,
           typename Toutput = Tinput>
 void ral_gemm(ExecutionContext* ctx, void* stream_handle,
@@ -791,6 +1152,12 @@ void ral_gemm(ExecutionContext* ctx, void* stream_handle,
     return;
   }
 
+  if (!normalizeTransposedMatrix(A, tp_a) ||
+      !normalizeTransposedMatrix(B, tp_b)) {
+    ctx->signalError(Context::FAILURE, "unsupported operand layout for gemm");
+    return;
+  }
+
 #if defined(TAO_AARCH64)
   applyACLThreadPoolConfigIfNotSet();
 #endif
@@ -802,17 +1169,23 @@ void ral_gemm(ExecutionContext* ctx, void* stream_handle,
     return;
   }
   int64_t n = (tp_b ? B.sizes[0] : B.sizes[1]);
+  auto run = [&](DiscCpuMathKernelMode mode) {
+    if (mode == kDiscPreferOneDNN) {
+      onednn_ral_gemm(ctx, stream_handle, A, B, C, tp_a, tp_b,
+                      weight_is_const);
+    } else {
+      assert(mode == kDiscPreferMKL);
+      mkl_ral_gemm(ctx, stream_handle, A, B, C, tp_a, tp_b, weight_is_const);
+    }
+  };
   DiscCpuMathKernelMode mode = GetDiscCpuMathKernelMode();
-  if (mode == kDiscPreferOneDNN) {
-    onednn_ral_gemm(ctx, stream_handle, A, B, C, tp_a, tp_b, weight_is_const);
-  } else if (mode == kDiscPreferMKL) {
-    mkl_ral_gemm(ctx, stream_handle, A, B, C, tp_a, tp_b, weight_is_const);
-  } else {
-    assert(mode == kDiscPreferTuningBasedSelection);
-    ctx->signalError(Context::FAILURE,
-                     "auto tuning mode for cpu gemm is not supported yet.");
-    return;
+  if (!isFp32Gemm<Tinput, Tweight, Toutput>()) {
+    mode = kDiscPreferOneDNN;
+  } else if (mode == kDiscPreferTuningBasedSelection) {
+    CpuGemmTuningKey key{m, n, k, 1, tp_a, tp_b, weight_is_const};
+    mode = getOrTuneCpuGemmBackend(key, run);
   }
+  run(mode);
 
   timer.Stop();
 
@@ -840,6 +1213,10 @@ void ral_gemm(ExecutionContext* ctx, void* stream_handle,
 }
 
 TAO_RAL_API("ral_gemm", "cpu", ral_gemm<float>);
+// Low precision variants. Note that oneDNN requires AVX512-BF16/AMX (or
+// AVX512-FP16 for fp16) to run them efficiently.
+TAO_RAL_API("ral_gemm", "cpu", ral_gemm<Eigen::bfloat16>);
+TAO_RAL_API("ral_gemm", "cpu", ral_gemm<Eigen::half>);
 
 template <typename T, int N>
 int64_t GetBatchSize(MemRefType<T, N> memref) {
@@ -859,6 +1236,11 @@ void mkl_ral_batch_gemm(ExecutionContext* ctx, void* stream_handle,
 #if not defined(TAO_X86)
   ctx->signalError(Context::FAILURE, "mkl_ral_batch_gemm not impl");
 #else
+  if (!isFp32Gemm<Tinput, Tweight, Toutput>()) {
+    ctx->signalError(Context::FAILURE,
+                     "mkl_ral_batch_gemm only supports fp32");
+    return;
+  }
   int b = GetBatchSize(A);
   int m = tp_a ? A.sizes[N - 1] : A.sizes[N - 2];
   int n = tp_b ? B.sizes[N - 2] : B.sizes[N - 1];
@@ -870,12 +1252,13 @@ void mkl_ral_batch_gemm(ExecutionContext* ctx, void* stream_handle,
 
   CBLAS_TRANSPOSE ta = tp_a ? CblasTrans : CblasNoTrans;
   CBLAS_TRANSPOSE tb = tp_b ? CblasTrans : CblasNoTrans;
-  Tinput alpha = 1.0f;
-  Tinput beta = 0.0f;
+  float alpha = 1.0f;
+  float beta = 0.0f;
 
-  cblas_sgemm_batch_strided(CblasRowMajor, ta, tb, m, n, k, alpha, A.data, ldA,
-                            m * k, B.data, ldB, k * n, beta, C.data, ldC, m * n,
-                            b);
+  cblas_sgemm_batch_strided(CblasRowMajor, ta, tb, m, n, k, alpha,
+                            reinterpret_cast<float*>(A.data), ldA, m * k,
+                            reinterpret_cast<float*>(B.data), ldB, k * n, beta,
+                            reinterpret_cast<float*>(C.data), ldC, m * n, b);
 #endif
 }
 
@@ -940,6 +1323,13 @@ void ral_batch_gemm(ExecutionContext* ctx, void* stream_handle,
     return;
   }
 
+  if (!normalizeTransposedMatrix(A, tp_a) ||
+      !normalizeTransposedMatrix(B, tp_b)) {
+    ctx->signalError(Context::FAILURE,
+                     "unsupported operand layout for batch gemm");
+    return;
+  }
+
 #if defined(TAO_AARCH64)
   applyACLThreadPoolConfigIfNotSet();
 #endif
@@ -961,20 +1351,24 @@ void ral_batch_gemm(ExecutionContext* ctx, void* stream_handle,
     return;
   }
 
+  auto run = [&](DiscCpuMathKernelMode mode) {
+    if (mode == kDiscPreferOneDNN) {
+      onednn_ral_batch_gemm(ctx, stream_handle, A, B, C, tp_a, tp_b,
+                            weight_is_const);
+    } else {
+      assert(mode == kDiscPreferMKL);
+      mkl_ral_batch_gemm(ctx, stream_handle, A, B, C, tp_a, tp_b,
+                         weight_is_const);
+    }
+  };
   DiscCpuMathKernelMode mode = GetDiscCpuMathKernelMode();
-  if (mode == kDiscPreferOneDNN) {
-    onednn_ral_batch_gemm(ctx, stream_handle, A, B, C, tp_a, tp_b,
-                          weight_is_const);
-  } else if (mode == kDiscPreferMKL) {
-    mkl_ral_batch_gemm(ctx, stream_handle, A, B, C, tp_a, tp_b,
-                       weight_is_const);
-  } else {
-    assert(mode == kDiscPreferTuningBasedSelection);
-    ctx->signalError(
-        Context::FAILURE,
-        "auto tuning mode for cpu batch gemm is not supported yet.");
-    return;
+  if (!isFp32Gemm<Tinput, Tweight, Toutput>()) {
+    mode = kDiscPreferOneDNN;
+  } else if (mode == kDiscPreferTuningBasedSelection) {
+    CpuGemmTuningKey key{m, n, k, batch_a, tp_a, tp_b, weight_is_const};
+    mode = getOrTuneCpuGemmBackend(key, run);
   }
+  run(mode);
 
   timer.Stop();
   if (isProfilingEnabled()) {
@@ -1005,6 +1399,10 @@ void ral_batch_gemm(ExecutionContext* ctx, void* stream_handle,
 
 TAO_RAL_API("ral_gemm", "cpu", ral_batch_gemm<float, 3>);
 TAO_RAL_API("ral_gemm", "cpu", ral_batch_gemm<float, 4>);
+TAO_RAL_API("ral_gemm", "cpu", ral_batch_gemm<Eigen::bfloat16, 3>);
+TAO_RAL_API("ral_gemm", "cpu", ral_batch_gemm<Eigen::bfloat16, 4>);
+TAO_RAL_API("ral_gemm", "cpu", ral_batch_gemm<Eigen::half, 3>);
+TAO_RAL_API("ral_gemm", "cpu", ral_batch_gemm<Eigen::half, 4>);
 
 }  // namespace ral
 }  // namespace tao
@@ -15,7 +15,14 @@
 #if defined(TAO_CPU_ONLY) && defined(TAO_ENABLE_MKLDNN)
 
 #include <array>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <thread>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "dnnl_threadpool_iface.hpp"
 #include "tensorflow/compiler/mlir/xla/ral/context/common_context_impl.h"
@@ -24,6 +31,7 @@
 #include "tensorflow/compiler/mlir/xla/ral/device/cpu/cpu_driver.h"
 #include "tensorflow/compiler/mlir/xla/ral/ral_base.h"
 #include "tensorflow/compiler/mlir/xla/ral/ral_helper.h"
+#include "third_party/eigen3/Eigen/Core"
 
 #if defined(TAO_AARCH64)
 #include "arm_compute/core/Types.h"
@@ -80,6 +88,16 @@ inline data_type toDataType<int8_t>() {
   return data_type::s8;
 }
 
+template <>
+inline data_type toDataType<Eigen::bfloat16>() {
+  return data_type::bf16;
+}
+
+template <>
+inline data_type toDataType<Eigen::half>() {
+  return data_type::f16;
+}
+
 template <class T>
 inline void hash_combine(std::size_t& seed, const T& v) {
   std::hash<T> hasher;
@@ -169,6 +187,225 @@ inline GEMMParamsKey makeDynamicShapeGEMMParamsKey(
   return key;
 }
 
+struct CpuGemmTuningKeyHasher;
+
+// Key of an auto-tuning result of cpu gemm (see
+// `kDiscPreferTuningBasedSelection`). Unlike `GEMMParamsKey`, it does not
+// depend on the address of the weight nor the calling thread, thus the results
+// can be shared by all the contexts and persisted across processes.
+struct CpuGemmTuningKey {
+  int64_t m = -1;
+  int64_t n = -1;
+  int64_t k = -1;
+  int64_t batch = 1;
+  bool transpose_a = false;
+  bool transpose_b = false;
+  bool weight_is_const = false;
+
+  bool operator==(const CpuGemmTuningKey& rhs) const {
+    return m == rhs.m && n == rhs.n && k == rhs.k && batch == rhs.batch &&
+           transpose_a == rhs.transpose_a && transpose_b == rhs.transpose_b &&
+           weight_is_const == rhs.weight_is_const;
+  }
+
+  using Hasher = CpuGemmTuningKeyHasher;
+};
+
+struct CpuGemmTuningKeyHasher {
+  std::size_t operator()(const CpuGemmTuningKey& key) const {
+    std::size_t seed = std::hash<int64_t>()(key.m);
+    hash_combine(seed, key.n);
+    hash_combine(seed, key.k);
+    hash_combine(seed, key.batch);
+    hash_combine(seed, key.transpose_a);
+    hash_combine(seed, key.transpose_b);
+    hash_combine(seed, key.weight_is_const);
+    return seed;
+  }
+};
+
+// Process-level store of the cpu gemm auto-tuning results.
+//
+// If `DISC_CPU_GEMM_TUNING_CACHE_FILE` is set, the results are loaded from the
+// file when the store is created, and the file is updated each time a new
+// result is added.
+class CpuGemmTuningCache {
+ public:
+  static CpuGemmTuningCache& Global();
+
+  // Returns true and sets `mode` if the key has been tuned.
+  bool find(const CpuGemmTuningKey& key, DiscCpuMathKernelMode* mode);
+  void insert(const CpuGemmTuningKey& key, DiscCpuMathKernelMode mode);
+
+  // Dumps all the results to the file, one result per line. Returns false if
+  // failed.
+  bool exportToFile(const std::string& path);
+  // Loads the results from a file dumped by `exportToFile`. Existing results
+  // are kept. Returns false if failed.
+  bool importFromFile(const std::string& path);
+
+ private:
+  CpuGemmTuningCache();
+  bool exportToFileLocked(const std::string& path);
+
+  std::mutex mu_;
+  std::string cache_file_;
+  std::unordered_map<CpuGemmTuningKey, DiscCpuMathKernelMode,
+                     CpuGemmTuningKey::Hasher>
+      results_;
+};
+
+// Identifies a packed weight: the constant it is packed from (see
+// `getHostConstUniqueId`) and the layout it is packed to, which encodes the
+// backend, the data type and the gemm configuration.
+struct PackedWeightKey {
+  std::string const_id;
+  std::string layout;
+
+  bool operator==(const PackedWeightKey& rhs) const {
+    return const_id == rhs.const_id && layout == rhs.layout;
+  }
+
+  struct Hasher {
+    std::size_t operator()(const PackedWeightKey& key) const {
+      std::size_t seed = std::hash<std::string>()(key.const_id);
+      hash_combine(seed, key.layout);
+      return seed;
+    }
+  };
+};
+
+// Identifies a packed weight within a context, which is cheap to build and
+// look up compared to a `PackedWeightKey`: the packing routine (`kind`, a
+// string literal compared by address) and the gemm configuration, including
+// the address of the constant weight.
+struct LocalPackedWeightKey {
+  const char* kind = nullptr;
+  GEMMParamsKey params;
+
+  bool operator==(const LocalPackedWeightKey& rhs) const {
+    return kind == rhs.kind && params == rhs.params;
+  }
+
+  struct Hasher {
+    std::size_t operator()(const LocalPackedWeightKey& key) const {
+      std::size_t seed = GEMMParamsKeyHasher()(key.params);
+      hash_combine(seed, key.kind);
+      return seed;
+    }
+  };
+};
+
+struct PackedWeightStoreStats {
+  int64_t num_hits = 0;
+  // The hits served by the context-local caches in front of the store.
+  int64_t num_local_hits = 0;
+  int64_t num_misses = 0;
+  int64_t num_evictions = 0;
+  int64_t num_entries = 0;
+  int64_t bytes_in_use = 0;
+  // A non-positive value means no limit.
+  int64_t bytes_limit = 0;
+  // A non-positive value means no limit.
+  int64_t entries_limit = 0;
+};
+
+// Process-level store of the packed constant weights.
+//
+// Entries are keyed by the id of the constant rather than its address, thus
+// contexts sharing constants (e.g. model replicas using the process level
+// const store) also share the packed weights. Each context using an entry
+// holds a reference to it and an entry is dropped once all the contexts
+// referencing it are destroyed. The total size of the entries is bounded by
+// `DISC_CPU_PACKED_WEIGHT_STORE_LIMIT_IN_MB` (no limit by default) and the
+// number of entries by `DISC_CPU_WEIGHT_PRE_PACKING_CACHE_CAPACITY` (1000 by
+// default), the least recently used entries are evicted first when either
+// limit is exceeded.
+class PackedWeightStore {
+ public:
+  using Value = std::shared_ptr<void>;
+  // Packs the weight and sets `bytes` to the size of the packed weight.
+  using Creator = std::function<Value(size_t* bytes)>;
+
+  // The store shared by all the contexts, with the limits set by the env vars.
+  static PackedWeightStore& Global();
+
+  PackedWeightStore(int64_t bytes_limit, int64_t entries_limit);
+
+  // Returns the packed weight of `key` and lets `ctx` reference it. Calls
+  // `creator` if not found. An evicted weight stays valid as long as the
+  // returned value is alive.
+  Value getOrCreate(Context* ctx, const PackedWeightKey& key,
+                    const Creator& creator);
+
+  // Records a hit of a context-local cache on `key`, which marks the entry as
+  // the most recently used one if it is not evicted yet.
+  void recordLocalHit(const PackedWeightKey& key);
+
+  // Drops all the references held by `ctx`.
+  void releaseContext(Context* ctx);
+
+  PackedWeightStoreStats getStats();
+
+ private:
+  using KeySet = std::unordered_set<PackedWeightKey, PackedWeightKey::Hasher>;
+
+  struct Entry {
+    Value value;
+    size_t bytes = 0;
+    std::unordered_set<Context*> owners;
+    std::list<PackedWeightKey>::iterator lru_it;
+  };
+  using EntryMap =
+      std::unordered_map<PackedWeightKey, Entry, PackedWeightKey::Hasher>;
+
+  void eraseLocked(EntryMap::iterator it);
+  void evictLocked();
+
+  std::mutex mu_;
+  // the most recently used one comes first.
+  std::list<PackedWeightKey> lru_;
+  EntryMap entries_;
+  std::unordered_map<Context*, KeySet> context_keys_;
+  PackedWeightStoreStats stats_;
+};
+
+// Context-local cache in front of a `PackedWeightStore`, keyed by a
+// `LocalPackedWeightKey`, thus the store (and the id of the constant) is only
+// looked up on a miss. The references are weak, thus a weight evicted by the
+// store is released as usual, and the expired entries are pruned once the
+// cache doubles its size since the last pruning.
+class LocalPackedWeightCache {
+ public:
+  explicit LocalPackedWeightCache(PackedWeightStore* store) : store_(store) {}
+
+  // Returns the packed weight of `local_key`, or nullptr if not cached or
+  // released. A hit is recorded in the store, keeping the weight from being
+  // evicted as long as the context keeps using it.
+  PackedWeightStore::Value lookup(const LocalPackedWeightKey& local_key);
+
+  // Caches `value`, which is got from the store with `key`.
+  void insert(const LocalPackedWeightKey& local_key, const PackedWeightKey& key,
+              const PackedWeightStore::Value& value);
+
+  // Returns the number of entries, including the expired ones not pruned yet.
+  size_t size();
+
+ private:
+  static constexpr size_t kMinPruneThreshold = 64;
+
+  struct Entry {
+    PackedWeightKey key;
+    std::weak_ptr<void> value;
+  };
+
+  PackedWeightStore* store_;
+  std::mutex mu_;
+  std::unordered_map<LocalPackedWeightKey, Entry, LocalPackedWeightKey::Hasher>
+      entries_;
+  size_t prune_threshold_ = kMinPruneThreshold;
+};
+
 struct ConvParams {
   format_tag input_format;
   format_tag filter_format;
@@ -0,0 +1,154 @@
+// Copyright 2022 The BladeDISC Authors. All rights reserved.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#if defined(TAO_CPU_ONLY) && defined(TAO_ENABLE_MKLDNN)
+
+#include "tensorflow/compiler/mlir/xla/ral/context/common_context_impl_mkldnn.h"
+
+#include "tensorflow/core/platform/test.h"
+
+namespace tao {
+namespace ral {
+namespace {
+
+// The store only uses the contexts as the owners of the entries.
+Context* const kCtx = reinterpret_cast<Context*>(0x1000);
+
+PackedWeightKey makeKey(const std::string& name) {
+  return PackedWeightKey{name, "layout"};
+}
+
+LocalPackedWeightKey makeLocalKey(int64_t i) {
+  GEMMParamsKey params{1, 1, 1, 1, false, false, reinterpret_cast<void*>(i),
+                       std::thread::id{}};
+  return LocalPackedWeightKey{"test", params};
+}
+
+// Gets the weight of `name` from the store, returns true if it is packed by
+// this call.
+bool getOrCreate(PackedWeightStore& store, const std::string& name,
+                 size_t bytes = 1, Context* ctx = kCtx) {
+  bool created = false;
+  store.getOrCreate(ctx, makeKey(name), [&](size_t* size) {
+    created = true;
+    *size = bytes;
+    return std::make_shared<int>(0);
+  });
+  return created;
+}
+
+TEST(PackedWeightStoreTest, LruOrderTest) {
+  PackedWeightStore store(0, 2);
+  EXPECT_TRUE(getOrCreate(store, "a"));
+  EXPECT_TRUE(getOrCreate(store, "b"));
+  // `a` becomes the most recently used one.
+  EXPECT_FALSE(getOrCreate(store, "a"));
+  EXPECT_TRUE(getOrCreate(store, "c"));
+
+  auto stats = store.getStats();
+  EXPECT_EQ(stats.num_entries, 2);
+  EXPECT_EQ(stats.num_evictions, 1);
+  EXPECT_EQ(stats.num_hits, 1);
+  EXPECT_EQ(stats.num_misses, 3);
+  EXPECT_FALSE(getOrCreate(store, "a"));
+  EXPECT_FALSE(getOrCreate(store, "c"));
+  EXPECT_TRUE(getOrCreate(store, "b"));
+}
+
+TEST(PackedWeightStoreTest, BytesLimitTest) {
+  PackedWeightStore store(100, 0);
+  EXPECT_TRUE(getOrCreate(store, "a", 40));
+  EXPECT_TRUE(getOrCreate(store, "b", 40));
+  EXPECT_TRUE(getOrCreate(store, "c", 40));
+  auto stats = store.getStats();
+  EXPECT_EQ(stats.num_entries, 2);
+  EXPECT_EQ(stats.bytes_in_use, 80);
+  EXPECT_EQ(stats.num_evictions, 1);
+
+  // A weight larger than the limit is returned without being cached.
+  EXPECT_TRUE(getOrCreate(store, "d", 200));
+  EXPECT_TRUE(getOrCreate(store, "d", 200));
+  EXPECT_EQ(store.getStats().num_entries, 2);
+  EXPECT_FALSE(getOrCreate(store, "c", 40));
+}
+
+TEST(PackedWeightStoreTest, DefaultLimitTest) {
+  // The number of entries is bounded even if no limit is configured.
+  EXPECT_GT(PackedWeightStore::Global().getStats().entries_limit, 0);
+}
+
+TEST(PackedWeightStoreTest, ReleaseContextTest) {
+  PackedWeightStore store(0, 0);
+  Context* other = reinterpret_cast<Context*>(0x2000);
+  EXPECT_TRUE(getOrCreate(store, "a"));
+  EXPECT_FALSE(getOrCreate(store, "a", 1, other));
+  EXPECT_TRUE(getOrCreate(store, "b", 1, other));
+
+  store.releaseContext(kCtx);
+  EXPECT_EQ(store.getStats().num_entries, 2);
+  store.releaseContext(other);
+  EXPECT_EQ(store.getStats().num_entries, 0);
+}
+
+TEST(LocalPackedWeightCacheTest, LocalHitRefreshesLruTest) {
+  PackedWeightStore store(0, 2);
+  LocalPackedWeightCache cache(&store);
+  for (int64_t i : {1, 2}) {
+    PackedWeightKey key = makeKey(std::to_string(i));
+    auto value = store.getOrCreate(kCtx, key, [](size_t* bytes) {
+      *bytes = 1;
+      return std::make_shared<int>(0);
+    });
+    cache.insert(makeLocalKey(i), key, value);
+  }
+  // Hits `1` locally, thus `2` is the least recently used one in the store.
+  EXPECT_TRUE(cache.lookup(makeLocalKey(1)) != nullptr);
+  EXPECT_EQ(store.getStats().num_local_hits, 1);
+  EXPECT_EQ(store.getStats().num_hits, 0);
+
+  EXPECT_TRUE(getOrCreate(store, "3"));
+  EXPECT_TRUE(cache.lookup(makeLocalKey(1)) != nullptr);
+  EXPECT_TRUE(cache.lookup(makeLocalKey(2)) == nullptr);
+  EXPECT_EQ(store.getStats().num_local_hits, 2);
+  EXPECT_FALSE(getOrCreate(store, "1"));
+  EXPECT_TRUE(getOrCreate(store, "2"));
+}
+
+TEST(LocalPackedWeightCacheTest, PruneTest) {
+  PackedWeightStore store(0, 1);
+  LocalPackedWeightCache cache(&store);
+  std::shared_ptr<void> alive;
+  for (int64_t i = 0; i < 1000; ++i) {
+    PackedWeightKey key = makeKey(std::to_string(i));
+    // Only the last weight is kept by the store, the others are released
+    // once evicted, except for the first one kept alive by the test.
+    auto value = store.getOrCreate(kCtx, key, [](size_t* bytes) {
+      *bytes = 1;
+      return std::make_shared<int>(0);
+    });
+    if (i == 0) alive = value;
+    cache.insert(makeLocalKey(i), key, value);
+  }
+  EXPECT_LT(cache.size(), 128u);
+  EXPECT_TRUE(cache.lookup(makeLocalKey(0)) != nullptr);
+  EXPECT_TRUE(cache.lookup(makeLocalKey(999)) != nullptr);
+
+  // An expired entry is dropped once looked up.
+  size_t size = cache.size();
+  EXPECT_TRUE(cache.lookup(makeLocalKey(998)) == nullptr);
+  EXPECT_EQ(cache.size(), size - 1);
+}
+
+}  // namespace
+}  // namespace ral
+}  // namespace tao
+
+#endif  // defined(TAO_CPU_ONLY) && defined(TAO_ENABLE_MKLDNN)
@@ -44,6 +44,12 @@ void ral_batch_gemm(ExecutionContext* ctx, void* stream_handle,
     ctx->signalError(Context::FAILURE, "ral_batch_gemm input error");
     return;
   }
+  if (!normalizeTransposedMatrix(A, tp_a) ||
+      !normalizeTransposedMatrix(B, tp_b)) {
+    ctx->signalError(Context::FAILURE,
+                     "unsupported operand layout for batch gemm");
+    return;
+  }
 
   // It would be better to use `static_assert` here while we need to support
   // lower gcc version in tao bridge ATM which does not support this well
@@ -111,6 +117,11 @@ void ral_gemm(ExecutionContext* ctx, void* stream_handle, MemRefType<T, 2> A,
                    " is on the road.");
 #endif
   CpuTimer timer("ral_cpu_gemm");
+  if (!normalizeTransposedMatrix(A, tp_a) ||
+      !normalizeTransposedMatrix(B, tp_b)) {
+    ctx->signalError(Context::FAILURE, "unsupported operand layout for gemm");
+    return;
+  }
   long long lda = A.strides[0];
   long long ldb = B.strides[0];
   long long ldc = C.strides[0];
@@ -13,6 +13,7 @@
 #define TENSORFLOW_COMPILER_MLIR_XLA_RAL_CONTEXT_CONTEXT_UTIL_H_
 
 #include <algorithm>
+#include <vector>
 
 #include "tensorflow/compiler/mlir/xla/ral/ral_helper.h"
 #include "tensorflow/compiler/mlir/xla/ral/ral_logging.h"
@@ -66,6 +67,77 @@ tao::ral::MemRefType<T, N> assignMemRef(void* ptr, const ShapeTy& shape) {
   return memref;
 }
 
+// Same as above, but using the given `strides` (in elements) instead of the
+// row-major strides. Empty `strides` stands for the row-major layout.
+template <typename T, int N, typename ShapeTy>
+tao::ral::MemRefType<T, N> assignMemRef(void* ptr, const ShapeTy& shape,
+                                        const ShapeTy& strides) {
+  tao::ral::MemRefType<T, N> memref = assignMemRef<T, N>(ptr, shape);
+  if (strides.empty()) return memref;
+  for (int i = 0; i < N; ++i) {
+    memref.strides[i] = strides[i];
+  }
+
+  if (TAO_VLOG_IS_ON(1)) {
+    print_memref(memref, "assigned strided");
+  }
+
+  return memref;
+}
+
+// Returns true if the `strides` (in elements) describe the row-major layout of
+// the `rank` dims of `sizes`, with the last two dims swapped if
+// `swap_last_two` is true. Strides of the dims having size 1 are ignored.
+inline bool isRowMajorLayout(const int64_t* sizes, const int64_t* strides,
+                             int rank, bool swap_last_two = false) {
+  int64_t stride = 1;
+  for (int i = rank - 1; i >= 0; --i) {
+    int dim = (swap_last_two && i >= rank - 2) ? 2 * rank - 3 - i : i;
+    if (sizes[dim] != 1 && strides[dim] != stride) return false;
+    stride *= sizes[dim];
+  }
+  return true;
+}
+
+// Returns true if the `strides` (in elements) describe the row-major layout of
+// `shape`. Strides of the dims having size 1 are ignored.
+template <typename ShapeTy>
+bool isRowMajorLayout(const ShapeTy& shape, const ShapeTy& strides) {
+  return isRowMajorLayout(shape.data(), strides.data(), shape.size());
+}
+
+// Returns true if the `strides` (in elements) describe a row-major layout of
+// `shape` with its last two dims swapped, i.e. a transposed view of a dense
+// batch of matrices.
+template <typename ShapeTy>
+bool isTransposedRowMajorLayout(const ShapeTy& shape, const ShapeTy& strides) {
+  int rank = shape.size();
+  if (rank < 2) return false;
+  return isRowMajorLayout(shape.data(), strides.data(), rank,
+                          /*swap_last_two=*/true);
+}
+
+// Rewrites `memref`, a (batch of) matrix whose last two dims are laid out
+// transposed (see `isTransposedRowMajorLayout`), to the row-major view of the
+// same buffer with the last two dims swapped, and flips `transposed`
+// accordingly. Such operands come from strided inputs, which gemm kernels
+// consume by flipping the transpose flag instead of copying. Returns false if
+// the layout is neither row-major nor transposed row-major.
+template <typename T, int N>
+bool normalizeTransposedMatrix(tao::ral::MemRefType<T, N>& memref,
+                               bool& transposed) {
+  static_assert(N >= 2, "matrix operands are at least 2d");
+  if (isRowMajorLayout(memref.sizes, memref.strides, N)) return true;
+  if (!isRowMajorLayout(memref.sizes, memref.strides, N,
+                        /*swap_last_two=*/true)) {
+    return false;
+  }
+  std::swap(memref.sizes[N - 1], memref.sizes[N - 2]);
+  std::swap(memref.strides[N - 1], memref.strides[N - 2]);
+  transposed = !transposed;
+  return true;
+}
+
 template <typename T>
 tao::ral::MemRefType<T, 0> assignMemRef_0d(void* ptr) {
   tao::ral::MemRefType<T, 0> memref;
@@ -0,0 +1,155 @@
+// Copyright 2022 The BladeDISC Authors. All rights reserved.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#include "tensorflow/compiler/mlir/xla/ral/context/dynamic_sort_impl.h"
+
+namespace tao {
+namespace ral {
+
+namespace {
+
+// A row is split among threads only if it is at least this long.
+constexpr int64_t kMinLengthForParallelSelection = 64 * 1024;
+
+// Strict total order used to sort the indices of a row: by key, and by index
+// for equal keys, so that the results do not depend on the thread count.
+// NaNs are treated as the largest values.
+template <typename T>
+struct KeyIndexComparator {
+  const T* keys;
+  bool ascending;
+
+  // Always false for integer types.
+  static bool isNaN(T v) { return v != v; }
+
+  bool operator()(int lhs, int rhs) const {
+    T a = keys[lhs];
+    T b = keys[rhs];
+    bool a_nan = isNaN(a);
+    bool b_nan = isNaN(b);
+    if (a_nan || b_nan) {
+      if (a_nan != b_nan) return ascending ? b_nan : a_nan;
+      return lhs < rhs;
+    }
+    if (a != b) return ascending ? a < b : a > b;
+    return lhs < rhs;
+  }
+};
+
+// Moves the first `k` indices in `[first, last)` according to `cmp` to the
+// front of the range and sorts them.
+template <typename Comparator>
+void selectAndSort(int* first, int* last, int64_t k, const Comparator& cmp) {
+  if (k < last - first) std::nth_element(first, first + k, last, cmp);
+  std::sort(first, first + std::min<int64_t>(k, last - first), cmp);
+}
+
+// Writes the first `k` elements of a row into `okey` and `oval`. `indices`
+// is used as the scratch space, and is of the length of the row.
+template <typename Tkey, typename Tval>
+void topKRow(const Tkey* ikey, const Tval* ival, Tkey* okey, Tval* oval,
+             int64_t length, int64_t k, bool ascending, int num_threads,
+             std::vector<int>& indices) {
+  KeyIndexComparator<Tkey> cmp{ikey, ascending};
+  indices.resize(length);
+  std::iota(indices.begin(), indices.end(), 0);
+  if (num_threads > 1 && k * num_threads < length) {
+    // Each thread selects the candidates from its own chunk, the final
+    // results are then selected from the (much fewer) candidates.
+    int64_t chunk = (length + num_threads - 1) / num_threads;
+    std::vector<int> candidates(k * num_threads);
+    std::vector<int64_t> num_candidates(num_threads, 0);
+#pragma omp parallel for schedule(static) num_threads(num_threads)
+    for (int t = 0; t < num_threads; ++t) {
+      int64_t begin = std::min<int64_t>(t * chunk, length);
+      int64_t end = std::min<int64_t>(begin + chunk, length);
+      int* first = indices.data() + begin;
+      int* last = indices.data() + end;
+      int64_t n = std::min<int64_t>(k, end - begin);
+      if (n < end - begin) std::nth_element(first, first + n, last, cmp);
+      std::copy(first, first + n, candidates.data() + t * k);
+      num_candidates[t] = n;
+    }
+    int64_t total = 0;
+    for (int t = 0; t < num_threads; ++t) {
+      std::copy(candidates.data() + t * k,
+                candidates.data() + t * k + num_candidates[t],
+                indices.data() + total);
+      total += num_candidates[t];
+    }
+    selectAndSort(indices.data(), indices.data() + total, k, cmp);
+  } else {
+    selectAndSort(indices.data(), indices.data() + length, k, cmp);
+  }
+  for (int64_t i = 0; i < k; ++i) {
+    okey[i] = ikey[indices[i]];
+    oval[i] = ival[indices[i]];
+  }
+}
+
+}  // namespace
+
+// Sorts each row of `keys` (the innermost dimension) and writes the first `k`
+// keys and the corresponding values to the outputs. `k == -1` means the whole
+// row.
+template <typename Tkey, typename Tval, unsigned int Rank = 1>
+void ral_cpu_dsort(ExecutionContext* ctx, void* stream_handle,
+                   MemRefType<Tkey, Rank> keys, MemRefType<Tval, Rank> values,
+                   MemRefType<int32_t, 0> k, MemRefType<Tkey, Rank> out_keys,
+                   MemRefType<Tval, Rank> out_values, int64_t dimension,
+                   bool is_ascending) {
+  int64_t top_k = *(k.data);
+  if (top_k < -1) {
+    ctx->signalError(Context::FAILURE, "Invalid ral_dsort with top k < -1");
+    return;
+  }
+  auto desc = makeSortDescriptor(ctx, Rank, keys.sizes, is_ascending);
+  if (top_k > desc.sort_length) {
+    ctx->signalError(Context::FAILURE,
+                     "Invalid Topk Sort with k > sorting length");
+    return;
+  }
+  if (top_k == -1) top_k = desc.sort_length;
+  if (desc.batch == 0 || top_k == 0) return;
+
+  CpuTimer timer("ral_cpu_dsort");
+  int64_t length = desc.sort_length;
+  int num_cores = getNumAvailableCores();
+  int num_threads =
+      std::max<int>(1, std::min<int64_t>(num_cores, desc.batch));
+  if (desc.batch * length < kMinLengthForParallelSelection) num_threads = 1;
+  // Rows are distributed among threads. A single long row is split among
+  // threads instead.
+  int threads_per_row = 1;
+  if (desc.batch == 1 && length >= kMinLengthForParallelSelection) {
+    threads_per_row = num_cores;
+  }
+
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads)
+  for (int64_t b = 0; b < desc.batch; ++b) {
+    thread_local std::vector<int> indices;
+    topKRow(keys.data + b * length, values.data + b * length,
+            out_keys.data + b * top_k, out_values.data + b * top_k, length,
+            top_k, is_ascending, threads_per_row, indices);
+  }
+}
+
+TAO_RAL_API("ral_dsort", "cpu", ral_cpu_dsort<float, int, 1>);
+TAO_RAL_API("ral_dsort", "cpu", ral_cpu_dsort<int, int, 1>);
+TAO_RAL_API("ral_dsort", "cpu", ral_cpu_dsort<float, int, 2>);
+TAO_RAL_API("ral_dsort", "cpu", ral_cpu_dsort<int, int, 2>);
+
+}  // namespace ral
+}  // namespace tao
@@ -9,13 +9,12 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-#include <cassert>
 #include <mutex>
-#include <random>
 #include <unordered_map>
 #include <vector>
 
 #include "tensorflow/compiler/mlir/xla/ral/context/context_util.h"
+#include "tensorflow/compiler/mlir/xla/ral/context/custom_library/guarded_philox_random.h"
 #include "tensorflow/compiler/mlir/xla/ral/context/custom_library/random.h"
 #include "tensorflow/compiler/mlir/xla/ral/device/gpu/gpu_driver.h"
 #include "tensorflow/compiler/mlir/xla/ral/ral_context.h"
@@ -34,66 +33,6 @@ namespace tao {
 namespace ral {
 namespace random {
 
-std::mt19937_64* InitRngWithRandomSeed() {
-  std::random_device device("/dev/urandom");
-  return new std::mt19937_64(device());
-}
-
-uint64_t New64() {
-  static std::mt19937_64* rng = InitRngWithRandomSeed();
-  static std::mutex mu;
-  std::lock_guard<std::mutex> l(mu);
-  return (*rng)();
-}
-
-class GuardedPhiloxRandom {
- public:
-  // Must call Init to finish initialization
-  GuardedPhiloxRandom(int64_t seed, int64_t seed2) : initialized_(false) {
-    Init(seed, seed2);
-  }
-
-  // Initialize with given seeds.
-  void Init(int64_t seed, int64_t seed2) {
-    assert(!initialized_);
-    if (seed == 0 && seed2 == 0) {
-      // If both seeds are unspecified, use completely random seeds.
-      seed = New64();
-      seed2 = New64();
-    }
-    std::lock_guard<std::mutex> l(mu_);
-    generator_ = PhiloxRandom(seed, seed2);
-    initialized_ = true;
-  }
-
-  // Reserve a certain number of 128-bit samples.
-  // This function is thread safe.  The returned generator is valid for the
-  // given number of samples, and can be used without a lock.
-  PhiloxRandom ReserveSamples128(int64_t samples) {
-    assert(initialized_);
-    std::lock_guard<std::mutex> l(mu_);
-    auto local = generator_;
-    generator_.Skip(samples);
-    return local;
-  }
-
-  // Reserve a certain number of 32-bit samples.
-  PhiloxRandom ReserveSamples32(int64_t samples) {
-    return ReserveSamples128((samples + 3) / 4);
-  }
-
-  // Reserve enough random samples in the generator for the given output count.
-  PhiloxRandom ReserveRandomOutputs(int64_t output_count, int multiplier) {
-    int64_t conservative_sample_count = output_count * multiplier;
-    return ReserveSamples128(conservative_sample_count);
-  }
-
- private:
-  std::mutex mu_;
-  PhiloxRandom generator_;
-  bool initialized_;
-};
-
 struct RalRngUniformState : public Context::Resource {
   std::mutex mu;
   using GeneratorType =
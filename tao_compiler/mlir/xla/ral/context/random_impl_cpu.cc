@@ -0,0 +1,130 @@
+// Copyright 2022 The BladeDISC Authors. All rights reserved.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <omp.h>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "tensorflow/compiler/mlir/xla/ral/context/common_context_impl.h"
+#include "tensorflow/compiler/mlir/xla/ral/context/context_util.h"
+#include "tensorflow/compiler/mlir/xla/ral/context/custom_library/guarded_philox_random.h"
+#include "tensorflow/compiler/mlir/xla/ral/context/custom_library/random.h"
+#include "tensorflow/compiler/mlir/xla/ral/ral_context.h"
+#include "tensorflow/compiler/mlir/xla/ral/ral_helper.h"
+#include "tensorflow/compiler/mlir/xla/ral/ral_logging.h"
+
+namespace tao {
+namespace ral {
+namespace random {
+
+namespace {
+
+// Below this number of elements, the samples are generated on the calling
+// thread.
+constexpr int64_t kMinElementsForParallelRandom = 16 * 1024;
+
+struct RalCpuRngUniformState : public Context::Resource {
+  std::mutex mu;
+  std::unordered_map<int64_t, std::unique_ptr<GuardedPhiloxRandom>> generators;
+};
+
+// The i-th group of `kResultElementCount` outputs is always generated from
+// the i-th sample of `gen`, thus the results do not depend on the number of
+// threads.
+template <class Distribution>
+void fillPhiloxRandomCpu(PhiloxRandom gen,
+                         typename Distribution::ResultElementType* data,
+                         int64_t size, Distribution dist) {
+  constexpr int kGroupSize = Distribution::kResultElementCount;
+  int64_t num_groups = (size + kGroupSize - 1) / kGroupSize;
+  int num_threads = size < kMinElementsForParallelRandom
+                        ? 1
+                        : static_cast<int>(std::min<int64_t>(
+                              getNumAvailableCores(), num_groups));
+#pragma omp parallel num_threads(num_threads)
+  {
+    int tid = omp_get_thread_num();
+    int nthreads = omp_get_num_threads();
+    int64_t groups_per_thread = (num_groups + nthreads - 1) / nthreads;
+    int64_t begin = std::min<int64_t>(tid * groups_per_thread, num_groups);
+    int64_t end = std::min<int64_t>(begin + groups_per_thread, num_groups);
+    // Each thread uses its own copy of the generator, starting at the counter
+    // of its first group.
+    PhiloxRandom local_gen = gen;
+    local_gen.Skip(begin);
+    for (int64_t group = begin; group < end; ++group) {
+      auto samples = dist(&local_gen);
+      int64_t offset = group * kGroupSize;
+      int64_t n = std::min<int64_t>(kGroupSize, size - offset);
+      for (int64_t i = 0; i < n; ++i) data[offset + i] = samples[i];
+    }
+  }
+}
+
+}  // namespace
+
+template <typename T, int N, typename Tidx = int>
+void ral_cpu_random_uniform(ExecutionContext* ctx, void* stream_handle,
+                            MemRefType<T, 0> start, MemRefType<T, 0> limit,
+                            MemRefType<Tidx, 1>, MemRefType<T, N> output,
+                            int64_t id, int64_t seed, int64_t seed2) {
+  T a = *start.data;
+  T b = *limit.data;
+  TAO_VLOG(2) << "random id#" << id << ":\n"
+              << "\tseed: (" << seed << "," << seed2 << ")\n"
+              << "\tstart: " << a << "\n"
+              << "\tlimit: " << b;
+  std::string unique_name =
+      "tao_ral.cpu.rng_uniform." + tao::ral::TaoTypeNameHelper<T>::Invoke();
+  auto state = ctx->getOrCreateResource<RalCpuRngUniformState>(
+      unique_name, []() { return new RalCpuRngUniformState; });
+
+  GuardedPhiloxRandom* generator = nullptr;
+  {
+    std::lock_guard<std::mutex> l(state->mu);
+    auto it = state->generators.find(id);
+    if (it == state->generators.end()) {
+      auto r = std::unique_ptr<GuardedPhiloxRandom>(
+          new GuardedPhiloxRandom(seed, seed2));
+      it = state->generators.emplace(id, std::move(r)).first;
+    }
+    generator = it->second.get();
+  }
+  int64_t nelem = Size(output);
+  TAO_VLOG(2) << "nelem = " << nelem;
+  CpuTimer timer("ral_cpu_rng_uniform");
+  using Distribution = UniformDistribution<PhiloxRandom, T>;
+  // Reserves the same number of samples as the gpu version, thus consecutive
+  // calls draw disjoint samples.
+  fillPhiloxRandomCpu(generator->ReserveRandomOutputs(nelem, 256), output.data,
+                      nelem, Distribution(a, b));
+}
+
+}  // namespace random
+
+TAO_RAL_API("ral_gpu_rng_uniform", "cpu",
+            random::ral_cpu_random_uniform<float, 1>);
+TAO_RAL_API("ral_gpu_rng_uniform", "cpu",
+            random::ral_cpu_random_uniform<float, 2>);
+TAO_RAL_API("ral_gpu_rng_uniform", "cpu",
+            random::ral_cpu_random_uniform<float, 3>);
+TAO_RAL_API("ral_gpu_rng_uniform", "cpu",
+            random::ral_cpu_random_uniform<float, 4>);
+TAO_RAL_API("ral_gpu_rng_uniform", "cpu",
+            random::ral_cpu_random_uniform<float, 5>);
+TAO_RAL_API("ral_gpu_rng_uniform", "cpu",
+            random::ral_cpu_random_uniform<float, 6>);
+
+}  // namespace ral
+}  // namespace tao
@@ -328,6 +328,12 @@ void ral_gemm(ExecutionContext* ctx, void* stream_handle, MemRefType<InT, 2> A,
     return;
   }
 
+  if (!normalizeTransposedMatrix(A, tp_a) ||
+      !normalizeTransposedMatrix(B, tp_b)) {
+    ctx->signalError(Context::FAILURE, "unsupported operand layout for gemm");
+    return;
+  }
+
 #if defined(PLATFORM_ALIBABA) and defined(ENABLE_BLADE_GEMM)
   {
     auto gpu_driver = ctx->getDriver<GPUDriver>(GPUDriver::name());
@@ -603,6 +609,13 @@ void ral_batch_gemm(ExecutionContext* ctx, void* stream_handle,
     return;
   }
 
+  if (!normalizeTransposedMatrix(A, tp_a) ||
+      !normalizeTransposedMatrix(B, tp_b)) {
+    ctx->signalError(Context::FAILURE,
+                     "unsupported operand layout for batch gemm");
+    return;
+  }
+
   // It would be better to use `static_assert` here while we need to support
   // lower gcc version in tao bridge ATM which does not support this well
   assert((N > 2) && "batch gemm requires operands with rank higher than 2");
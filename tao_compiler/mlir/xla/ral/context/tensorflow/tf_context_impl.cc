@@ -47,6 +47,8 @@ constexpr int kMaxEmptyTensorPointerWrapperSlotId = 1024 * 512 - 1;
 struct RalTfExecutionContext::Impl {
   // TF op context
   OpKernelContext* op_ctx;
+  // Inputs replacing the ones of `op_ctx`.
+  std::unordered_map<int, Tensor> inputs;
   // Allocated buffers are backed by TF tensors.
   // This makes sure that we do not need to copy output buffer
   // to tensorflow context.
@@ -128,8 +130,7 @@ RalTfContext::RalTfContext(const RalTfContextOptions& options) {
 
       // The metadata file is loaded once. The data will
       // be erased from metadata file once memcpy is done;
-      if ((state->metadata = tao::ral::MetadataFile::loadFromFile(
-               options.metadata_file_path))) {
+      if (state->loadMetadataFile(options.metadata_file_path)) {
         return state;
       } else {
         delete state;
@@ -154,6 +155,16 @@ void RalTfExecutionContext::setOpContext(OpKernelContext* ctx) {
 
 OpKernelContext* RalTfExecutionContext::getOpContext() { return impl_->op_ctx; }
 
+void RalTfExecutionContext::setInput(int idx, const Tensor& tensor) {
+  impl_->inputs[idx] = tensor;
+}
+
+const Tensor& RalTfExecutionContext::getInput(int idx) {
+  auto it = impl_->inputs.find(idx);
+  if (it != impl_->inputs.end()) return it->second;
+  return impl_->op_ctx->input(idx);
+}
+
 // ============================================================================
 // ========================== gpu drvier api impl =============================
 // ============================================================================
@@ -219,6 +230,11 @@ buffer_t ral_tf_gpu_alloc(ExecutionContext* ctx, size_t bytes) {
   return ptr;
 }
 
+buffer_t ral_tf_gpu_alloc_output(ExecutionContext* ctx, int64_t output_idx,
+                                 size_t bytes) {
+  return ral_tf_gpu_alloc(ctx, bytes);
+}
+
 buffer_t ral_tf_gpu_alloc_persistent(ExecutionContext* ctx, size_t bytes) {
   auto ral_tf_ctx = dynamic_cast<RalTfExecutionContext*>(ctx);
   auto* state = ctx->getResource<RalTFContextState>(kRalTFContextState);
@@ -278,6 +294,13 @@ buffer_t ral_tf_cpu_alloc(ExecutionContext* ctx, size_t bytes) {
   return ptr;
 }
 
+// Caller-provided output buffers are not supported by the tf context, thus
+// outputs are always allocated as regular buffers.
+buffer_t ral_tf_cpu_alloc_output(ExecutionContext* ctx, int64_t output_idx,
+                                 size_t bytes) {
+  return ral_tf_cpu_alloc(ctx, bytes);
+}
+
 buffer_t ral_tf_cpu_alloc_persistent(ExecutionContext* ctx, size_t bytes) {
   auto ral_tf_ctx = dynamic_cast<RalTfExecutionContext*>(ctx);
   auto* state = ctx->getResource<RalTFContextState>(kRalTFContextState);
@@ -605,7 +628,7 @@ template <typename T, int N>
 
   auto ral_tf_ctx = dynamic_cast<RalTfExecutionContext*>(ctx);
 
-  Tensor tensor = ral_tf_ctx->getOpContext()->input(input_idx);
+  Tensor tensor = ral_tf_ctx->getInput(input_idx);
   memref.basePtr = (T*)(tensor.tensor_data().data());
   memref.data = memref.basePtr;
   memref.offset = 0;
@@ -636,7 +659,7 @@ template <typename T>
 
   auto ral_tf_ctx = dynamic_cast<RalTfExecutionContext*>(ctx);
 
-  Tensor tensor = ral_tf_ctx->getOpContext()->input(input_idx);
+  Tensor tensor = ral_tf_ctx->getInput(input_idx);
   memref.basePtr = (T*)(tensor.tensor_data().data());
   memref.data = memref.basePtr;
   memref.offset = 0;
@@ -858,6 +881,8 @@ void ral_tf_send_output_0d(ExecutionContext* ctx, int64_t output_idx,
                                          int64_t output_idx,                \
                                          ::tao::ral::MemRefType<T, N>);     \
   TAO_RAL_API(::tao::ral::kRalRecvInput, "cpu", ral_tf_recv_input<T, N>);   \
+  TAO_RAL_API(::tao::ral::kRalRecvStridedInput, "cpu",                      \
+              ral_tf_recv_input<T, N>);                                     \
   TAO_RAL_API(::tao::ral::kRalSendOutput, "cpu", ral_tf_send_output<T, N>); \
   TAO_RAL_API(::tao::ral::kRalBitcast, "gpu", ral_tf_bitcast<T, N>);        \
   TAO_RAL_API(::tao::ral::kRalBitcast, "gpu", ral_tf_bitcast<T, 0, N>);     \
@@ -911,6 +936,7 @@ void ral_tf_send_output_0d(ExecutionContext* ctx, int64_t output_idx,
 RAL_REGISTER_IO_FUNC_0D(float);
 RAL_REGISTER_IO_FUNC_0D(double);
 RAL_REGISTER_IO_FUNC_0D(Eigen::half);
+RAL_REGISTER_IO_FUNC_0D(Eigen::bfloat16);
 RAL_REGISTER_IO_FUNC_0D(int8_t);
 RAL_REGISTER_IO_FUNC_0D(int32_t);
 RAL_REGISTER_IO_FUNC_0D(int64_t);
@@ -940,6 +966,14 @@ RAL_REGISTER_IO_FUNC(Eigen::half, 5);
 RAL_REGISTER_IO_FUNC(Eigen::half, 6);
 RAL_REGISTER_IO_FUNC(Eigen::half, 7);
 RAL_REGISTER_IO_FUNC(Eigen::half, 8);
+RAL_REGISTER_IO_FUNC(Eigen::bfloat16, 1);
+RAL_REGISTER_IO_FUNC(Eigen::bfloat16, 2);
+RAL_REGISTER_IO_FUNC(Eigen::bfloat16, 3);
+RAL_REGISTER_IO_FUNC(Eigen::bfloat16, 4);
+RAL_REGISTER_IO_FUNC(Eigen::bfloat16, 5);
+RAL_REGISTER_IO_FUNC(Eigen::bfloat16, 6);
+RAL_REGISTER_IO_FUNC(Eigen::bfloat16, 7);
+RAL_REGISTER_IO_FUNC(Eigen::bfloat16, 8);
 RAL_REGISTER_IO_FUNC(int8_t, 1);
 RAL_REGISTER_IO_FUNC(int8_t, 2);
 RAL_REGISTER_IO_FUNC(int8_t, 3);
@@ -987,15 +1021,20 @@ namespace tao {
 namespace ral {
 
 DEFINE_TAO_TYPE_NAME_HELPER(Eigen::half, "f16");
+DEFINE_TAO_TYPE_NAME_HELPER(Eigen::bfloat16, "bf16");
 
 TAO_RAL_API(::tao::ral::cpu::kRalCpuAlloc, "cpu", tensorflow::ral_tf_cpu_alloc);
 TAO_RAL_API(::tao::ral::cpu::kRalCpuAllocPersistent, "cpu",
             tensorflow::ral_tf_cpu_alloc_persistent);
+TAO_RAL_API(::tao::ral::kRalAllocOutput, "cpu",
+            tensorflow::ral_tf_cpu_alloc_output);
 TAO_RAL_API(::tao::ral::cpu::kRalCpuDealloc, "cpu",
             tensorflow::ral_tf_cpu_dealloc);
 TAO_RAL_API(::tao::ral::gpu::kRalGpuAlloc, "gpu", tensorflow::ral_tf_gpu_alloc);
 TAO_RAL_API(::tao::ral::gpu::kRalGpuAllocPersistent, "gpu",
             tensorflow::ral_tf_gpu_alloc_persistent);
+TAO_RAL_API(::tao::ral::kRalAllocOutput, "gpu",
+            tensorflow::ral_tf_gpu_alloc_output);
 TAO_RAL_API(::tao::ral::gpu::kRalGpuDealloc, "gpu",
             tensorflow::ral_tf_gpu_dealloc);
 TAO_RAL_API(::tao::ral::gpu::kRalGpuLaunch, "gpu",
@@ -58,6 +58,12 @@ class RalTfExecutionContext : public ::tao::ral::ExecutionContext {
   OpKernelContext* getOpContext();
   void setOpContext(OpKernelContext* ctx);
 
+  // Replaces the input #`idx` of the op context, e.g. with the input padded
+  // to its bucketed shape.
+  void setInput(int idx, const Tensor& tensor);
+  // Returns the input #`idx`, which is the replaced one if any.
+  const Tensor& getInput(int idx);
+
   struct Impl;
   Impl* getImpl() { return impl_.get(); };
 
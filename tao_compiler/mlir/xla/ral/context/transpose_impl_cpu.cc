@@ -0,0 +1,157 @@
+// Copyright 2022 The BladeDISC Authors. All rights reserved.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstring>
+
+#include "tensorflow/compiler/mlir/xla/ral/context/common_context_impl.h"
+#include "tensorflow/compiler/mlir/xla/ral/context/context_util.h"
+#include "tensorflow/compiler/mlir/xla/ral/ral_context.h"
+#include "tensorflow/compiler/mlir/xla/ral/ral_helper.h"
+#include "tensorflow/compiler/mlir/xla/ral/ral_logging.h"
+
+namespace tao {
+namespace ral {
+
+namespace {
+
+// The inner matrices are transposed tile by tile, thus both the loads and the
+// stores of a tile stay in L1 cache.
+constexpr int64_t kTransposeTileSize = 32;
+
+// Below this number of elements, the transpose runs on the calling thread.
+constexpr int64_t kMinElementsForParallelTranspose = 64 * 1024;
+
+// Transposes the [r0, r1) x [c0, c1) tile of a `rows` x `cols` row-major
+// matrix.
+template <typename T>
+inline void transposeTile(const T* in, T* out, int64_t rows, int64_t cols,
+                          int64_t r0, int64_t r1, int64_t c0, int64_t c1) {
+  for (int64_t c = c0; c < c1; ++c) {
+    T* dst = out + c * rows;
+    const T* src = in + c;
+#pragma omp simd
+    for (int64_t r = r0; r < r1; ++r) {
+      dst[r] = src[r * cols];
+    }
+  }
+}
+
+// Transposes `batch` independent `rows` x `cols` matrices.
+template <typename T>
+void batchTranspose2D(const T* in, T* out, int64_t batch, int64_t rows,
+                      int64_t cols) {
+  int64_t row_tiles = (rows + kTransposeTileSize - 1) / kTransposeTileSize;
+  int64_t col_tiles = (cols + kTransposeTileSize - 1) / kTransposeTileSize;
+  int64_t tiles_per_matrix = row_tiles * col_tiles;
+  int64_t num_tiles = batch * tiles_per_matrix;
+  int64_t matrix_size = rows * cols;
+  int num_threads =
+      batch * matrix_size < kMinElementsForParallelTranspose
+          ? 1
+          : static_cast<int>(std::min<int64_t>(getNumAvailableCores(),
+                                               num_tiles));
+#pragma omp parallel for schedule(static) num_threads(num_threads)
+  for (int64_t tile = 0; tile < num_tiles; ++tile) {
+    int64_t b = tile / tiles_per_matrix;
+    int64_t r = (tile % tiles_per_matrix) / col_tiles * kTransposeTileSize;
+    int64_t c = (tile % col_tiles) * kTransposeTileSize;
+    transposeTile(in + b * matrix_size, out + b * matrix_size, rows, cols, r,
+                  std::min(r + kTransposeTileSize, rows), c,
+                  std::min(c + kTransposeTileSize, cols));
+  }
+}
+
+// Fallback for the permutations that do not swap the two innermost dims of a
+// batch of matrices.
+template <typename T, int N>
+void genericTranspose(const T* in, T* out, const int64_t* in_sizes,
+                      const int* permutation) {
+  int64_t in_strides[N];
+  in_strides[N - 1] = 1;
+  for (int i = N - 2; i >= 0; --i) {
+    in_strides[i] = in_strides[i + 1] * in_sizes[i + 1];
+  }
+  int64_t out_sizes[N];
+  int64_t perm_strides[N];
+  for (int i = 0; i < N; ++i) {
+    out_sizes[i] = in_sizes[permutation[i]];
+    perm_strides[i] = in_strides[permutation[i]];
+  }
+  int64_t outer = out_sizes[0];
+  int64_t inner = 1;
+  for (int i = 1; i < N; ++i) inner *= out_sizes[i];
+  int num_threads = outer * inner < kMinElementsForParallelTranspose
+                        ? 1
+                        : static_cast<int>(std::min<int64_t>(
+                              getNumAvailableCores(), outer));
+#pragma omp parallel for schedule(static) num_threads(num_threads)
+  for (int64_t i = 0; i < outer; ++i) {
+    T* dst = out + i * inner;
+    for (int64_t j = 0; j < inner; ++j) {
+      int64_t offset = i * perm_strides[0];
+      int64_t linear = j;
+      for (int d = N - 1; d > 0; --d) {
+        offset += (linear % out_sizes[d]) * perm_strides[d];
+        linear /= out_sizes[d];
+      }
+      dst[j] = in[offset];
+    }
+  }
+}
+
+}  // namespace
+
+template <typename T, int N>
+void ral_cpu_transpose(ExecutionContext* ctx, void* stream_handle,
+                       MemRefType<T, N> input, MemRefType<int, 1> permute_value,
+                       MemRefType<T, N> output) {
+  static_assert(N == 2 || N == 3,
+                "input of ral_transpose op should be rank2 or rank3 tensor");
+  if (permute_value.sizes[0] != N) {
+    ctx->signalError(Context::FAILURE, "mismatch ral_transpose permutation");
+    return;
+  }
+  const int* permutation = permute_value.data;
+  CpuTimer timer("ral_cpu_transpose");
+  int64_t num_elements = Size(input);
+  if (num_elements == 0) return;
+
+  bool is_identity = true;
+  for (int i = 0; i < N; ++i) is_identity &= (permutation[i] == i);
+  if (is_identity) {
+    std::memcpy(output.data, input.data, num_elements * sizeof(T));
+    return;
+  }
+
+  // [1, 0] for rank-2 and [0, 2, 1] for rank-3 inputs.
+  if (permutation[N - 1] == N - 2 && permutation[N - 2] == N - 1 &&
+      (N == 2 || permutation[0] == 0)) {
+    int64_t batch = N == 2 ? 1 : input.sizes[0];
+    batchTranspose2D(input.data, output.data, batch, input.sizes[N - 2],
+                     input.sizes[N - 1]);
+    return;
+  }
+
+  genericTranspose<T, N>(input.data, output.data, input.sizes, permutation);
+}
+
+TAO_RAL_API("ral_transpose", "cpu", ral_cpu_transpose<float, 2>);
+TAO_RAL_API("ral_transpose", "cpu", ral_cpu_transpose<float, 3>);
+TAO_RAL_API("ral_transpose", "cpu", ral_cpu_transpose<double, 2>);
+TAO_RAL_API("ral_transpose", "cpu", ral_cpu_transpose<double, 3>);
+TAO_RAL_API("ral_transpose", "cpu", ral_cpu_transpose<int32_t, 2>);
+TAO_RAL_API("ral_transpose", "cpu", ral_cpu_transpose<int32_t, 3>);
+TAO_RAL_API("ral_transpose", "cpu", ral_cpu_transpose<int64_t, 2>);
+TAO_RAL_API("ral_transpose", "cpu", ral_cpu_transpose<int64_t, 3>);
+
+}  //  namespace ral
+}  //  namespace tao
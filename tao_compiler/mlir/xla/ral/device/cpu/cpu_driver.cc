@@ -28,18 +28,21 @@ namespace cpu {
 
 const char* kRalCpuAlloc = "alloc";
 const char* kRalCpuAllocPersistent = "ral_cpu_alloc_persistent";
+const char* kRalCpuRegisterPersistent = "ral_cpu_register_persistent";
 const char* kRalCpuDealloc = "dealloc";
 const char* kRalCpuRawAlloc = "raw_cpu_alloc";
 const char* kRalCpuRawDealloc = "raw_cpu_dealloc";
 const char* kRalCpuMemcpy = "ral_cpu_memcpy";
 const char* kRalCpuMemset = "ral_cpu_memset";
 const char* kRalCpuLaunch = "ral_kernel_launch";
+const char* kRalCpuLaunchDeferred = "ral_kernel_launch_deferred";
 
 struct CPUDriver::Impl {
   Context* context;
   using T = ExecutionContext*;
   std::function<buffer_t(T, size_t)> alloc;
   std::function<buffer_t(T, size_t)> alloc_persistent;
+  std::function<void(T, buffer_t)> register_persistent;
   std::function<buffer_t(Context*, size_t)> raw_alloc;
   std::function<void(Context*, buffer_t)> raw_dealloc;
   std::function<void(T, buffer_t)> dealloc;
@@ -58,6 +61,8 @@ CPUDriver::CPUDriver(Context* context) : impl_(new CPUDriver::Impl) {
           std::string(kRalCpuAlloc) + "___cpu")));
   TAO_RAL_ASSIGN_TO_API_FUNC_WRAPPER(impl_->alloc_persistent,
                                      context->find(kRalCpuAllocPersistent));
+  TAO_RAL_ASSIGN_TO_API_FUNC_WRAPPER(impl_->register_persistent,
+                                     context->find(kRalCpuRegisterPersistent));
   TAO_RAL_ASSIGN_TO_API_FUNC_WRAPPER(
       impl_->dealloc,
       context->find(TaoRalApiFuncNameHelper<decltype(impl_->dealloc)>::Invoke(
@@ -97,6 +102,13 @@ buffer_t CPUDriver::alloc_persistent(ExecutionContext* ctx, size_t bytes) {
   return impl_->alloc_persistent(ctx, bytes);
 }
 
+bool CPUDriver::register_persistent(ExecutionContext* ctx, buffer_t buffer) {
+  // Optional, the caller is supposed to fall back to `alloc_persistent`.
+  if (!impl_->register_persistent) return false;
+  impl_->register_persistent(ctx, buffer);
+  return true;
+}
+
 void CPUDriver::dealloc(ExecutionContext* ctx, buffer_t buffer) {
   if (!impl_->dealloc) {
     impl_->context->signalError(
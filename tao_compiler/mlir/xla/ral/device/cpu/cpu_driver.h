@@ -34,12 +34,14 @@ namespace cpu {
 
 extern const char* kRalCpuAlloc;
 extern const char* kRalCpuAllocPersistent;
+extern const char* kRalCpuRegisterPersistent;
 extern const char* kRalCpuDealloc;
 extern const char* kRalCpuRawAlloc;
 extern const char* kRalCpuRawDealloc;
 extern const char* kRalCpuMemcpy;
 extern const char* kRalCpuMemset;
 extern const char* kRalCpuLaunch;
+extern const char* kRalCpuLaunchDeferred;
 
 using CpuLaunchDims = MemRefType<int64_t, 1>;
 
@@ -56,6 +58,11 @@ class CPUDriver : public Driver {
   buffer_t alloc_persistent(ExecutionContext* ctx, size_t);
   void dealloc(ExecutionContext* ctx, buffer_t);
 
+  // Marks a buffer not allocated by the driver (e.g. a const mapped from the
+  // const blob file) as a persistent one, thus it's never freed by the context
+  // and outlives the execution. Returns false if not supported by the context.
+  bool register_persistent(ExecutionContext* ctx, buffer_t);
+
   // Raw alloc & dealloc. The driver itself does not keep track of such buffers.
   // It's the responsibility of the user to manage the buffers correctly.
   buffer_t raw_alloc(Context* ctx, size_t);
@@ -17,10 +17,49 @@
 
 #include "tensorflow/compiler/mlir/xla/ral/ral_api.h"
 
+#include <dlfcn.h>
+
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 
 #include "tensorflow/compiler/mlir/xla/ral/ral_context.h"
+#include "tensorflow/compiler/mlir/xla/ral/ral_helper.h"
 #include "tensorflow/compiler/mlir/xla/ral/ral_logging.h"
+#include "tensorflow/compiler/mlir/xla/ral/ral_profiler.h"
+
+namespace {
+
+// An entry of the dense api table. The compiled code only knows that the first
+// field is the function to call, thus the layout should not be changed.
+struct ApiTableEntry {
+  void (*invoke)(ApiTableEntry* entry, void** args);
+  tao::ral::api_func_t api_func;
+};
+
+void invokeApiTableEntry(ApiTableEntry* entry, void** args) {
+  entry->api_func(args);
+}
+
+// Returns the entry of the api named `name` or nullptr if not found. Entries
+// are shared by all the loaded modules and live until the process exits.
+ApiTableEntry* getOrCreateApiTableEntry(const char* name) {
+  static std::mutex mu;
+  static auto* entries =
+      new std::unordered_map<std::string, std::unique_ptr<ApiTableEntry>>;
+  std::lock_guard<std::mutex> l(mu);
+  auto it = entries->find(name);
+  if (it != entries->end()) return it->second.get();
+  auto api_func = tao::ral::TaoRalApiRegistry::Global().Find(name);
+  if (!api_func) return nullptr;
+  auto& entry = (*entries)[name];
+  entry.reset(new ApiTableEntry{invokeApiTableEntry, std::move(api_func)});
+  return entry.get();
+}
+
+}  // namespace
 
 #ifdef __cplusplus
 extern "C" {
@@ -36,6 +75,44 @@ void tao_ral_call_impl(tao_ral_context_t ctx, void* name, void** args) {
   typed_ctx->getContext()->call((const char*)name, args);
 }
 
+int tao_ral_resolve_api_table(void* dso_handle) {
+  auto table = static_cast<void**>(dlsym(dso_handle, "disc_ral_api_table"));
+  auto names = static_cast<const char* const*>(
+      dlsym(dso_handle, "disc_ral_api_names"));
+  auto size = static_cast<const int64_t*>(
+      dlsym(dso_handle, "disc_ral_api_table_size"));
+  if (!table || !names || !size) return 0;
+  // Leaves all the slots unresolved, thus every call goes through
+  // `Context::call` and is recorded by the profiler.
+  if (tao::ral::RalCallProfiler::enabled()) {
+    TAO_VLOG(1) << "api table: not resolved since ral call profiling is on";
+    return *size;
+  }
+
+  int num_unresolved = 0;
+  for (int64_t i = 0; i < *size; ++i) {
+    // The module may be loaded more than once (dlopen returns the same handle),
+    // and thus the table may be in use already. Resolved slots never change.
+    if (table[i]) continue;
+    ApiTableEntry* entry = getOrCreateApiTableEntry(names[i]);
+    if (!entry) {
+      TAO_VLOG(1) << "api table: unresolved api " << names[i];
+      ++num_unresolved;
+      continue;
+    }
+    table[i] = entry;
+  }
+  TAO_VLOG(1) << "api table: resolved " << *size - num_unresolved << " of "
+              << *size << " slots";
+  return num_unresolved;
+}
+
+const char* tao_ral_strided_inputs(void* dso_handle) {
+  auto mask =
+      static_cast<const char*>(dlsym(dso_handle, "disc_ral_strided_inputs"));
+  return mask ? mask : "";
+}
+
 tao_ral_status_t tao_ral_last_error(tao_ral_context_t ctx,
                                     const char** err_msg) {
   TAO_VLOG(1) << "tao_ral_last_error is called with ctx = " << ctx;
@@ -58,6 +58,25 @@ typedef int32_t tao_ral_status_t;
 
 void tao_ral_call_impl(tao_ral_context_t, void* name, void** args);
 
+// Resolves the dense api table of a compiled module loaded by `dlopen`.
+//
+// A module compiled with `DISC_ENABLE_RAL_CALL_TABLE=true` exports a table
+// having one slot per distinct api name it calls. Each resolved slot turns the
+// corresponding call sites into a direct call, bypassing the by-name lookup
+// of `tao_ral_call_impl`. Unresolved slots still go through the by-name path.
+// Returns the number of slots that can not be resolved. It's a no-op (and
+// returns 0) for modules that do not have such a table.
+int tao_ral_resolve_api_table(void* dso_handle);
+
+// Returns the strided input mask of a compiled module loaded by `dlopen`.
+//
+// The mask is a null-terminated string having one char per leading input,
+// which is '1' if the module receives that input via `ral_recv_strided_input`,
+// i.e. the input can be bound with a non-row-major layout (see
+// `ExecutionContext::bindInput`). Inputs beyond the end of the mask only accept
+// the row-major layout. Returns an empty mask for modules not exporting one.
+const char* tao_ral_strided_inputs(void* dso_handle);
+
 // Returns the status since the last api call.
 // When error occurs, error msg is stored into `err_msg` if it's
 // not null. `err_msg` is empty is status is ok.
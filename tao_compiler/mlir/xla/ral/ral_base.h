@@ -53,6 +53,9 @@ struct Allocator {
   virtual void releaseAllFreeBuffers(){};
   virtual buffer_t alloc(size_t bytes) = 0;
   virtual void dealloc(buffer_t buffer) = 0;
+  // Returns true if `alloc` and `dealloc` can be called concurrently without
+  // external synchronization.
+  virtual bool isThreadSafe() const { return false; }
 };
 
 }  // namespace ral
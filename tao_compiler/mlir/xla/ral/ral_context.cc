@@ -25,6 +25,7 @@
 #include "tensorflow/compiler/mlir/xla/ral/ral_driver.h"
 #include "tensorflow/compiler/mlir/xla/ral/ral_helper.h"
 #include "tensorflow/compiler/mlir/xla/ral/ral_logging.h"
+#include "tensorflow/compiler/mlir/xla/ral/ral_profiler.h"
 
 namespace tao {
 namespace ral {
@@ -36,6 +37,8 @@ std::atomic<int> nextThreadIdx{0};
 }
 
 const char* kRalRecvInput = "ral_recv_input";
+const char* kRalRecvStridedInput = "ral_recv_strided_input";
+const char* kRalAllocOutput = "ral_alloc_output";
 const char* kRalSendOutput = "ral_send_output";
 const char* kRalCudaConst = "ral_const";
 const char* kRalHostConst = "ral_const";
@@ -83,6 +86,18 @@ struct Context::Impl {
   static constexpr const int kMaxNumThreadsAllowed = 1024;
   std::array<ApiFuncCache, kMaxNumThreadsAllowed> fast_api_func_cache_map;
 
+  // Not null if profiling of RAL api calls is enabled.
+  std::unique_ptr<RalCallProfiler> profiler = RalCallProfiler::create();
+
+  void invoke(const char* api_name, const api_func_t& api_func, void** args) {
+    if (TAO_PREDICT_FALSE(profiler != nullptr)) {
+      RalCallProfiler::Scope scope(profiler.get(), api_name);
+      api_func(args);
+      return;
+    }
+    api_func(args);
+  }
+
   ApiFuncCache* GetCache() {
     auto tid = ThreadLocalIndex::Get();
     if (tid < kMaxNumThreadsAllowed) {
@@ -114,7 +129,8 @@ void Context::call(const std::string& api_name, void** args) {
     return;
   }
   TAO_VLOG(1) << "before call api_func " << api_name;
-  api_func(args);
+  impl_->invoke(impl_->profiler ? impl_->profiler->intern(api_name) : nullptr,
+                api_func, args);
   TAO_VLOG(1) << "after call api_func " << api_name;
 }
 
@@ -123,7 +139,7 @@ void Context::call(const char* api_name, void** args) {
   auto it = api_map->find(api_name);
   if (it != api_map->end()) {
     TAO_VLOG(1) << "before call cached api_func " << api_name;
-    it->second(args);
+    impl_->invoke(api_name, it->second, args);
     TAO_VLOG(1) << "after call cached api_func " << api_name;
     return;
   }
@@ -137,7 +153,7 @@ void Context::call(const char* api_name, void** args) {
   (*api_map)[api_name] = api_func;
 
   TAO_VLOG(1) << "before call api_func " << api_name;
-  api_func(args);
+  impl_->invoke(api_name, api_func, args);
   TAO_VLOG(1) << "after call api_func " << api_name;
 }
 
@@ -146,6 +162,7 @@ api_func_t Context::find(const std::string& api_name) {
 }
 
 void Context::onExecutionStart(ExecutionContext* exec_ctx) {
+  if (impl_->profiler) impl_->profiler->onExecutionStart(exec_ctx);
   std::lock_guard<std::mutex> lock(mu);
   for (auto& resource : impl_->resources) {
     resource.second->onExecutionStart(exec_ctx);
@@ -153,12 +170,17 @@ void Context::onExecutionStart(ExecutionContext* exec_ctx) {
 }
 
 void Context::onExecutionFinish(ExecutionContext* exec_ctx) {
-  std::lock_guard<std::mutex> lock(mu);
-  for (auto& resource : impl_->resources) {
-    resource.second->onExecutionFinish(exec_ctx);
+  {
+    std::lock_guard<std::mutex> lock(mu);
+    for (auto& resource : impl_->resources) {
+      resource.second->onExecutionFinish(exec_ctx);
+    }
   }
+  if (impl_->profiler) impl_->profiler->onExecutionFinish(exec_ctx);
 }
 
+RalCallProfiler* Context::getCallProfiler() { return impl_->profiler.get(); }
+
 status_t Context::getLastError(const char** msg_ptr) {
   std::lock_guard<std::mutex> lock(mu);
   if (msg_ptr) {
@@ -237,5 +259,19 @@ ExecutionContext::~ExecutionContext() {}
 
 Context* ExecutionContext::getContext() { return impl_->context; }
 
+void ExecutionContext::bindInput(int input_idx, buffer_t buffer,
+                                 const buffer_shape_t& shape,
+                                 const buffer_shape_t& strides) {
+  int64_t stride = 1;
+  for (int i = static_cast<int>(shape.size()) - 1; i >= 0; --i) {
+    if (shape[i] != 1 && strides[i] != stride) {
+      signalError(Context::FAILURE, "strided input is not supported");
+      return;
+    }
+    stride *= shape[i];
+  }
+  bindInput(input_idx, buffer, shape);
+}
+
 }  // namespace ral
 }  // namespace tao
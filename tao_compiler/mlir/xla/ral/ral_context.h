@@ -33,6 +33,8 @@ namespace tao {
 namespace ral {
 
 extern const char* kRalRecvInput;
+extern const char* kRalRecvStridedInput;
+extern const char* kRalAllocOutput;
 extern const char* kRalSendOutput;
 extern const char* kRalCudaConst;
 extern const char* kRalHostConst;
@@ -41,6 +43,9 @@ extern const char* kRalBitcast;
 // Abstraction of a core device driver api set
 class Driver;
 
+// Records the latency of RAL api calls, see ral_profiler.h
+class RalCallProfiler;
+
 struct ThreadLocalIndex {
   // Returns a unique index for each thread.
   static int Get();
@@ -127,6 +132,10 @@ class Context {
                          std::unique_ptr<Driver> driver);
   virtual Driver* getDriver(const std::string& name);
 
+  // Returns the profiler of the RAL api calls of this context, or nullptr if
+  // profiling is not enabled.
+  RalCallProfiler* getCallProfiler();
+
  protected:
   void signalErrorLocked(status_t errcode, const std::string& err_msg);
 
@@ -147,6 +156,13 @@ class OutputBufferWrapper {
   // Release the ownership of the wrapper buffer.
   // This requires that the buffer is owned the this wrapper.
   virtual void release() = 0;
+  // Returns true if the buffer is a persistent buffer of the context (e.g. a
+  // constant), which is reused by the following executions.
+  virtual bool persistent() const { return false; }
+  // Returns true if the buffer is allocated by the allocator of the context
+  // and is freed by this wrapper. Unlike `owned`, the buffer may be referred
+  // by multiple outputs, in which case only one of the wrappers frees it.
+  virtual bool allocated() const { return false; }
 };
 
 // Context wrapper for a single execution
@@ -163,8 +179,23 @@ class ExecutionContext {
   // reuqirement.
   virtual void bindInput(int input_idx, buffer_t buffer,
                          const buffer_shape_t& shape){};
+  // Binds an input having the given `strides` (in elements) instead of the
+  // dense row-major layout. Only the inputs that the compiled module receives
+  // via `kRalRecvStridedInput` (see `tao_ral_strided_inputs`) can be bound
+  // with a non-row-major layout. The default implementation only accepts the
+  // row-major layout.
+  virtual void bindInput(int input_idx, buffer_t buffer,
+                         const buffer_shape_t& shape,
+                         const buffer_shape_t& strides);
   virtual void bindOutput(int output_idx,
                           std::unique_ptr<OutputBufferWrapper>* output){};
+  // Provides a caller-owned buffer of `bytes` bytes for the `output_idx`-th
+  // output. The compiled module writes the output into it in place if the
+  // output is allocated via `kRalAllocOutput` and has exactly `bytes` bytes,
+  // and allocates a buffer of its own otherwise. Callers tell the two cases
+  // apart by the data pointer of the output returned by `bindOutput`.
+  virtual void bindOutputBuffer(int output_idx, buffer_t buffer,
+                                size_t bytes){};
 
   template <typename T>
   T* getOrCreateResource(const std::string& key,
@@ -17,6 +17,15 @@
 
 #include "tensorflow/compiler/mlir/xla/ral/ral_metadata.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <unordered_map>
 
 namespace tao {
@@ -60,8 +69,173 @@ bool writeToBinaryStream(std::ofstream& out, const std::string& t) {
 
 constexpr const uint64_t kMetadataFileMagicNumber = 0x1234567890ABCDEF;
 
+// Layout of the const blob file:
+//   header: magic number, version, offset of the index, number of consts
+//   data: the raw bytes of each const, starting at an aligned offset
+//   index: <key, offset, bytes> for each const
+constexpr const uint64_t kConstBlobFileMagicNumber = 0x424F4C4254534E43;
+constexpr const uint64_t kConstBlobFileVersion = 1;
+constexpr const uint64_t kConstBlobFileHeaderBytes = 4 * sizeof(uint64_t);
+// Consts not smaller than a page are page aligned, thus each of them can be
+// paged in (and shared) independently. Smaller ones are packed with the
+// alignment used by the host allocator.
+constexpr const uint64_t kConstBlobPageBytes = 4096;
+constexpr const uint64_t kConstBlobMinAlignment = 64;
+
+// Trailer of a metadata file bundled with its const blob file. A plain
+// metadata file ends with the number of consts, which never equals this.
+constexpr const uint64_t kMetadataBundleMagicNumber = 0x454C444E55424C52;
+constexpr const uint64_t kMetadataBundleTailerBytes = 2 * sizeof(uint64_t);
+
+uint64_t alignConstBlobOffset(uint64_t offset, uint64_t bytes) {
+  uint64_t align = bytes >= kConstBlobPageBytes ? kConstBlobPageBytes
+                                                 : kConstBlobMinAlignment;
+  return (offset + align - 1) / align * align;
+}
+
+bool padBinaryStream(std::ofstream& out, uint64_t bytes) {
+  static const char zeros[kConstBlobPageBytes] = {0};
+  while (out && bytes > 0) {
+    uint64_t n = std::min(bytes, kConstBlobPageBytes);
+    out.write(zeros, n);
+    bytes -= n;
+  }
+  return static_cast<bool>(out);
+}
+
+// Reads a value of type `T` at `offset` of a buffer with `size` bytes.
+// Returns false if out of range.
+template <typename T>
+bool readFromBuffer(const char* base, uint64_t size, uint64_t& offset, T& t) {
+  if (offset > size || size - offset < sizeof(T)) return false;
+  std::memcpy(&t, base + offset, sizeof(T));
+  offset += sizeof(T);
+  return true;
+}
+
+template <>
+bool readFromBuffer(const char* base, uint64_t size, uint64_t& offset,
+                    std::string& val) {
+  size_t bytes;
+  if (!readFromBuffer(base, size, offset, bytes)) return false;
+  if (offset > size || size - offset < bytes) return false;
+  val.assign(base + offset, bytes);
+  offset += bytes;
+  return true;
+}
+
 }  // namespace
 
+std::string getConstBlobFileName(const std::string& metadata_filename) {
+  return metadata_filename + ".blob";
+}
+
+std::string bundleMetadataWithConstBlob(const std::string& metadata,
+                                        const std::string& blob) {
+  if (blob.empty()) return metadata;
+  uint64_t blobSize = blob.size();
+  std::string bundle;
+  bundle.reserve(metadata.size() + blob.size() + kMetadataBundleTailerBytes);
+  bundle.append(metadata);
+  bundle.append(blob);
+  bundle.append(reinterpret_cast<const char*>(&blobSize), sizeof(blobSize));
+  bundle.append(reinterpret_cast<const char*>(&kMetadataBundleMagicNumber),
+                sizeof(kMetadataBundleMagicNumber));
+  return bundle;
+}
+
+/* static */ std::unique_ptr<ConstBlobFile> ConstBlobFile::loadFromFile(
+    const std::string& filename) {
+  int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return nullptr;
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      static_cast<uint64_t>(st.st_size) < kConstBlobFileHeaderBytes) {
+    close(fd);
+    return nullptr;
+  }
+  // The mapping is private and writable though consts are never written in
+  // practice: clean pages are still shared with the page cache (and thus other
+  // processes), while a stray write gets a private copy instead of a fault or
+  // modifying the file.
+  void* addr = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                    fd, 0);
+  // The mapping keeps a reference to the file.
+  close(fd);
+  if (addr == MAP_FAILED) return nullptr;
+
+  std::unique_ptr<ConstBlobFile> file(new ConstBlobFile);
+  file->base_ = static_cast<char*>(addr);
+  file->size_ = st.st_size;
+  if (!file->parseIndex()) return nullptr;
+  return file;
+}
+
+/* static */ std::unique_ptr<ConstBlobFile> ConstBlobFile::loadFromMemory(
+    const char* data, size_t size) {
+  if (size < kConstBlobFileHeaderBytes) return nullptr;
+  // Keeps the same alignment of consts as the mapped file.
+  void* addr = nullptr;
+  if (posix_memalign(&addr, kConstBlobPageBytes, size) != 0) return nullptr;
+  std::memcpy(addr, data, size);
+
+  std::unique_ptr<ConstBlobFile> file(new ConstBlobFile);
+  file->base_ = static_cast<char*>(addr);
+  file->size_ = size;
+  file->owned_ = true;
+  if (!file->parseIndex()) return nullptr;
+  return file;
+}
+
+bool ConstBlobFile::parseIndex() {
+  uint64_t offset = 0;
+  uint64_t magicNumber, version, indexOffset, numConsts;
+  if (!readFromBuffer(base_, size_, offset, magicNumber) ||
+      magicNumber != kConstBlobFileMagicNumber ||
+      !readFromBuffer(base_, size_, offset, version) ||
+      version != kConstBlobFileVersion ||
+      !readFromBuffer(base_, size_, offset, indexOffset) ||
+      !readFromBuffer(base_, size_, offset, numConsts)) {
+    return false;
+  }
+  offset = indexOffset;
+  for (uint64_t i = 0; i < numConsts; ++i) {
+    std::string key;
+    uint64_t dataOffset, bytes;
+    if (!readFromBuffer(base_, size_, offset, key) ||
+        !readFromBuffer(base_, size_, offset, dataOffset) ||
+        !readFromBuffer(base_, size_, offset, bytes) ||
+        dataOffset > indexOffset || indexOffset - dataOffset < bytes) {
+      return false;
+    }
+    constMap_.emplace(std::move(key), std::make_pair(dataOffset, bytes));
+  }
+  return true;
+}
+
+ConstBlobFile::~ConstBlobFile() {
+  if (!base_) return;
+  if (owned_) {
+    std::free(base_);
+  } else {
+    munmap(base_, size_);
+  }
+}
+
+bool ConstBlobFile::getConstant(const std::string& name, void*& data,
+                                size_t& bytes) const {
+  auto it = constMap_.find(name);
+  if (it == constMap_.end()) return false;
+  data = base_ + it->second.first;
+  bytes = it->second.second;
+  return true;
+}
+
+bool ConstBlobFile::contains(const void* ptr) const {
+  auto p = static_cast<const char*>(ptr);
+  return p >= base_ && p < base_ + size_;
+}
+
 /* static */ std::unique_ptr<MetadataFile> MetadataFile::loadFromFile(
     const std::string& filename) {
   std::unique_ptr<MetadataFile> file(new MetadataFile);
@@ -87,6 +261,64 @@ constexpr const uint64_t kMetadataFileMagicNumber = 0x1234567890ABCDEF;
       file->deviceConstMap_.emplace(std::move(key), std::move(value));
     }
   }
+  // The const blob file is optional.
+  file->hostConstBlob_ =
+      ConstBlobFile::loadFromFile(getConstBlobFileName(filename));
+  file->numHostConsts_ = file->hostConstMap_.size();
+  if (file->hostConstBlob_) {
+    file->numHostConsts_ += file->hostConstBlob_->getNumConstants();
+  }
+  file->numDeviceConsts_ = file->deviceConstMap_.size();
+  return file;
+}
+
+/* static */ std::unique_ptr<MetadataFile> MetadataFile::loadFromMemory(
+    const char* data, size_t size) {
+  std::unique_ptr<MetadataFile> file(new MetadataFile);
+  // Splits the const blob out of a bundle, if any.
+  uint64_t bundleMagic = 0, blobSize = 0;
+  uint64_t bundleOffset = size >= kMetadataBundleTailerBytes
+                              ? size - kMetadataBundleTailerBytes
+                              : size;
+  if (readFromBuffer(data, size, bundleOffset, blobSize) &&
+      readFromBuffer(data, size, bundleOffset, bundleMagic) &&
+      bundleMagic == kMetadataBundleMagicNumber) {
+    size -= kMetadataBundleTailerBytes;
+    if (blobSize > size) return nullptr;
+    size -= blobSize;
+    file->hostConstBlob_ =
+        ConstBlobFile::loadFromMemory(data + size, blobSize);
+    if (!file->hostConstBlob_) return nullptr;
+  }
+  uint64_t offset = 0;
+  uint64_t magicNumber = 0ull;
+  if (!readFromBuffer(data, size, offset, magicNumber) ||
+      magicNumber != kMetadataFileMagicNumber) {
+    return nullptr;
+  }
+  // The number of consts is stored at the end.
+  if (size < offset + sizeof(size_t)) return nullptr;
+  uint64_t bodySize = size - sizeof(size_t);
+  uint64_t tailerOffset = bodySize;
+  size_t numConsts;
+  if (!readFromBuffer(data, size, tailerOffset, numConsts)) return nullptr;
+  for (size_t i = 0; i < numConsts; ++i) {
+    bool isHost;
+    std::string key, value;
+    if (!readFromBuffer(data, bodySize, offset, isHost)) return nullptr;
+    if (!readFromBuffer(data, bodySize, offset, key)) return nullptr;
+    if (!readFromBuffer(data, bodySize, offset, value)) return nullptr;
+    if (isHost) {
+      file->hostConstMap_.emplace(std::move(key), std::move(value));
+    } else {
+      file->deviceConstMap_.emplace(std::move(key), std::move(value));
+    }
+  }
+  file->numHostConsts_ = file->hostConstMap_.size();
+  if (file->hostConstBlob_) {
+    file->numHostConsts_ += file->hostConstBlob_->getNumConstants();
+  }
+  file->numDeviceConsts_ = file->deviceConstMap_.size();
   return file;
 }
 
@@ -105,6 +337,16 @@ bool MetadataFile::releaseHostConstant(const std::string& name) {
   return true;
 }
 
+bool MetadataFile::getHostConstantFromBlob(const std::string& name,
+                                           void*& data, size_t& bytes) {
+  if (!hostConstBlob_) return false;
+  return hostConstBlob_->getConstant(name, data, bytes);
+}
+
+bool MetadataFile::isHostConstantInBlob(const void* ptr) {
+  return hostConstBlob_ && hostConstBlob_->contains(ptr);
+}
+
 bool MetadataFile::getDeviceConstant(const std::string& name,
                                      const std::string*& data) {
   auto it = deviceConstMap_.find(name);
@@ -120,19 +362,36 @@ bool MetadataFile::releaseDeviceConstant(const std::string& name) {
   return true;
 }
 
-MetadataFileEmitter::MetadataFileEmitter(const std::string& filename)
-    : filename_(filename) {}
+MetadataFileEmitter::MetadataFileEmitter(const std::string& filename,
+                                         bool enable_const_blob)
+    : filename_(filename), enableConstBlob_(enable_const_blob) {}
 
 bool MetadataFileEmitter::emitHeader() {
   out_.open(filename_, std::ios::out | std::ios::binary);
   if (!writeToBinaryStream(out_, kMetadataFileMagicNumber)) return false;
   nextOffset_ += sizeof(kMetadataFileMagicNumber);
+  std::string blobFilename = getConstBlobFileName(filename_);
+  if (!enableConstBlob_) {
+    // Removes the stale const blob file, if any, left by a previous
+    // compilation.
+    std::remove(blobFilename.c_str());
+    return static_cast<bool>(out_);
+  }
+  blobOut_.open(blobFilename, std::ios::out | std::ios::binary);
+  // The offset of the index and the number of consts are updated when
+  // emitting the tailer.
+  if (!writeToBinaryStream(blobOut_, kConstBlobFileMagicNumber)) return false;
+  if (!writeToBinaryStream(blobOut_, kConstBlobFileVersion)) return false;
+  if (!writeToBinaryStream(blobOut_, uint64_t(0))) return false;
+  if (!writeToBinaryStream(blobOut_, uint64_t(0))) return false;
+  nextBlobOffset_ = kConstBlobFileHeaderBytes;
   return static_cast<bool>(out_);
 }
 
 bool MetadataFileEmitter::emitHostConstant(const std::string& name,
                                            const std::string& data) {
   // Returns false if there are duplicated keys.
+  if (blobConstMap_.count(name)) return false;
   if (!hostConstMap_.emplace(name, nextOffset_).second) return false;
   // emit is_host?
   if (!writeToBinaryStream(out_, true)) return false;
@@ -146,6 +405,22 @@ bool MetadataFileEmitter::emitHostConstant(const std::string& name,
   return true;
 }
 
+bool MetadataFileEmitter::emitHostConstantToBlob(const std::string& name,
+                                                 const char* data,
+                                                 size_t bytes) {
+  if (!enableConstBlob_) return false;
+  // Returns false if there are duplicated keys.
+  if (hostConstMap_.count(name)) return false;
+  uint64_t offset = alignConstBlobOffset(nextBlobOffset_, bytes);
+  if (!blobConstMap_.emplace(name, std::make_pair(offset, bytes)).second)
+    return false;
+  blobConstNames_.push_back(name);
+  if (!padBinaryStream(blobOut_, offset - nextBlobOffset_)) return false;
+  blobOut_.write(data, bytes);
+  nextBlobOffset_ = offset + bytes;
+  return static_cast<bool>(blobOut_);
+}
+
 bool MetadataFileEmitter::emitDeviceConstant(const std::string& name,
                                              const std::string& data) {
   // Returns false if there are duplicated keys.
@@ -165,7 +440,21 @@ bool MetadataFileEmitter::emitTailer() {
   size_t numConsts = hostConstMap_.size() + deviceConstMap_.size();
   if (!writeToBinaryStream(out_, numConsts)) return false;
   out_.close();
-  return true;
+  if (!enableConstBlob_) return true;
+
+  uint64_t indexOffset = nextBlobOffset_;
+  for (const auto& name : blobConstNames_) {
+    const auto& entry = blobConstMap_[name];
+    if (!writeToBinaryStream(blobOut_, name)) return false;
+    if (!writeToBinaryStream(blobOut_, entry.first)) return false;
+    if (!writeToBinaryStream(blobOut_, entry.second)) return false;
+  }
+  blobOut_.seekp(2 * sizeof(uint64_t));
+  if (!writeToBinaryStream(blobOut_, indexOffset)) return false;
+  if (!writeToBinaryStream(blobOut_, uint64_t(blobConstNames_.size())))
+    return false;
+  blobOut_.close();
+  return static_cast<bool>(blobOut_);
 }
 
 }  // namespace ral
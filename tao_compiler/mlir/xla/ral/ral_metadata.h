@@ -23,21 +23,93 @@
 #include <sstream>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace tao {
 namespace ral {
 
+// Returns the name of the const blob file that goes along with the metadata
+// file named `metadata_filename`.
+std::string getConstBlobFileName(const std::string& metadata_filename);
+
+// Returns the content of a metadata file along with its const blob file in a
+// single buffer, which can be parsed by `MetadataFile::loadFromMemory`. The
+// layout is:
+//   [metadata bytes][blob bytes][uint64 blob bytes][uint64 bundle magic]
+// Returns `metadata` untouched if `blob` is empty.
+std::string bundleMetadataWithConstBlob(const std::string& metadata,
+                                        const std::string& blob);
+
+// A const blob file is an optional companion of the metadata file. It holds
+// the raw bytes of host consts, each of which starts at an aligned offset
+// (large consts are page aligned). The file is mapped into memory and the
+// consts are used in place, thus no decoding or copy is needed and processes
+// loading the same file share the same physical pages.
+class ConstBlobFile {
+ public:
+  // Maps the const blob file named `filename`.
+  // Return nullptr if failed, otherwise a new ConstBlobFile instance.
+  static std::unique_ptr<ConstBlobFile> loadFromFile(
+      const std::string& filename);
+
+  // Same as above, but copies the `size` bytes at `data` which hold the
+  // content of a const blob file into a page aligned buffer owned by the
+  // returned instance.
+  static std::unique_ptr<ConstBlobFile> loadFromMemory(const char* data,
+                                                       size_t size);
+
+  ~ConstBlobFile();
+
+  // Returns true if there is a const named `name` and `data` and `bytes` are
+  // set to the address and the size of its value inside the mapped file.
+  // Otherwise return false and `data` and `bytes` are leaved untouched.
+  bool getConstant(const std::string& name, void*& data, size_t& bytes) const;
+
+  // Returns true if `ptr` points into the mapped file.
+  bool contains(const void* ptr) const;
+
+  // Returns the number of consts in the file.
+  size_t getNumConstants() const { return constMap_.size(); }
+
+ private:
+  // Disallows new a ConstBlobFile directly.
+  explicit ConstBlobFile() = default;
+
+  // Disables copy and assignment methods.
+  ConstBlobFile(const ConstBlobFile& other) = delete;
+  ConstBlobFile& operator=(const ConstBlobFile& other) = delete;
+
+  // Parses the header and the index of the blob at `base_`.
+  bool parseIndex();
+
+  char* base_ = nullptr;
+  size_t size_ = 0;
+  // true if `base_` is allocated by us rather than mapped.
+  bool owned_ = false;
+  // map key -> <offset, bytes> of the const inside the blob file.
+  std::unordered_map<std::string, std::pair<uint64_t, uint64_t>> constMap_;
+};
+
 // A metadata file is generated during compilation and is used to aid the
 // execution of the compiled binary. it usually includes:
 // - (maybe large) const values, their shape and checksum
 // - other related information used to aid the execution of the compiled binary.
 class MetadataFile {
  public:
-  // Loads the metadata file named `filename`.
+  // Loads the metadata file named `filename`. The const blob file along with
+  // it is mapped as well if it exists.
   // Return nullptr if failed, otherwise a new MetadataFile instance.
   static std::unique_ptr<MetadataFile> loadFromFile(
       const std::string& filename);
 
+  // Same as above, but parses the `size` bytes at `data` which hold the
+  // content of a metadata file, thus no file is read. The content may be
+  // generated by `bundleMetadataWithConstBlob`, in which case the const blob
+  // is copied out of it.
+  static std::unique_ptr<MetadataFile> loadFromMemory(const char* data,
+                                                      size_t size);
+
   // Returns true if there is a host const named `name` and `data` is set to the
   // corresponding value. Otherwise return false and `data` is leaved untouched.
   bool getHostConstant(const std::string& name, const std::string*& data);
@@ -47,6 +119,18 @@ class MetadataFile {
   // false. Returns false if no such host constant.
   bool releaseHostConstant(const std::string& name);
 
+  // Returns true if there is a host const named `name` inside the const blob
+  // file. `data` and `bytes` are set to the address and the size of its value
+  // inside the mapped file, which remains valid during the lifetime of this
+  // MetadataFile. Otherwise return false and `data` and `bytes` are leaved
+  // untouched.
+  bool getHostConstantFromBlob(const std::string& name, void*& data,
+                               size_t& bytes);
+
+  // Returns true if `ptr` points into the (mapped or copied) const blob, in
+  // which case it must not be freed.
+  bool isHostConstantInBlob(const void* ptr);
+
   // Returns true if there is a device const named `name` and `data` is set to
   // the corresponding value. Otherwise return false and `data` is leaved
   // untouched.
@@ -57,6 +141,14 @@ class MetadataFile {
   // return false. Returns false if no such device constant.
   bool releaseDeviceConstant(const std::string& name);
 
+  // Returns the number of host consts in the metadata file and the const blob
+  // file when loaded, which is not changed by releasing consts.
+  size_t getNumHostConstants() { return numHostConsts_; }
+
+  // Returns the number of device consts in the metadata file when loaded,
+  // which is not changed by releasing consts.
+  size_t getNumDeviceConstants() { return numDeviceConsts_; }
+
  private:
   // Disallows new a MetadataFile directly.
   explicit MetadataFile() = default;
@@ -67,12 +159,18 @@ class MetadataFile {
 
   std::unordered_map<std::string, std::string> hostConstMap_;
   std::unordered_map<std::string, std::string> deviceConstMap_;
+  std::unique_ptr<ConstBlobFile> hostConstBlob_;
+  size_t numHostConsts_ = 0;
+  size_t numDeviceConsts_ = 0;
 };
 
 // A helper class which is used to emit metadata file during compilation.
 class MetadataFileEmitter {
  public:
-  explicit MetadataFileEmitter(const std::string& filename);
+  // Host consts emitted by `emitHostConstantToBlob` are written to the const
+  // blob file along with the metadata file if `enable_const_blob` is true.
+  explicit MetadataFileEmitter(const std::string& filename,
+                               bool enable_const_blob = false);
 
   // Disables copy and assignment methods.
   MetadataFileEmitter(const MetadataFileEmitter& other) = delete;
@@ -84,11 +182,21 @@ class MetadataFileEmitter {
   bool emitHeader();
 
   // Returns the number of host consts that have been emitted.
-  int getNumHostConstantEmitted() { return hostConstMap_.size(); }
+  int getNumHostConstantEmitted() {
+    return hostConstMap_.size() + blobConstMap_.size();
+  }
 
   // Emits a new host constant with key `name` and value `data`.
   bool emitHostConstant(const std::string& name, const std::string& data);
 
+  // Returns true if host consts can be emitted to the const blob file.
+  bool isConstBlobEnabled() { return enableConstBlob_; }
+
+  // Emits a new host constant with key `name` and the raw bytes `data` to the
+  // const blob file. The const blob file must be enabled.
+  bool emitHostConstantToBlob(const std::string& name, const char* data,
+                              size_t bytes);
+
   // Returns the number of device consts that have been emitted.
   int getNumDeviceConstantEmitted() { return deviceConstMap_.size(); }
 
@@ -107,6 +215,14 @@ class MetadataFileEmitter {
   // map key -> offset of beginning the const inside the metadata file.
   std::unordered_map<std::string, uint64_t> hostConstMap_;
   std::unordered_map<std::string, uint64_t> deviceConstMap_;
+
+  bool enableConstBlob_;
+  std::ofstream blobOut_;
+  uint64_t nextBlobOffset_ = 0;
+  // keys in emitting order and map key -> <offset, bytes> of the const inside
+  // the const blob file.
+  std::vector<std::string> blobConstNames_;
+  std::unordered_map<std::string, std::pair<uint64_t, uint64_t>> blobConstMap_;
 };
 
 }  // namespace ral
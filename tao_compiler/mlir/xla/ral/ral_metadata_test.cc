@@ -11,6 +11,9 @@
 
 #include "tensorflow/compiler/mlir/xla/ral/ral_metadata.h"
 
+#include <fstream>
+#include <iterator>
+
 #include "tensorflow/core/platform/test.h"
 
 namespace tao {
@@ -31,6 +34,8 @@ TEST(MetadataFileAndEmitterTest, BasicTest) {
   ASSERT_TRUE(MetadataFile::loadFromFile("not_exist") == nullptr);
   auto metadata = MetadataFile::loadFromFile("test.bin");
   ASSERT_TRUE(metadata != nullptr);
+  ASSERT_TRUE(metadata->getNumHostConstants() == 2);
+  ASSERT_TRUE(metadata->getNumDeviceConstants() == 1);
 
   const std::string *hstr, *dstr;
   ASSERT_TRUE(metadata->getHostConstant("h0", hstr));
@@ -48,5 +53,106 @@ TEST(MetadataFileAndEmitterTest, BasicTest) {
   ASSERT_FALSE(metadata->getDeviceConstant("d0", dstr));
 }
 
+TEST(MetadataFileAndEmitterTest, ConstBlobTest) {
+  std::string large(5000, 'x');
+  MetadataFileEmitter emitter("test_blob.bin", /*enable_const_blob*/ true);
+  ASSERT_TRUE(emitter.emitHeader());
+  ASSERT_TRUE(emitter.emitHostConstantToBlob("b0", "abc", 3));
+  ASSERT_TRUE(emitter.emitHostConstantToBlob("b1", large.data(), large.size()));
+  ASSERT_TRUE(emitter.emitHostConstant("h0", "0000"));
+  ASSERT_TRUE(emitter.getNumHostConstantEmitted() == 3);
+  // dumplicate key
+  ASSERT_FALSE(emitter.emitHostConstantToBlob("b0", "abc", 3));
+  ASSERT_FALSE(emitter.emitHostConstant("b1", "0000"));
+  ASSERT_TRUE(emitter.emitTailer());
+
+  auto metadata = MetadataFile::loadFromFile("test_blob.bin");
+  ASSERT_TRUE(metadata != nullptr);
+  ASSERT_TRUE(metadata->getNumHostConstants() == 3);
+
+  void* data = nullptr;
+  size_t bytes = 0;
+  ASSERT_TRUE(metadata->getHostConstantFromBlob("b0", data, bytes));
+  ASSERT_TRUE(bytes == 3 && std::string((char*)data, bytes) == "abc");
+  ASSERT_TRUE(metadata->isHostConstantInBlob(data));
+  ASSERT_TRUE(metadata->getHostConstantFromBlob("b1", data, bytes));
+  ASSERT_TRUE(std::string((char*)data, bytes) == large);
+  // large consts are page aligned
+  ASSERT_TRUE(reinterpret_cast<uintptr_t>(data) % 4096 == 0);
+  ASSERT_FALSE(metadata->getHostConstantFromBlob("h0", data, bytes));
+  const std::string* hstr;
+  ASSERT_TRUE(metadata->getHostConstant("h0", hstr));
+  ASSERT_FALSE(metadata->isHostConstantInBlob(hstr->data()));
+
+  // The const blob file is removed if not enabled.
+  MetadataFileEmitter emitter2("test_blob.bin");
+  ASSERT_TRUE(emitter2.emitHeader());
+  ASSERT_TRUE(emitter2.emitTailer());
+  metadata = MetadataFile::loadFromFile("test_blob.bin");
+  ASSERT_TRUE(metadata != nullptr);
+  ASSERT_FALSE(metadata->getHostConstantFromBlob("b0", data, bytes));
+}
+
+TEST(MetadataFileAndEmitterTest, LoadFromMemoryTest) {
+  MetadataFileEmitter emitter("test_memory.bin");
+  ASSERT_TRUE(emitter.emitHeader());
+  ASSERT_TRUE(emitter.emitHostConstant("h0", "0000"));
+  ASSERT_TRUE(emitter.emitDeviceConstant("d0", "0001"));
+  ASSERT_TRUE(emitter.emitTailer());
+
+  std::ifstream fin("test_memory.bin", std::ios::in | std::ios::binary);
+  std::string content((std::istreambuf_iterator<char>(fin)),
+                      std::istreambuf_iterator<char>());
+  auto metadata = MetadataFile::loadFromMemory(content.data(), content.size());
+  ASSERT_TRUE(metadata != nullptr);
+  ASSERT_TRUE(metadata->getNumHostConstants() == 1);
+  ASSERT_TRUE(metadata->getNumDeviceConstants() == 1);
+  const std::string *hstr, *dstr;
+  ASSERT_TRUE(metadata->getHostConstant("h0", hstr));
+  ASSERT_TRUE(*hstr == "0000");
+  ASSERT_TRUE(metadata->getDeviceConstant("d0", dstr));
+  ASSERT_TRUE(*dstr == "0001");
+
+  // truncated content
+  ASSERT_TRUE(MetadataFile::loadFromMemory(content.data(),
+                                           content.size() - 1) == nullptr);
+  ASSERT_TRUE(MetadataFile::loadFromMemory(content.data(), 4) == nullptr);
+}
+
+TEST(MetadataFileAndEmitterTest, LoadBundleFromMemoryTest) {
+  std::string large(5000, 'x');
+  MetadataFileEmitter emitter("test_bundle.bin", /*enable_const_blob*/ true);
+  ASSERT_TRUE(emitter.emitHeader());
+  ASSERT_TRUE(emitter.emitHostConstantToBlob("b0", large.data(), large.size()));
+  ASSERT_TRUE(emitter.emitHostConstant("h0", "0000"));
+  ASSERT_TRUE(emitter.emitTailer());
+
+  std::ifstream fin("test_bundle.bin", std::ios::in | std::ios::binary);
+  std::string content((std::istreambuf_iterator<char>(fin)),
+                      std::istreambuf_iterator<char>());
+  std::ifstream blobFin(getConstBlobFileName("test_bundle.bin"),
+                        std::ios::in | std::ios::binary);
+  std::string blob((std::istreambuf_iterator<char>(blobFin)),
+                   std::istreambuf_iterator<char>());
+  std::string bundle = bundleMetadataWithConstBlob(content, blob);
+  auto metadata = MetadataFile::loadFromMemory(bundle.data(), bundle.size());
+  ASSERT_TRUE(metadata != nullptr);
+  ASSERT_TRUE(metadata->getNumHostConstants() == 2);
+
+  void* data = nullptr;
+  size_t bytes = 0;
+  ASSERT_TRUE(metadata->getHostConstantFromBlob("b0", data, bytes));
+  ASSERT_TRUE(std::string((char*)data, bytes) == large);
+  ASSERT_TRUE(reinterpret_cast<uintptr_t>(data) % 4096 == 0);
+  ASSERT_TRUE(metadata->isHostConstantInBlob(data));
+  const std::string* hstr;
+  ASSERT_TRUE(metadata->getHostConstant("h0", hstr));
+  ASSERT_TRUE(*hstr == "0000");
+
+  // truncated bundle
+  ASSERT_TRUE(MetadataFile::loadFromMemory(bundle.data(), bundle.size() - 1) ==
+              nullptr);
+}
+
 }  // namespace ral
 }  // namespace tao
@@ -0,0 +1,345 @@
+// Copyright 2022 The BladeDISC Authors. All rights reserved.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/mlir/xla/ral/ral_profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+
+#include "tensorflow/compiler/mlir/xla/ral/ral_context.h"
+#include "tensorflow/compiler/mlir/xla/ral/ral_logging.h"
+
+namespace tao {
+namespace ral {
+
+namespace {
+
+constexpr const size_t kDefaultMaxTraceEvents = 1 << 20;
+
+bool envValueIsTrue(const char* name) {
+  const char* env = getenv(name);
+  if (!env) return false;
+  std::string envStr = env;
+  std::transform(envStr.begin(), envStr.end(), envStr.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return envStr == "true" || envStr == "1";
+}
+
+std::string envValueOrEmpty(const char* name) {
+  const char* env = getenv(name);
+  return env ? env : "";
+}
+
+// Files are shared by all the contexts of the process, thus the contexts
+// created later dump to `<file>.<n>` instead of overwriting the first one.
+std::string uniqueFileName(const std::string& filename) {
+  static std::atomic<int> nextIdx{0};
+  if (filename.empty()) return filename;
+  int idx = nextIdx++;
+  return idx == 0 ? filename : filename + "." + std::to_string(idx);
+}
+
+double toUs(int64_t ns) { return ns / 1000.0; }
+
+// Returns `s` quoted and escaped as a json string.
+std::string quoted(const std::string& s) {
+  std::ostringstream out;
+  out << '"';
+  for (char c : s) {
+    switch (c) {
+      case '"':
+        out << "\\\"";
+        break;
+      case '\\':
+        out << "\\\\";
+        break;
+      case '\n':
+        out << "\\n";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          out << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+              << static_cast<int>(c) << std::dec;
+        } else {
+          out << c;
+        }
+    }
+  }
+  out << '"';
+  return out.str();
+}
+
+void dumpStatsJson(std::ostream& out, const RalCallStats& stats) {
+  out << "\"count\": " << stats.count
+      << ", \"total_us\": " << toUs(stats.total_ns)
+      << ", \"avg_us\": "
+      << (stats.count ? toUs(stats.total_ns) / stats.count : 0.0)
+      << ", \"min_us\": " << toUs(stats.min_ns)
+      << ", \"max_us\": " << toUs(stats.max_ns) << ", \"histogram_us\": [";
+  bool first = true;
+  for (int i = 0; i < RalCallStats::kNumBuckets; ++i) {
+    if (!stats.histogram[i]) continue;
+    if (!first) out << ", ";
+    first = false;
+    // The upper bound of the bucket, "inf" for the last one.
+    out << "{\"lt\": ";
+    if (i + 1 < RalCallStats::kNumBuckets) {
+      out << (int64_t(1) << i);
+    } else {
+      out << "\"inf\"";
+    }
+    out << ", \"count\": " << stats.histogram[i] << "}";
+  }
+  out << "]";
+}
+
+void dumpApiStatsJson(std::ostream& out,
+                      const std::map<std::string, RalCallStats>& api_stats,
+                      const std::string& indent) {
+  // The hot apis go first.
+  std::vector<const std::pair<const std::string, RalCallStats>*> sorted;
+  int64_t total_ns = 0;
+  for (const auto& e : api_stats) {
+    sorted.push_back(&e);
+    total_ns += e.second.total_ns;
+  }
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [](const auto* a, const auto* b) {
+                     return a->second.total_ns > b->second.total_ns;
+                   });
+  out << indent << "\"ral_call_total_us\": " << toUs(total_ns) << ",\n";
+  out << indent << "\"apis\": [";
+  for (size_t i = 0; i < sorted.size(); ++i) {
+    out << (i ? ",\n" : "\n") << indent << "  {\"name\": "
+        << quoted(sorted[i]->first) << ", ";
+    dumpStatsJson(out, sorted[i]->second);
+    out << "}";
+  }
+  out << (sorted.empty() ? "]" : "\n" + indent + "]");
+}
+
+}  // namespace
+
+void RalCallStats::record(int64_t ns) {
+  if (count == 0 || ns < min_ns) min_ns = ns;
+  if (ns > max_ns) max_ns = ns;
+  ++count;
+  total_ns += ns;
+  int64_t us = ns / 1000;
+  int bucket = 0;
+  while (us > 0 && bucket + 1 < kNumBuckets) {
+    us >>= 1;
+    ++bucket;
+  }
+  ++histogram[bucket];
+}
+
+void RalCallStats::merge(const RalCallStats& other) {
+  if (!other.count) return;
+  if (count == 0 || other.min_ns < min_ns) min_ns = other.min_ns;
+  max_ns = std::max(max_ns, other.max_ns);
+  count += other.count;
+  total_ns += other.total_ns;
+  for (int i = 0; i < kNumBuckets; ++i) histogram[i] += other.histogram[i];
+}
+
+// The calls of an execution are recorded without locking, and are merged into
+// the profiler when the execution finishes.
+struct RalCallProfiler::ExecutionRecord {
+  RalCallProfiler* profiler;
+  int64_t start_ns;
+  int tid;
+  // Set when the execution finishes, maybe by another thread.
+  std::atomic<bool> finished{false};
+  std::unordered_map<const char*, RalCallStats> stats;
+  std::vector<TraceEvent> events;
+};
+
+thread_local std::vector<std::shared_ptr<RalCallProfiler::ExecutionRecord>>
+    RalCallProfiler::thread_executions_;
+
+/* static */ bool RalCallProfiler::enabled() {
+  static bool enabled =
+      envValueIsTrue("DISC_RAL_ENABLE_CALL_PROFILE") ||
+      !envValueOrEmpty("DISC_RAL_CALL_PROFILE_FILE").empty() ||
+      !envValueOrEmpty("DISC_RAL_CALL_TRACE_FILE").empty();
+  return enabled;
+}
+
+/* static */ std::unique_ptr<RalCallProfiler> RalCallProfiler::create() {
+  if (!enabled()) return nullptr;
+  std::string profile_file = envValueOrEmpty("DISC_RAL_CALL_PROFILE_FILE");
+  std::string trace_file = envValueOrEmpty("DISC_RAL_CALL_TRACE_FILE");
+  size_t max_trace_events = kDefaultMaxTraceEvents;
+  std::string max_events = envValueOrEmpty("DISC_RAL_CALL_TRACE_MAX_EVENTS");
+  if (!max_events.empty()) max_trace_events = std::stoull(max_events);
+  return std::unique_ptr<RalCallProfiler>(
+      new RalCallProfiler(uniqueFileName(profile_file),
+                          uniqueFileName(trace_file), max_trace_events));
+}
+
+RalCallProfiler::RalCallProfiler(std::string profile_file,
+                                 std::string trace_file,
+                                 size_t max_trace_events)
+    : profile_file_(std::move(profile_file)),
+      trace_file_(std::move(trace_file)),
+      trace_enabled_(!trace_file_.empty()),
+      max_trace_events_(max_trace_events) {}
+
+RalCallProfiler::~RalCallProfiler() {
+  if (!profile_file_.empty()) {
+    std::ofstream out(profile_file_);
+    dumpJson(out);
+    TAO_VLOG(0) << "[[DISC]] dumped ral call profile to " << profile_file_;
+  }
+  if (!trace_file_.empty()) {
+    std::ofstream out(trace_file_);
+    dumpChromeTrace(out);
+    TAO_VLOG(0) << "[[DISC]] dumped ral call trace to " << trace_file_;
+  }
+}
+
+void RalCallProfiler::onExecutionStart(ExecutionContext* exec_ctx) {
+  auto record = std::make_shared<ExecutionRecord>();
+  record->profiler = this;
+  record->start_ns = now();
+  record->tid = ThreadLocalIndex::Get();
+  thread_executions_.push_back(record);
+  std::lock_guard<std::mutex> l(mu_);
+  executions_[exec_ctx] = std::move(record);
+}
+
+void RalCallProfiler::onExecutionFinish(ExecutionContext* exec_ctx) {
+  int64_t end_ns = now();
+  std::lock_guard<std::mutex> l(mu_);
+  auto it = executions_.find(exec_ctx);
+  if (it == executions_.end()) return;
+  std::shared_ptr<ExecutionRecord> record = std::move(it->second);
+  executions_.erase(it);
+  // The record is removed from `thread_executions_` lazily, since it may be
+  // finished by a thread other than the one it started on.
+  record->finished = true;
+
+  last_execution_stats_ = RalCallStats();
+  last_execution_stats_.record(end_ns - record->start_ns);
+  execution_stats_.merge(last_execution_stats_);
+  last_execution_api_stats_.clear();
+  // The names may be owned by the compiled module, thus are copied.
+  std::unordered_map<const char*, const char*> names;
+  for (auto& e : record->stats) {
+    auto name_it = interned_names_.insert(e.first).first;
+    names[e.first] = name_it->c_str();
+    last_execution_api_stats_[*name_it].merge(e.second);
+    cumulative_stats_[*name_it].merge(e.second);
+  }
+  if (trace_enabled_) {
+    for (auto& event : record->events) event.name = names[event.name];
+    record->events.push_back(TraceEvent{"execution", record->start_ns, end_ns,
+                                        record->tid});
+    appendTraceEventsLocked(record->events);
+  }
+}
+
+void RalCallProfiler::record(const char* api_name, int64_t start_ns,
+                             int64_t end_ns) {
+  auto& executions = thread_executions_;
+  while (!executions.empty() && executions.back()->finished) {
+    executions.pop_back();
+  }
+  // Skips the executions of other contexts on the same thread.
+  ExecutionRecord* record = nullptr;
+  for (auto it = executions.rbegin(); it != executions.rend(); ++it) {
+    if (!(*it)->finished && (*it)->profiler == this) {
+      record = it->get();
+      break;
+    }
+  }
+  if (record) {
+    record->stats[api_name].record(end_ns - start_ns);
+    if (trace_enabled_) {
+      record->events.push_back(
+          TraceEvent{api_name, start_ns, end_ns, record->tid});
+    }
+    return;
+  }
+  // Not inside an execution of this context, e.g. called by another thread.
+  std::lock_guard<std::mutex> l(mu_);
+  const char* name = interned_names_.insert(api_name).first->c_str();
+  cumulative_stats_[name].record(end_ns - start_ns);
+  if (trace_enabled_) {
+    appendTraceEventsLocked(
+        {TraceEvent{name, start_ns, end_ns, ThreadLocalIndex::Get()}});
+  }
+}
+
+const char* RalCallProfiler::intern(const std::string& api_name) {
+  std::lock_guard<std::mutex> l(mu_);
+  return interned_names_.insert(api_name).first->c_str();
+}
+
+void RalCallProfiler::appendTraceEventsLocked(
+    const std::vector<TraceEvent>& events) {
+  size_t capacity =
+      max_trace_events_ - std::min(max_trace_events_, trace_events_.size());
+  size_t num_kept = std::min(events.size(), capacity);
+  trace_events_.insert(trace_events_.end(), events.begin(),
+                       events.begin() + num_kept);
+  num_dropped_trace_events_ += events.size() - num_kept;
+}
+
+void RalCallProfiler::dumpJson(std::ostream& out) {
+  std::lock_guard<std::mutex> l(mu_);
+  out << "{\n";
+  out << "  \"executions\": {";
+  dumpStatsJson(out, execution_stats_);
+  out << "},\n";
+  dumpApiStatsJson(out, cumulative_stats_, "  ");
+  out << ",\n  \"last_execution\": {\n";
+  out << "    \"execution\": {";
+  dumpStatsJson(out, last_execution_stats_);
+  out << "},\n";
+  dumpApiStatsJson(out, last_execution_api_stats_, "    ");
+  out << "\n  }\n}\n";
+}
+
+void RalCallProfiler::dumpChromeTrace(std::ostream& out) {
+  std::lock_guard<std::mutex> l(mu_);
+  out << "{\"displayTimeUnit\": \"ns\", \"otherData\": {\"dropped_events\": "
+      << num_dropped_trace_events_ << "}, \"traceEvents\": [";
+  int64_t base_ns = trace_events_.empty() ? 0 : trace_events_[0].start_ns;
+  for (const auto& event : trace_events_) {
+    base_ns = std::min(base_ns, event.start_ns);
+  }
+  for (size_t i = 0; i < trace_events_.size(); ++i) {
+    const auto& event = trace_events_[i];
+    out << (i ? ",\n" : "\n") << "{\"name\": " << quoted(event.name)
+        << ", \"cat\": \"ral\", \"ph\": \"X\", \"pid\": 0, \"tid\": "
+        << event.tid << ", \"ts\": " << toUs(event.start_ns - base_ns)
+        << ", \"dur\": " << toUs(event.end_ns - event.start_ns) << "}";
+  }
+  out << "\n]}\n";
+}
+
+void RalCallProfiler::reset() {
+  std::lock_guard<std::mutex> l(mu_);
+  execution_stats_ = RalCallStats();
+  last_execution_stats_ = RalCallStats();
+  cumulative_stats_.clear();
+  last_execution_api_stats_.clear();
+  trace_events_.clear();
+  num_dropped_trace_events_ = 0;
+}
+
+}  // namespace ral
+}  // namespace tao
@@ -0,0 +1,157 @@
+// Copyright 2022 The BladeDISC Authors. All rights reserved.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RAL_RAL_PROFILER_H_
+#define RAL_RAL_PROFILER_H_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace tao {
+namespace ral {
+
+class ExecutionContext;
+
+// Latency statistics of the calls to one RAL api.
+struct RalCallStats {
+  // Bucket 0 counts the calls taking less than 1us, bucket i (i > 0) counts
+  // the calls taking [2^(i-1), 2^i) us, and the last bucket counts the rest.
+  static constexpr const int kNumBuckets = 24;
+
+  int64_t count = 0;
+  int64_t total_ns = 0;
+  int64_t min_ns = 0;
+  int64_t max_ns = 0;
+  std::array<int64_t, kNumBuckets> histogram{};
+
+  void record(int64_t ns);
+  void merge(const RalCallStats& other);
+};
+
+// Records the latency of each RAL api called through `Context::call`, both
+// per execution and cumulatively. Enabled by the following env vars:
+//  - `DISC_RAL_ENABLE_CALL_PROFILE`: enables the profiler.
+//  - `DISC_RAL_CALL_PROFILE_FILE`: enables the profiler, and dumps the
+//    statistics as json to the file when the context is destroyed.
+//  - `DISC_RAL_CALL_TRACE_FILE`: enables the profiler, records each call as a
+//    trace event, and dumps them in chrome trace format to the file when the
+//    context is destroyed. At most `DISC_RAL_CALL_TRACE_MAX_EVENTS` (1M by
+//    default) events are kept.
+class RalCallProfiler {
+ public:
+  // Returns true if the profiler is enabled by the env vars.
+  static bool enabled();
+
+  // Returns nullptr if the profiler is not enabled.
+  static std::unique_ptr<RalCallProfiler> create();
+
+  // Dumps the profile to the files specified by the env vars, if any.
+  ~RalCallProfiler();
+
+  // Disables copy and assignment methods.
+  RalCallProfiler(const RalCallProfiler& other) = delete;
+  RalCallProfiler& operator=(const RalCallProfiler& other) = delete;
+
+  static int64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  // The calls made on the thread during an execution are accounted to the
+  // execution.
+  void onExecutionStart(ExecutionContext* exec_ctx);
+  void onExecutionFinish(ExecutionContext* exec_ctx);
+
+  // Records a call to `api_name`. `api_name` should outlive the current
+  // execution, e.g. a name owned by the compiled module or returned by
+  // `intern`.
+  void record(const char* api_name, int64_t start_ns, int64_t end_ns);
+
+  // Returns a copy of `api_name` that lives as long as the profiler.
+  const char* intern(const std::string& api_name);
+
+  // Dumps the cumulative statistics, and the ones of the last execution, as
+  // json.
+  void dumpJson(std::ostream& out);
+
+  // Dumps the recorded calls and executions in chrome trace format, which can
+  // be loaded by `chrome://tracing` or perfetto.
+  void dumpChromeTrace(std::ostream& out);
+
+  // Clears all the statistics and trace events recorded so far.
+  void reset();
+
+  // Records the call to `api_name` during its lifetime.
+  class Scope {
+   public:
+    Scope(RalCallProfiler* profiler, const char* api_name)
+        : profiler_(profiler), api_name_(api_name), start_ns_(now()) {}
+    ~Scope() { profiler_->record(api_name_, start_ns_, now()); }
+
+   private:
+    RalCallProfiler* profiler_;
+    const char* api_name_;
+    int64_t start_ns_;
+  };
+
+ private:
+  struct TraceEvent {
+    const char* name;
+    int64_t start_ns;
+    int64_t end_ns;
+    int tid;
+  };
+
+  struct ExecutionRecord;
+
+  RalCallProfiler(std::string profile_file, std::string trace_file,
+                  size_t max_trace_events);
+
+  void appendTraceEventsLocked(const std::vector<TraceEvent>& events);
+
+  // The executions started on this thread and not finished yet (maybe of
+  // other contexts), the latest one is at the back.
+  static thread_local std::vector<std::shared_ptr<ExecutionRecord>>
+      thread_executions_;
+
+  std::string profile_file_;
+  std::string trace_file_;
+  bool trace_enabled_;
+  size_t max_trace_events_;
+
+  std::mutex mu_;
+  std::unordered_map<ExecutionContext*, std::shared_ptr<ExecutionRecord>>
+      executions_;
+  std::set<std::string> interned_names_;
+  // Statistics of the executions themselves, i.e. the wall time between
+  // `onExecutionStart` and `onExecutionFinish`.
+  RalCallStats execution_stats_;
+  RalCallStats last_execution_stats_;
+  std::map<std::string, RalCallStats> cumulative_stats_;
+  std::map<std::string, RalCallStats> last_execution_api_stats_;
+  std::vector<TraceEvent> trace_events_;
+  int64_t num_dropped_trace_events_ = 0;
+};
+
+}  // namespace ral
+}  // namespace tao
+
+#endif  // RAL_RAL_PROFILER_H_
@@ -0,0 +1,221 @@
+// Copyright 2022 The BladeDISC Authors. All rights reserved.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/mlir/xla/ral/ral_profiler.h"
+
+#include <stdlib.h>
+
+#include <sstream>
+#include <thread>
+
+#include "tensorflow/core/platform/test.h"
+
+namespace tao {
+namespace ral {
+namespace {
+
+// The profiler only uses the execution contexts as keys.
+ExecutionContext* fakeExecutionContext(int i) {
+  return reinterpret_cast<ExecutionContext*>(0x1000 + i * 0x10);
+}
+
+// Enables the profiler with tracing, which is decided once per process.
+std::unique_ptr<RalCallProfiler> createProfiler() {
+  std::string trace_file = ::testing::TempDir() + "/ral_call_trace.json";
+  setenv("DISC_RAL_CALL_TRACE_FILE", trace_file.c_str(), 1);
+  auto profiler = RalCallProfiler::create();
+  profiler->reset();
+  return profiler;
+}
+
+int64_t count(const std::string& s, const std::string& pattern) {
+  int64_t n = 0;
+  for (size_t pos = s.find(pattern); pos != std::string::npos;
+       pos = s.find(pattern, pos + pattern.size())) {
+    ++n;
+  }
+  return n;
+}
+
+TEST(RalCallStatsTest, RecordTest) {
+  RalCallStats stats;
+  stats.record(3000);
+  stats.record(1000);
+  stats.record(5000);
+  EXPECT_EQ(stats.count, 3);
+  EXPECT_EQ(stats.total_ns, 9000);
+  EXPECT_EQ(stats.min_ns, 1000);
+  EXPECT_EQ(stats.max_ns, 5000);
+}
+
+TEST(RalCallStatsTest, HistogramTest) {
+  RalCallStats stats;
+  // < 1us
+  stats.record(0);
+  stats.record(999);
+  // [1, 2) us
+  stats.record(1000);
+  stats.record(1999);
+  // [2, 4) us
+  stats.record(2000);
+  stats.record(3999);
+  // [4, 8) us
+  stats.record(4000);
+  // Too long for the buckets in between.
+  stats.record(int64_t(1) << 50);
+  EXPECT_EQ(stats.histogram[0], 2);
+  EXPECT_EQ(stats.histogram[1], 2);
+  EXPECT_EQ(stats.histogram[2], 2);
+  EXPECT_EQ(stats.histogram[3], 1);
+  EXPECT_EQ(stats.histogram[RalCallStats::kNumBuckets - 1], 1);
+  int64_t total = 0;
+  for (int64_t n : stats.histogram) total += n;
+  EXPECT_EQ(total, stats.count);
+}
+
+TEST(RalCallStatsTest, MergeTest) {
+  RalCallStats a, b, empty;
+  a.record(2000);
+  b.record(500);
+  b.record(8000);
+  a.merge(empty);
+  EXPECT_EQ(a.count, 1);
+  a.merge(b);
+  EXPECT_EQ(a.count, 3);
+  EXPECT_EQ(a.total_ns, 10500);
+  EXPECT_EQ(a.min_ns, 500);
+  EXPECT_EQ(a.max_ns, 8000);
+  EXPECT_EQ(a.histogram[0], 1);
+  EXPECT_EQ(a.histogram[2], 1);
+  EXPECT_EQ(a.histogram[4], 1);
+
+  // Merging into empty stats takes the min of the other.
+  empty.merge(b);
+  EXPECT_EQ(empty.min_ns, 500);
+}
+
+TEST(RalCallProfilerTest, MultiThreadMergeTest) {
+  auto profiler = createProfiler();
+  ASSERT_NE(profiler, nullptr);
+  constexpr int kNumThreads = 4;
+  constexpr int kNumCalls = 100;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&, i]() {
+      ExecutionContext* exec_ctx = fakeExecutionContext(i);
+      profiler->onExecutionStart(exec_ctx);
+      for (int j = 0; j < kNumCalls; ++j) {
+        profiler->record("ral_gemm", 0, 1000);
+      }
+      profiler->onExecutionFinish(exec_ctx);
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  // Not inside an execution.
+  profiler->record("ral_alloc", 0, 3000);
+
+  std::ostringstream json;
+  profiler->dumpJson(json);
+  std::string s = json.str();
+  EXPECT_NE(s.find("\"executions\": {\"count\": 4,"), std::string::npos) << s;
+  EXPECT_NE(s.find("{\"name\": \"ral_gemm\", \"count\": 400,"),
+            std::string::npos)
+      << s;
+  EXPECT_NE(s.find("{\"name\": \"ral_alloc\", \"count\": 1,"),
+            std::string::npos)
+      << s;
+  // The last execution only has the calls of itself.
+  std::string last = s.substr(s.find("\"last_execution\""));
+  EXPECT_NE(last.find("{\"name\": \"ral_gemm\", \"count\": 100,"),
+            std::string::npos)
+      << s;
+  EXPECT_EQ(last.find("ral_alloc"), std::string::npos) << s;
+}
+
+TEST(RalCallProfilerTest, JsonFormatTest) {
+  auto profiler = createProfiler();
+  ExecutionContext* exec_ctx = fakeExecutionContext(0);
+  profiler->onExecutionStart(exec_ctx);
+  // A name owned by the module is copied when the execution finishes.
+  std::string name = "ral_\"quoted\"";
+  profiler->record(name.c_str(), 0, 1000);
+  profiler->record(name.c_str(), 0, 3000);
+  profiler->record("ral_gemm", 0, 8000);
+  profiler->onExecutionFinish(exec_ctx);
+  name.assign(name.size(), ' ');
+
+  std::ostringstream json;
+  profiler->dumpJson(json);
+  std::string s = json.str();
+  // The apis spending more time go first.
+  size_t gemm = s.find("{\"name\": \"ral_gemm\", \"count\": 1, "
+                       "\"total_us\": 8, \"avg_us\": 8, \"min_us\": 8, "
+                       "\"max_us\": 8, \"histogram_us\": "
+                       "[{\"lt\": 16, \"count\": 1}]}");
+  size_t quoted = s.find(
+      "{\"name\": \"ral_\\\"quoted\\\"\", \"count\": 2, \"total_us\": 4, "
+      "\"avg_us\": 2, \"min_us\": 1, \"max_us\": 3, \"histogram_us\": "
+      "[{\"lt\": 2, \"count\": 1}, {\"lt\": 4, \"count\": 1}]}");
+  ASSERT_NE(gemm, std::string::npos) << s;
+  ASSERT_NE(quoted, std::string::npos) << s;
+  EXPECT_LT(gemm, quoted);
+  EXPECT_NE(s.find("\"ral_call_total_us\": 12,"), std::string::npos) << s;
+  EXPECT_EQ(s.front(), '{');
+  EXPECT_EQ(count(s, "{"), count(s, "}"));
+  EXPECT_EQ(count(s, "["), count(s, "]"));
+
+  // The last bucket has no upper bound.
+  profiler->reset();
+  profiler->record("ral_slow", 0, int64_t(1) << 50);
+  std::ostringstream slow;
+  profiler->dumpJson(slow);
+  EXPECT_NE(slow.str().find("[{\"lt\": \"inf\", \"count\": 1}]"),
+            std::string::npos)
+      << slow.str();
+}
+
+TEST(RalCallProfilerTest, ChromeTraceFormatTest) {
+  auto profiler = createProfiler();
+  ExecutionContext* exec_ctx = fakeExecutionContext(0);
+  profiler->onExecutionStart(exec_ctx);
+  int64_t start = RalCallProfiler::now();
+  profiler->record("ral_gemm", start, start + 2000);
+  profiler->onExecutionFinish(exec_ctx);
+
+  std::ostringstream trace;
+  profiler->dumpChromeTrace(trace);
+  std::string s = trace.str();
+  EXPECT_EQ(s.find("{\"displayTimeUnit\": \"ns\", \"otherData\": "
+                   "{\"dropped_events\": 0}, \"traceEvents\": ["),
+            0u)
+      << s;
+  EXPECT_NE(s.find("{\"name\": \"ral_gemm\", \"cat\": \"ral\", \"ph\": \"X\", "
+                   "\"pid\": 0, \"tid\": "),
+            std::string::npos)
+      << s;
+  EXPECT_NE(s.find(", \"dur\": 2}"), std::string::npos) << s;
+  EXPECT_NE(s.find("{\"name\": \"execution\", \"cat\": \"ral\""),
+            std::string::npos)
+      << s;
+  // The timestamps are relative to the earliest event.
+  EXPECT_NE(s.find("\"ts\": 0,"), std::string::npos) << s;
+  EXPECT_EQ(count(s, "\"ph\": \"X\""), 2);
+  EXPECT_EQ(s.substr(s.size() - 4), "\n]}\n");
+
+  profiler->reset();
+  std::ostringstream empty;
+  profiler->dumpChromeTrace(empty);
+  EXPECT_EQ(count(empty.str(), "\"ph\""), 0);
+}
+
+}  // namespace
+}  // namespace ral
+}  // namespace tao
@@ -0,0 +1,200 @@
+//===- ral_shape_bucketing.cc ----------------------===//
+//
+// Copyright 2022 The PAI Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "tensorflow/compiler/mlir/xla/ral/ral_shape_bucketing.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+namespace tao {
+namespace ral {
+
+namespace {
+
+bool parseIntList(const std::string& str, std::vector<int64_t>* values) {
+  std::stringstream ss(str);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    char* end = nullptr;
+    long long value = std::strtoll(item.c_str(), &end, 10);
+    if (item.empty() || *end != '\0' || value < 0) return false;
+    values->push_back(value);
+  }
+  return !values->empty();
+}
+
+// Parses `<output>.<dim>=<bucketed dim>`.
+bool parseOutputDim(const std::string& str, int64_t* output, int64_t* dim,
+                    int64_t* bucketed_dim) {
+  auto dot = str.find('.');
+  auto eq = str.find('=');
+  if (dot == std::string::npos || eq == std::string::npos || eq < dot) {
+    return false;
+  }
+  std::vector<int64_t> values;
+  if (!parseIntList(str.substr(0, dot), &values) ||
+      !parseIntList(str.substr(dot + 1, eq - dot - 1), &values) ||
+      !parseIntList(str.substr(eq + 1), &values) || values.size() != 3) {
+    return false;
+  }
+  *output = values[0];
+  *dim = values[1];
+  *bucketed_dim = values[2];
+  return true;
+}
+
+}  // namespace
+
+/* static */ std::unique_ptr<ShapeBucketingPolicy> ShapeBucketingPolicy::parse(
+    const std::string& spec, std::string* error) {
+  std::unique_ptr<ShapeBucketingPolicy> policy(new ShapeBucketingPolicy);
+  auto outputs_pos = spec.find(';');
+  std::string inputs = spec.substr(0, outputs_pos);
+  std::string outputs =
+      outputs_pos == std::string::npos ? "" : spec.substr(outputs_pos + 1);
+  auto pos = inputs.find(':');
+  std::string dims = inputs.substr(0, pos);
+  std::string buckets = pos == std::string::npos ? "" : inputs.substr(pos + 1);
+  if (!parseIntList(dims, &policy->dims_)) {
+    if (error) *error = "invalid dims in shape bucketing spec: " + spec;
+    return nullptr;
+  }
+  std::sort(policy->dims_.begin(), policy->dims_.end());
+  policy->dims_.erase(std::unique(policy->dims_.begin(), policy->dims_.end()),
+                      policy->dims_.end());
+
+  if (!buckets.empty() && buckets != "pow2" &&
+      (!parseIntList(buckets, &policy->buckets_) ||
+       !std::is_sorted(policy->buckets_.begin(), policy->buckets_.end(),
+                       std::less_equal<int64_t>()) ||
+       policy->buckets_.front() == 0)) {
+    if (error) *error = "invalid buckets in shape bucketing spec: " + spec;
+    return nullptr;
+  }
+
+  std::stringstream ss(outputs);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    int64_t output, dim, bucketed_dim;
+    if (!parseOutputDim(item, &output, &dim, &bucketed_dim) ||
+        !std::binary_search(policy->dims_.begin(), policy->dims_.end(),
+                            bucketed_dim)) {
+      if (error) *error = "invalid outputs in shape bucketing spec: " + spec;
+      return nullptr;
+    }
+    policy->output_dims_[output].emplace_back(dim, bucketed_dim);
+  }
+  return policy;
+}
+
+int64_t ShapeBucketingPolicy::getBucketSize(int64_t size) const {
+  if (size <= 0) return size;
+  if (buckets_.empty()) {
+    int64_t bucket = 1;
+    while (bucket < size) bucket <<= 1;
+    return bucket;
+  }
+  auto it = std::lower_bound(buckets_.begin(), buckets_.end(), size);
+  if (it != buckets_.end()) return *it;
+  int64_t last = buckets_.back();
+  return (size + last - 1) / last * last;
+}
+
+bool ShapeBucketingPolicy::bucketShape(const std::vector<int64_t>& shape,
+                                       std::vector<int64_t>* padded_shape,
+                                       BucketedDims* dims) const {
+  *padded_shape = shape;
+  for (int64_t dim : dims_) {
+    if (dim >= static_cast<int64_t>(shape.size())) break;
+    int64_t size = shape[dim];
+    auto it = dims->find(dim);
+    if (it != dims->end()) {
+      if (it->second.size != size) return false;
+    } else {
+      dims->emplace(dim, BucketedDim{size, getBucketSize(size)});
+    }
+    (*padded_shape)[dim] = dims->at(dim).padded_size;
+  }
+  return true;
+}
+
+bool ShapeBucketingPolicy::getSlicedShape(
+    int64_t output_idx, const std::vector<int64_t>& padded_shape,
+    const BucketedDims& dims, std::vector<int64_t>* shape) const {
+  *shape = padded_shape;
+  auto output_it = output_dims_.find(output_idx);
+  if (output_it == output_dims_.end()) return true;
+  for (auto& pair : output_it->second) {
+    int64_t dim = pair.first;
+    auto it = dims.find(pair.second);
+    // No input has the bucketed dim, thus nothing is padded.
+    if (it == dims.end()) continue;
+    if (dim >= static_cast<int64_t>(shape->size()) ||
+        (*shape)[dim] != it->second.padded_size) {
+      return false;
+    }
+    (*shape)[dim] = it->second.size;
+  }
+  return true;
+}
+
+void forEachSharedChunk(
+    const std::vector<int64_t>& src_shape,
+    const std::vector<int64_t>& dst_shape, int64_t elem_bytes,
+    const std::function<void(int64_t, int64_t, int64_t)>& copy) {
+  int rank = src_shape.size();
+  std::vector<int64_t> extents(rank);
+  for (int i = 0; i < rank; ++i) {
+    extents[i] = std::min(src_shape[i], dst_shape[i]);
+    if (extents[i] <= 0) return;
+  }
+  // Dims after the last differing one are copied as a whole.
+  int last = rank - 1;
+  while (last >= 0 && src_shape[last] == dst_shape[last]) --last;
+  if (last < 0) {
+    int64_t bytes = elem_bytes;
+    for (int64_t extent : extents) bytes *= extent;
+    copy(0, 0, bytes);
+    return;
+  }
+
+  std::vector<int64_t> src_strides(rank), dst_strides(rank);
+  int64_t src_stride = elem_bytes, dst_stride = elem_bytes;
+  for (int i = rank - 1; i >= 0; --i) {
+    src_strides[i] = src_stride;
+    dst_strides[i] = dst_stride;
+    src_stride *= src_shape[i];
+    dst_stride *= dst_shape[i];
+  }
+  int64_t chunk_bytes = extents[last] * src_strides[last];
+  std::vector<int64_t> index(last, 0);
+  while (true) {
+    int64_t src_offset = 0, dst_offset = 0;
+    for (int i = 0; i < last; ++i) {
+      src_offset += index[i] * src_strides[i];
+      dst_offset += index[i] * dst_strides[i];
+    }
+    copy(dst_offset, src_offset, chunk_bytes);
+    int i = last - 1;
+    while (i >= 0 && ++index[i] == extents[i]) index[i--] = 0;
+    if (i < 0) break;
+  }
+}
+
+}  // namespace ral
+}  // namespace tao
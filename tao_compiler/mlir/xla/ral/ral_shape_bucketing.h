@@ -0,0 +1,107 @@
+//===- ral_shape_bucketing.h ----------------------===//
+//
+// Copyright 2022 The PAI Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#ifndef RAL_RAL_SHAPE_BUCKETING_H_
+#define RAL_RAL_SHAPE_BUCKETING_H_
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tao {
+namespace ral {
+
+// The original and the padded size of a bucketed dim.
+struct BucketedDim {
+  int64_t size;
+  int64_t padded_size;
+};
+
+// Maps the index of a bucketed dim to its sizes, shared by all the inputs of
+// a call.
+using BucketedDims = std::map<int64_t, BucketedDim>;
+
+// Rounds the designated dims of the inputs (e.g. the sequence length of NLP
+// models) up to a small set of sizes, thus a few static-shape executables
+// cover all the shapes seen at runtime. The inputs are padded with zeros and
+// the outputs are sliced back to the original sizes by the runtime.
+//
+// It is only correct for models whose valid outputs do not depend on the
+// padded elements (e.g. the padded tokens are masked out), thus it is opt-in.
+class ShapeBucketingPolicy {
+ public:
+  // Parses a spec of the form `<dims>[:<buckets>][;<outputs>]`, where `dims`
+  // is a comma separated list of the dim indices to bucket, and `buckets` is
+  // either `pow2` (the default) or an increasing comma separated list of sizes.
+  // Sizes larger than the last bucket are rounded up to a multiple of it.
+  // `outputs` is a comma separated list of `<output>.<dim>=<bucketed dim>`,
+  // each of which designates a dim of an output that has the size of a
+  // bucketed dim of the inputs, thus is sliced back. Outputs not listed are
+  // returned as is. e.g. `1;0.1=1`, `0,1:pow2;0.0=0,0.1=1` or
+  // `1:32,64,128,256;0.1=1,1.2=1`.
+  // Returns nullptr and sets `error` if the spec is invalid.
+  static std::unique_ptr<ShapeBucketingPolicy> parse(const std::string& spec,
+                                                     std::string* error);
+
+  // Returns the size `size` is rounded up to.
+  int64_t getBucketSize(int64_t size) const;
+
+  // Sets `padded_shape` to `shape` with the designated dims rounded up, and
+  // records the designated dims into `dims`. Returns false if a designated
+  // dim differs from the same dim of an input recorded before, in which case
+  // the outputs can not be sliced unambiguously and the call should not be
+  // bucketed.
+  bool bucketShape(const std::vector<int64_t>& shape,
+                   std::vector<int64_t>* padded_shape,
+                   BucketedDims* dims) const;
+
+  // Sets `shape` to the shape of the `output_idx`-th output, whose shape is
+  // `padded_shape`, with the padding sliced off, i.e. each dim designated by
+  // the spec is restored to the original size of its bucketed dim. Returns
+  // false if a designated dim does not have the padded size, in which case
+  // the output does not follow the spec.
+  bool getSlicedShape(int64_t output_idx,
+                      const std::vector<int64_t>& padded_shape,
+                      const BucketedDims& dims,
+                      std::vector<int64_t>* shape) const;
+
+  const std::vector<int64_t>& getDims() const { return dims_; }
+
+ private:
+  std::vector<int64_t> dims_;
+  // Empty for rounding up to powers of two.
+  std::vector<int64_t> buckets_;
+  // Maps the index of an output to the <dim, bucketed dim> pairs to slice.
+  std::map<int64_t, std::vector<std::pair<int64_t, int64_t>>> output_dims_;
+};
+
+// Calls `copy(dst_offset, src_offset, bytes)` for each contiguous chunk of the
+// region shared by two row-major buffers of `src_shape` and `dst_shape`, which
+// have the same rank. Offsets are in bytes. It is used to copy an input into
+// its padded buffer and an output out of its padded buffer.
+void forEachSharedChunk(
+    const std::vector<int64_t>& src_shape,
+    const std::vector<int64_t>& dst_shape, int64_t elem_bytes,
+    const std::function<void(int64_t, int64_t, int64_t)>& copy);
+
+}  // namespace ral
+}  // namespace tao
+
+#endif  // RAL_RAL_SHAPE_BUCKETING_H_
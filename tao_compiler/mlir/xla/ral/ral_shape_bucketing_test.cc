@@ -0,0 +1,118 @@
+// Copyright 2022 The BladeDISC Authors. All rights reserved.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/mlir/xla/ral/ral_shape_bucketing.h"
+
+#include <cstring>
+
+#include "tensorflow/core/platform/test.h"
+
+namespace tao {
+namespace ral {
+
+TEST(ShapeBucketingPolicyTest, ParseTest) {
+  std::string error;
+  EXPECT_NE(ShapeBucketingPolicy::parse("1", &error), nullptr);
+  EXPECT_NE(ShapeBucketingPolicy::parse("0,1:pow2", &error), nullptr);
+  EXPECT_NE(ShapeBucketingPolicy::parse("1:32,64,128", &error), nullptr);
+  EXPECT_NE(ShapeBucketingPolicy::parse("1;0.1=1", &error), nullptr);
+  EXPECT_NE(ShapeBucketingPolicy::parse("0,1:pow2;0.0=0,1.2=1", &error),
+            nullptr);
+  EXPECT_EQ(ShapeBucketingPolicy::parse("", &error), nullptr);
+  EXPECT_EQ(ShapeBucketingPolicy::parse("a", &error), nullptr);
+  EXPECT_EQ(ShapeBucketingPolicy::parse("1:64,32", &error), nullptr);
+  EXPECT_EQ(ShapeBucketingPolicy::parse("1:0,32", &error), nullptr);
+  // The output dims must follow a bucketed dim.
+  EXPECT_EQ(ShapeBucketingPolicy::parse("1;0.1=0", &error), nullptr);
+  EXPECT_EQ(ShapeBucketingPolicy::parse("1;0.1", &error), nullptr);
+  EXPECT_EQ(ShapeBucketingPolicy::parse("1;0=1", &error), nullptr);
+  EXPECT_FALSE(error.empty());
+}
+
+TEST(ShapeBucketingPolicyTest, BucketSizeTest) {
+  auto pow2 = ShapeBucketingPolicy::parse("1", nullptr);
+  EXPECT_EQ(pow2->getBucketSize(0), 0);
+  EXPECT_EQ(pow2->getBucketSize(1), 1);
+  EXPECT_EQ(pow2->getBucketSize(3), 4);
+  EXPECT_EQ(pow2->getBucketSize(64), 64);
+  EXPECT_EQ(pow2->getBucketSize(65), 128);
+
+  auto buckets = ShapeBucketingPolicy::parse("1:32,64,128", nullptr);
+  EXPECT_EQ(buckets->getBucketSize(1), 32);
+  EXPECT_EQ(buckets->getBucketSize(64), 64);
+  EXPECT_EQ(buckets->getBucketSize(100), 128);
+  EXPECT_EQ(buckets->getBucketSize(129), 256);
+  EXPECT_EQ(buckets->getBucketSize(300), 384);
+}
+
+TEST(ShapeBucketingPolicyTest, BucketShapeTest) {
+  auto policy = ShapeBucketingPolicy::parse("1;0.1=1,1.0=1", nullptr);
+  BucketedDims dims;
+  std::vector<int64_t> padded;
+  ASSERT_TRUE(policy->bucketShape({2, 5}, &padded, &dims));
+  EXPECT_EQ(padded, std::vector<int64_t>({2, 8}));
+  ASSERT_TRUE(policy->bucketShape({2, 5, 3}, &padded, &dims));
+  EXPECT_EQ(padded, std::vector<int64_t>({2, 8, 3}));
+  // Inputs without the designated dim are left untouched.
+  ASSERT_TRUE(policy->bucketShape({2}, &padded, &dims));
+  EXPECT_EQ(padded, std::vector<int64_t>({2}));
+  // The same dim of another input has a different size.
+  EXPECT_FALSE(policy->bucketShape({2, 6}, &padded, &dims));
+
+  std::vector<int64_t> sliced;
+  ASSERT_TRUE(policy->getSlicedShape(0, {2, 8, 8}, dims, &sliced));
+  EXPECT_EQ(sliced, std::vector<int64_t>({2, 5, 8}));
+  // The designated dim of an output may sit at another index.
+  ASSERT_TRUE(policy->getSlicedShape(1, {8, 8}, dims, &sliced));
+  EXPECT_EQ(sliced, std::vector<int64_t>({5, 8}));
+  // Outputs not designated are left untouched, even if a dim has the padded
+  // size.
+  ASSERT_TRUE(policy->getSlicedShape(2, {2, 8}, dims, &sliced));
+  EXPECT_EQ(sliced, std::vector<int64_t>({2, 8}));
+  // The designated dim does not have the padded size.
+  EXPECT_FALSE(policy->getSlicedShape(0, {2, 16}, dims, &sliced));
+  EXPECT_FALSE(policy->getSlicedShape(0, {8}, dims, &sliced));
+  // Nothing is sliced if no input has the bucketed dim.
+  ASSERT_TRUE(policy->getSlicedShape(0, {2, 16}, BucketedDims(), &sliced));
+  EXPECT_EQ(sliced, std::vector<int64_t>({2, 16}));
+}
+
+TEST(ShapeBucketingPolicyTest, SharedChunkTest) {
+  // Pads a 2x3 matrix to 4x4 and slices it back.
+  std::vector<int> src = {1, 2, 3, 4, 5, 6};
+  std::vector<int> padded(16, 0);
+  auto pad = [&](int64_t dst_offset, int64_t src_offset, int64_t bytes) {
+    std::memcpy(reinterpret_cast<char*>(padded.data()) + dst_offset,
+                reinterpret_cast<char*>(src.data()) + src_offset, bytes);
+  };
+  forEachSharedChunk({2, 3}, {4, 4}, sizeof(int), pad);
+  EXPECT_EQ(padded, std::vector<int>({1, 2, 3, 0, 4, 5, 6, 0, 0, 0, 0, 0, 0,
+                                      0, 0, 0}));
+
+  std::vector<int> sliced(6, 0);
+  int num_chunks = 0;
+  auto slice = [&](int64_t dst_offset, int64_t src_offset, int64_t bytes) {
+    std::memcpy(reinterpret_cast<char*>(sliced.data()) + dst_offset,
+                reinterpret_cast<char*>(padded.data()) + src_offset, bytes);
+    ++num_chunks;
+  };
+  forEachSharedChunk({4, 4}, {2, 3}, sizeof(int), slice);
+  EXPECT_EQ(sliced, src);
+  EXPECT_EQ(num_chunks, 2);
+
+  // Only the leading dim differs, copied in a single chunk.
+  num_chunks = 0;
+  forEachSharedChunk({4, 4}, {1, 4}, sizeof(int), slice);
+  EXPECT_EQ(num_chunks, 1);
+}
+
+}  // namespace ral
+}  // namespace tao
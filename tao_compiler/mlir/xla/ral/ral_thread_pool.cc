@@ -0,0 +1,157 @@
+//===- ral_thread_pool.cc ----------------------===//
+//
+// Copyright 2022 The PAI Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "tensorflow/compiler/mlir/xla/ral/ral_thread_pool.h"
+
+#include <algorithm>
+
+namespace tao {
+namespace ral {
+
+namespace {
+
+thread_local bool tInWorkerThread = false;
+
+}  // namespace
+
+// A parallel loop. Each queue entry of a job is a helper that claims and runs
+// the tasks of the loop until none is left.
+struct WorkStealingThreadPool::Job {
+  const std::function<void(int64_t)>* fn;
+  int64_t numTasks;
+  std::atomic<int64_t> next{0};
+  std::atomic<int64_t> numDone{0};
+  std::mutex mu;
+  std::condition_variable cv;
+};
+
+WorkStealingThreadPool::WorkStealingThreadPool(int numWorkers) {
+  numWorkers = std::max(numWorkers, 0);
+  for (int i = 0; i < numWorkers; ++i) {
+    queues_.emplace_back(new WorkerQueue);
+  }
+  for (int i = 0; i < numWorkers; ++i) {
+    workers_.emplace_back([this, i]() { workerLoop(i); });
+  }
+}
+
+WorkStealingThreadPool::~WorkStealingThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+/* static */ bool WorkStealingThreadPool::inWorkerThread() {
+  return tInWorkerThread;
+}
+
+void WorkStealingThreadPool::parallelFor(
+    int64_t numTasks, int maxConcurrency,
+    const std::function<void(int64_t)>& fn) {
+  if (numTasks <= 0) return;
+  int64_t numHelpers =
+      std::min<int64_t>(numWorkers(), maxConcurrency > 0 ? maxConcurrency - 1
+                                                         : numWorkers());
+  numHelpers = std::min(numHelpers, numTasks - 1);
+  // Nested loops run inline, thus the pool never waits on itself.
+  if (numHelpers <= 0 || inWorkerThread()) {
+    for (int64_t i = 0; i < numTasks; ++i) fn(i);
+    return;
+  }
+
+  auto job = std::make_shared<Job>();
+  job->fn = &fn;
+  job->numTasks = numTasks;
+  unsigned start = nextQueue_.fetch_add(numHelpers);
+  for (int64_t i = 0; i < numHelpers; ++i) {
+    push((start + i) % numWorkers(), job);
+  }
+
+  // The calling thread works on the loop as well.
+  runJob(job.get());
+  std::unique_lock<std::mutex> lock(job->mu);
+  job->cv.wait(lock, [&]() { return job->numDone.load() == numTasks; });
+}
+
+/* static */ void WorkStealingThreadPool::runJob(Job* job) {
+  int64_t numDone = 0;
+  for (int64_t i = job->next++; i < job->numTasks; i = job->next++) {
+    (*job->fn)(i);
+    ++numDone;
+  }
+  if (numDone == 0) return;
+  if (job->numDone.fetch_add(numDone) + numDone == job->numTasks) {
+    // Notifies under the lock, thus the waiter can not miss it.
+    std::lock_guard<std::mutex> lock(job->mu);
+    job->cv.notify_all();
+  }
+}
+
+void WorkStealingThreadPool::push(int id, std::shared_ptr<Job> job) {
+  {
+    std::lock_guard<std::mutex> lock(queues_[id]->mu);
+    queues_[id]->jobs.push_back(std::move(job));
+  }
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    ++numQueued_;
+  }
+  cv_.notify_one();
+}
+
+std::shared_ptr<WorkStealingThreadPool::Job>
+WorkStealingThreadPool::popOrSteal(int id) {
+  int n = numWorkers();
+  for (int i = 0; i < n; ++i) {
+    auto& queue = *queues_[(id + i) % n];
+    std::lock_guard<std::mutex> lock(queue.mu);
+    if (queue.jobs.empty()) continue;
+    std::shared_ptr<Job> job;
+    // Takes the oldest entry of its own queue, and the newest one of others.
+    if (i == 0) {
+      job = std::move(queue.jobs.front());
+      queue.jobs.pop_front();
+    } else {
+      job = std::move(queue.jobs.back());
+      queue.jobs.pop_back();
+    }
+    --numQueued_;
+    return job;
+  }
+  return nullptr;
+}
+
+void WorkStealingThreadPool::workerLoop(int id) {
+  tInWorkerThread = true;
+  while (true) {
+    if (auto job = popOrSteal(id)) {
+      runJob(job.get());
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mu_);
+    cv_.wait(lock, [&]() { return stop_ || numQueued_.load() > 0; });
+    if (stop_ && numQueued_.load() == 0) return;
+  }
+}
+
+}  // namespace ral
+}  // namespace tao
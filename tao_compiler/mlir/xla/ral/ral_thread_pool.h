@@ -0,0 +1,82 @@
+//===- ral_thread_pool.h ----------------------===//
+//
+// Copyright 2022 The PAI Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#ifndef RAL_RAL_THREAD_POOL_H_
+#define RAL_RAL_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tao {
+namespace ral {
+
+// A fixed size thread pool to run parallel loops. Each worker has its own
+// queue and steals from the queues of the other workers when its own one is
+// empty, thus the loops submitted by concurrent callers share the workers
+// instead of each creating a team of threads.
+class WorkStealingThreadPool {
+ public:
+  explicit WorkStealingThreadPool(int numWorkers);
+  ~WorkStealingThreadPool();
+
+  int numWorkers() const { return queues_.size(); }
+
+  // Calls `fn(i)` for each i in [0, numTasks), and returns when all the calls
+  // finish. At most `maxConcurrency` threads, including the calling thread,
+  // work on the loop at the same time. Tasks are claimed one by one, thus a
+  // loop split into more tasks than threads is balanced dynamically.
+  // Loops issued from a worker of the pool run on the calling thread.
+  void parallelFor(int64_t numTasks, int maxConcurrency,
+                   const std::function<void(int64_t)>& fn);
+
+  // Returns true if the calling thread is a worker of any pool.
+  static bool inWorkerThread();
+
+ private:
+  struct Job;
+
+  struct WorkerQueue {
+    std::mutex mu;
+    std::deque<std::shared_ptr<Job>> jobs;
+  };
+
+  void workerLoop(int id);
+  void push(int id, std::shared_ptr<Job> job);
+  std::shared_ptr<Job> popOrSteal(int id);
+  static void runJob(Job* job);
+
+  std::vector<std::unique_ptr<WorkerQueue>> queues_;
+  std::vector<std::thread> workers_;
+  std::atomic<unsigned> nextQueue_{0};
+
+  // Guards sleeping and waking up the idle workers.
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::atomic<int64_t> numQueued_{0};
+  bool stop_ = false;
+};
+
+}  // namespace ral
+}  // namespace tao
+
+#endif  // RAL_RAL_THREAD_POOL_H_
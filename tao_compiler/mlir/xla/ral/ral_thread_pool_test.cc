@@ -0,0 +1,62 @@
+// Copyright 2022 The BladeDISC Authors. All rights reserved.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/mlir/xla/ral/ral_thread_pool.h"
+
+#include <set>
+
+#include "tensorflow/core/platform/test.h"
+
+namespace tao {
+namespace ral {
+
+TEST(WorkStealingThreadPoolTest, ParallelForTest) {
+  WorkStealingThreadPool pool(3);
+  EXPECT_EQ(pool.numWorkers(), 3);
+  std::vector<int> counts(1000, 0);
+  pool.parallelFor(counts.size(), 0, [&](int64_t i) { ++counts[i]; });
+  for (int count : counts) {
+    EXPECT_EQ(count, 1);
+  }
+  // Empty loops return immediately.
+  pool.parallelFor(0, 0, [&](int64_t i) { ++counts[i]; });
+}
+
+TEST(WorkStealingThreadPoolTest, MaxConcurrencyTest) {
+  WorkStealingThreadPool pool(4);
+  std::mutex mu;
+  std::set<std::thread::id> threads;
+  pool.parallelFor(64, 1, [&](int64_t i) {
+    std::lock_guard<std::mutex> lock(mu);
+    threads.insert(std::this_thread::get_id());
+  });
+  EXPECT_EQ(threads.size(), 1);
+  EXPECT_EQ(*threads.begin(), std::this_thread::get_id());
+}
+
+TEST(WorkStealingThreadPoolTest, ConcurrentAndNestedTest) {
+  WorkStealingThreadPool pool(2);
+  std::atomic<int64_t> sum{0};
+  std::vector<std::thread> callers;
+  for (int t = 0; t < 4; ++t) {
+    callers.emplace_back([&]() {
+      pool.parallelFor(16, 0, [&](int64_t i) {
+        pool.parallelFor(4, 0, [&](int64_t j) { sum += i * 4 + j; });
+      });
+    });
+  }
+  for (auto& caller : callers) caller.join();
+  EXPECT_EQ(sum.load(), 4 * (64 * 63 / 2));
+  EXPECT_FALSE(WorkStealingThreadPool::inWorkerThread());
+}
+
+}  // namespace ral
+}  // namespace tao